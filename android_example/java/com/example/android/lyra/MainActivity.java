@@ -293,6 +293,10 @@ public class MainActivity extends AppCompatActivity {
    */
   public native String lyraBenchmark(int numCondVectors, String modelBasePath);
 
+  /**
+   * Encodes and decodes the first sampleLength samples in whole hops. The codec persists across
+   * calls, so each call continues the stream of the previous one.
+   */
   public native short[] encodeAndDecodeSamples(
       short[] samples, int sampleLength, int bitrate, String modelBasePath);
 }
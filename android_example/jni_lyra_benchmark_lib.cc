@@ -14,47 +14,81 @@
 
 #include <jni.h>
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
-#include "absl/random/random.h"
-#include "decoder_main_lib.h"
-#include "encoder_main_lib.h"
 #include "lyra_benchmark_lib.h"
+#include "lyra_c_api.h"
 #include "lyra_config.h"
 
+namespace {
+
+// Kept across calls so that the models are only loaded once. The Java caller
+// is synchronized.
+// The codec state is kept as well: each call continues the stream of the
+// previous one instead of starting from silence. So the first hops of a
+// recording are encoded and decoded with the context of the end of the
+// previous one, and may differ slightly from what a fresh codec would
+// output. Only changing the model path recreates the codec.
+lyra_encoder* encoder = nullptr;
+lyra_decoder* decoder = nullptr;
+std::string codec_model_base_path;
+
+// Makes |encoder| and |decoder| use the models under |model_base_path| and
+// encode at |bitrate|. Returns false on failure.
+bool PrepareCodec(int bitrate, const char* model_base_path) {
+  if (encoder == nullptr || decoder == nullptr ||
+      codec_model_base_path != model_base_path) {
+    lyra_encoder_free(encoder);
+    lyra_decoder_free(decoder);
+    encoder = lyra_encoder_new(16000, chromemedia::codec::kNumChannels,
+                               bitrate, /*enable_dtx=*/0, model_base_path);
+    decoder = lyra_decoder_new(16000, chromemedia::codec::kNumChannels,
+                               model_base_path);
+    codec_model_base_path = model_base_path;
+    return encoder != nullptr && decoder != nullptr;
+  }
+  return lyra_encoder_set_bitrate(encoder, bitrate) == LYRA_OK;
+}
+
+}  // namespace
+
 extern "C" JNIEXPORT jshortArray JNICALL
 Java_com_example_android_lyra_MainActivity_encodeAndDecodeSamples(
     JNIEnv* env, jobject this_obj, jshortArray samples, jint sample_length,
     jint bitrate, jstring model_base_path) {
-  std::vector<int16_t> samples_vector(sample_length);
-  std::vector<uint8_t> features;
-  std::vector<int16_t> decoded_audio;
-  jshortArray java_decoded_audio = nullptr;
-  env->GetShortArrayRegion(samples, jsize{0}, sample_length,
-                           &samples_vector[0]);
-
   const char* cpp_model_base_path = env->GetStringUTFChars(model_base_path, 0);
-  std::unique_ptr<chromemedia::codec::LyraDecoder> decoder =
-      chromemedia::codec::LyraDecoder::Create(
-          16000, chromemedia::codec::kNumChannels, cpp_model_base_path);
-
-  absl::BitGen gen;
-  if (chromemedia::codec::EncodeWav(
-          samples_vector, chromemedia::codec::kNumChannels, 16000, bitrate,
-          false, false, cpp_model_base_path, &features) &&
-      chromemedia::codec::DecodeFeatures(
-          features, chromemedia::codec::BitrateToPacketSize(bitrate),
-          /*randomize_num_samples_requested=*/false, gen, decoder.get(),
-          nullptr, &decoded_audio)) {
-    java_decoded_audio = env->NewShortArray(decoded_audio.size());
-    env->SetShortArrayRegion(java_decoded_audio, 0, decoded_audio.size(),
-                             &decoded_audio[0]);
+  const bool prepared = PrepareCodec(bitrate, cpp_model_base_path);
+  env->ReleaseStringUTFChars(model_base_path, cpp_model_base_path);
+  if (!prepared) {
+    return nullptr;
   }
 
-  env->ReleaseStringUTFChars(model_base_path, cpp_model_base_path);
+  // Every hop is encoded and decoded straight between the Java arrays.
+  const int num_samples_per_hop = lyra_encoder_num_samples_per_hop(encoder);
+  const int num_decoded_samples =
+      sample_length / num_samples_per_hop * num_samples_per_hop;
+  jshortArray java_decoded_audio = env->NewShortArray(num_decoded_samples);
+  jshort* input = env->GetShortArrayElements(samples, nullptr);
+  jshort* output = env->GetShortArrayElements(java_decoded_audio, nullptr);
+  std::vector<uint8_t> packet(lyra_max_packet_size());
+  bool success = true;
+  for (int begin = 0; success && begin < num_decoded_samples;
+       begin += num_samples_per_hop) {
+    const int packet_size =
+        lyra_encode_into(encoder, input + begin, num_samples_per_hop,
+                         packet.data(), packet.size());
+    success = packet_size >= 0 &&
+              lyra_decoder_set_packet(decoder, packet.data(), packet_size) ==
+                  LYRA_OK &&
+              lyra_decode_into(decoder, output + begin, num_samples_per_hop) ==
+                  num_samples_per_hop;
+  }
+  env->ReleaseShortArrayElements(samples, input, JNI_ABORT);
+  env->ReleaseShortArrayElements(java_decoded_audio, output, 0);
 
-  return java_decoded_audio;
+  return success ? java_decoded_audio : nullptr;
 }
 
 extern "C" JNIEXPORT int JNICALL
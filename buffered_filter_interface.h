@@ -34,6 +34,11 @@ class BufferedFilterInterface {
       const std::function<std::optional<std::vector<int16_t>>(int)>&
           sample_generator,
       int num_samples) = 0;
+
+  virtual std::optional<std::vector<float>> FilterAndBuffer(
+      const std::function<std::optional<std::vector<float>>(int)>&
+          sample_generator,
+      int num_samples) = 0;
 };
 
 }  // namespace codec
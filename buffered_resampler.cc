@@ -24,6 +24,8 @@
 #include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/types/span.h"
+#include "dsp_utils.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "resampler.h"
 
@@ -44,7 +46,9 @@ std::unique_ptr<BufferedResampler> BufferedResampler::Create(
 
 BufferedResampler::BufferedResampler(
     std::unique_ptr<ResamplerInterface> resampler)
-    : leftover_samples_(0), resampler_(std::move(resampler)) {
+    : leftover_samples_(0),
+      float_leftover_samples_(0),
+      resampler_(std::move(resampler)) {
   if (resampler_->target_sample_rate_hz() >
       resampler_->input_sample_rate_hz()) {
     CHECK_EQ(resampler_->target_sample_rate_hz() %
@@ -64,13 +68,40 @@ std::optional<std::vector<int16_t>> BufferedResampler::FilterAndBuffer(
     const std::function<std::optional<std::vector<int16_t>>(int)>&
         sample_generator,
     int num_external_samples_requested) {
+  if (!float_leftover_samples_.empty()) {
+    leftover_samples_ =
+        UnitToInt16(absl::MakeConstSpan(float_leftover_samples_));
+    float_leftover_samples_.clear();
+  }
+  return FilterAndBufferSamples(sample_generator,
+                                num_external_samples_requested,
+                                leftover_samples_);
+}
+
+std::optional<std::vector<float>> BufferedResampler::FilterAndBuffer(
+    const std::function<std::optional<std::vector<float>>(int)>&
+        sample_generator,
+    int num_external_samples_requested) {
+  if (!leftover_samples_.empty()) {
+    float_leftover_samples_ = Int16ToUnit<float>(leftover_samples_);
+    leftover_samples_.clear();
+  }
+  return FilterAndBufferSamples(sample_generator,
+                                num_external_samples_requested,
+                                float_leftover_samples_);
+}
+
+template <typename T>
+std::optional<std::vector<T>> BufferedResampler::FilterAndBufferSamples(
+    const std::function<std::optional<std::vector<T>>(int)>& sample_generator,
+    int num_external_samples_requested, std::vector<T>& leftover_samples) {
   const int num_internal_samples_to_generate =
       GetInternalNumSamplesToGenerate(num_external_samples_requested);
 
   // 1. If we have any leftover samples from last time we must use them.
-  std::vector<int16_t> samples(num_external_samples_requested);
-  const int num_leftover_used =
-      UseLeftoverSamples(num_external_samples_requested, &samples);
+  std::vector<T> samples(num_external_samples_requested);
+  const int num_leftover_used = UseLeftoverSamples(
+      num_external_samples_requested, leftover_samples, &samples);
 
   // 2. Generate samples using |sample_generator|.
   auto internal_samples = sample_generator(num_internal_samples_to_generate);
@@ -80,22 +111,23 @@ std::optional<std::vector<int16_t>> BufferedResampler::FilterAndBuffer(
   CHECK_EQ(internal_samples->size(), num_internal_samples_to_generate);
 
   // 3. Resample the internal samples to produce new samples.
-  const std::vector<int16_t> external_samples =
-      Resample(internal_samples.value());
+  const std::vector<T> external_samples = Resample(internal_samples.value());
 
   // 4. Copy the new samples to output and the leftover buffers.
   CopyNewSamples(external_samples, num_external_samples_requested,
-                 num_leftover_used, &samples);
+                 num_leftover_used, leftover_samples, &samples);
   return samples;
 }
 
 int BufferedResampler::GetInternalNumSamplesToGenerate(
     int num_external_samples_requested) const {
-  if (num_external_samples_requested <= leftover_samples_.size()) {
+  const int num_leftover_samples =
+      leftover_samples_.size() + float_leftover_samples_.size();
+  if (num_external_samples_requested <= num_leftover_samples) {
     return 0;
   }
   const int new_external_samples_needed =
-      num_external_samples_requested - leftover_samples_.size();
+      num_external_samples_requested - num_leftover_samples;
   const float resample_ratio =
       static_cast<float>(resampler_->target_sample_rate_hz()) /
       static_cast<float>(resampler_->input_sample_rate_hz());
@@ -104,33 +136,38 @@ int BufferedResampler::GetInternalNumSamplesToGenerate(
       static_cast<float>(new_external_samples_needed) / resample_ratio));
 }
 
+template <typename T>
 int BufferedResampler::UseLeftoverSamples(int num_external_samples_requested,
-                                          std::vector<int16_t>* samples) {
+                                          std::vector<T>& leftover_samples,
+                                          std::vector<T>* samples) {
   const int num_leftover_used =
-      std::min(static_cast<int>(leftover_samples_.size()),
+      std::min(static_cast<int>(leftover_samples.size()),
                num_external_samples_requested);
-  std::move(leftover_samples_.begin(),
-            leftover_samples_.begin() + num_leftover_used, samples->begin());
-  std::move(leftover_samples_.begin() + num_leftover_used,
-            leftover_samples_.end(), leftover_samples_.begin());
-  leftover_samples_.resize(leftover_samples_.size() - num_leftover_used);
+  std::move(leftover_samples.begin(),
+            leftover_samples.begin() + num_leftover_used, samples->begin());
+  std::move(leftover_samples.begin() + num_leftover_used,
+            leftover_samples.end(), leftover_samples.begin());
+  leftover_samples.resize(leftover_samples.size() - num_leftover_used);
   return num_leftover_used;
 }
 
-std::vector<int16_t> BufferedResampler::Resample(
-    const std::vector<int16_t>& internal_samples) {
+template <typename T>
+std::vector<T> BufferedResampler::Resample(
+    const std::vector<T>& internal_samples) {
   // If the internal and external sample rates match, no need to do anything.
   if (resampler_->target_sample_rate_hz() ==
       resampler_->input_sample_rate_hz()) {
     return internal_samples;
   }
-  return resampler_->Resample(internal_samples);
+  return resampler_->Resample(absl::MakeConstSpan(internal_samples));
 }
 
-void BufferedResampler::CopyNewSamples(
-    const std::vector<int16_t>& external_samples,
-    int num_external_samples_requested, int num_leftover_used,
-    std::vector<int16_t>* samples) {
+template <typename T>
+void BufferedResampler::CopyNewSamples(const std::vector<T>& external_samples,
+                                       int num_external_samples_requested,
+                                       int num_leftover_used,
+                                       std::vector<T>& leftover_samples,
+                                       std::vector<T>* samples) {
   // Copy the needed samples to the destination, which already has some
   // leftover samples from the last run.
   const int num_samples_to_copy =
@@ -140,10 +177,10 @@ void BufferedResampler::CopyNewSamples(
             external_samples.begin() + num_samples_to_copy,
             samples->begin() + num_leftover_used);
 
-  // Store the rest in the |leftover_samples_|.
-  leftover_samples_.insert(leftover_samples_.end(),
-                           external_samples.begin() + num_samples_to_copy,
-                           external_samples.end());
+  // Store the rest in the |leftover_samples|.
+  leftover_samples.insert(leftover_samples.end(),
+                          external_samples.begin() + num_samples_to_copy,
+                          external_samples.end());
 }
 
 }  // namespace codec
@@ -45,30 +45,54 @@ class BufferedResampler : public BufferedFilterInterface {
           sample_generator,
       int num_external_samples_requested) override;
 
+  // Same as above for float samples in [-1, 1], which are never clipped.
+  std::optional<std::vector<float>> FilterAndBuffer(
+      const std::function<std::optional<std::vector<float>>(int)>&
+          sample_generator,
+      int num_external_samples_requested) override;
+
  private:
   explicit BufferedResampler(std::unique_ptr<ResamplerInterface> resampler);
 
+  // Shared implementation of both |FilterAndBuffer| overloads, which keep
+  // their leftovers in |leftover_samples|.
+  template <typename T>
+  std::optional<std::vector<T>> FilterAndBufferSamples(
+      const std::function<std::optional<std::vector<T>>(int)>&
+          sample_generator,
+      int num_external_samples_requested, std::vector<T>& leftover_samples);
+
   // Helper function to inform the generative model how many samples need to
   // be generated if a total of |num_external_samples_requested| are requested
   // upstream. Computed based on the number of leftover samples from previous
   // calls and the external to internal resample ratio.
   int GetInternalNumSamplesToGenerate(int num_external_samples_requested) const;
 
-  // Use at most |num_external_samples_requested| from |leftover_samples_| to
+  // Use at most |num_external_samples_requested| from |leftover_samples| to
   // fill the beginning of |samples|.
-  int UseLeftoverSamples(int num_external_samples_requested,
-                         std::vector<int16_t>* samples);
+  template <typename T>
+  static int UseLeftoverSamples(int num_external_samples_requested,
+                                std::vector<T>& leftover_samples,
+                                std::vector<T>* samples);
 
-  std::vector<int16_t> Resample(const std::vector<int16_t>& internal_samples);
+  template <typename T>
+  std::vector<T> Resample(const std::vector<T>& internal_samples);
 
-  void CopyNewSamples(const std::vector<int16_t>& external_samples,
-                      int num_external_samples_requested, int num_leftover_used,
-                      std::vector<int16_t>* samples);
+  template <typename T>
+  static void CopyNewSamples(const std::vector<T>& external_samples,
+                             int num_external_samples_requested,
+                             int num_leftover_used,
+                             std::vector<T>& leftover_samples,
+                             std::vector<T>* samples);
 
   // If the resample ratio is greater than 1, buffer at most
   // |external_sample_rate| / |internal_sample_rate_hz|/ - 1 leftover samples
   // from the last run. Otherwise this is unused.
   std::vector<int16_t> leftover_samples_;
+  // Leftovers of the float |FilterAndBuffer|. At most one of the two leftover
+  // buffers is non-empty, as they are converted when the caller switches
+  // between sample types.
+  std::vector<float> float_leftover_samples_;
 
   std::unique_ptr<ResamplerInterface> resampler_;
 
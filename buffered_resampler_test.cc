@@ -48,6 +48,17 @@ class BufferedResamplerPeer {
                                                 num_external_samples_requested);
   }
 
+  std::optional<std::vector<float>> FilterAndBuffer(
+      std::optional<std::vector<float>> new_split_samples,
+      int num_external_samples_requested) {
+    std::function<std::optional<std::vector<float>>(int)> sample_generator =
+        [&new_split_samples](int num_samples_to_generate)
+        -> std::optional<std::vector<float>> { return new_split_samples; };
+
+    return buffered_resampler_->FilterAndBuffer(sample_generator,
+                                                num_external_samples_requested);
+  }
+
   int GetInternalNumSamplesToGenerate(int num_external_samples_requested) {
     return buffered_resampler_->GetInternalNumSamplesToGenerate(
         num_external_samples_requested);
@@ -62,7 +73,7 @@ class BufferedResamplerPeer {
 
 namespace {
 
-using testing::_;
+using testing::An;
 using testing::Exactly;
 using testing::Return;
 
@@ -75,7 +86,8 @@ TEST(BufferedResamplerTest, ResamplerNotCalledMatchingRates) {
   const std::vector<int16_t> internal_samples(75);
 
   // Expect the resampler to be never called.
-  EXPECT_CALL(*mock_resampler, Resample(_)).Times(Exactly(0));
+  EXPECT_CALL(*mock_resampler, Resample(An<absl::Span<const int16_t>>()))
+      .Times(Exactly(0));
 
   BufferedResamplerPeer buffered_resampler_peer(std::move(mock_resampler));
   auto samples = buffered_resampler_peer.FilterAndBuffer(internal_samples, 75);
@@ -203,6 +215,51 @@ TEST(BufferedResamplerTest, SubsequentFilterAndBufferUseLeftovers) {
   EXPECT_EQ(result_1, expected_results_1);
 }
 
+TEST(BufferedResamplerTest, FloatSamplesAreNotClipped) {
+  auto mock_resampler =
+      std::make_unique<MockResampler>(kInternalSampleRateHz, 48000);
+  const std::vector<float> expected_internal_samples({0.5f, 1.5f});
+  const std::vector<float> expected_resampled_samples(
+      {0.5f, 0.5f, 0.5f, 1.5f, 1.5f, 1.5f});
+
+  EXPECT_CALL(*mock_resampler,
+              Resample(absl::MakeConstSpan(expected_internal_samples)))
+      .WillOnce(Return(expected_resampled_samples));
+  EXPECT_CALL(*mock_resampler, Resample(An<absl::Span<const int16_t>>()))
+      .Times(Exactly(0));
+  BufferedResamplerPeer buffered_resampler_peer(std::move(mock_resampler));
+
+  auto samples =
+      buffered_resampler_peer.FilterAndBuffer(expected_internal_samples, 6);
+  ASSERT_TRUE(samples.has_value());
+  EXPECT_EQ(samples.value(), expected_resampled_samples);
+}
+
+TEST(BufferedResamplerTest, LeftoversCarryOverBetweenSampleTypes) {
+  auto mock_resampler =
+      std::make_unique<MockResampler>(kInternalSampleRateHz, 48000);
+  const std::vector<float> internal_samples({0.f, 0.25f});
+  const std::vector<float> resampled_samples(
+      {0.f, 0.f, 0.f, 0.25f, 0.25f, 0.25f});
+  EXPECT_CALL(*mock_resampler, Resample(An<absl::Span<const float>>()))
+      .WillOnce(Return(resampled_samples));
+  BufferedResamplerPeer buffered_resampler_peer(std::move(mock_resampler));
+
+  auto float_samples =
+      buffered_resampler_peer.FilterAndBuffer(internal_samples, 4);
+  ASSERT_TRUE(float_samples.has_value());
+  EXPECT_EQ(float_samples.value(),
+            std::vector<float>(resampled_samples.begin(),
+                               resampled_samples.begin() + 4));
+
+  // The two float leftovers are enough for the next int16 request.
+  EXPECT_EQ(0, buffered_resampler_peer.GetInternalNumSamplesToGenerate(2));
+  auto int16_samples =
+      buffered_resampler_peer.FilterAndBuffer(std::vector<int16_t>(0), 2);
+  ASSERT_TRUE(int16_samples.has_value());
+  EXPECT_EQ(int16_samples.value(), std::vector<int16_t>(2, 8192));
+}
+
 class BufferedResamplerSampleRatesTest : public testing::TestWithParam<int> {
  protected:
   BufferedResamplerSampleRatesTest() : external_sample_rate_hz_(GetParam()) {}
@@ -0,0 +1,513 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "codec_daemon.h"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "codec_daemon_protocol.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+#include "lyra_decoder.h"
+#include "lyra_decoder_interface.h"
+#include "lyra_encoder.h"
+#include "lyra_encoder_interface.h"
+#include "shared_memory_ring.h"
+#include "tflite_model_wrapper.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+// How long Run() waits for clients before checking whether it was stopped.
+constexpr int kPollTimeoutMillis = 100;
+// How long a new client may take to send its request.
+constexpr int kRequestTimeoutMillis = 100;
+// Workers keep polling their rings for this long after the last request, and
+// then block until a client wakes them.
+constexpr absl::Duration kSpinDuration = absl::Milliseconds(1);
+// How long a blocked worker waits before it frees closed streams anyway.
+constexpr int kIdleTimeoutMillis = 100;
+
+}  // namespace
+
+// The codec and the rings of one client.
+class CodecDaemon::Stream {
+ public:
+  // Takes ownership of |memory|, which has to be a mapping of
+  // GetStreamMemoryBytes() bytes. Exactly one of |encoder| and |decoder| has
+  // to be set.
+  Stream(std::unique_ptr<LyraEncoderInterface> encoder,
+         std::unique_ptr<LyraDecoderInterface> decoder, void* memory)
+      : encoder_(std::move(encoder)),
+        decoder_(std::move(decoder)),
+        memory_(memory),
+        request_ring_(SharedMemoryRing::Create(memory, kStreamRingCapacity)),
+        response_ring_(SharedMemoryRing::Create(
+            static_cast<uint8_t*>(memory) + GetResponseRingOffset(),
+            kStreamRingCapacity)),
+        control_(new (static_cast<uint8_t*>(memory) + GetStreamControlOffset())
+                     StreamControl{}),
+        closed_(false) {}
+
+  ~Stream() { munmap(memory_, GetStreamMemoryBytes()); }
+
+  // Answers all pending requests. Returns true if there were any.
+  bool Process() {
+    bool processed = false;
+    while (const auto type = request_ring_->Read(&request_)) {
+      processed = true;
+      StreamRecordType response_type = StreamRecordType::kError;
+      response_.clear();
+      if (encoder_ != nullptr &&
+          type.value() == static_cast<uint8_t>(StreamRecordType::kEncode)) {
+        response_type = Encode();
+      } else if (decoder_ != nullptr &&
+                 type.value() ==
+                     static_cast<uint8_t>(StreamRecordType::kDecode)) {
+        response_type = Decode();
+      } else {
+        LOG(ERROR) << "Unexpected request of type "
+                   << static_cast<int>(type.value()) << ".";
+      }
+      if (!response_ring_->Write(static_cast<uint8_t>(response_type),
+                                 response_)) {
+        LOG(ERROR) << "Client does not read its responses.";
+      }
+    }
+    return processed;
+  }
+
+  // Tells the client whether it has to wake the worker after a request.
+  void set_worker_sleeping(bool sleeping) {
+    control_->worker_sleeping.store(sleeping, std::memory_order_relaxed);
+  }
+
+  // Called once the client disconnected. The stream may then be destroyed.
+  void Close() { closed_.store(true, std::memory_order_release); }
+
+  bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+ private:
+  StreamRecordType Encode() {
+    if (request_.size() % sizeof(int16_t) != 0) {
+      LOG(ERROR) << "Encode request holds a partial sample.";
+      return StreamRecordType::kError;
+    }
+    const auto packet = encoder_->Encode(
+        absl::MakeConstSpan(reinterpret_cast<const int16_t*>(request_.data()),
+                            request_.size() / sizeof(int16_t)));
+    if (!packet.has_value()) {
+      return StreamRecordType::kError;
+    }
+    response_.assign(packet->begin(), packet->end());
+    return StreamRecordType::kPacket;
+  }
+
+  StreamRecordType Decode() {
+    int32_t num_samples;
+    if (request_.size() < sizeof(num_samples)) {
+      LOG(ERROR) << "Decode request is missing the number of samples.";
+      return StreamRecordType::kError;
+    }
+    std::memcpy(&num_samples, request_.data(), sizeof(num_samples));
+    // Comes from the client, and every request has to be answered by exactly
+    // one response which fits into the response ring.
+    if (num_samples <= 0 || num_samples > GetMaxNumDecodedSamples()) {
+      LOG(ERROR) << "Decode request asks for " << num_samples
+                 << " samples, but has to ask for between 1 and "
+                 << GetMaxNumDecodedSamples() << ".";
+      return StreamRecordType::kError;
+    }
+    const auto packet = absl::MakeConstSpan(request_).subspan(
+        sizeof(num_samples));
+    if (!packet.empty() && !decoder_->SetEncodedPacket(packet)) {
+      return StreamRecordType::kError;
+    }
+    const auto samples = decoder_->DecodeSamples(num_samples);
+    if (!samples.has_value()) {
+      return StreamRecordType::kError;
+    }
+    const auto* bytes = reinterpret_cast<const uint8_t*>(samples->data());
+    response_.assign(bytes, bytes + samples->size() * sizeof(int16_t));
+    return StreamRecordType::kSamples;
+  }
+
+  const std::unique_ptr<LyraEncoderInterface> encoder_;
+  const std::unique_ptr<LyraDecoderInterface> decoder_;
+  void* const memory_;
+  const std::unique_ptr<SharedMemoryRing> request_ring_;
+  const std::unique_ptr<SharedMemoryRing> response_ring_;
+  StreamControl* const control_;
+  std::atomic<bool> closed_;
+  // Reused across requests to avoid allocations.
+  std::vector<uint8_t> request_;
+  std::vector<uint8_t> response_;
+};
+
+// A thread which serves a set of streams.
+class CodecDaemon::Worker {
+ public:
+  // Takes ownership of |wake_fd|, a non-blocking eventfd which the clients of
+  // the worker write to when it sleeps.
+  Worker(std::atomic<int>* num_streams, int wake_fd)
+      : num_streams_(num_streams),
+        wake_fd_(wake_fd),
+        stopped_(false),
+        thread_([this]() { Run(); }) {}
+
+  ~Worker() {
+    stopped_.store(true, std::memory_order_relaxed);
+    Wake();
+    thread_.join();
+    close(wake_fd_);
+  }
+
+  int wake_fd() const { return wake_fd_; }
+
+  // The models the codecs of the streams of this worker run on, which are
+  // null until the first stream of their kind. Only to be used by the thread
+  // which adds the streams; the codecs themselves are only run by the worker.
+  std::shared_ptr<TfLiteModelWrapper>* encoder_model() {
+    return &encoder_model_;
+  }
+  std::shared_ptr<TfLiteModelWrapper>* decoder_model() {
+    return &decoder_model_;
+  }
+
+  void AddStream(std::unique_ptr<Stream> stream) {
+    absl::MutexLock lock(&mutex_);
+    streams_.push_back(std::move(stream));
+    // The new stream does not know yet whether the worker sleeps.
+    Wake();
+  }
+
+ private:
+  void Run() {
+    absl::Time last_request = absl::Now();
+    while (!stopped_.load(std::memory_order_relaxed)) {
+      const bool idle = absl::Now() - last_request > kSpinDuration;
+      bool processed = false;
+      {
+        absl::MutexLock lock(&mutex_);
+        if (idle) {
+          // Announced before the pass over the rings, so a request is either
+          // seen by the pass or its client sees the flag and wakes us.
+          for (auto& stream : streams_) {
+            stream->set_worker_sleeping(true);
+          }
+          std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        for (auto& stream : streams_) {
+          processed |= stream->Process();
+        }
+        const auto first_closed = std::remove_if(
+            streams_.begin(), streams_.end(),
+            [](const std::unique_ptr<Stream>& stream) {
+              return stream->closed();
+            });
+        num_streams_->fetch_sub(streams_.end() - first_closed);
+        streams_.erase(first_closed, streams_.end());
+      }
+      if (idle && !processed) {
+        WaitForWake();
+      } else if (!processed) {
+        // Lets clients on the same core run while spinning.
+        std::this_thread::yield();
+      }
+      if (idle) {
+        absl::MutexLock lock(&mutex_);
+        for (auto& stream : streams_) {
+          stream->set_worker_sleeping(false);
+        }
+      }
+      if (processed || idle) {
+        last_request = absl::Now();
+      }
+    }
+  }
+
+  // Blocks until a client or the daemon writes to the eventfd, or until the
+  // idle timeout passes, and resets the eventfd.
+  void WaitForWake() {
+    struct pollfd poll_fd = {wake_fd_, POLLIN, 0};
+    poll(&poll_fd, 1, kIdleTimeoutMillis);
+    uint64_t num_wakes;
+    while (read(wake_fd_, &num_wakes, sizeof(num_wakes)) < 0 &&
+           errno == EINTR) {
+    }
+  }
+
+  void Wake() {
+    const uint64_t one = 1;
+    while (write(wake_fd_, &one, sizeof(one)) < 0 && errno == EINTR) {
+    }
+  }
+
+  std::atomic<int>* const num_streams_;
+  const int wake_fd_;
+  std::atomic<bool> stopped_;
+  std::shared_ptr<TfLiteModelWrapper> encoder_model_;
+  std::shared_ptr<TfLiteModelWrapper> decoder_model_;
+  absl::Mutex mutex_;
+  std::vector<std::unique_ptr<Stream>> streams_ ABSL_GUARDED_BY(mutex_);
+  // Declared last so it starts after all other members are initialized.
+  std::thread thread_;
+};
+
+std::unique_ptr<CodecDaemon> CodecDaemon::Create(
+    const ghc::filesystem::path& socket_path,
+    const ghc::filesystem::path& model_path, int num_workers) {
+  return Create(
+      socket_path, num_workers,
+      [model_path](int sample_rate_hz, int bitrate, bool enable_dtx,
+                   std::shared_ptr<TfLiteModelWrapper>* model)
+          -> std::unique_ptr<LyraEncoderInterface> {
+        if (*model == nullptr) {
+          *model = LyraEncoder::CreateSharedModel(model_path);
+          if (*model == nullptr) {
+            return nullptr;
+          }
+        }
+        return LyraEncoder::Create(sample_rate_hz, /*num_channels=*/1,
+                                   bitrate, enable_dtx, model_path, *model);
+      },
+      [model_path](int sample_rate_hz,
+                   std::shared_ptr<TfLiteModelWrapper>* model)
+          -> std::unique_ptr<LyraDecoderInterface> {
+        if (*model == nullptr) {
+          *model = LyraDecoder::CreateSharedModel(model_path);
+          if (*model == nullptr) {
+            return nullptr;
+          }
+        }
+        return LyraDecoder::Create(sample_rate_hz, /*num_channels=*/1,
+                                   model_path, *model);
+      });
+}
+
+std::unique_ptr<CodecDaemon> CodecDaemon::Create(
+    const ghc::filesystem::path& socket_path, int num_workers,
+    EncoderFactory encoder_factory, DecoderFactory decoder_factory) {
+  if (num_workers <= 0) {
+    LOG(ERROR) << "Number of workers has to be positive, but is "
+               << num_workers << ".";
+    return nullptr;
+  }
+  struct sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socket_path.string().size() >= sizeof(address.sun_path)) {
+    LOG(ERROR) << "Socket path " << socket_path << " is too long.";
+    return nullptr;
+  }
+  std::strncpy(address.sun_path, socket_path.c_str(),
+               sizeof(address.sun_path) - 1);
+
+  const int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd < 0) {
+    LOG(ERROR) << "Could not create socket: " << std::strerror(errno);
+    return nullptr;
+  }
+  unlink(socket_path.c_str());
+  if (bind(listen_fd, reinterpret_cast<struct sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      listen(listen_fd, SOMAXCONN) != 0) {
+    LOG(ERROR) << "Could not listen on " << socket_path << ": "
+               << std::strerror(errno);
+    close(listen_fd);
+    return nullptr;
+  }
+  std::vector<int> wake_fds;
+  for (int i = 0; i < num_workers; ++i) {
+    const int wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd < 0) {
+      LOG(ERROR) << "Could not create eventfd: " << std::strerror(errno);
+      for (const int created_fd : wake_fds) {
+        close(created_fd);
+      }
+      close(listen_fd);
+      return nullptr;
+    }
+    wake_fds.push_back(wake_fd);
+  }
+  return absl::WrapUnique(
+      new CodecDaemon(socket_path, listen_fd, wake_fds,
+                      std::move(encoder_factory), std::move(decoder_factory)));
+}
+
+CodecDaemon::CodecDaemon(const ghc::filesystem::path& socket_path,
+                         int listen_fd, const std::vector<int>& wake_fds,
+                         EncoderFactory encoder_factory,
+                         DecoderFactory decoder_factory)
+    : socket_path_(socket_path),
+      listen_fd_(listen_fd),
+      encoder_factory_(std::move(encoder_factory)),
+      decoder_factory_(std::move(decoder_factory)),
+      stopped_(false),
+      num_streams_(0),
+      next_worker_(0) {
+  for (const int wake_fd : wake_fds) {
+    workers_.push_back(std::make_unique<Worker>(&num_streams_, wake_fd));
+  }
+}
+
+CodecDaemon::~CodecDaemon() {
+  Stop();
+  // Joins the workers, which destroy their streams.
+  workers_.clear();
+  for (const auto& [client_fd, stream] : streams_) {
+    close(client_fd);
+  }
+  close(listen_fd_);
+  unlink(socket_path_.c_str());
+}
+
+void CodecDaemon::Run() {
+  std::vector<struct pollfd> poll_fds;
+  while (!stopped_.load(std::memory_order_relaxed)) {
+    poll_fds.clear();
+    poll_fds.push_back({listen_fd_, POLLIN, 0});
+    for (const auto& [client_fd, stream] : streams_) {
+      poll_fds.push_back({client_fd, POLLIN, 0});
+    }
+    if (poll(poll_fds.data(), poll_fds.size(), kPollTimeoutMillis) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(ERROR) << "Could not poll clients: " << std::strerror(errno);
+      return;
+    }
+    // Clients send nothing after their request, so any event on a client
+    // socket means it disconnected.
+    for (int i = 1; i < poll_fds.size(); ++i) {
+      if (poll_fds[i].revents != 0) {
+        const auto stream = streams_.find(poll_fds[i].fd);
+        stream->second->Close();
+        close(stream->first);
+        streams_.erase(stream);
+      }
+    }
+    if (poll_fds[0].revents & POLLIN) {
+      const int client_fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+      if (client_fd >= 0) {
+        OpenStream(client_fd);
+      }
+    }
+  }
+}
+
+void CodecDaemon::Stop() { stopped_.store(true, std::memory_order_relaxed); }
+
+int CodecDaemon::num_streams() const {
+  return num_streams_.load(std::memory_order_relaxed);
+}
+
+void CodecDaemon::OpenStream(int client_fd) {
+  const struct timeval request_timeout = {0, kRequestTimeoutMillis * 1000};
+  setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &request_timeout,
+             sizeof(request_timeout));
+  StreamRequest request;
+  if (!ReceiveWithFds(client_fd, &request, sizeof(request), /*fds=*/{})) {
+    LOG(ERROR) << "Could not receive stream request.";
+    close(client_fd);
+    return;
+  }
+
+  // Creating a codec on a shared model only reads the sizes of its tensors
+  // and states, so it is safe while the worker runs the model.
+  Worker& worker = *workers_[next_worker_];
+  std::unique_ptr<LyraEncoderInterface> encoder;
+  std::unique_ptr<LyraDecoderInterface> decoder;
+  if (request.version != kCodecDaemonProtocolVersion) {
+    LOG(ERROR) << "Client uses protocol version " << request.version
+               << ", but the daemon uses " << kCodecDaemonProtocolVersion
+               << ".";
+  } else if (request.kind == StreamKind::kEncoder) {
+    encoder = encoder_factory_(request.sample_rate_hz, request.bitrate,
+                               request.enable_dtx, worker.encoder_model());
+  } else if (request.kind == StreamKind::kDecoder) {
+    decoder = decoder_factory_(request.sample_rate_hz, worker.decoder_model());
+  }
+
+  void* memory = MAP_FAILED;
+  int memory_fd = -1;
+  if (encoder != nullptr || decoder != nullptr) {
+    memory_fd = memfd_create("lyra_stream", MFD_CLOEXEC);
+    if (memory_fd >= 0 && ftruncate(memory_fd, GetStreamMemoryBytes()) == 0) {
+      memory = mmap(nullptr, GetStreamMemoryBytes(), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, memory_fd, 0);
+    }
+    if (memory == MAP_FAILED) {
+      LOG(ERROR) << "Could not map stream memory: " << std::strerror(errno);
+    }
+  }
+
+  const bool opened = memory != MAP_FAILED;
+  // The stream initializes the rings, which the client attaches to as soon as
+  // it receives the response.
+  Stream* stream = nullptr;
+  if (opened) {
+    auto owned_stream =
+        std::make_unique<Stream>(std::move(encoder), std::move(decoder), memory);
+    stream = owned_stream.get();
+    num_streams_.fetch_add(1);
+    worker.AddStream(std::move(owned_stream));
+  }
+  const StreamResponse response = {opened};
+  const int fds[] = {memory_fd, worker.wake_fd()};
+  const bool sent =
+      SendWithFds(client_fd, &response, sizeof(response),
+                  opened ? absl::MakeConstSpan(fds) : absl::Span<const int>());
+  if (memory_fd >= 0) {
+    close(memory_fd);
+  }
+  if (!opened || !sent) {
+    if (stream != nullptr) {
+      // The worker destroys the stream, which unmaps the memory.
+      stream->Close();
+    }
+    close(client_fd);
+    return;
+  }
+  streams_[client_fd] = stream;
+  next_worker_ = (next_worker_ + 1) % workers_.size();
+}
+
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_CODEC_DAEMON_H_
+#define LYRA_CODEC_CODEC_DAEMON_H_
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "include/ghc/filesystem.hpp"
+#include "lyra_decoder_interface.h"
+#include "lyra_encoder_interface.h"
+#include "tflite_model_wrapper.h"
+
+namespace chromemedia {
+namespace codec {
+
+/// Encodes and decodes the streams of many client processes in one process.
+///
+/// Clients connect to a Unix domain socket and exchange samples and packets
+/// with the daemon through shared-memory rings, as described in
+/// codec_daemon_protocol.h and implemented by CodecDaemonClient. The streams
+/// are spread over a pool of worker threads, which poll the rings of their
+/// streams, so a busy stream costs no system call on either side. A worker
+/// whose streams are idle blocks on an eventfd, which the next client to send
+/// a request writes to. Each worker loads the encoder and decoder models once
+/// and runs the codecs of all its streams on them, so a stream only adds its
+/// model states and quantizer.
+class CodecDaemon {
+ public:
+  /// Static method to create a CodecDaemon.
+  ///
+  /// @param socket_path Path of the Unix domain socket to listen on. An
+  ///                    existing file at this path is replaced.
+  /// @param model_path Path to the model weights.
+  /// @param num_workers Number of worker threads serving the streams.
+  /// @return A unique_ptr to a |CodecDaemon| on success, else nullptr.
+  static std::unique_ptr<CodecDaemon> Create(
+      const ghc::filesystem::path& socket_path,
+      const ghc::filesystem::path& model_path, int num_workers);
+
+  ~CodecDaemon();
+
+  /// Accepts clients and serves their streams until Stop() is called.
+  void Run();
+
+  /// Makes Run() return. May be called from any thread.
+  void Stop();
+
+  /// @return Number of open streams.
+  int num_streams() const;
+
+ private:
+  friend class CodecDaemonPeer;
+
+  class Stream;
+  class Worker;
+
+  // Create the codec of a new stream. |model| belongs to the worker which
+  // will serve the stream, and all codecs of the worker run on it: a factory
+  // which finds it null creates it, and reuses it otherwise.
+  using EncoderFactory = std::function<std::unique_ptr<LyraEncoderInterface>(
+      int sample_rate_hz, int bitrate, bool enable_dtx,
+      std::shared_ptr<TfLiteModelWrapper>* model)>;
+  using DecoderFactory = std::function<std::unique_ptr<LyraDecoderInterface>(
+      int sample_rate_hz, std::shared_ptr<TfLiteModelWrapper>* model)>;
+
+  static std::unique_ptr<CodecDaemon> Create(
+      const ghc::filesystem::path& socket_path, int num_workers,
+      EncoderFactory encoder_factory, DecoderFactory decoder_factory);
+
+  // Starts one worker for each of |wake_fds|, which it takes ownership of.
+  CodecDaemon(const ghc::filesystem::path& socket_path, int listen_fd,
+              const std::vector<int>& wake_fds, EncoderFactory encoder_factory,
+              DecoderFactory decoder_factory);
+
+  // Reads the request of a newly connected client and opens its stream.
+  // Closes |client_fd| on failure.
+  void OpenStream(int client_fd);
+
+  const ghc::filesystem::path socket_path_;
+  const int listen_fd_;
+  const EncoderFactory encoder_factory_;
+  const DecoderFactory decoder_factory_;
+  std::atomic<bool> stopped_;
+  // Incremented by Run() and decremented by the workers.
+  std::atomic<int> num_streams_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  int next_worker_;
+  // The stream of every connected client, by socket. Only used by Run(); the
+  // streams are owned by the workers.
+  std::map<int, Stream*> streams_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_CODEC_DAEMON_H_
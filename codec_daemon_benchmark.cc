@@ -0,0 +1,127 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures what serving a stream from the codec daemon costs. Every iteration
+// encodes one hop on each of a number of streams, once through daemon clients
+// and once with encoders in the benchmark process running on a shared model
+// like the daemon workers do. The difference in time per stream hop is the
+// cost of the rings, the worker and its wake-ups.
+
+#include <cstdint>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/random/random.h"
+#include "benchmark/benchmark.h"
+#include "codec_daemon.h"
+#include "codec_daemon_client.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra_config.h"
+#include "lyra_encoder.h"
+#include "tflite_model_wrapper.h"
+
+static constexpr int kSampleRateHz = 16000;
+
+static std::vector<int16_t> RandomHop() {
+  absl::BitGen gen;
+  std::vector<int16_t> hop(
+      chromemedia::codec::GetNumSamplesPerHop(kSampleRateHz));
+  for (auto& sample : hop) {
+    sample = absl::Uniform<int16_t>(gen, -1000, 1000);
+  }
+  return hop;
+}
+
+static void SetStreamHopCounters(benchmark::State& state, int num_streams) {
+  state.SetItemsProcessed(state.iterations() * num_streams);
+  state.counters["seconds_per_stream_hop"] = benchmark::Counter(
+      num_streams, benchmark::Counter::kIsIterationInvariantRate |
+                       benchmark::Counter::kInvert);
+}
+
+void BM_DaemonEncode(benchmark::State& state) {
+  const int num_streams = state.range(0);
+  const ghc::filesystem::path socket_path =
+      ghc::filesystem::temp_directory_path() / "codec_daemon_benchmark.sock";
+  auto daemon = chromemedia::codec::CodecDaemon::Create(
+      socket_path, ghc::filesystem::current_path() / "model_coeffs",
+      /*num_workers=*/1);
+  if (daemon == nullptr) {
+    state.SkipWithError("Could not create codec daemon.");
+    return;
+  }
+  std::thread daemon_thread([&daemon]() { daemon->Run(); });
+
+  const int bitrate =
+      chromemedia::codec::QualityPresetToBitrate(1, kSampleRateHz);
+  std::vector<std::unique_ptr<chromemedia::codec::CodecDaemonClient>> clients;
+  bool connected = true;
+  for (int i = 0; i < num_streams && connected; ++i) {
+    clients.push_back(chromemedia::codec::CodecDaemonClient::ConnectEncoder(
+        socket_path, kSampleRateHz, bitrate, /*enable_dtx=*/false));
+    if (clients.back() == nullptr) {
+      state.SkipWithError("Could not connect to codec daemon.");
+      connected = false;
+    }
+  }
+  const std::vector<int16_t> hop = RandomHop();
+  if (connected) {
+    for (auto _ : state) {
+      for (auto& client : clients) {
+        benchmark::DoNotOptimize(client->Encode(hop));
+      }
+    }
+    SetStreamHopCounters(state, num_streams);
+  }
+
+  clients.clear();
+  daemon->Stop();
+  daemon_thread.join();
+}
+
+void BM_InProcessEncode(benchmark::State& state) {
+  const int num_streams = state.range(0);
+  const ghc::filesystem::path model_path =
+      ghc::filesystem::current_path() / "model_coeffs";
+  std::shared_ptr<chromemedia::codec::TfLiteModelWrapper> shared_model =
+      chromemedia::codec::LyraEncoder::CreateSharedModel(model_path);
+  if (shared_model == nullptr) {
+    state.SkipWithError("Could not create encoder model.");
+    return;
+  }
+  const int bitrate =
+      chromemedia::codec::QualityPresetToBitrate(1, kSampleRateHz);
+  std::vector<std::unique_ptr<chromemedia::codec::LyraEncoder>> encoders;
+  for (int i = 0; i < num_streams; ++i) {
+    encoders.push_back(chromemedia::codec::LyraEncoder::Create(
+        kSampleRateHz, /*num_channels=*/1, bitrate, /*enable_dtx=*/false,
+        model_path, shared_model));
+    if (encoders.back() == nullptr) {
+      state.SkipWithError("Could not create encoder.");
+      return;
+    }
+  }
+  const std::vector<int16_t> hop = RandomHop();
+  for (auto _ : state) {
+    for (auto& encoder : encoders) {
+      benchmark::DoNotOptimize(encoder->Encode(hop));
+    }
+  }
+  SetStreamHopCounters(state, num_streams);
+}
+
+BENCHMARK(BM_DaemonEncode)->RangeMultiplier(4)->Range(1, 16)->UseRealTime();
+BENCHMARK(BM_InProcessEncode)->RangeMultiplier(4)->Range(1, 16)->UseRealTime();
+BENCHMARK_MAIN();
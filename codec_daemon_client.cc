@@ -0,0 +1,234 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "codec_daemon_client.h"
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "codec_daemon_protocol.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+#include "shared_memory_ring.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+// The client spins this many times on the response ring before it starts
+// yielding the processor.
+constexpr int kNumSpins = 1000;
+// A daemon which has not answered after this long is considered gone.
+constexpr absl::Duration kResponseTimeout = absl::Seconds(1);
+
+}  // namespace
+
+std::unique_ptr<CodecDaemonClient> CodecDaemonClient::ConnectEncoder(
+    const ghc::filesystem::path& socket_path, int sample_rate_hz, int bitrate,
+    bool enable_dtx) {
+  StreamRequest request;
+  std::memset(&request, 0, sizeof(request));
+  request.version = kCodecDaemonProtocolVersion;
+  request.kind = StreamKind::kEncoder;
+  request.sample_rate_hz = sample_rate_hz;
+  request.bitrate = bitrate;
+  request.enable_dtx = enable_dtx;
+  return Connect(socket_path, request);
+}
+
+std::unique_ptr<CodecDaemonClient> CodecDaemonClient::ConnectDecoder(
+    const ghc::filesystem::path& socket_path, int sample_rate_hz) {
+  StreamRequest request;
+  std::memset(&request, 0, sizeof(request));
+  request.version = kCodecDaemonProtocolVersion;
+  request.kind = StreamKind::kDecoder;
+  request.sample_rate_hz = sample_rate_hz;
+  return Connect(socket_path, request);
+}
+
+std::unique_ptr<CodecDaemonClient> CodecDaemonClient::Connect(
+    const ghc::filesystem::path& socket_path, const StreamRequest& request) {
+  struct sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socket_path.string().size() >= sizeof(address.sun_path)) {
+    LOG(ERROR) << "Socket path " << socket_path << " is too long.";
+    return nullptr;
+  }
+  std::strncpy(address.sun_path, socket_path.c_str(),
+               sizeof(address.sun_path) - 1);
+  const int socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (socket_fd < 0) {
+    LOG(ERROR) << "Could not create socket: " << std::strerror(errno);
+    return nullptr;
+  }
+  if (connect(socket_fd, reinterpret_cast<struct sockaddr*>(&address),
+              sizeof(address)) != 0) {
+    LOG(ERROR) << "Could not connect to " << socket_path << ": "
+               << std::strerror(errno);
+    close(socket_fd);
+    return nullptr;
+  }
+
+  StreamResponse response;
+  int fds[kMaxNumFds];
+  if (!SendWithFds(socket_fd, &request, sizeof(request), /*fds=*/{}) ||
+      !ReceiveWithFds(socket_fd, &response, sizeof(response),
+                      absl::MakeSpan(fds))) {
+    close(socket_fd);
+    return nullptr;
+  }
+  const int memory_fd = fds[0];
+  const int wake_fd = fds[1];
+  if (!response.success || memory_fd < 0 || wake_fd < 0) {
+    LOG(ERROR) << "Daemon could not open the stream.";
+    for (const int fd : fds) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+    close(socket_fd);
+    return nullptr;
+  }
+  void* memory = mmap(nullptr, GetStreamMemoryBytes(), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, memory_fd, 0);
+  close(memory_fd);
+  if (memory == MAP_FAILED) {
+    LOG(ERROR) << "Could not map stream memory: " << std::strerror(errno);
+    close(wake_fd);
+    close(socket_fd);
+    return nullptr;
+  }
+  auto request_ring = SharedMemoryRing::Attach(memory, kStreamRingCapacity);
+  auto response_ring = SharedMemoryRing::Attach(
+      static_cast<uint8_t*>(memory) + GetResponseRingOffset(),
+      kStreamRingCapacity);
+  if (request_ring == nullptr || response_ring == nullptr) {
+    munmap(memory, GetStreamMemoryBytes());
+    close(wake_fd);
+    close(socket_fd);
+    return nullptr;
+  }
+  return absl::WrapUnique(
+      new CodecDaemonClient(request.kind, socket_fd, wake_fd, memory,
+                            std::move(request_ring), std::move(response_ring)));
+}
+
+CodecDaemonClient::CodecDaemonClient(
+    StreamKind kind, int socket_fd, int wake_fd, void* memory,
+    std::unique_ptr<SharedMemoryRing> request_ring,
+    std::unique_ptr<SharedMemoryRing> response_ring)
+    : kind_(kind),
+      socket_fd_(socket_fd),
+      wake_fd_(wake_fd),
+      memory_(memory),
+      control_(reinterpret_cast<StreamControl*>(static_cast<uint8_t*>(memory) +
+                                                GetStreamControlOffset())),
+      request_ring_(std::move(request_ring)),
+      response_ring_(std::move(response_ring)) {}
+
+CodecDaemonClient::~CodecDaemonClient() {
+  munmap(memory_, GetStreamMemoryBytes());
+  close(wake_fd_);
+  close(socket_fd_);
+}
+
+std::optional<std::vector<uint8_t>> CodecDaemonClient::Encode(
+    absl::Span<const int16_t> audio) {
+  if (kind_ != StreamKind::kEncoder) {
+    LOG(ERROR) << "Only encoder streams can encode.";
+    return std::nullopt;
+  }
+  const auto* bytes = reinterpret_cast<const uint8_t*>(audio.data());
+  request_.assign(bytes, bytes + audio.size() * sizeof(int16_t));
+  if (!Call(StreamRecordType::kEncode, StreamRecordType::kPacket)) {
+    return std::nullopt;
+  }
+  return response_;
+}
+
+std::optional<std::vector<int16_t>> CodecDaemonClient::Decode(
+    absl::Span<const uint8_t> encoded, int num_samples) {
+  if (kind_ != StreamKind::kDecoder) {
+    LOG(ERROR) << "Only decoder streams can decode.";
+    return std::nullopt;
+  }
+  const int32_t num_samples_to_send = num_samples;
+  const auto* bytes = reinterpret_cast<const uint8_t*>(&num_samples_to_send);
+  request_.assign(bytes, bytes + sizeof(num_samples_to_send));
+  request_.insert(request_.end(), encoded.begin(), encoded.end());
+  if (!Call(StreamRecordType::kDecode, StreamRecordType::kSamples)) {
+    return std::nullopt;
+  }
+  std::vector<int16_t> samples(response_.size() / sizeof(int16_t));
+  std::memcpy(samples.data(), response_.data(),
+              samples.size() * sizeof(int16_t));
+  return samples;
+}
+
+bool CodecDaemonClient::Call(StreamRecordType request_type,
+                             StreamRecordType response_type) {
+  if (!request_ring_->Write(static_cast<uint8_t>(request_type), request_)) {
+    LOG(ERROR) << "Request of " << request_.size()
+               << " bytes does not fit into the ring.";
+    return false;
+  }
+  // Pairs with the fence the worker issues between announcing that it sleeps
+  // and its last pass over the rings.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (control_->worker_sleeping.load(std::memory_order_relaxed) != 0) {
+    const uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+      LOG(ERROR) << "Could not wake the daemon: " << std::strerror(errno);
+    }
+  }
+  std::optional<uint8_t> type;
+  std::optional<absl::Time> deadline;
+  for (int spin = 0; !(type = response_ring_->Read(&response_)); ++spin) {
+    if (spin < kNumSpins) {
+      continue;
+    }
+    if (!deadline.has_value()) {
+      deadline = absl::Now() + kResponseTimeout;
+    } else if (absl::Now() > deadline.value()) {
+      LOG(ERROR) << "Daemon did not respond.";
+      return false;
+    }
+    std::this_thread::yield();
+  }
+  if (type.value() != static_cast<uint8_t>(response_type)) {
+    LOG(ERROR) << "Daemon could not process the request.";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_CODEC_DAEMON_CLIENT_H_
+#define LYRA_CODEC_CODEC_DAEMON_CLIENT_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "codec_daemon_protocol.h"
+#include "include/ghc/filesystem.hpp"
+#include "shared_memory_ring.h"
+
+namespace chromemedia {
+namespace codec {
+
+/// One encoder or decoder stream served by a CodecDaemon.
+///
+/// Requests are written to a ring in memory shared with the daemon and the
+/// client spins on the response ring until the answer arrives, so a hop costs
+/// no system call unless the worker serving the stream went to sleep and has
+/// to be woken. A client is not thread-safe.
+class CodecDaemonClient {
+ public:
+  /// Opens an encoder stream.
+  ///
+  /// @param socket_path Path of the Unix domain socket of the daemon.
+  /// @param sample_rate_hz Sample rate of the audio in Hertz.
+  /// @param bitrate Bitrate of the packets in bps.
+  /// @param enable_dtx Whether silent hops are not sent.
+  /// @return A unique_ptr to a |CodecDaemonClient| on success, else nullptr.
+  static std::unique_ptr<CodecDaemonClient> ConnectEncoder(
+      const ghc::filesystem::path& socket_path, int sample_rate_hz,
+      int bitrate, bool enable_dtx);
+
+  /// Opens a decoder stream.
+  ///
+  /// @param socket_path Path of the Unix domain socket of the daemon.
+  /// @param sample_rate_hz Sample rate of the decoded audio in Hertz.
+  /// @return A unique_ptr to a |CodecDaemonClient| on success, else nullptr.
+  static std::unique_ptr<CodecDaemonClient> ConnectDecoder(
+      const ghc::filesystem::path& socket_path, int sample_rate_hz);
+
+  /// Closes the stream.
+  ~CodecDaemonClient();
+
+  /// Encodes one hop of an encoder stream.
+  ///
+  /// @param audio One hop of samples.
+  /// @return The encoded packet, which is empty if it is not sent because of
+  ///         DTX, or nullopt on failure.
+  std::optional<std::vector<uint8_t>> Encode(absl::Span<const int16_t> audio);
+
+  /// Decodes samples of a decoder stream.
+  ///
+  /// @param encoded Packet to decode from. An empty packet conceals the hop.
+  /// @param num_samples Number of samples to decode.
+  /// @return The decoded samples, or nullopt on failure.
+  std::optional<std::vector<int16_t>> Decode(absl::Span<const uint8_t> encoded,
+                                             int num_samples);
+
+ private:
+  static std::unique_ptr<CodecDaemonClient> Connect(
+      const ghc::filesystem::path& socket_path, const StreamRequest& request);
+
+  CodecDaemonClient(StreamKind kind, int socket_fd, int wake_fd, void* memory,
+                    std::unique_ptr<SharedMemoryRing> request_ring,
+                    std::unique_ptr<SharedMemoryRing> response_ring);
+
+  // Sends |request_| and waits for the response, which is stored in
+  // |response_|. Returns false if the daemon failed or did not respond.
+  bool Call(StreamRecordType request_type, StreamRecordType response_type);
+
+  const StreamKind kind_;
+  const int socket_fd_;
+  // The eventfd of the worker serving the stream.
+  const int wake_fd_;
+  void* const memory_;
+  StreamControl* const control_;
+  const std::unique_ptr<SharedMemoryRing> request_ring_;
+  const std::unique_ptr<SharedMemoryRing> response_ring_;
+  // Reused across calls to avoid allocations.
+  std::vector<uint8_t> request_;
+  std::vector<uint8_t> response_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_CODEC_DAEMON_CLIENT_H_
@@ -0,0 +1,64 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <csignal>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/flags/usage.h"
+#include "architecture_utils.h"
+#include "codec_daemon.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+
+ABSL_FLAG(std::string, socket_path, "/tmp/lyra_codec_daemon.sock",
+          "Path of the Unix domain socket clients connect to.");
+ABSL_FLAG(int, num_workers, std::thread::hardware_concurrency(),
+          "The number of worker threads which encode and decode the streams.");
+ABSL_FLAG(std::string, model_path, "model_coeffs",
+          "Path to directory containing TFLite files. For mobile this is the "
+          "absolute path, like '/sdcard/model_coeffs/'. For desktop this is "
+          "the path relative to the binary.");
+
+namespace {
+
+chromemedia::codec::CodecDaemon* daemon_to_stop = nullptr;
+
+void StopDaemon(int signal) { daemon_to_stop->Stop(); }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::SetProgramUsageMessage(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+
+  auto daemon = chromemedia::codec::CodecDaemon::Create(
+      absl::GetFlag(FLAGS_socket_path),
+      chromemedia::codec::GetCompleteArchitecturePath(
+          absl::GetFlag(FLAGS_model_path)),
+      absl::GetFlag(FLAGS_num_workers));
+  if (daemon == nullptr) {
+    LOG(ERROR) << "Could not start codec daemon.";
+    return -1;
+  }
+  daemon_to_stop = daemon.get();
+  std::signal(SIGINT, StopDaemon);
+  std::signal(SIGTERM, StopDaemon);
+  LOG(INFO) << "Serving streams on " << absl::GetFlag(FLAGS_socket_path);
+  daemon->Run();
+  return 0;
+}
@@ -0,0 +1,125 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "codec_daemon_protocol.h"
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "shared_memory_ring.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+// Keeps the response ring aligned like the request ring.
+constexpr size_t kRingAlignment = 64;
+
+}  // namespace
+
+size_t GetResponseRingOffset() {
+  const size_t ring_bytes =
+      SharedMemoryRing::GetRequiredBytes(kStreamRingCapacity);
+  return (ring_bytes + kRingAlignment - 1) / kRingAlignment * kRingAlignment;
+}
+
+size_t GetStreamControlOffset() {
+  const size_t end_of_rings =
+      GetResponseRingOffset() +
+      SharedMemoryRing::GetRequiredBytes(kStreamRingCapacity);
+  return (end_of_rings + kRingAlignment - 1) / kRingAlignment * kRingAlignment;
+}
+
+size_t GetStreamMemoryBytes() {
+  return GetStreamControlOffset() + sizeof(StreamControl);
+}
+
+int GetMaxNumDecodedSamples() {
+  return (kStreamRingCapacity - SharedMemoryRing::GetRecordBytes(0)) /
+         sizeof(int16_t);
+}
+
+bool SendWithFds(int socket_fd, const void* data, size_t size,
+                 absl::Span<const int> fds) {
+  CHECK_LE(fds.size(), kMaxNumFds);
+  struct iovec iov;
+  iov.iov_base = const_cast<void*>(data);
+  iov.iov_len = size;
+  struct msghdr message;
+  std::memset(&message, 0, sizeof(message));
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxNumFds)];
+  if (!fds.empty()) {
+    message.msg_control = control;
+    message.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+    struct cmsghdr* control_message = CMSG_FIRSTHDR(&message);
+    control_message->cmsg_level = SOL_SOCKET;
+    control_message->cmsg_type = SCM_RIGHTS;
+    control_message->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    std::memcpy(CMSG_DATA(control_message), fds.data(),
+                sizeof(int) * fds.size());
+  }
+  const ssize_t num_sent = sendmsg(socket_fd, &message, MSG_NOSIGNAL);
+  if (num_sent != static_cast<ssize_t>(size)) {
+    LOG(ERROR) << "Could not send message: " << std::strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+bool ReceiveWithFds(int socket_fd, void* data, size_t size,
+                    absl::Span<int> fds) {
+  CHECK_LE(fds.size(), kMaxNumFds);
+  std::fill(fds.begin(), fds.end(), -1);
+  struct iovec iov;
+  iov.iov_base = data;
+  iov.iov_len = size;
+  struct msghdr message;
+  std::memset(&message, 0, sizeof(message));
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  // Without room for them, the kernel closes the descriptors sent along.
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxNumFds)];
+  if (!fds.empty()) {
+    message.msg_control = control;
+    message.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+  }
+  const ssize_t num_received = recvmsg(socket_fd, &message, MSG_WAITALL);
+  if (num_received != static_cast<ssize_t>(size)) {
+    if (num_received < 0) {
+      LOG(ERROR) << "Could not receive message: " << std::strerror(errno);
+    }
+    return false;
+  }
+  struct cmsghdr* control_message = CMSG_FIRSTHDR(&message);
+  if (control_message != nullptr && control_message->cmsg_level == SOL_SOCKET &&
+      control_message->cmsg_type == SCM_RIGHTS) {
+    const int num_fds =
+        (control_message->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    std::memcpy(fds.data(), CMSG_DATA(control_message),
+                sizeof(int) * std::min<int>(num_fds, fds.size()));
+  }
+  return true;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
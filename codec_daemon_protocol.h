@@ -0,0 +1,122 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_CODEC_DAEMON_PROTOCOL_H_
+#define LYRA_CODEC_CODEC_DAEMON_PROTOCOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/types/span.h"
+
+namespace chromemedia {
+namespace codec {
+
+// Protocol between the codec daemon and its clients.
+//
+// A client opens one stream per connection to the Unix domain socket of the
+// daemon by sending a StreamRequest. The daemon answers with a StreamResponse
+// and, on success, passes two file descriptors along with it: the shared
+// memory of the stream and the eventfd which wakes the worker serving it. The
+// memory holds two SharedMemoryRings of kStreamRingCapacity bytes, the request
+// ring, which the client writes, at offset 0 and the response ring at
+// GetResponseRingOffset(), followed by a StreamControl at
+// GetStreamControlOffset(). Every request record is answered by exactly one
+// response record. Closing the connection closes the stream.
+
+inline constexpr uint32_t kCodecDaemonProtocolVersion = 2;
+
+inline constexpr int kStreamRingCapacity = 1 << 16;
+
+enum class StreamKind : uint8_t {
+  kEncoder = 0,
+  kDecoder = 1,
+};
+
+struct StreamRequest {
+  uint32_t version;
+  StreamKind kind;
+  int32_t sample_rate_hz;
+  // Only used by encoders.
+  int32_t bitrate;
+  bool enable_dtx;
+};
+
+struct StreamResponse {
+  bool success;
+};
+
+// Types of the records in the rings of a stream.
+enum class StreamRecordType : uint8_t {
+  // Request of encoders: one hop of int16 samples to encode.
+  kEncode = 1,
+  // Request of decoders: the number of samples to decode as int32, followed by
+  // the packet to set before decoding. An empty packet asks for concealment.
+  kDecode = 2,
+  // Response to kEncode: the encoded packet, which is empty if it was not sent
+  // because of DTX.
+  kPacket = 3,
+  // Response to kDecode: the decoded int16 samples.
+  kSamples = 4,
+  // Response to any request which failed.
+  kError = 5,
+};
+
+// Lets a worker sleep while its streams are idle without missing requests.
+struct StreamControl {
+  // Set by the worker before it blocks on its eventfd and cleared once it
+  // runs again. A client which finds it set after writing a request, behind a
+  // sequentially consistent fence, writes to the eventfd.
+  std::atomic<uint32_t> worker_sleeping;
+};
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "The stream control has to be lock-free to be shared between "
+              "processes.");
+
+// The most file descriptors sent along with one message.
+inline constexpr int kMaxNumFds = 2;
+
+// Returns the offset of the response ring in the shared memory of a stream.
+size_t GetResponseRingOffset();
+
+// Returns the offset of the StreamControl in the shared memory of a stream.
+size_t GetStreamControlOffset();
+
+// Returns the number of bytes of the shared memory of a stream.
+size_t GetStreamMemoryBytes();
+
+// Returns the most samples a kDecode request may ask for, so that the kSamples
+// response fits into the response ring.
+int GetMaxNumDecodedSamples();
+
+// Sends the |size| bytes at |data| over the connected |socket_fd|, along with
+// the at most kMaxNumFds file descriptors in |fds|. Returns false on failure.
+bool SendWithFds(int socket_fd, const void* data, size_t size,
+                 absl::Span<const int> fds);
+
+// Receives exactly |size| bytes into |data| from the connected |socket_fd|.
+// The file descriptors sent along are stored in |fds|, which holds at most
+// kMaxNumFds, and the remaining entries are set to -1. Descriptors which do
+// not fit into |fds| are closed. Returns false on failure or if the peer
+// closed the connection.
+bool ReceiveWithFds(int socket_fd, void* data, size_t size,
+                    absl::Span<int> fds);
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_CODEC_DAEMON_PROTOCOL_H_
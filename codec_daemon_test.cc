@@ -0,0 +1,298 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "codec_daemon.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "codec_daemon_client.h"
+#include "codec_daemon_protocol.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra_decoder_interface.h"
+#include "lyra_encoder_interface.h"
+#include "testing/mock_lyra_decoder.h"
+#include "testing/mock_lyra_encoder.h"
+#include "tflite_model_wrapper.h"
+
+namespace chromemedia {
+namespace codec {
+
+// Gives access to the private factory to inject mocks.
+class CodecDaemonPeer {
+ public:
+  static std::unique_ptr<CodecDaemon> Create(
+      const ghc::filesystem::path& socket_path,
+      CodecDaemon::EncoderFactory encoder_factory,
+      CodecDaemon::DecoderFactory decoder_factory) {
+    return CodecDaemon::Create(socket_path, /*num_workers=*/2,
+                               std::move(encoder_factory),
+                               std::move(decoder_factory));
+  }
+};
+
+namespace {
+
+using testing::_;
+using testing::ElementsAre;
+using testing::IsEmpty;
+using testing::Matcher;
+using testing::NiceMock;
+using testing::Return;
+
+constexpr int kSampleRateHz = 16000;
+constexpr int kBitrate = 3200;
+
+class CodecDaemonTest : public testing::Test {
+ protected:
+  CodecDaemonTest()
+      : socket_path_(ghc::filesystem::path(testing::TempDir()) /
+                     "codec_daemon_test.sock") {}
+
+  void TearDown() override {
+    if (daemon_ != nullptr) {
+      daemon_->Stop();
+      daemon_thread_.join();
+    }
+  }
+
+  void StartDaemon(
+      std::function<std::unique_ptr<LyraEncoderInterface>()> encoder_factory,
+      std::function<std::unique_ptr<LyraDecoderInterface>()>
+          decoder_factory) {
+    daemon_ = CodecDaemonPeer::Create(
+        socket_path_,
+        [encoder_factory](int sample_rate_hz, int bitrate, bool enable_dtx,
+                          std::shared_ptr<TfLiteModelWrapper>* model) {
+          return encoder_factory();
+        },
+        [decoder_factory](int sample_rate_hz,
+                          std::shared_ptr<TfLiteModelWrapper>* model) {
+          return decoder_factory();
+        });
+    ASSERT_NE(daemon_, nullptr);
+    daemon_thread_ = std::thread([this]() { daemon_->Run(); });
+  }
+
+  // Waits until the daemon serves |num_streams| streams.
+  bool WaitForNumStreams(int num_streams) {
+    const absl::Time deadline = absl::Now() + absl::Seconds(5);
+    while (daemon_->num_streams() != num_streams) {
+      if (absl::Now() > deadline) {
+        return false;
+      }
+      absl::SleepFor(absl::Milliseconds(1));
+    }
+    return true;
+  }
+
+  const ghc::filesystem::path socket_path_;
+  std::unique_ptr<CodecDaemon> daemon_;
+  std::thread daemon_thread_;
+};
+
+TEST_F(CodecDaemonTest, EncodesInDaemon) {
+  StartDaemon(
+      []() {
+        auto encoder = std::make_unique<NiceMock<MockLyraEncoder>>();
+        EXPECT_CALL(*encoder, Encode(Matcher<absl::Span<const int16_t>>(
+                                  ElementsAre(1, 2, 3))))
+            .WillOnce(Return(std::vector<uint8_t>{4, 5}))
+            .WillOnce(Return(std::vector<uint8_t>()))
+            .WillOnce(Return(std::nullopt));
+        return encoder;
+      },
+      []() { return nullptr; });
+
+  auto client = CodecDaemonClient::ConnectEncoder(socket_path_, kSampleRateHz,
+                                                  kBitrate,
+                                                  /*enable_dtx=*/true);
+  ASSERT_NE(client, nullptr);
+  const std::vector<int16_t> audio = {1, 2, 3};
+  EXPECT_THAT(client->Encode(audio), testing::Optional(ElementsAre(4, 5)));
+  // A hop which is not sent because of DTX.
+  EXPECT_THAT(client->Encode(audio), testing::Optional(IsEmpty()));
+  EXPECT_FALSE(client->Encode(audio).has_value());
+  EXPECT_FALSE(client->Decode({}, 3).has_value());
+}
+
+TEST_F(CodecDaemonTest, DecodesInDaemon) {
+  StartDaemon([]() { return nullptr; },
+              []() {
+                auto decoder = std::make_unique<NiceMock<MockLyraDecoder>>();
+                EXPECT_CALL(*decoder, SetEncodedPacket(ElementsAre(9, 8)))
+                    .WillOnce(Return(true));
+                EXPECT_CALL(*decoder, DecodeSamples(3))
+                    .Times(2)
+                    .WillRepeatedly(Return(std::vector<int16_t>{1, 2, 3}));
+                return decoder;
+              });
+
+  auto client = CodecDaemonClient::ConnectDecoder(socket_path_, kSampleRateHz);
+  ASSERT_NE(client, nullptr);
+  const std::vector<uint8_t> packet = {9, 8};
+  EXPECT_THAT(client->Decode(packet, 3),
+              testing::Optional(ElementsAre(1, 2, 3)));
+  // An empty packet is concealed without setting a packet.
+  EXPECT_THAT(client->Decode({}, 3), testing::Optional(ElementsAre(1, 2, 3)));
+  EXPECT_FALSE(client->Encode(std::vector<int16_t>(3)).has_value());
+}
+
+TEST_F(CodecDaemonTest, RejectsInvalidNumberOfSamplesToDecode) {
+  StartDaemon([]() { return nullptr; },
+              []() {
+                auto decoder = std::make_unique<NiceMock<MockLyraDecoder>>();
+                // Invalid numbers never reach the decoder.
+                EXPECT_CALL(*decoder, DecodeSamples(_)).Times(0);
+                EXPECT_CALL(*decoder, DecodeSamples(3))
+                    .WillOnce(Return(std::vector<int16_t>{1, 2, 3}));
+                return decoder;
+              });
+
+  auto client = CodecDaemonClient::ConnectDecoder(socket_path_, kSampleRateHz);
+  ASSERT_NE(client, nullptr);
+  EXPECT_FALSE(client->Decode({}, -1).has_value());
+  EXPECT_FALSE(client->Decode({}, 0).has_value());
+  // The samples would not fit into a response.
+  EXPECT_FALSE(client->Decode({}, GetMaxNumDecodedSamples() + 1).has_value());
+  // Every rejected request was answered, so the stream is still in sync.
+  EXPECT_THAT(client->Decode({}, 3), testing::Optional(ElementsAre(1, 2, 3)));
+}
+
+TEST_F(CodecDaemonTest, RejectsStreamWhichCannotBeCreated) {
+  StartDaemon([]() { return nullptr; }, []() { return nullptr; });
+
+  EXPECT_EQ(CodecDaemonClient::ConnectEncoder(socket_path_, kSampleRateHz,
+                                              kBitrate, /*enable_dtx=*/false),
+            nullptr);
+  EXPECT_EQ(CodecDaemonClient::ConnectDecoder(socket_path_, kSampleRateHz),
+            nullptr);
+  EXPECT_EQ(daemon_->num_streams(), 0);
+}
+
+TEST_F(CodecDaemonTest, ClientsConnectingInQuickSuccessionAttachToRings) {
+  StartDaemon([]() { return std::make_unique<NiceMock<MockLyraEncoder>>(); },
+              []() { return nullptr; });
+
+  // Every client attaches to its rings right after it receives the response.
+  std::vector<std::unique_ptr<CodecDaemonClient>> clients;
+  for (int i = 0; i < 64; ++i) {
+    clients.push_back(CodecDaemonClient::ConnectEncoder(
+        socket_path_, kSampleRateHz, kBitrate, /*enable_dtx=*/false));
+    ASSERT_NE(clients.back(), nullptr) << "Client " << i;
+  }
+  EXPECT_TRUE(WaitForNumStreams(64));
+}
+
+TEST_F(CodecDaemonTest, DisconnectingClientClosesStream) {
+  StartDaemon(
+      []() { return std::make_unique<NiceMock<MockLyraEncoder>>(); },
+      []() { return std::make_unique<NiceMock<MockLyraDecoder>>(); });
+
+  auto encoder_client = CodecDaemonClient::ConnectEncoder(
+      socket_path_, kSampleRateHz, kBitrate, /*enable_dtx=*/false);
+  auto decoder_client =
+      CodecDaemonClient::ConnectDecoder(socket_path_, kSampleRateHz);
+  ASSERT_NE(encoder_client, nullptr);
+  ASSERT_NE(decoder_client, nullptr);
+  EXPECT_TRUE(WaitForNumStreams(2));
+
+  encoder_client.reset();
+  EXPECT_TRUE(WaitForNumStreams(1));
+  decoder_client.reset();
+  EXPECT_TRUE(WaitForNumStreams(0));
+}
+
+TEST_F(CodecDaemonTest, ClientWakesIdleWorker) {
+  StartDaemon(
+      []() {
+        auto encoder = std::make_unique<NiceMock<MockLyraEncoder>>();
+        ON_CALL(*encoder, Encode(Matcher<absl::Span<const int16_t>>(_)))
+            .WillByDefault(Return(std::vector<uint8_t>{1}));
+        return encoder;
+      },
+      []() { return nullptr; });
+  auto client = CodecDaemonClient::ConnectEncoder(
+      socket_path_, kSampleRateHz, kBitrate, /*enable_dtx=*/false);
+  ASSERT_NE(client, nullptr);
+
+  // Each request finds the worker blocked, which without a wake-up would only
+  // look at the rings again after its idle timeout of 100 ms.
+  constexpr int kNumRequests = 10;
+  absl::Duration total_latency;
+  for (int i = 0; i < kNumRequests; ++i) {
+    absl::SleepFor(absl::Milliseconds(20));
+    const absl::Time start = absl::Now();
+    ASSERT_TRUE(client->Encode(std::vector<int16_t>(3)).has_value());
+    total_latency += absl::Now() - start;
+  }
+  EXPECT_LT(total_latency, absl::Milliseconds(100));
+}
+
+TEST_F(CodecDaemonTest, StreamsOfAWorkerShareItsModel) {
+  std::vector<std::shared_ptr<TfLiteModelWrapper>*> models;
+  daemon_ = CodecDaemonPeer::Create(
+      socket_path_,
+      [&models](int sample_rate_hz, int bitrate, bool enable_dtx,
+                std::shared_ptr<TfLiteModelWrapper>* model) {
+        models.push_back(model);
+        return std::make_unique<NiceMock<MockLyraEncoder>>();
+      },
+      [](int sample_rate_hz, std::shared_ptr<TfLiteModelWrapper>* model) {
+        return nullptr;
+      });
+  ASSERT_NE(daemon_, nullptr);
+  daemon_thread_ = std::thread([this]() { daemon_->Run(); });
+
+  // The streams are spread over the two workers in turn.
+  std::vector<std::unique_ptr<CodecDaemonClient>> clients;
+  for (int i = 0; i < 3; ++i) {
+    clients.push_back(CodecDaemonClient::ConnectEncoder(
+        socket_path_, kSampleRateHz, kBitrate, /*enable_dtx=*/false));
+    ASSERT_NE(clients.back(), nullptr);
+  }
+  ASSERT_TRUE(WaitForNumStreams(3));
+  // Joins the thread which called the factory before looking at |models|.
+  daemon_->Stop();
+  daemon_thread_.join();
+  daemon_.reset();
+  ASSERT_EQ(models.size(), 3);
+  EXPECT_NE(models[0], models[1]);
+  EXPECT_EQ(models[0], models[2]);
+}
+
+TEST(CodecDaemonCreationTest, CreateFailsForInvalidParameters) {
+  const ghc::filesystem::path socket_path =
+      ghc::filesystem::path(testing::TempDir()) / "codec_daemon_test.sock";
+  EXPECT_EQ(CodecDaemon::Create(socket_path, "model_coeffs",
+                                /*num_workers=*/0),
+            nullptr);
+  EXPECT_EQ(CodecDaemon::Create(std::string(200, 'a'), "model_coeffs",
+                                /*num_workers=*/1),
+            nullptr);
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
@@ -19,11 +19,11 @@
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <random>
 #include <utility>
 #include <vector>
 
 #include "absl/memory/memory.h"
-#include "absl/random/random.h"
 #include "absl/types/span.h"
 #include "audio/dsp/mfcc/mel_filterbank.h"
 #include "audio/dsp/number_util.h"
@@ -37,15 +37,12 @@ namespace codec {
 
 std::unique_ptr<ComfortNoiseGenerator> ComfortNoiseGenerator::Create(
     int sample_rate_hz, int num_samples_per_hop, int window_length_samples,
-    int num_mel_bins) {
+    int num_mel_bins, bool random_seed) {
   const int kFftSize = static_cast<int>(
       audio_dsp::NextPowerOfTwo(static_cast<unsigned>(window_length_samples)));
-  const int kNumFftBins = kFftSize / 2 + 1;
-  auto mel_filterbank = std::make_unique<audio_dsp::MelFilterbank>();
-  if (!mel_filterbank->Initialize(
-          kNumFftBins, static_cast<double>(sample_rate_hz), num_mel_bins,
-          LogMelSpectrogramExtractorImpl::GetLowerFreqLimit(),
-          LogMelSpectrogramExtractorImpl::GetUpperFreqLimit(sample_rate_hz))) {
+  auto mel_filterbank = LogMelSpectrogramExtractorImpl::GetMelFilterbank(
+      sample_rate_hz, window_length_samples, num_mel_bins);
+  if (mel_filterbank == nullptr) {
     LOG(ERROR) << "Could not initialize mel filterbank.";
     return nullptr;
   }
@@ -56,20 +53,29 @@ std::unique_ptr<ComfortNoiseGenerator> ComfortNoiseGenerator::Create(
     return nullptr;
   }
 
+  unsigned int seed = 5489u;
+  if (random_seed) {
+    std::random_device rd;
+    seed = rd();
+  }
+
   return absl::WrapUnique(new ComfortNoiseGenerator(
       sample_rate_hz, num_samples_per_hop, num_mel_bins,
-      std::move(mel_filterbank), std::move(inverse_spectrogram)));
+      std::move(mel_filterbank), std::move(inverse_spectrogram), seed));
 }
 
 ComfortNoiseGenerator::ComfortNoiseGenerator(
     int sample_rate_hz, int num_samples_per_hop, int num_mel_bins,
-    std::unique_ptr<audio_dsp::MelFilterbank> mel_filterbank,
-    std::unique_ptr<audio_dsp::InverseSpectrogram> inverse_spectrogram)
+    std::shared_ptr<const audio_dsp::MelFilterbank> mel_filterbank,
+    std::unique_ptr<audio_dsp::InverseSpectrogram> inverse_spectrogram,
+    unsigned int seed)
     : GenerativeModel(num_samples_per_hop, num_mel_bins),
       mel_filterbank_(std::move(mel_filterbank)),
       inverse_spectrogram_(std::move(inverse_spectrogram)),
       squared_magnitude_fft_(num_samples_per_hop),
-      reconstructed_samples_(num_samples_per_hop) {}
+      reconstructed_samples_(num_samples_per_hop),
+      gen_(seed),
+      phase_(0.0, 2 * M_PI) {}
 
 bool ComfortNoiseGenerator::RunConditioning(
     const std::vector<float>& features) {
@@ -100,10 +106,9 @@ bool ComfortNoiseGenerator::InvertFft() {
   // InverseSpectrogram class expects a 2D spectrogram, so one containing just
   // one slice is constructed.
   std::vector<std::vector<std::complex<double>>> random_phase_spectrogram(1);
-  absl::BitGen gen;
   for (int i = 0; i < squared_magnitude_fft_.size(); ++i) {
     double magnitude = sqrt(squared_magnitude_fft_.at(i));
-    double random_angle = absl::Uniform<double>(gen, 0, 2 * M_PI);
+    double random_angle = phase_(gen_);
     random_phase_spectrogram[0].push_back(
         magnitude * std::exp(std::complex<double>(0.0, 1.0) * random_angle));
   }
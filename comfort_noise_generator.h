@@ -20,6 +20,7 @@
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <random>
 #include <vector>
 
 #include "audio/dsp/mfcc/mel_filterbank.h"
@@ -34,17 +35,20 @@ namespace codec {
 class ComfortNoiseGenerator : public GenerativeModel {
  public:
   // Returns a nullptr on failure.
+  // If |random_seed| is false the random phases are drawn from a fixed seed,
+  // so that instances fed the same features generate the same samples.
   static std::unique_ptr<ComfortNoiseGenerator> Create(
       int sample_rate_hz, int num_samples_per_hop, int window_length_samples,
-      int num_mel_bins);
+      int num_mel_bins, bool random_seed = true);
 
   ~ComfortNoiseGenerator() override {}
 
  private:
   ComfortNoiseGenerator(
       int sample_rate_hz, int num_samples_per_hop, int num_mel_bins,
-      std::unique_ptr<audio_dsp::MelFilterbank> mel_filterbank,
-      std::unique_ptr<audio_dsp::InverseSpectrogram> inverse_spectrogram);
+      std::shared_ptr<const audio_dsp::MelFilterbank> mel_filterbank,
+      std::unique_ptr<audio_dsp::InverseSpectrogram> inverse_spectrogram,
+      unsigned int seed);
 
   bool RunConditioning(const std::vector<float>& features) override;
 
@@ -60,11 +64,16 @@ class ComfortNoiseGenerator : public GenerativeModel {
   // and false otherwise.
   bool InvertFft();
 
-  const std::unique_ptr<const audio_dsp::MelFilterbank> mel_filterbank_;
+  const std::shared_ptr<const audio_dsp::MelFilterbank> mel_filterbank_;
   const std::unique_ptr<audio_dsp::InverseSpectrogram> inverse_spectrogram_;
 
   std::vector<double> squared_magnitude_fft_;
   std::vector<int16_t> reconstructed_samples_;
+
+  // Not using absl::Uniform for the same reason as GilbertModel: it can't
+  // ensure the same output between runs even with explicit seeding.
+  std::mt19937 gen_;
+  std::uniform_real_distribution<double> phase_;
 };
 
 }  // namespace codec
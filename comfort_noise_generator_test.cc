@@ -97,6 +97,30 @@ TEST(ComfortNoiseGeneratorTest, BasicUseCaseSucceeds) {
   EXPECT_THAT(generated_samples.value(), Each(0.0));
 }
 
+TEST(ComfortNoiseGeneratorTest, FixedSeedIsReproducible) {
+  auto comfort_noise_generator = ComfortNoiseGenerator::Create(
+      kTestSampleRate, kTestHopLengthSamples, kTestWindowLengthSamples,
+      kTestNumFeatures, /*random_seed=*/false);
+  auto other_comfort_noise_generator = ComfortNoiseGenerator::Create(
+      kTestSampleRate, kTestHopLengthSamples, kTestWindowLengthSamples,
+      kTestNumFeatures, /*random_seed=*/false);
+  ASSERT_NE(comfort_noise_generator, nullptr);
+  ASSERT_NE(other_comfort_noise_generator, nullptr);
+
+  std::vector<float> features(kTestNumFeatures, 1.0);
+  const int kNumTimesToCall = 10;
+  for (int i = 0; i < kNumTimesToCall; ++i) {
+    ASSERT_TRUE(comfort_noise_generator->AddFeatures(features));
+    ASSERT_TRUE(other_comfort_noise_generator->AddFeatures(features));
+    auto generated_samples =
+        comfort_noise_generator->GenerateSamples(kTestHopLengthSamples);
+    ASSERT_TRUE(generated_samples.has_value());
+    EXPECT_THAT(
+        other_comfort_noise_generator->GenerateSamples(kTestHopLengthSamples),
+        Optional(generated_samples.value()));
+  }
+}
+
 TEST(ComfortNoiseGeneratorTest, GeneratedNoiseHasSimilarFeatures) {
   // Since log-mel-spectrogram extractors are stateful, it is necessary to
   // create separate ones for input and output.
@@ -0,0 +1,207 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "conference_mixer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+#include "lyra_config.h"
+#include "lyra_decoder.h"
+#include "lyra_decoder_interface.h"
+#include "lyra_encoder.h"
+#include "lyra_encoder_interface.h"
+#include "tflite_model_wrapper.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+constexpr int kNumSamplesPerHop = CodecProfile::kNumSamplesPerHop;
+
+// The loops below work on contiguous floats without aliasing or branches other
+// than min/max, so that the compiler vectorizes them.
+
+// Adds |source| to |destination|.
+void Accumulate(const float* __restrict source, float* __restrict destination) {
+  for (int i = 0; i < kNumSamplesPerHop; ++i) {
+    destination[i] += source[i];
+  }
+}
+
+// Writes |total| minus |own|, clamped to [-1, 1], to |destination|. |own| may
+// be nullptr if the stream was not mixed.
+void MixMinus(const float* __restrict total, const float* __restrict own,
+              float* __restrict destination) {
+  if (own == nullptr) {
+    for (int i = 0; i < kNumSamplesPerHop; ++i) {
+      destination[i] = std::clamp(total[i], -1.f, 1.f);
+    }
+    return;
+  }
+  for (int i = 0; i < kNumSamplesPerHop; ++i) {
+    destination[i] = std::clamp(total[i] - own[i], -1.f, 1.f);
+  }
+}
+
+}  // namespace
+
+std::unique_ptr<ConferenceMixer> ConferenceMixer::Create(
+    int sample_rate_hz, int num_participants, int bitrate, bool enable_dtx,
+    const ghc::filesystem::path& model_path) {
+  if (num_participants <= 0) {
+    LOG(ERROR) << "A conference needs at least one participant, but "
+               << num_participants << " were requested.";
+    return nullptr;
+  }
+  // The codecs are only run from Mix(), one after the other, so they can all
+  // take turns on one model of each kind.
+  std::shared_ptr<TfLiteModelWrapper> decoder_model =
+      LyraDecoder::CreateSharedModel(model_path);
+  std::shared_ptr<TfLiteModelWrapper> encoder_model =
+      LyraEncoder::CreateSharedModel(model_path);
+  if (decoder_model == nullptr || encoder_model == nullptr) {
+    LOG(ERROR) << "Could not create the models of the conference.";
+    return nullptr;
+  }
+  std::vector<std::unique_ptr<LyraDecoderInterface>> decoders;
+  std::vector<std::unique_ptr<LyraEncoderInterface>> encoders;
+  for (int participant = 0; participant < num_participants; ++participant) {
+    auto decoder = LyraDecoder::Create(sample_rate_hz, kNumChannels,
+                                       model_path, decoder_model);
+    if (decoder == nullptr) {
+      LOG(ERROR) << "Could not create decoder of participant " << participant
+                 << ".";
+      return nullptr;
+    }
+    auto encoder = LyraEncoder::Create(sample_rate_hz, kNumChannels, bitrate,
+                                       enable_dtx, model_path, encoder_model);
+    if (encoder == nullptr) {
+      LOG(ERROR) << "Could not create encoder of participant " << participant
+                 << ".";
+      return nullptr;
+    }
+    decoders.push_back(std::move(decoder));
+    encoders.push_back(std::move(encoder));
+  }
+  return absl::WrapUnique(
+      new ConferenceMixer(std::move(decoders), std::move(encoders),
+                          std::move(decoder_model), std::move(encoder_model)));
+}
+
+ConferenceMixer::ConferenceMixer(
+    std::vector<std::unique_ptr<LyraDecoderInterface>> decoders,
+    std::vector<std::unique_ptr<LyraEncoderInterface>> encoders,
+    std::shared_ptr<TfLiteModelWrapper> decoder_model,
+    std::shared_ptr<TfLiteModelWrapper> encoder_model)
+    : decoders_(std::move(decoders)),
+      encoders_(std::move(encoders)),
+      decoder_model_(std::move(decoder_model)),
+      encoder_model_(std::move(encoder_model)),
+      is_dtx_(decoders_.size(), false),
+      is_received_(decoders_.size(), false),
+      is_mixed_(decoders_.size(), false),
+      num_mixed_streams_(0),
+      decoded_(decoders_.size()) {
+  CHECK_EQ(decoders_.size(), encoders_.size());
+}
+
+bool ConferenceMixer::SetEncodedPacket(int participant,
+                                       absl::Span<const uint8_t> encoded) {
+  if (participant < 0 || participant >= num_participants()) {
+    LOG(ERROR) << "Participant " << participant << " is not in the conference.";
+    return false;
+  }
+  if (encoded.empty()) {
+    is_dtx_.at(participant) = true;
+    return true;
+  }
+  if (!decoders_.at(participant)->SetEncodedPacket(encoded)) {
+    LOG(ERROR) << "Could not set packet of participant " << participant << ".";
+    return false;
+  }
+  is_dtx_.at(participant) = false;
+  is_received_.at(participant) = true;
+  return true;
+}
+
+std::optional<std::vector<std::vector<uint8_t>>> ConferenceMixer::Mix() {
+  std::fill(std::begin(total_), std::end(total_), 0.f);
+  num_mixed_streams_ = 0;
+  for (int participant = 0; participant < num_participants(); ++participant) {
+    const std::optional<bool> is_mixed = MaybeDecode(participant);
+    if (!is_mixed.has_value()) {
+      return std::nullopt;
+    }
+    is_mixed_.at(participant) = is_mixed.value();
+    if (is_mixed.value()) {
+      Accumulate(decoded_.at(participant).data(), total_);
+      ++num_mixed_streams_;
+    }
+  }
+  std::fill(is_dtx_.begin(), is_dtx_.end(), false);
+  std::fill(is_received_.begin(), is_received_.end(), false);
+
+  std::vector<std::vector<uint8_t>> encoded(num_participants());
+  for (int participant = 0; participant < num_participants(); ++participant) {
+    MixMinus(total_,
+             is_mixed_.at(participant) ? decoded_.at(participant).data()
+                                       : nullptr,
+             mix_minus_);
+    auto packet = encoders_.at(participant)->Encode(
+        absl::MakeConstSpan(mix_minus_, kNumSamplesPerHop));
+    if (!packet.has_value()) {
+      LOG(ERROR) << "Could not encode mix of participant " << participant
+                 << ".";
+      return std::nullopt;
+    }
+    encoded.at(participant) = std::move(packet.value());
+  }
+  return encoded;
+}
+
+std::optional<bool> ConferenceMixer::MaybeDecode(int participant) {
+  LyraDecoderInterface* decoder = decoders_.at(participant).get();
+  // A participant in DTX sends nothing worth mixing, and one whose decoder
+  // only produces comfort noise would just add noise to everybody else.
+  if (is_dtx_.at(participant) ||
+      (!is_received_.at(participant) && decoder->is_comfort_noise())) {
+    return false;
+  }
+  auto decoded = decoder->DecodeFloatSamples(kNumSamplesPerHop);
+  if (!decoded.has_value() || decoded->size() != kNumSamplesPerHop) {
+    LOG(ERROR) << "Could not decode hop of participant " << participant << ".";
+    return std::nullopt;
+  }
+  if (decoder->is_comfort_noise()) {
+    return false;
+  }
+  decoded_.at(participant) = std::move(decoded.value());
+  return true;
+}
+
+int ConferenceMixer::num_participants() const { return decoders_.size(); }
+
+int ConferenceMixer::num_mixed_streams() const { return num_mixed_streams_; }
+
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_CONFERENCE_MIXER_H_
+#define LYRA_CODEC_CONFERENCE_MIXER_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra_config.h"
+#include "lyra_decoder_interface.h"
+#include "lyra_encoder_interface.h"
+#include "tflite_model_wrapper.h"
+
+namespace chromemedia {
+namespace codec {
+
+/// Mixes a conference of Lyra streams.
+///
+/// Every hop, each participant's stream is decoded to float and summed into a
+/// single total. Each participant then receives the total minus its own
+/// stream, so the cost of mixing grows linearly with the number of
+/// participants instead of quadratically. The mix-minus of every participant is
+/// re-encoded with that participant's encoder. All decoders run on one decoder
+/// model and all encoders on one encoder model, so a participant only adds its
+/// model states and quantizers.
+///
+/// Streams which are in discontinuous transmission (DTX) or only produce
+/// comfort noise are neither decoded nor mixed.
+class ConferenceMixer {
+ public:
+  /// Static method to create a ConferenceMixer.
+  ///
+  /// @param sample_rate_hz Sample rate of all streams in Hertz.
+  /// @param num_participants Number of participants in the conference.
+  /// @param bitrate Bitrate of the re-encoded streams in bps.
+  /// @param enable_dtx Whether the re-encoded streams use DTX.
+  /// @param model_path Path to the model weights.
+  /// @return A unique_ptr to a |ConferenceMixer| on success, else nullptr.
+  static std::unique_ptr<ConferenceMixer> Create(
+      int sample_rate_hz, int num_participants, int bitrate, bool enable_dtx,
+      const ghc::filesystem::path& model_path);
+
+  /// Sets the packet received from a participant for the next hop.
+  ///
+  /// @param participant Index of the participant.
+  /// @param encoded Encoded packet. An empty packet marks a hop which was not
+  ///                transmitted because of DTX.
+  /// @return True on success.
+  bool SetEncodedPacket(int participant, absl::Span<const uint8_t> encoded);
+
+  /// Mixes one hop.
+  ///
+  /// Participants without a packet since the last call are concealed by their
+  /// decoder.
+  ///
+  /// @return For every participant the encoded mix of all other
+  ///         participants, or nullopt on failure.
+  std::optional<std::vector<std::vector<uint8_t>>> Mix();
+
+  /// @return Number of participants.
+  int num_participants() const;
+
+  /// @return Number of streams summed into the total by the last |Mix| call.
+  int num_mixed_streams() const;
+
+ private:
+  ConferenceMixer(
+      std::vector<std::unique_ptr<LyraDecoderInterface>> decoders,
+      std::vector<std::unique_ptr<LyraEncoderInterface>> encoders,
+      std::shared_ptr<TfLiteModelWrapper> decoder_model,
+      std::shared_ptr<TfLiteModelWrapper> encoder_model);
+
+  // Decodes the hop of |participant| into |decoded_| and returns whether it
+  // has to be mixed, or nullopt on failure.
+  std::optional<bool> MaybeDecode(int participant);
+
+  const std::vector<std::unique_ptr<LyraDecoderInterface>> decoders_;
+  const std::vector<std::unique_ptr<LyraEncoderInterface>> encoders_;
+  // Models shared by all decoders and by all encoders, or null if the codecs
+  // were passed in.
+  const std::shared_ptr<TfLiteModelWrapper> decoder_model_;
+  const std::shared_ptr<TfLiteModelWrapper> encoder_model_;
+
+  // Whether a DTX packet was set for each participant since the last hop.
+  std::vector<bool> is_dtx_;
+  // Whether a packet was set for each participant since the last hop.
+  std::vector<bool> is_received_;
+  // Whether the stream of each participant is part of |total_|.
+  std::vector<bool> is_mixed_;
+  int num_mixed_streams_;
+
+  // Last decoded hop of every participant.
+  std::vector<std::vector<float>> decoded_;
+  // Sum of all mixed streams. Aligned so the mix-minus can be passed to the
+  // encoders without a copy.
+  alignas(64) float total_[CodecProfile::kNumSamplesPerHop];
+  alignas(64) float mix_minus_[CodecProfile::kNumSamplesPerHop];
+
+  friend class ConferenceMixerPeer;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_CONFERENCE_MIXER_H_
@@ -0,0 +1,75 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures how many conference participants one core can mix in real time.
+// Every participant sends speech-like random packets, so all streams are
+// decoded, mixed and re-encoded.
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "benchmark/benchmark.h"
+#include "conference_mixer.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra_config.h"
+
+static constexpr int kSampleRateHz = 16000;
+static constexpr int kNumRandomPackets = 100;
+
+void BM_MixConference(benchmark::State& state) {
+  const int num_participants = state.range(0);
+  const int bitrate =
+      chromemedia::codec::QualityPresetToBitrate(1, kSampleRateHz);
+  auto mixer = chromemedia::codec::ConferenceMixer::Create(
+      kSampleRateHz, num_participants, bitrate, /*enable_dtx=*/false,
+      ghc::filesystem::current_path() / "model_coeffs");
+  if (mixer == nullptr) {
+    state.SkipWithError("Could not create conference mixer.");
+    return;
+  }
+  const int packet_size = chromemedia::codec::BitrateToPacketSize(
+      bitrate, chromemedia::codec::GetFrameRate(kSampleRateHz));
+  absl::BitGen gen;
+  std::vector<std::vector<uint8_t>> packets(
+      kNumRandomPackets, std::vector<uint8_t>(packet_size));
+  for (auto& packet : packets) {
+    for (auto& byte : packet) {
+      byte = absl::Uniform<uint8_t>(gen);
+    }
+  }
+
+  int packet_index = 0;
+  for (auto _ : state) {
+    for (int participant = 0; participant < num_participants; ++participant) {
+      mixer->SetEncodedPacket(participant, packets.at(packet_index));
+      packet_index = (packet_index + 1) % kNumRandomPackets;
+    }
+    benchmark::DoNotOptimize(mixer->Mix());
+  }
+
+  // The number of participants which could be mixed within the duration of
+  // one hop, assuming the cost is linear in the number of participants.
+  const double hop_seconds =
+      static_cast<double>(
+          chromemedia::codec::GetNumSamplesPerHop(kSampleRateHz)) /
+      kSampleRateHz;
+  state.counters["participants_per_core"] = benchmark::Counter(
+      num_participants * hop_seconds,
+      benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK(BM_MixConference)->RangeMultiplier(2)->Range(2, 32);
+BENCHMARK_MAIN();
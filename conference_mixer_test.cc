@@ -0,0 +1,227 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "conference_mixer.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra_config.h"
+#include "lyra_decoder_interface.h"
+#include "lyra_encoder_interface.h"
+#include "testing/mock_lyra_decoder.h"
+#include "testing/mock_lyra_encoder.h"
+#include "tflite_model_wrapper.h"
+
+namespace chromemedia {
+namespace codec {
+
+// Gives access to the private constructor to inject mocks.
+class ConferenceMixerPeer {
+ public:
+  static std::unique_ptr<ConferenceMixer> Create(
+      std::vector<std::unique_ptr<LyraDecoderInterface>> decoders,
+      std::vector<std::unique_ptr<LyraEncoderInterface>> encoders) {
+    return std::unique_ptr<ConferenceMixer>(
+        new ConferenceMixer(std::move(decoders), std::move(encoders),
+                            /*decoder_model=*/nullptr,
+                            /*encoder_model=*/nullptr));
+  }
+
+  static const std::shared_ptr<TfLiteModelWrapper>& decoder_model(
+      const ConferenceMixer& mixer) {
+    return mixer.decoder_model_;
+  }
+
+  static const std::shared_ptr<TfLiteModelWrapper>& encoder_model(
+      const ConferenceMixer& mixer) {
+    return mixer.encoder_model_;
+  }
+};
+
+namespace {
+
+using testing::Each;
+using testing::FloatNear;
+using testing::Matcher;
+using testing::NiceMock;
+using testing::Return;
+
+constexpr int kNumSamplesPerHop = CodecProfile::kNumSamplesPerHop;
+
+class ConferenceMixerTest : public testing::Test {
+ protected:
+  // Creates a mixer where every participant decodes a constant hop of the
+  // given value.
+  void CreateMixer(const std::vector<float>& decoded_values) {
+    std::vector<std::unique_ptr<LyraDecoderInterface>> decoders;
+    std::vector<std::unique_ptr<LyraEncoderInterface>> encoders;
+    for (float value : decoded_values) {
+      auto decoder = std::make_unique<NiceMock<MockLyraDecoder>>();
+      ON_CALL(*decoder, SetEncodedPacket).WillByDefault(Return(true));
+      ON_CALL(*decoder, DecodeFloatSamples(kNumSamplesPerHop))
+          .WillByDefault(Return(std::vector<float>(kNumSamplesPerHop, value)));
+      ON_CALL(*decoder, is_comfort_noise).WillByDefault(Return(false));
+      decoders_.push_back(decoder.get());
+      decoders.push_back(std::move(decoder));
+
+      auto encoder = std::make_unique<NiceMock<MockLyraEncoder>>();
+      encoders_.push_back(encoder.get());
+      encoders.push_back(std::move(encoder));
+    }
+    mixer_ =
+        ConferenceMixerPeer::Create(std::move(decoders), std::move(encoders));
+  }
+
+  // Expects |participant| to be sent a hop where every sample is |value|.
+  void ExpectMix(int participant, float value) {
+    EXPECT_CALL(*encoders_.at(participant),
+                Encode(Matcher<absl::Span<const float>>(
+                    Each(FloatNear(value, 1e-6f)))))
+        .WillOnce(Return(std::vector<uint8_t>{static_cast<uint8_t>(
+            participant)}));
+  }
+
+  const std::vector<uint8_t> packet_ = std::vector<uint8_t>(15, 0);
+  std::vector<MockLyraDecoder*> decoders_;
+  std::vector<MockLyraEncoder*> encoders_;
+  std::unique_ptr<ConferenceMixer> mixer_;
+};
+
+TEST_F(ConferenceMixerTest, EveryParticipantHearsEverybodyElse) {
+  CreateMixer({0.1f, 0.2f, 0.3f});
+  for (int participant = 0; participant < 3; ++participant) {
+    ASSERT_TRUE(mixer_->SetEncodedPacket(participant, packet_));
+  }
+  ExpectMix(0, 0.5f);
+  ExpectMix(1, 0.4f);
+  ExpectMix(2, 0.3f);
+
+  auto encoded = mixer_->Mix();
+  ASSERT_TRUE(encoded.has_value());
+  EXPECT_EQ(encoded.value(),
+            (std::vector<std::vector<uint8_t>>{{0}, {1}, {2}}));
+  EXPECT_EQ(mixer_->num_mixed_streams(), 3);
+}
+
+TEST_F(ConferenceMixerTest, DtxStreamsAreNotDecoded) {
+  CreateMixer({0.1f, 0.2f, 0.3f});
+  ASSERT_TRUE(mixer_->SetEncodedPacket(0, packet_));
+  ASSERT_TRUE(mixer_->SetEncodedPacket(1, {}));
+  ASSERT_TRUE(mixer_->SetEncodedPacket(2, packet_));
+  EXPECT_CALL(*decoders_.at(1), SetEncodedPacket).Times(0);
+  EXPECT_CALL(*decoders_.at(1), DecodeFloatSamples).Times(0);
+  ExpectMix(0, 0.3f);
+  ExpectMix(1, 0.4f);
+  ExpectMix(2, 0.1f);
+
+  ASSERT_TRUE(mixer_->Mix().has_value());
+  EXPECT_EQ(mixer_->num_mixed_streams(), 2);
+}
+
+TEST_F(ConferenceMixerTest, ComfortNoiseStreamsAreNotMixed) {
+  CreateMixer({0.1f, 0.2f});
+  // Participant 1 has been lost long enough to only produce comfort noise.
+  ON_CALL(*decoders_.at(1), is_comfort_noise).WillByDefault(Return(true));
+  EXPECT_CALL(*decoders_.at(1), DecodeFloatSamples).Times(0);
+  ASSERT_TRUE(mixer_->SetEncodedPacket(0, packet_));
+  ExpectMix(0, 0.f);
+  ExpectMix(1, 0.1f);
+
+  ASSERT_TRUE(mixer_->Mix().has_value());
+  EXPECT_EQ(mixer_->num_mixed_streams(), 1);
+}
+
+TEST_F(ConferenceMixerTest, LostPacketsAreConcealed) {
+  CreateMixer({0.1f, 0.2f});
+  ASSERT_TRUE(mixer_->SetEncodedPacket(0, packet_));
+  EXPECT_CALL(*decoders_.at(1), DecodeFloatSamples(kNumSamplesPerHop));
+  ExpectMix(0, 0.2f);
+  ExpectMix(1, 0.1f);
+
+  ASSERT_TRUE(mixer_->Mix().has_value());
+  EXPECT_EQ(mixer_->num_mixed_streams(), 2);
+}
+
+TEST_F(ConferenceMixerTest, MixIsClipped) {
+  CreateMixer({0.7f, 0.8f, -0.9f, 0.f});
+  for (int participant = 0; participant < 4; ++participant) {
+    ASSERT_TRUE(mixer_->SetEncodedPacket(participant, packet_));
+  }
+  ExpectMix(0, -0.1f);
+  ExpectMix(1, -0.2f);
+  ExpectMix(2, 1.f);
+  ExpectMix(3, 0.6f);
+
+  ASSERT_TRUE(mixer_->Mix().has_value());
+}
+
+TEST_F(ConferenceMixerTest, FailsOnDecoderFailure) {
+  CreateMixer({0.1f, 0.2f});
+  ON_CALL(*decoders_.at(1), DecodeFloatSamples)
+      .WillByDefault(Return(std::nullopt));
+  EXPECT_FALSE(mixer_->Mix().has_value());
+}
+
+TEST_F(ConferenceMixerTest, FailsOnEncoderFailure) {
+  CreateMixer({0.1f, 0.2f});
+  EXPECT_CALL(*encoders_.at(0), Encode(testing::An<absl::Span<const float>>()))
+      .WillOnce(Return(std::nullopt));
+  EXPECT_FALSE(mixer_->Mix().has_value());
+}
+
+TEST_F(ConferenceMixerTest, InvalidParticipantFails) {
+  CreateMixer({0.1f, 0.2f});
+  EXPECT_FALSE(mixer_->SetEncodedPacket(-1, packet_));
+  EXPECT_FALSE(mixer_->SetEncodedPacket(2, packet_));
+}
+
+TEST_F(ConferenceMixerTest, InvalidPacketFails) {
+  CreateMixer({0.1f});
+  EXPECT_CALL(*decoders_.at(0), SetEncodedPacket).WillOnce(Return(false));
+  EXPECT_FALSE(mixer_->SetEncodedPacket(0, packet_));
+}
+
+TEST(ConferenceMixerCreateTest, CreationFailsWithoutParticipants) {
+  EXPECT_EQ(ConferenceMixer::Create(16000, 0, 6000, false, "model_coeffs"),
+            nullptr);
+}
+
+TEST(ConferenceMixerCreateTest, ParticipantsShareTheModels) {
+  auto mixer = ConferenceMixer::Create(
+      16000, /*num_participants=*/3, QualityPresetToBitrate(1, 16000),
+      /*enable_dtx=*/false, ghc::filesystem::current_path() / "model_coeffs");
+  ASSERT_NE(mixer, nullptr);
+  EXPECT_EQ(mixer->num_participants(), 3);
+  // Besides the mixer, every decoder holds the one decoder model and every
+  // encoder the one encoder model.
+  const auto& decoder_model = ConferenceMixerPeer::decoder_model(*mixer);
+  const auto& encoder_model = ConferenceMixerPeer::encoder_model(*mixer);
+  ASSERT_NE(decoder_model, nullptr);
+  ASSERT_NE(encoder_model, nullptr);
+  EXPECT_NE(decoder_model, encoder_model);
+  EXPECT_EQ(decoder_model.use_count(), 1 + 3);
+  EXPECT_EQ(encoder_model.use_count(), 1 + 3);
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <optional>
 #include <string>
 #include <system_error>  // NOLINT(build/c++11)
 #include <vector>
@@ -20,10 +21,12 @@
 #include "absl/flags/parse.h"
 #include "absl/flags/usage.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "architecture_utils.h"
 #include "decoder_main_lib.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "include/ghc/filesystem.hpp"
+#include "jitter_network_model.h"
 
 ABSL_FLAG(std::string, encoded_path, "",
           "Complete path to the file containing the encoded features.");
@@ -37,6 +40,10 @@ ABSL_FLAG(int, sample_rate, 8000, "The sample rate of the original file");
 ABSL_FLAG(int, num_channels, 1, "The number of channels in the original file");
 ABSL_FLAG(int, quality_preset, 1,
           "The quality preset (1-8) at which the file has been quantized.");
+ABSL_FLAG(bool, length_prefixed, false,
+          "If true, the file is read as length-prefixed packets, as written "
+          "by variable bitrate or redundant encoding. --quality_preset is "
+          "then only validated.");
 ABSL_FLAG(bool, randomize_num_samples_requested, false,
           "If true, requests a random number of samples for decoding within "
           "each hop. If false, requests only one whole hop at a time.");
@@ -51,6 +58,26 @@ ABSL_FLAG(chromemedia::codec::PacketLossPattern, fixed_packet_loss_pattern,
           "bursts will be rounded up to the nearest packet duration boundary. "
           "If this flag contains a nonzero number of values we ignore "
           "|packet_loss_rate| and |average_burst_length|.");
+ABSL_FLAG(std::string, network_trace, "",
+          "Path to a network trace with one '<sequence> <arrival ms>' or "
+          "'<sequence> lost' line per packet. If set, packets are replayed "
+          "through the trace and the packet loss flags are ignored.");
+ABSL_FLAG(std::string, jitter_distribution, "",
+          "One of 'none', 'uniform', 'half_normal' or 'exponential'. If set, "
+          "packets are delayed by a simulated network and concealed when "
+          "they miss the playout deadline.");
+ABSL_FLAG(double, jitter_ms, 0.0,
+          "Scale of the jitter distribution in milliseconds.");
+ABSL_FLAG(double, base_delay_ms, 0.0,
+          "Constant network delay in milliseconds.");
+ABSL_FLAG(double, reorder_probability, 0.0,
+          "Probability that a packet is held back by --reorder_delay_ms.");
+ABSL_FLAG(double, reorder_delay_ms, 0.0,
+          "Extra delay in milliseconds of reordered packets.");
+ABSL_FLAG(double, playout_delay_ms, 60.0,
+          "Time in milliseconds a packet may spend in the network before it "
+          "misses its playout deadline. Only used with --network_trace or "
+          "--jitter_distribution.");
 ABSL_FLAG(std::string, model_path, "model_coeffs",
           "Path to directory containing TFLite files. For mobile this is the "
           "absolute path, like '/sdcard/model_coeffs/'. For desktop this is "
@@ -66,6 +93,7 @@ int main(int argc, char** argv) {
   const int sample_rate_hz = absl::GetFlag(FLAGS_sample_rate);
   const int quality_preset = absl::GetFlag(FLAGS_quality_preset);
   const int num_channels = absl::GetFlag(FLAGS_num_channels);
+  const bool length_prefixed = absl::GetFlag(FLAGS_length_prefixed);
   const bool randomize_num_samples_requested =
       absl::GetFlag(FLAGS_randomize_num_samples_requested);
   const float packet_loss_rate = absl::GetFlag(FLAGS_packet_loss_rate);
@@ -78,6 +106,37 @@ int main(int argc, char** argv) {
   if (!fixed_packet_loss_pattern.starts_.empty()) {
     LOG(INFO) << "Using fixed packet loss pattern instead of gilbert model.";
   }
+  std::optional<chromemedia::codec::NetworkImpairmentConfig>
+      network_impairment;
+  const std::string network_trace = absl::GetFlag(FLAGS_network_trace);
+  const std::string jitter_distribution =
+      absl::GetFlag(FLAGS_jitter_distribution);
+  if (!network_trace.empty() || !jitter_distribution.empty()) {
+    chromemedia::codec::NetworkImpairmentConfig config;
+    config.trace_path = network_trace;
+    config.playout_delay =
+        absl::Milliseconds(absl::GetFlag(FLAGS_playout_delay_ms));
+    if (network_trace.empty()) {
+      const auto distribution =
+          chromemedia::codec::ParseJitterDistribution(jitter_distribution);
+      if (!distribution.has_value()) {
+        LOG(ERROR) << "Unknown --jitter_distribution " << jitter_distribution;
+        return -1;
+      }
+      config.jitter_params.jitter_distribution = distribution.value();
+      config.jitter_params.jitter =
+          absl::Milliseconds(absl::GetFlag(FLAGS_jitter_ms));
+      config.jitter_params.base_delay =
+          absl::Milliseconds(absl::GetFlag(FLAGS_base_delay_ms));
+      config.jitter_params.reorder_probability =
+          absl::GetFlag(FLAGS_reorder_probability);
+      config.jitter_params.reorder_delay =
+          absl::Milliseconds(absl::GetFlag(FLAGS_reorder_delay_ms));
+      config.jitter_params.packet_loss_rate = packet_loss_rate;
+      config.jitter_params.average_burst_length = average_burst_length;
+    }
+    network_impairment = config;
+  }
   if (encoded_path.empty()) {
     LOG(ERROR) << "Flag --encoded_path not set.";
     return -1;
@@ -103,7 +162,8 @@ int main(int argc, char** argv) {
   if (!chromemedia::codec::DecodeFile(encoded_path, output_path, sample_rate_hz,
                                       quality_preset, randomize_num_samples_requested,
                                       packet_loss_rate, average_burst_length,
-                                      fixed_packet_loss_pattern, model_path, num_channels)) {
+                                      fixed_packet_loss_pattern, model_path, num_channels,
+                                      network_impairment, length_prefixed)) {
     LOG(ERROR) << "Could not decode " << encoded_path;
     return -1;
   }
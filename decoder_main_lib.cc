@@ -23,6 +23,7 @@
 #include <sstream>
 #include <string>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "absl/flags/marshalling.h"
@@ -37,8 +38,13 @@
 #include "gilbert_model.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "include/ghc/filesystem.hpp"
+#include "jitter_network_model.h"
 #include "lyra_config.h"
 #include "lyra_decoder.h"
+#include "network_impairment_model_interface.h"
+#include "packet_framing.h"
+#include "playout_deadline_model.h"
+#include "trace_network_model.h"
 #include "wav_utils.h"
 
 namespace chromemedia {
@@ -89,26 +95,54 @@ bool DecodeFeatures(const std::vector<uint8_t>& packet_stream, int packet_size,
                     PacketLossModelInterface* packet_loss_model,
                     std::vector<int16_t>* decoded_audio,
                     int sample_rate_hz) {
-  const int num_samples_per_packet =
-      GetNumSamplesPerHop(sample_rate_hz, (sample_rate_hz/320));
+  return DecodePackets(SplitFixedSizePackets(packet_stream, packet_size),
+                       randomize_num_samples_requested, gen, decoder,
+                       packet_loss_model, decoded_audio, sample_rate_hz);
+}
+
+bool DecodePackets(const std::vector<absl::Span<const uint8_t>>& packets,
+                   bool randomize_num_samples_requested, absl::BitGenRef gen,
+                   LyraDecoder* decoder,
+                   PacketLossModelInterface* packet_loss_model,
+                   std::vector<int16_t>* decoded_audio, int sample_rate_hz) {
+  const int num_samples_per_packet = GetNumSamplesPerHop(sample_rate_hz);
+  const int frame_rate = GetFrameRate(sample_rate_hz);
+
+  // Losses are drawn for all packets up front, so a lost packet can be
+  // recovered from the redundant copy in the next one, as a receiver with a
+  // jitter buffer of one frame would.
+  std::vector<bool> is_received(packets.size());
+  for (int frame_index = 0; frame_index < packets.size(); ++frame_index) {
+    is_received[frame_index] =
+        packet_loss_model == nullptr || packet_loss_model->IsPacketReceived();
+  }
+  int num_recovered_packets = 0;
 
   const auto benchmark_start = absl::Now();
-  for (int encoded_index = 0; encoded_index < packet_stream.size();
-       encoded_index += packet_size) {
-    const absl::Span<const uint8_t> encoded_packet =
-        absl::MakeConstSpan(packet_stream.data() + encoded_index, packet_size);
+  for (int frame_index = 0; frame_index < packets.size(); ++frame_index) {
+    const absl::Span<const uint8_t> encoded_packet = packets[frame_index];
 
-    const int frame_index = encoded_index / packet_size;
     const float packet_start_seconds =
-        static_cast<float>(frame_index) / (sample_rate_hz/320);
+        static_cast<float>(frame_index) / frame_rate;
     std::optional<std::vector<int16_t>> decoded;
-    if (packet_loss_model == nullptr || packet_loss_model->IsPacketReceived()) {
+    const bool is_next_received =
+        frame_index + 1 < packets.size() && is_received[frame_index + 1];
+    if (encoded_packet.empty()) {
+      // Frames which were not transmitted because of DTX are played out as
+      // comfort noise.
+      VLOG(1) << "Decoding DTX frame at " << packet_start_seconds
+              << " seconds.";
+    } else if (is_received[frame_index]) {
       if (!decoder->SetEncodedPacket(encoded_packet)) {
-        LOG(ERROR) << "Unable to set encoded packet starting at byte "
-                   << encoded_index << " at time " << packet_start_seconds
-                   << "s.";
+        LOG(ERROR) << "Unable to set encoded packet " << frame_index
+                   << " at time " << packet_start_seconds << "s.";
         return false;
       }
+    } else if (is_next_received &&
+               decoder->SetRedundantPacket(packets[frame_index + 1])) {
+      VLOG(1) << "Decoding packet starting at " << packet_start_seconds
+              << " seconds from the redundant copy in the next packet.";
+      ++num_recovered_packets;
     } else {
       VLOG(1) << "Decoding packet starting at " << packet_start_seconds
               << "seconds in PLC mode.";
@@ -125,8 +159,8 @@ bool DecodeFeatures(const std::vector<uint8_t>& packet_stream, int packet_size,
               << " samples for decoding.";
       decoded = decoder->DecodeSamples(samples_to_request);
       if (!decoded.has_value()) {
-        LOG(ERROR) << "Unable to decode features starting at byte "
-                   << encoded_index;
+        LOG(ERROR) << "Unable to decode features of packet " << frame_index
+                   << ".";
         return false;
       }
       samples_decoded_so_far += decoded->size();
@@ -139,6 +173,10 @@ bool DecodeFeatures(const std::vector<uint8_t>& packet_stream, int packet_size,
   LOG(INFO) << "Elapsed seconds : " << absl::ToInt64Seconds(elapsed);
   LOG(INFO) << "Samples per second : "
             << decoded_audio->size() / absl::ToDoubleSeconds(elapsed);
+  if (num_recovered_packets > 0) {
+    LOG(INFO) << "Packets recovered from redundancy : "
+              << num_recovered_packets;
+  }
   return true;
 }
 
@@ -147,20 +185,43 @@ bool DecodeFile(const ghc::filesystem::path& encoded_path,
                 int quality_preset, bool randomize_num_samples_requested,
                 float packet_loss_rate, float average_burst_length,
                 const PacketLossPattern& fixed_packet_loss_pattern,
-                const ghc::filesystem::path& model_path, int num_channels) {
+                const ghc::filesystem::path& model_path, int num_channels,
+                const std::optional<NetworkImpairmentConfig>&
+                    network_impairment,
+                bool length_prefixed) {
   auto decoder = LyraDecoder::Create(sample_rate_hz, num_channels, model_path);
   if (decoder == nullptr) {
     LOG(ERROR) << "Could not create lyra decoder.";
     return false;
   }
   std::unique_ptr<PacketLossModelInterface> packet_loss_model;
-  if (fixed_packet_loss_pattern.starts_.empty()) {
+  // Non-owning, only set when simulating network impairments.
+  PlayoutDeadlineModel* playout_deadline_model = nullptr;
+  if (network_impairment.has_value()) {
+    std::unique_ptr<NetworkImpairmentModelInterface> network_model;
+    if (!network_impairment->trace_path.empty()) {
+      network_model = TraceNetworkModel::Create(network_impairment->trace_path);
+    } else {
+      network_model =
+          JitterNetworkModel::Create(network_impairment->jitter_params);
+    }
+    if (network_model == nullptr) {
+      LOG(ERROR) << "Could not create network impairment model.";
+      return false;
+    }
+    auto model = std::make_unique<PlayoutDeadlineModel>(
+        std::move(network_model),
+        absl::Seconds(1) / GetFrameRate(sample_rate_hz),
+        network_impairment->playout_delay);
+    playout_deadline_model = model.get();
+    packet_loss_model = std::move(model);
+  } else if (fixed_packet_loss_pattern.starts_.empty()) {
     packet_loss_model =
         GilbertModel::Create(packet_loss_rate, average_burst_length);
 
   } else {
     packet_loss_model = std::make_unique<FixedPacketLossModel>(
-        sample_rate_hz, GetNumSamplesPerHop(sample_rate_hz, (sample_rate_hz/320)),
+        sample_rate_hz, GetNumSamplesPerHop(sample_rate_hz),
         fixed_packet_loss_pattern.starts_,
         fixed_packet_loss_pattern.durations_);
   }
@@ -178,42 +239,9 @@ bool DecodeFile(const ghc::filesystem::path& encoded_path,
       std::istreambuf_iterator<char>(encoded_stream),
       std::istreambuf_iterator<char>()};
 
-  int bitrate = 0;
-  int multiple = sample_rate_hz/8000;
-  if (quality_preset == 1) {
-    bitrate = 1600*multiple;
-    
-  } else if (quality_preset == 2) {
-    bitrate = (1400*multiple) + (1600*multiple);
-
-  } else if (quality_preset == 3) {
-    bitrate = (1400*multiple) + (1600*multiple)*2;
-  } else if (quality_preset == 4) {
-    bitrate = (1400*multiple)*2 + (1600*multiple)*2;
-  } else if (quality_preset == 5) {
-    bitrate = (1400*multiple)*2 + (1600*multiple)*3;
-  } else if (quality_preset == 6) {
-    bitrate = (1400*multiple)*3 + (1600*multiple)*3;
-  } else if (quality_preset == 7) {
-    bitrate = (1400*multiple)*3 + (1600*multiple)*4;
-  } else if (quality_preset == 8) {
-    bitrate = (1400*multiple)*4 + (1600*multiple)*4;
-  } else {
+  const int bitrate = QualityPresetToBitrate(quality_preset, sample_rate_hz);
+  if (bitrate < 0) {
     LOG(ERROR) << "Unsupported quality preset: " << quality_preset;
-  }
-  const int packet_size = BitrateToPacketSize(bitrate, (sample_rate_hz/320));
-  const int stream_size_remainder = packet_stream_string.size() % packet_size;
-  if (stream_size_remainder != 0) {
-    LOG(WARNING)
-        << "Read " << packet_stream_string.size()
-        << " bytes from file, which has a remainder when divided by packet "
-           "size. Removing the excess bytes from the end and attempting to "
-           "decode.";
-    packet_stream_string = packet_stream_string.substr(
-        0, packet_stream_string.size() - stream_size_remainder);
-  }
-  if (packet_stream_string.empty()) {
-    LOG(ERROR) << "File was empty or incomplete and truncated to empty size.";
     return false;
   }
   std::vector<uint8_t> packet_stream(packet_stream_string.size());
@@ -221,16 +249,57 @@ bool DecodeFile(const ghc::filesystem::path& encoded_path,
                  packet_stream.begin(),
                  [](char packet) { return static_cast<uint8_t>(packet); });
 
+  std::vector<absl::Span<const uint8_t>> packets;
+  if (length_prefixed) {
+    // With variable bitrate the quality preset is only the ceiling, and every
+    // record carries the size of its packet.
+    auto split_packets = SplitLengthPrefixedPackets(packet_stream);
+    if (!split_packets.has_value()) {
+      LOG(ERROR) << "File " << encoded_path
+                 << " is not a valid length-prefixed stream.";
+      return false;
+    }
+    packets = std::move(split_packets.value());
+  } else {
+    const int packet_size =
+        BitrateToPacketSize(bitrate, GetFrameRate(sample_rate_hz));
+    if (packet_stream.size() % packet_size != 0) {
+      LOG(WARNING)
+          << "Read " << packet_stream.size()
+          << " bytes from file, which has a remainder when divided by packet "
+             "size. Removing the excess bytes from the end and attempting to "
+             "decode.";
+    }
+    packets = SplitFixedSizePackets(packet_stream, packet_size);
+  }
+  if (packets.empty()) {
+    LOG(ERROR) << "File was empty or incomplete and truncated to empty size.";
+    return false;
+  }
+
   std::vector<int16_t> decoded_audio;
-  // Use one |gen| across each file. Creating |gen| inside |DecodeFeatures|
+  // Use one |gen| across each file. Creating |gen| inside |DecodePackets|
   // would use the same pattern for each hop.
   absl::BitGen gen;
-  if (!DecodeFeatures(packet_stream, packet_size,
-                      randomize_num_samples_requested, gen, decoder.get(),
-                      packet_loss_model.get(), &decoded_audio, sample_rate_hz)) {
+  if (!DecodePackets(packets, randomize_num_samples_requested, gen,
+                     decoder.get(), packet_loss_model.get(), &decoded_audio,
+                     sample_rate_hz)) {
     LOG(ERROR) << "Unable to decode features for file " << encoded_path;
     return false;
   }
+  if (playout_deadline_model != nullptr) {
+    LOG(INFO) << "Packets : " << playout_deadline_model->num_packets()
+              << " (lost " << playout_deadline_model->num_lost_packets()
+              << ", late " << playout_deadline_model->num_late_packets()
+              << ")";
+    LOG(INFO) << "Concealment rate : "
+              << playout_deadline_model->concealment_rate();
+    LOG(INFO) << "Network delay : mean "
+              << playout_deadline_model->mean_network_delay() << ", max "
+              << playout_deadline_model->max_network_delay();
+    LOG(INFO) << "Configured latency : "
+              << playout_deadline_model->configured_latency();
+  }
 
   absl::Status write_status =
       Write16BitWavFileFromVector(output_path.string(), num_channels,
@@ -18,12 +18,16 @@
 #define LYRA_CODEC_DECODER_MAIN_LIB_H_
 
 #include <cstdint>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "absl/random/bit_gen_ref.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "include/ghc/filesystem.hpp"
+#include "jitter_network_model.h"
 #include "lyra_decoder.h"
 #include "packet_loss_model_interface.h"
 
@@ -40,6 +44,16 @@ struct PacketLossPattern {
   std::vector<float> durations_;
 };
 
+// Used to simulate network delay, jitter and reordering in decoder_main.
+// If |trace_path| is not empty the trace is replayed, otherwise the network is
+// simulated with a |JitterNetworkModel| using |jitter_params|. Packets which
+// arrive more than |playout_delay| after they were sent are concealed.
+struct NetworkImpairmentConfig {
+  ghc::filesystem::path trace_path;
+  JitterNetworkParams jitter_params;
+  absl::Duration playout_delay;
+};
+
 std::string AbslUnparseFlag(chromemedia::codec::PacketLossPattern pattern);
 
 bool AbslParseFlag(absl::string_view text,
@@ -54,6 +68,17 @@ bool DecodeFeatures(const std::vector<uint8_t>& packet_stream, int packet_size,
                     PacketLossModelInterface* packet_loss_model,
                     std::vector<int16_t>* decoded_audio);
 
+// Decodes a sequence of packets into wav data. Empty packets mark frames which
+// were not transmitted because of DTX.
+// If |packet_loss_model| is nullptr no packets will be lost. A lost packet is
+// decoded from the redundant copy in the next packet, if that one is received
+// and carries one.
+bool DecodePackets(const std::vector<absl::Span<const uint8_t>>& packets,
+                   bool randomize_num_samples_requested, absl::BitGenRef gen,
+                   LyraDecoder* decoder,
+                   PacketLossModelInterface* packet_loss_model,
+                   std::vector<int16_t>* decoded_audio, int sample_rate_hz);
+
 // Decodes an encoded features file into a wav file.
 // Uses the model and quant files located under |model_path|.
 // Given the file /tmp/lyra/file1.lyra exists and is a valid encoded file. For:
@@ -61,13 +86,20 @@ bool DecodeFeatures(const std::vector<uint8_t>& packet_stream, int packet_size,
 // |output_path| = "/tmp/lyra/file1_decoded.lyra"
 // Then successful decoding will write out the file
 // /tmp/lyra/encoded/file1_decoded.wav
+// If |network_impairment| is set it replaces the packet loss parameters, and
+// the concealment rate, network delay and configured latency are logged.
+// If |length_prefixed| is true the file is read as length-prefixed records, as
+// written by variable bitrate encoding, and |bitrate| is only validated.
 bool DecodeFile(const ghc::filesystem::path& encoded_path,
                 const ghc::filesystem::path& output_path, int sample_rate_hz,
                 int bitrate, bool randomize_num_samples_requested,
                 float packet_loss_rate, float average_burst_length,
                 const PacketLossPattern& fixed_packet_loss_pattern,
                 const ghc::filesystem::path& model_path,
-                int num_channels);
+                int num_channels,
+                const std::optional<NetworkImpairmentConfig>&
+                    network_impairment = std::nullopt,
+                bool length_prefixed = false);
 
 }  // namespace codec
 }  // namespace chromemedia
@@ -14,6 +14,9 @@
 
 #include "decoder_main_lib.h"
 
+#include <cstdint>
+#include <fstream>
+#include <optional>
 #include <string>
 #include <system_error>  // NOLINT(build/c++11)
 #include <vector>
@@ -23,9 +26,11 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "gtest/gtest.h"
 #include "include/ghc/filesystem.hpp"
 #include "lyra_config.h"
+#include "packet_framing.h"
 #include "wav_utils.h"
 
 namespace chromemedia {
@@ -164,6 +169,98 @@ TEST_P(DecoderMainLibTest, TwoEncodedPacketsWithFixedPacketLoss) {
   EXPECT_EQ(NumSamplesInWavFile(output_path_), expected_num_samples);
 }
 
+TEST_P(DecoderMainLibTest, LengthPrefixedPacketsOfDifferentSizes) {
+  // A full packet, a DTX frame and a smaller packet.
+  std::vector<uint8_t> packet_stream;
+  ASSERT_TRUE(AppendLengthPrefixedPacket(
+      std::vector<uint8_t>(GetPacketSize(kSupportedQuantizedBits[1])),
+      &packet_stream));
+  ASSERT_TRUE(AppendLengthPrefixedPacket({}, &packet_stream));
+  ASSERT_TRUE(AppendLengthPrefixedPacket(
+      std::vector<uint8_t>(GetPacketSize(kSupportedQuantizedBits[0])),
+      &packet_stream));
+  input_path_ = output_dir_ / "length_prefixed.lyra";
+  output_path_ =
+      output_dir_ / absl::StrCat("length_prefixed_", GetParam(), ".wav");
+  {
+    std::ofstream encoded_stream(input_path_.string(), std::ios_base::binary);
+    ASSERT_TRUE(encoded_stream.is_open());
+    encoded_stream.write(reinterpret_cast<const char*>(packet_stream.data()),
+                         packet_stream.size());
+  }
+
+  EXPECT_TRUE(DecodeFile(
+      input_path_, output_path_, sample_rate_hz_,
+      /*bitrate=*/2, /*randomize_num_samples_requested=*/false,
+      /*packet_loss_rate=*/0.f,
+      /*average_burst_length=*/1.f, PacketLossPattern({}, {}), model_path_,
+      /*num_channels=*/1, /*network_impairment=*/std::nullopt,
+      /*length_prefixed=*/true));
+  EXPECT_EQ(NumSamplesInWavFile(output_path_), 3 * num_samples_in_packet_);
+}
+
+TEST_P(DecoderMainLibTest, TruncatedLengthPrefixedPacket) {
+  const std::vector<uint8_t> packet_stream = {15, 0, 0};
+  input_path_ = output_dir_ / "truncated_length_prefixed.lyra";
+  output_path_ = output_dir_ / absl::StrCat("truncated_length_prefixed_",
+                                            GetParam(), ".wav");
+  {
+    std::ofstream encoded_stream(input_path_.string(), std::ios_base::binary);
+    ASSERT_TRUE(encoded_stream.is_open());
+    encoded_stream.write(reinterpret_cast<const char*>(packet_stream.data()),
+                         packet_stream.size());
+  }
+
+  EXPECT_FALSE(DecodeFile(
+      input_path_, output_path_, sample_rate_hz_,
+      /*bitrate=*/2, /*randomize_num_samples_requested=*/false,
+      /*packet_loss_rate=*/0.f,
+      /*average_burst_length=*/1.f, PacketLossPattern({}, {}), model_path_,
+      /*num_channels=*/1, /*network_impairment=*/std::nullopt,
+      /*length_prefixed=*/true));
+}
+
+TEST_P(DecoderMainLibTest, NetworkTraceConcealsLostAndLatePackets) {
+  const std::vector<uint8_t> packet(GetPacketSize(kSupportedQuantizedBits[0]));
+  input_path_ = output_dir_ / "network_trace.lyra";
+  output_path_ =
+      output_dir_ / absl::StrCat("network_trace_", GetParam(), ".wav");
+  {
+    std::ofstream encoded_stream(input_path_.string(), std::ios_base::binary);
+    ASSERT_TRUE(encoded_stream.is_open());
+    for (int i = 0; i < 3; ++i) {
+      encoded_stream.write(reinterpret_cast<const char*>(packet.data()),
+                           packet.size());
+    }
+  }
+  // Packet 1 is lost and packet 2 misses its playout deadline. The far out
+  // sequence number must not make the trace allocate for every packet before
+  // it.
+  NetworkImpairmentConfig network_impairment;
+  network_impairment.trace_path =
+      output_dir_ / absl::StrCat("network_trace_", GetParam(), ".txt");
+  network_impairment.playout_delay = absl::Milliseconds(60);
+  {
+    std::ofstream trace(network_impairment.trace_path.string());
+    ASSERT_TRUE(trace.is_open());
+    trace << "0 10\n1 lost\n2 200\n2000000000 10\n";
+  }
+
+  EXPECT_TRUE(DecodeFile(
+      input_path_, output_path_, sample_rate_hz_, /*bitrate=*/1,
+      /*randomize_num_samples_requested=*/false, /*packet_loss_rate=*/0.f,
+      /*average_burst_length=*/1.f, PacketLossPattern({}, {}), model_path_,
+      /*num_channels=*/1, network_impairment));
+  EXPECT_EQ(NumSamplesInWavFile(output_path_), 3 * num_samples_in_packet_);
+
+  network_impairment.trace_path = output_dir_ / "does_not_exist.txt";
+  EXPECT_FALSE(DecodeFile(
+      input_path_, output_path_, sample_rate_hz_, /*bitrate=*/1,
+      /*randomize_num_samples_requested=*/false, /*packet_loss_rate=*/0.f,
+      /*average_burst_length=*/1.f, PacketLossPattern({}, {}), model_path_,
+      /*num_channels=*/1, network_impairment));
+}
+
 INSTANTIATE_TEST_SUITE_P(SampleRates, DecoderMainLibTest,
                          testing::ValuesIn(kSupportedSampleRates));
 
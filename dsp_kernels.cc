@@ -0,0 +1,420 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dsp_kernels.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LYRA_DSP_KERNELS_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+// NEON is part of the baseline of aarch64, so it needs no runtime detection.
+#define LYRA_DSP_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+// The negated minimum of int16, which unit floats are scaled by.
+constexpr float kInt16Scale = 32768.f;
+constexpr float kInt16Min = -32768.f;
+constexpr float kInt16Max = 32767.f;
+
+// Per sample operations, which the vectorized kernels also use for the
+// samples left over after their last full vector.
+
+inline int16_t UnitToInt16Sample(float value) {
+  return static_cast<int16_t>(
+      std::min(std::max(value * kInt16Scale, kInt16Min), kInt16Max));
+}
+
+inline float Int16ToUnitSample(int16_t value) {
+  return static_cast<float>(value) / kInt16Scale;
+}
+
+template <typename T>
+inline T CrossfadeSample(T from, T to, float weight) {
+  return from * weight + to * (1.f - weight);
+}
+
+void UnitToInt16Scalar(const float* input, int num_samples, int16_t* output) {
+  for (int i = 0; i < num_samples; ++i) {
+    output[i] = UnitToInt16Sample(input[i]);
+  }
+}
+
+void Int16ToUnitScalar(const int16_t* input, int num_samples, float* output) {
+  for (int i = 0; i < num_samples; ++i) {
+    output[i] = Int16ToUnitSample(input[i]);
+  }
+}
+
+void CrossfadeScalar(const float* from, const float* to, const float* weights,
+                     int num_samples, float* output) {
+  for (int i = 0; i < num_samples; ++i) {
+    output[i] = CrossfadeSample(from[i], to[i], weights[i]);
+  }
+}
+
+void CrossfadeInt16Scalar(const int16_t* from, const int16_t* to,
+                          const float* weights, int num_samples,
+                          int16_t* output) {
+  for (int i = 0; i < num_samples; ++i) {
+    output[i] = static_cast<int16_t>(
+        CrossfadeSample<float>(from[i], to[i], weights[i]));
+  }
+}
+
+constexpr DspKernels kScalarKernels = {
+    SimdLevel::kScalar, UnitToInt16Scalar, Int16ToUnitScalar, CrossfadeScalar,
+    CrossfadeInt16Scalar};
+
+#if defined(LYRA_DSP_KERNELS_X86)
+
+// The AVX2 and AVX-512 kernels are compiled for their instruction set with
+// target attributes, so the rest of the binary keeps running on any x86 CPU.
+// AVX-512 implies FMA, so the library is built with -ffp-contract=off to keep
+// the weighted sums rounding exactly like the scalar ones.
+
+__attribute__((target("avx2"))) void UnitToInt16Avx2(const float* input,
+                                                      int num_samples,
+                                                      int16_t* output) {
+  const __m256 scale = _mm256_set1_ps(kInt16Scale);
+  const __m256 min = _mm256_set1_ps(kInt16Min);
+  const __m256 max = _mm256_set1_ps(kInt16Max);
+  int i = 0;
+  for (; i + 8 <= num_samples; i += 8) {
+    const __m256 scaled = _mm256_min_ps(
+        _mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(input + i), scale), min),
+        max);
+    const __m256i truncated = _mm256_cvttps_epi32(scaled);
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(output + i),
+        _mm_packs_epi32(_mm256_castsi256_si128(truncated),
+                        _mm256_extracti128_si256(truncated, 1)));
+  }
+  for (; i < num_samples; ++i) {
+    output[i] = UnitToInt16Sample(input[i]);
+  }
+}
+
+__attribute__((target("avx2"))) void Int16ToUnitAvx2(const int16_t* input,
+                                                      int num_samples,
+                                                      float* output) {
+  const __m256 inverse_scale = _mm256_set1_ps(1.f / kInt16Scale);
+  int i = 0;
+  for (; i + 8 <= num_samples; i += 8) {
+    const __m256i widened = _mm256_cvtepi16_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i)));
+    _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(widened),
+                                               inverse_scale));
+  }
+  for (; i < num_samples; ++i) {
+    output[i] = Int16ToUnitSample(input[i]);
+  }
+}
+
+__attribute__((target("avx2"))) inline __m256 CrossfadeAvx2(__m256 from,
+                                                             __m256 to,
+                                                             __m256 weights) {
+  return _mm256_add_ps(
+      _mm256_mul_ps(from, weights),
+      _mm256_mul_ps(to, _mm256_sub_ps(_mm256_set1_ps(1.f), weights)));
+}
+
+__attribute__((target("avx2"))) void CrossfadeAvx2(const float* from,
+                                                    const float* to,
+                                                    const float* weights,
+                                                    int num_samples,
+                                                    float* output) {
+  int i = 0;
+  for (; i + 8 <= num_samples; i += 8) {
+    _mm256_storeu_ps(output + i, CrossfadeAvx2(_mm256_loadu_ps(from + i),
+                                               _mm256_loadu_ps(to + i),
+                                               _mm256_loadu_ps(weights + i)));
+  }
+  for (; i < num_samples; ++i) {
+    output[i] = CrossfadeSample(from[i], to[i], weights[i]);
+  }
+}
+
+__attribute__((target("avx2"))) inline __m256 LoadInt16Avx2(
+    const int16_t* input) {
+  return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(input))));
+}
+
+__attribute__((target("avx2"))) void CrossfadeInt16Avx2(const int16_t* from,
+                                                         const int16_t* to,
+                                                         const float* weights,
+                                                         int num_samples,
+                                                         int16_t* output) {
+  int i = 0;
+  for (; i + 8 <= num_samples; i += 8) {
+    const __m256i truncated = _mm256_cvttps_epi32(
+        CrossfadeAvx2(LoadInt16Avx2(from + i), LoadInt16Avx2(to + i),
+                      _mm256_loadu_ps(weights + i)));
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(output + i),
+        _mm_packs_epi32(_mm256_castsi256_si128(truncated),
+                        _mm256_extracti128_si256(truncated, 1)));
+  }
+  for (; i < num_samples; ++i) {
+    output[i] = static_cast<int16_t>(
+        CrossfadeSample<float>(from[i], to[i], weights[i]));
+  }
+}
+
+constexpr DspKernels kAvx2Kernels = {SimdLevel::kAvx2, UnitToInt16Avx2,
+                                     Int16ToUnitAvx2, CrossfadeAvx2,
+                                     CrossfadeInt16Avx2};
+
+__attribute__((target("avx512f"))) void UnitToInt16Avx512(const float* input,
+                                                           int num_samples,
+                                                           int16_t* output) {
+  const __m512 scale = _mm512_set1_ps(kInt16Scale);
+  const __m512 min = _mm512_set1_ps(kInt16Min);
+  const __m512 max = _mm512_set1_ps(kInt16Max);
+  int i = 0;
+  for (; i + 16 <= num_samples; i += 16) {
+    const __m512 scaled = _mm512_min_ps(
+        _mm512_max_ps(_mm512_mul_ps(_mm512_loadu_ps(input + i), scale), min),
+        max);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i),
+                        _mm512_cvtsepi32_epi16(_mm512_cvttps_epi32(scaled)));
+  }
+  for (; i < num_samples; ++i) {
+    output[i] = UnitToInt16Sample(input[i]);
+  }
+}
+
+__attribute__((target("avx512f"))) void Int16ToUnitAvx512(
+    const int16_t* input, int num_samples, float* output) {
+  const __m512 inverse_scale = _mm512_set1_ps(1.f / kInt16Scale);
+  int i = 0;
+  for (; i + 16 <= num_samples; i += 16) {
+    const __m512i widened = _mm512_cvtepi16_epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i)));
+    _mm512_storeu_ps(output + i, _mm512_mul_ps(_mm512_cvtepi32_ps(widened),
+                                               inverse_scale));
+  }
+  for (; i < num_samples; ++i) {
+    output[i] = Int16ToUnitSample(input[i]);
+  }
+}
+
+__attribute__((target("avx512f"))) inline __m512 CrossfadeAvx512(
+    __m512 from, __m512 to, __m512 weights) {
+  return _mm512_add_ps(
+      _mm512_mul_ps(from, weights),
+      _mm512_mul_ps(to, _mm512_sub_ps(_mm512_set1_ps(1.f), weights)));
+}
+
+__attribute__((target("avx512f"))) void CrossfadeAvx512(const float* from,
+                                                         const float* to,
+                                                         const float* weights,
+                                                         int num_samples,
+                                                         float* output) {
+  int i = 0;
+  for (; i + 16 <= num_samples; i += 16) {
+    _mm512_storeu_ps(output + i,
+                     CrossfadeAvx512(_mm512_loadu_ps(from + i),
+                                     _mm512_loadu_ps(to + i),
+                                     _mm512_loadu_ps(weights + i)));
+  }
+  for (; i < num_samples; ++i) {
+    output[i] = CrossfadeSample(from[i], to[i], weights[i]);
+  }
+}
+
+__attribute__((target("avx512f"))) inline __m512 LoadInt16Avx512(
+    const int16_t* input) {
+  return _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input))));
+}
+
+__attribute__((target("avx512f"))) void CrossfadeInt16Avx512(
+    const int16_t* from, const int16_t* to, const float* weights,
+    int num_samples, int16_t* output) {
+  int i = 0;
+  for (; i + 16 <= num_samples; i += 16) {
+    const __m512i truncated = _mm512_cvttps_epi32(
+        CrossfadeAvx512(LoadInt16Avx512(from + i), LoadInt16Avx512(to + i),
+                        _mm512_loadu_ps(weights + i)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i),
+                        _mm512_cvtsepi32_epi16(truncated));
+  }
+  for (; i < num_samples; ++i) {
+    output[i] = static_cast<int16_t>(
+        CrossfadeSample<float>(from[i], to[i], weights[i]));
+  }
+}
+
+constexpr DspKernels kAvx512Kernels = {SimdLevel::kAvx512, UnitToInt16Avx512,
+                                       Int16ToUnitAvx512, CrossfadeAvx512,
+                                       CrossfadeInt16Avx512};
+
+#elif defined(LYRA_DSP_KERNELS_NEON)
+
+void UnitToInt16Neon(const float* input, int num_samples, int16_t* output) {
+  const float32x4_t min = vdupq_n_f32(kInt16Min);
+  const float32x4_t max = vdupq_n_f32(kInt16Max);
+  int i = 0;
+  for (; i + 8 <= num_samples; i += 8) {
+    const float32x4_t low = vminq_f32(
+        vmaxq_f32(vmulq_n_f32(vld1q_f32(input + i), kInt16Scale), min), max);
+    const float32x4_t high = vminq_f32(
+        vmaxq_f32(vmulq_n_f32(vld1q_f32(input + i + 4), kInt16Scale), min),
+        max);
+    vst1q_s16(output + i, vcombine_s16(vqmovn_s32(vcvtq_s32_f32(low)),
+                                       vqmovn_s32(vcvtq_s32_f32(high))));
+  }
+  for (; i < num_samples; ++i) {
+    output[i] = UnitToInt16Sample(input[i]);
+  }
+}
+
+void Int16ToUnitNeon(const int16_t* input, int num_samples, float* output) {
+  int i = 0;
+  for (; i + 8 <= num_samples; i += 8) {
+    const int16x8_t samples = vld1q_s16(input + i);
+    vst1q_f32(output + i,
+              vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(samples))),
+                          1.f / kInt16Scale));
+    vst1q_f32(output + i + 4,
+              vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(samples))),
+                          1.f / kInt16Scale));
+  }
+  for (; i < num_samples; ++i) {
+    output[i] = Int16ToUnitSample(input[i]);
+  }
+}
+
+inline float32x4_t CrossfadeNeon(float32x4_t from, float32x4_t to,
+                                 float32x4_t weights) {
+  return vaddq_f32(vmulq_f32(from, weights),
+                   vmulq_f32(to, vsubq_f32(vdupq_n_f32(1.f), weights)));
+}
+
+void CrossfadeNeon(const float* from, const float* to, const float* weights,
+                   int num_samples, float* output) {
+  int i = 0;
+  for (; i + 4 <= num_samples; i += 4) {
+    vst1q_f32(output + i, CrossfadeNeon(vld1q_f32(from + i),
+                                        vld1q_f32(to + i),
+                                        vld1q_f32(weights + i)));
+  }
+  for (; i < num_samples; ++i) {
+    output[i] = CrossfadeSample(from[i], to[i], weights[i]);
+  }
+}
+
+void CrossfadeInt16Neon(const int16_t* from, const int16_t* to,
+                        const float* weights, int num_samples,
+                        int16_t* output) {
+  int i = 0;
+  for (; i + 8 <= num_samples; i += 8) {
+    const int16x8_t from_samples = vld1q_s16(from + i);
+    const int16x8_t to_samples = vld1q_s16(to + i);
+    const float32x4_t low = CrossfadeNeon(
+        vcvtq_f32_s32(vmovl_s16(vget_low_s16(from_samples))),
+        vcvtq_f32_s32(vmovl_s16(vget_low_s16(to_samples))),
+        vld1q_f32(weights + i));
+    const float32x4_t high = CrossfadeNeon(
+        vcvtq_f32_s32(vmovl_s16(vget_high_s16(from_samples))),
+        vcvtq_f32_s32(vmovl_s16(vget_high_s16(to_samples))),
+        vld1q_f32(weights + i + 4));
+    vst1q_s16(output + i, vcombine_s16(vqmovn_s32(vcvtq_s32_f32(low)),
+                                       vqmovn_s32(vcvtq_s32_f32(high))));
+  }
+  for (; i < num_samples; ++i) {
+    output[i] = static_cast<int16_t>(
+        CrossfadeSample<float>(from[i], to[i], weights[i]));
+  }
+}
+
+constexpr DspKernels kNeonKernels = {SimdLevel::kNeon, UnitToInt16Neon,
+                                     Int16ToUnitNeon, CrossfadeNeon,
+                                     CrossfadeInt16Neon};
+
+#endif
+
+}  // namespace
+
+absl::string_view SimdLevelName(SimdLevel level) {
+  switch (level) {
+    case SimdLevel::kScalar:
+      return "Scalar";
+    case SimdLevel::kNeon:
+      return "Neon";
+    case SimdLevel::kAvx2:
+      return "Avx2";
+    case SimdLevel::kAvx512:
+      return "Avx512";
+  }
+  return "Unknown";
+}
+
+std::vector<SimdLevel> GetSupportedSimdLevels() {
+  std::vector<SimdLevel> levels = {SimdLevel::kScalar};
+#if defined(LYRA_DSP_KERNELS_X86)
+  if (__builtin_cpu_supports("avx2")) {
+    levels.push_back(SimdLevel::kAvx2);
+    if (__builtin_cpu_supports("avx512f")) {
+      levels.push_back(SimdLevel::kAvx512);
+    }
+  }
+#elif defined(LYRA_DSP_KERNELS_NEON)
+  levels.push_back(SimdLevel::kNeon);
+#endif
+  return levels;
+}
+
+const DspKernels* GetDspKernelsForLevel(SimdLevel level) {
+  const std::vector<SimdLevel> levels = GetSupportedSimdLevels();
+  if (std::find(levels.begin(), levels.end(), level) == levels.end()) {
+    return nullptr;
+  }
+  switch (level) {
+    case SimdLevel::kScalar:
+      return &kScalarKernels;
+#if defined(LYRA_DSP_KERNELS_X86)
+    case SimdLevel::kAvx2:
+      return &kAvx2Kernels;
+    case SimdLevel::kAvx512:
+      return &kAvx512Kernels;
+#elif defined(LYRA_DSP_KERNELS_NEON)
+    case SimdLevel::kNeon:
+      return &kNeonKernels;
+#endif
+    default:
+      return nullptr;
+  }
+}
+
+const DspKernels& GetDspKernels() {
+  static const DspKernels* const kKernels =
+      GetDspKernelsForLevel(GetSupportedSimdLevels().back());
+  return *kKernels;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_DSP_KERNELS_H_
+#define LYRA_CODEC_DSP_KERNELS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+namespace chromemedia {
+namespace codec {
+
+// Instruction set extensions which DSP kernels are specialized for.
+enum class SimdLevel {
+  // Portable C++, vectorized only as far as the compiler manages to for the
+  // baseline architecture of the build.
+  kScalar,
+  kNeon,
+  kAvx2,
+  kAvx512,
+};
+
+absl::string_view SimdLevelName(SimdLevel level);
+
+// Table of the DSP kernels of one SimdLevel. All arrays hold |num_samples|
+// elements. An output may be the same array as an input of the same type, but
+// may not partially overlap it.
+struct DspKernels {
+  SimdLevel level;
+  // Scales unit floats to int16 and clips them. Matches UnitToInt16Scalar().
+  void (*unit_to_int16)(const float* input, int num_samples, int16_t* output);
+  // Scales int16 to unit floats. Matches Int16ToUnitScalar().
+  void (*int16_to_unit)(const int16_t* input, int num_samples, float* output);
+  // Writes |weights| * |from| + (1 - |weights|) * |to| to |output|.
+  void (*crossfade)(const float* from, const float* to, const float* weights,
+                    int num_samples, float* output);
+  // Same as |crossfade| for int16 samples, truncating the weighted sums.
+  void (*crossfade_int16)(const int16_t* from, const int16_t* to,
+                          const float* weights, int num_samples,
+                          int16_t* output);
+};
+
+// Returns the levels which are compiled in and supported by the host CPU,
+// from kScalar up to the best one.
+std::vector<SimdLevel> GetSupportedSimdLevels();
+
+// Returns the kernels of |level|, or nullptr if |level| is not supported.
+const DspKernels* GetDspKernelsForLevel(SimdLevel level);
+
+// Returns the kernels of the best supported level. The host CPU is only
+// inspected on the first call, so this is cheap enough to call per hop.
+const DspKernels& GetDspKernels();
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_DSP_KERNELS_H_
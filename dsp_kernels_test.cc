@@ -0,0 +1,186 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dsp_kernels.h"
+
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "dsp_utils.h"
+#include "gtest/gtest.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+// Sizes around the vector widths of all levels, to cover the leftover samples
+// after the last full vector.
+constexpr int kTestNumSamples[] = {0, 1, 3, 4, 7, 8, 9, 15, 16, 17, 33, 320};
+
+// Checks every supported level against the scalar kernels, which are in turn
+// checked against the reference implementations in dsp_utils.h. All levels
+// are expected to be bit-exact.
+class DspKernelsTest : public testing::TestWithParam<SimdLevel> {
+ protected:
+  DspKernelsTest()
+      : kernels_(GetDspKernelsForLevel(GetParam())),
+        scalar_kernels_(GetDspKernelsForLevel(SimdLevel::kScalar)),
+        gen_(1) {}
+
+  std::vector<float> RandomFloats(int num_samples, float min, float max) {
+    std::uniform_real_distribution<float> distribution(min, max);
+    std::vector<float> values(num_samples);
+    for (float& value : values) {
+      value = distribution(gen_);
+    }
+    return values;
+  }
+
+  std::vector<int16_t> RandomInt16s(int num_samples) {
+    std::uniform_int_distribution<int16_t> distribution(
+        std::numeric_limits<int16_t>::min(),
+        std::numeric_limits<int16_t>::max());
+    std::vector<int16_t> values(num_samples);
+    for (int16_t& value : values) {
+      value = distribution(gen_);
+    }
+    // Always cover the extremes.
+    if (num_samples >= 2) {
+      values.front() = std::numeric_limits<int16_t>::min();
+      values.back() = std::numeric_limits<int16_t>::max();
+    }
+    return values;
+  }
+
+  const DspKernels* kernels_;
+  const DspKernels* scalar_kernels_;
+  std::mt19937 gen_;
+};
+
+TEST_P(DspKernelsTest, LevelIsSupported) {
+  ASSERT_NE(kernels_, nullptr);
+  EXPECT_EQ(kernels_->level, GetParam());
+}
+
+TEST_P(DspKernelsTest, UnitToInt16MatchesReference) {
+  ASSERT_NE(kernels_, nullptr);
+  for (const int num_samples : kTestNumSamples) {
+    // Exceed the unit range to also cover clipping.
+    const std::vector<float> input = RandomFloats(num_samples, -1.25f, 1.25f);
+    std::vector<int16_t> output(num_samples);
+    kernels_->unit_to_int16(input.data(), num_samples, output.data());
+    for (int i = 0; i < num_samples; ++i) {
+      EXPECT_EQ(output[i], UnitToInt16Scalar(input[i]))
+          << "num_samples=" << num_samples << ", i=" << i;
+    }
+  }
+}
+
+TEST_P(DspKernelsTest, Int16ToUnitMatchesReference) {
+  ASSERT_NE(kernels_, nullptr);
+  for (const int num_samples : kTestNumSamples) {
+    const std::vector<int16_t> input = RandomInt16s(num_samples);
+    std::vector<float> output(num_samples);
+    kernels_->int16_to_unit(input.data(), num_samples, output.data());
+    for (int i = 0; i < num_samples; ++i) {
+      EXPECT_EQ(output[i], Int16ToUnitScalar<float>(input[i]))
+          << "num_samples=" << num_samples << ", i=" << i;
+    }
+  }
+}
+
+TEST_P(DspKernelsTest, CrossfadeMatchesScalar) {
+  ASSERT_NE(kernels_, nullptr);
+  for (const int num_samples : kTestNumSamples) {
+    const std::vector<float> from = RandomFloats(num_samples, -1.f, 1.f);
+    const std::vector<float> to = RandomFloats(num_samples, -1.f, 1.f);
+    const std::vector<float> weights = RandomFloats(num_samples, 0.f, 1.f);
+    std::vector<float> output(num_samples);
+    std::vector<float> scalar_output(num_samples);
+    kernels_->crossfade(from.data(), to.data(), weights.data(), num_samples,
+                        output.data());
+    scalar_kernels_->crossfade(from.data(), to.data(), weights.data(),
+                               num_samples, scalar_output.data());
+    EXPECT_EQ(output, scalar_output) << "num_samples=" << num_samples;
+    for (int i = 0; i < num_samples; ++i) {
+      // The reference may be compiled with multiply-adds fused.
+      EXPECT_FLOAT_EQ(scalar_output[i],
+                      from[i] * weights[i] + to[i] * (1.f - weights[i]));
+    }
+  }
+}
+
+TEST_P(DspKernelsTest, CrossfadeInt16MatchesScalar) {
+  ASSERT_NE(kernels_, nullptr);
+  for (const int num_samples : kTestNumSamples) {
+    const std::vector<int16_t> from = RandomInt16s(num_samples);
+    const std::vector<int16_t> to = RandomInt16s(num_samples);
+    const std::vector<float> weights = RandomFloats(num_samples, 0.f, 1.f);
+    std::vector<int16_t> output(num_samples);
+    std::vector<int16_t> scalar_output(num_samples);
+    kernels_->crossfade_int16(from.data(), to.data(), weights.data(),
+                              num_samples, output.data());
+    scalar_kernels_->crossfade_int16(from.data(), to.data(), weights.data(),
+                                     num_samples, scalar_output.data());
+    EXPECT_EQ(output, scalar_output) << "num_samples=" << num_samples;
+    for (int i = 0; i < num_samples; ++i) {
+      EXPECT_NEAR(scalar_output[i],
+                  from[i] * weights[i] + to[i] * (1.f - weights[i]), 1.f);
+    }
+  }
+}
+
+TEST_P(DspKernelsTest, CrossfadeInPlace) {
+  ASSERT_NE(kernels_, nullptr);
+  const int kNumSamples = 320;
+  const std::vector<float> to = RandomFloats(kNumSamples, -1.f, 1.f);
+  const std::vector<float> weights = RandomFloats(kNumSamples, 0.f, 1.f);
+  std::vector<float> from_and_output = RandomFloats(kNumSamples, -1.f, 1.f);
+  std::vector<float> expected(kNumSamples);
+  scalar_kernels_->crossfade(from_and_output.data(), to.data(),
+                             weights.data(), kNumSamples, expected.data());
+  kernels_->crossfade(from_and_output.data(), to.data(), weights.data(),
+                      kNumSamples, from_and_output.data());
+  EXPECT_EQ(from_and_output, expected);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    SupportedLevels, DspKernelsTest,
+    testing::ValuesIn(GetSupportedSimdLevels()),
+    [](const testing::TestParamInfo<SimdLevel>& info) {
+      return std::string(SimdLevelName(info.param));
+    });
+
+TEST(DspKernelsDispatchTest, SelectsBestSupportedLevel) {
+  const std::vector<SimdLevel> levels = GetSupportedSimdLevels();
+  ASSERT_FALSE(levels.empty());
+  EXPECT_EQ(levels.front(), SimdLevel::kScalar);
+  EXPECT_EQ(GetDspKernels().level, levels.back());
+  EXPECT_EQ(&GetDspKernels(), GetDspKernelsForLevel(levels.back()));
+}
+
+TEST(DspKernelsDispatchTest, UnsupportedLevelHasNoKernels) {
+#if defined(__aarch64__)
+  EXPECT_EQ(GetDspKernelsForLevel(SimdLevel::kAvx2), nullptr);
+#else
+  EXPECT_EQ(GetDspKernelsForLevel(SimdLevel::kNeon), nullptr);
+#endif
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
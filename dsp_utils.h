@@ -27,6 +27,7 @@
 #include <vector>
 
 #include "absl/types/span.h"
+#include "dsp_kernels.h"
 
 namespace chromemedia {
 namespace codec {
@@ -93,11 +94,18 @@ template <typename T>
 typename std::enable_if<std::is_floating_point<T>::value,
                         std::vector<int16_t>>::type
 UnitToInt16(const absl::Span<const T> input) {
-  std::vector<int16_t> output;
-  output.reserve(input.size());
-  std::transform(input.begin(), input.end(), std::back_inserter(output),
-                 UnitToInt16Scalar<T>);
-  return output;
+  if constexpr (std::is_same_v<T, float>) {
+    // Floats take the vectorized kernel of the host CPU.
+    std::vector<int16_t> output(input.size());
+    GetDspKernels().unit_to_int16(input.data(), input.size(), output.data());
+    return output;
+  } else {
+    std::vector<int16_t> output;
+    output.reserve(input.size());
+    std::transform(input.begin(), input.end(), std::back_inserter(output),
+                   UnitToInt16Scalar<T>);
+    return output;
+  }
 }
 
 // Converts from a 16-bit integers to a unit-floats or unit-doubles.
@@ -112,11 +120,18 @@ Int16ToUnitScalar(int16_t integer) {
 template <typename T>
 typename std::enable_if<std::is_floating_point<T>::value, std::vector<T>>::type
 Int16ToUnit(const absl::Span<const int16_t> input) {
-  std::vector<T> output;
-  output.reserve(input.size());
-  std::transform(input.begin(), input.end(), std::back_inserter(output),
-                 Int16ToUnitScalar<T>);
-  return output;
+  if constexpr (std::is_same_v<T, float>) {
+    // Floats take the vectorized kernel of the host CPU.
+    std::vector<float> output(input.size());
+    GetDspKernels().int16_to_unit(input.data(), input.size(), output.data());
+    return output;
+  } else {
+    std::vector<T> output;
+    output.reserve(input.size());
+    std::transform(input.begin(), input.end(), std::back_inserter(output),
+                   Int16ToUnitScalar<T>);
+    return output;
+  }
 }
 
 }  // namespace codec
@@ -40,6 +40,16 @@ ABSL_FLAG(bool, enable_preprocessing, false,
 ABSL_FLAG(bool, enable_dtx, false,
           "Enables discontinuous transmission (DTX). DTX does not send packets "
           "when noise is detected.");
+ABSL_FLAG(double, vbr_max_residual_error, 0.0,
+          "If positive, enables variable bitrate encoding. Each frame uses "
+          "the lowest bitrate whose quantization residual energy, relative "
+          "to the feature energy, is below this value. --quality_preset is "
+          "then the ceiling. The output has to be decoded with "
+          "--length_prefixed.");
+ABSL_FLAG(double, fec_packet_loss_rate, 0.0,
+          "If positive, packets carry a low-rate copy of the previous frame "
+          "for a receiver which reports this packet loss rate. The output "
+          "has to be decoded with --length_prefixed.");
 ABSL_FLAG(std::string, model_path, "model_coeffs",
           "Path to directory containing TFLite files. For mobile this is the "
           "absolute path, like '/sdcard/model_coeffs/'. For desktop this is "
@@ -57,6 +67,9 @@ int main(int argc, char** argv) {
   const int quality_preset = absl::GetFlag(FLAGS_quality_preset);
   const bool enable_preprocessing = absl::GetFlag(FLAGS_enable_preprocessing);
   const bool enable_dtx = absl::GetFlag(FLAGS_enable_dtx);
+  const float vbr_max_residual_error =
+      absl::GetFlag(FLAGS_vbr_max_residual_error);
+  const float fec_packet_loss_rate = absl::GetFlag(FLAGS_fec_packet_loss_rate);
 
   if (input_path.empty()) {
     LOG(ERROR) << "Flag --input_path not set.";
@@ -81,7 +94,8 @@ int main(int argc, char** argv) {
 
   if (!chromemedia::codec::EncodeFile(input_path, output_path, quality_preset,
                                       enable_preprocessing, enable_dtx,
-                                      model_path)) {
+                                      model_path, vbr_max_residual_error,
+                                      fec_packet_loss_rate)) {
     LOG(ERROR) << "Failed to encode " << input_path;
     return -1;
   }
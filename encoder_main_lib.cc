@@ -33,6 +33,7 @@
 #include "lyra_config.h"
 #include "lyra_encoder.h"
 #include "no_op_preprocessor.h"
+#include "packet_framing.h"
 #include "wav_utils.h"
 
 namespace chromemedia {
@@ -43,7 +44,8 @@ namespace codec {
 bool EncodeWav(const std::vector<int16_t>& wav_data, int num_channels,
                int sample_rate_hz, int bitrate, bool enable_preprocessing,
                bool enable_dtx, const ghc::filesystem::path& model_path,
-               std::vector<uint8_t>* encoded_features) {
+               std::vector<uint8_t>* encoded_features,
+               float vbr_max_residual_error, float fec_packet_loss_rate) {
   auto encoder = LyraEncoder::Create(/*sample_rate_hz=*/sample_rate_hz,
                                      /*num_channels=*/num_channels,
                                      /*bitrate=*/bitrate,
@@ -53,6 +55,18 @@ bool EncodeWav(const std::vector<int16_t>& wav_data, int num_channels,
     LOG(ERROR) << "Could not create lyra encoder.";
     return false;
   }
+  const bool is_variable_bitrate = vbr_max_residual_error > 0.f;
+  if (is_variable_bitrate &&
+      !encoder->EnableVariableBitrate(vbr_max_residual_error, bitrate)) {
+    LOG(ERROR) << "Could not enable variable bitrate encoding.";
+    return false;
+  }
+  const bool is_redundant = fec_packet_loss_rate > 0.f;
+  if (is_redundant && !encoder->SetPacketLossRate(fec_packet_loss_rate)) {
+    LOG(ERROR) << "Could not enable redundancy.";
+    return false;
+  }
+  const bool is_length_prefixed = is_variable_bitrate || is_redundant;
 
   std::unique_ptr<PreprocessorInterface> preprocessor;
   if (enable_preprocessing) {
@@ -67,7 +81,7 @@ bool EncodeWav(const std::vector<int16_t>& wav_data, int num_channels,
         absl::MakeConstSpan(wav_data.data(), wav_data.size()), sample_rate_hz);
   }
 
-  const int num_samples_per_packet = sample_rate_hz / (sample_rate_hz/320);
+  const int num_samples_per_packet = GetNumSamplesPerHop(sample_rate_hz);
   // Iterate over the wav data until the end of the vector.
   for (int wav_iterator = 0;
        wav_iterator + num_samples_per_packet <= processed_data.size();
@@ -84,8 +98,14 @@ bool EncodeWav(const std::vector<int16_t>& wav_data, int num_channels,
 
     // Append the encoded audio frames to the encoded_features accumulator
     // vector.
-    encoded_features->insert(encoded_features->end(), encoded.value().begin(),
-                             encoded.value().end());
+    if (is_length_prefixed) {
+      if (!AppendLengthPrefixedPacket(encoded.value(), encoded_features)) {
+        return false;
+      }
+    } else {
+      encoded_features->insert(encoded_features->end(),
+                               encoded.value().begin(), encoded.value().end());
+    }
   }
   const auto elapsed = absl::Now() - benchmark_start;
   LOG(INFO) << "Elapsed seconds : " << absl::ToInt64Seconds(elapsed);
@@ -98,7 +118,8 @@ bool EncodeWav(const std::vector<int16_t>& wav_data, int num_channels,
 bool EncodeFile(const ghc::filesystem::path& wav_path,
                 const ghc::filesystem::path& output_path, int quality_preset,
                 bool enable_preprocessing, bool enable_dtx,
-                const ghc::filesystem::path& model_path) {
+                const ghc::filesystem::path& model_path,
+                float vbr_max_residual_error, float fec_packet_loss_rate) {
   // Reads the entire wav file into memory.
   absl::StatusOr<ReadWavResult> read_wav_result =
       Read16BitWavFileToVector(wav_path.string());
@@ -107,34 +128,18 @@ bool EncodeFile(const ghc::filesystem::path& wav_path,
     LOG(ERROR) << read_wav_result.status();
     return false;
   }
-  int bitrate = 0;
-  int multiple = read_wav_result->sample_rate_hz/8000;
-  if (quality_preset == 1) {
-    bitrate = 1600*multiple;
-    
-  } else if (quality_preset == 2) {
-    bitrate = (1400*multiple) + (1600*multiple);
-
-  } else if (quality_preset == 3) {
-    bitrate = (1400*multiple) + (1600*multiple)*2;
-  } else if (quality_preset == 4) {
-    bitrate = (1400*multiple)*2 + (1600*multiple)*2;
-  } else if (quality_preset == 5) {
-    bitrate = (1400*multiple)*2 + (1600*multiple)*3;
-  } else if (quality_preset == 6) {
-    bitrate = (1400*multiple)*3 + (1600*multiple)*3;
-  } else if (quality_preset == 7) {
-    bitrate = (1400*multiple)*3 + (1600*multiple)*4;
-  } else if (quality_preset == 8) {
-    bitrate = (1400*multiple)*4 + (1600*multiple)*4;
-  } else {
+  const int bitrate =
+      QualityPresetToBitrate(quality_preset, read_wav_result->sample_rate_hz);
+  if (bitrate < 0) {
     LOG(ERROR) << "Unsupported quality preset: " << quality_preset;
+    return false;
   }
   // Keep an accumulator vector of all the encoded features to write to file.
   std::vector<uint8_t> encoded_features;
   if (!EncodeWav(read_wav_result->samples, read_wav_result->num_channels,
                  read_wav_result->sample_rate_hz, bitrate, enable_preprocessing,
-                 enable_dtx, model_path, &encoded_features)) {
+                 enable_dtx, model_path, &encoded_features,
+                 vbr_max_residual_error, fec_packet_loss_rate)) {
     LOG(ERROR) << "Unable to encode features for file " << wav_path;
     return false;
   }
@@ -27,18 +27,30 @@ namespace codec {
 
 // Encodes a vector of wav_data into encoded_features.
 // Uses the quant files located under |model_path|.
+// If |vbr_max_residual_error| is positive the audio is encoded with variable
+// bitrate up to |bitrate|. If |fec_packet_loss_rate| is positive packets carry
+// redundancy adapted to that loss rate. In both cases the packets are
+// length-prefixed as described in packet_framing.h.
 bool EncodeWav(const std::vector<int16_t>& wav_data, int num_channels,
                int sample_rate_hz, int bitrate, bool enable_preprocessing,
                bool enable_dtx, const ghc::filesystem::path& model_path,
-               std::vector<uint8_t>* encoded_features);
+               std::vector<uint8_t>* encoded_features,
+               float vbr_max_residual_error = 0.f,
+               float fec_packet_loss_rate = 0.f);
 
 // Encodes a wav file into an encoded feature file. Encodes num_samples from the
 // file at |wav_path| and writes the encoded features out to |output_path|.
 // Uses the quant files located under |model_path|.
+// If |vbr_max_residual_error| is positive |quality_preset| is the ceiling of
+// the variable bitrate. If either |vbr_max_residual_error| or
+// |fec_packet_loss_rate| is positive the file has to be decoded as
+// length-prefixed.
 bool EncodeFile(const ghc::filesystem::path& wav_path,
-                const ghc::filesystem::path& output_path, int bitrate,
+                const ghc::filesystem::path& output_path, int quality_preset,
                 bool enable_preprocessing, bool enable_dtx,
-                const ghc::filesystem::path& model_path);
+                const ghc::filesystem::path& model_path,
+                float vbr_max_residual_error = 0.f,
+                float fec_packet_loss_rate = 0.f);
 
 }  // namespace codec
 }  // namespace chromemedia
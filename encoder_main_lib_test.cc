@@ -14,8 +14,12 @@
 
 #include "encoder_main_lib.h"
 
+#include <cstdint>
+#include <fstream>
+#include <iterator>
 #include <string>
 #include <system_error>  // NOLINT(build/c++11)
+#include <vector>
 
 // Placeholder for get runfiles header.
 // Placeholder for testing header.
@@ -23,6 +27,8 @@
 #include "absl/strings/string_view.h"
 #include "gtest/gtest.h"
 #include "include/ghc/filesystem.hpp"
+#include "lyra_config.h"
+#include "packet_framing.h"
 
 namespace chromemedia {
 namespace codec {
@@ -79,6 +85,36 @@ TEST_F(EncoderMainLibTest, EncodeSingleWavFiles) {
   }
 }
 
+TEST_F(EncoderMainLibTest, EncodeVariableBitrateWavFiles) {
+  const int kQualityPreset = 3;
+  for (const auto wav_file : kWavFiles) {
+    const auto kInputWavepath = (testdata_dir_ / wav_file).concat(".wav");
+    const auto kOutputEncoded = (output_dir_ / wav_file).concat("_vbr.lyra");
+    ASSERT_TRUE(EncodeFile(kInputWavepath, kOutputEncoded, kQualityPreset,
+                           /*enable_preprocessing=*/false,
+                           /*enable_dtx=*/true, model_path_,
+                           /*vbr_max_residual_error=*/0.05f));
+
+    std::ifstream encoded_stream(kOutputEncoded.string(),
+                                 std::ios_base::binary);
+    ASSERT_TRUE(encoded_stream.is_open());
+    const std::vector<uint8_t> encoded{
+        std::istreambuf_iterator<char>(encoded_stream),
+        std::istreambuf_iterator<char>()};
+    const auto packets = SplitLengthPrefixedPackets(encoded);
+    ASSERT_TRUE(packets.has_value());
+    EXPECT_FALSE(packets->empty());
+    const int max_packet_size =
+        GetPacketSize(QualityPresetToNumQuantizedBits(kQualityPreset));
+    for (const auto& packet : packets.value()) {
+      // Empty packets are DTX frames.
+      EXPECT_TRUE(packet.empty() ||
+                  PacketSizeToNumQuantizedBits(packet.size()) > 0);
+      EXPECT_LE(packet.size(), max_packet_size);
+    }
+  }
+}
+
 }  // namespace
 }  // namespace codec
 }  // namespace chromemedia
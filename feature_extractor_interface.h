@@ -36,6 +36,10 @@ class FeatureExtractorInterface {
   // Extracts features from the audio. On failure returns a nullopt.
   virtual std::optional<std::vector<float>> Extract(
       const absl::Span<const int16_t> audio) = 0;
+
+  // Same as above for float samples in [-1, 1].
+  virtual std::optional<std::vector<float>> Extract(
+      const absl::Span<const float> audio) = 0;
 };
 
 }  // namespace codec
@@ -20,8 +20,11 @@
 #include <cstdint>
 #include <optional>
 #include <queue>
+#include <type_traits>
 #include <vector>
 
+#include "absl/types/span.h"
+#include "dsp_utils.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 
 namespace chromemedia {
@@ -38,6 +41,11 @@ class GenerativeModelInterface {
   virtual std::optional<std::vector<int16_t>> GenerateSamples(
       int num_samples) = 0;
 
+  // Same as above, but the samples are floats in [-1, 1] which are neither
+  // rounded nor clipped.
+  virtual std::optional<std::vector<float>> GenerateFloatSamples(
+      int num_samples) = 0;
+
   virtual int num_samples_available() const = 0;
 };
 
@@ -62,13 +70,59 @@ class GenerativeModel : public GenerativeModelInterface {
   // Returns a vector of audio samples on success. Returns a nullopt on failure.
   std::optional<std::vector<int16_t>> GenerateSamples(
       int num_samples) override final {
+    return Generate<int16_t>(num_samples);
+  }
+
+  std::optional<std::vector<float>> GenerateFloatSamples(
+      int num_samples) override final {
+    return Generate<float>(num_samples);
+  }
+
+  int num_samples_available() const override final {
+    return features_queue_.size() * num_samples_per_hop_ - next_sample_in_hop_;
+  }
+
+ protected:
+  GenerativeModel(int num_samples_per_hop, int num_features)
+      : num_samples_per_hop_(num_samples_per_hop),
+        num_features_(num_features),
+        next_sample_in_hop_(0) {
+    VLOG(1) << "Number of features: " << num_features;
+    VLOG(1) << "Number of samples per feature: " << num_samples_per_hop;
+  }
+
+  // Process the features on top of the queue.
+  // Called from |GenerateSamples|.
+  virtual bool RunConditioning(const std::vector<float>& features) = 0;
+
+  // Generate samples from the latest set of features added by |AddFeatures|,
+  // which have already been processed by |RunConditioning|.
+  virtual std::optional<std::vector<int16_t>> RunModel(int num_samples) = 0;
+
+  // Same as |RunModel| for float samples in [-1, 1]. Models which produce
+  // float audio should override this to skip the int16 round trip.
+  virtual std::optional<std::vector<float>> RunFloatModel(int num_samples) {
+    auto samples = RunModel(num_samples);
+    if (!samples.has_value()) {
+      return std::nullopt;
+    }
+    return Int16ToUnit<float>(samples.value());
+  }
+
+  int next_sample_in_hop() const { return next_sample_in_hop_; }
+
+ private:
+  GenerativeModel() = delete;
+
+  template <typename T>
+  std::optional<std::vector<T>> Generate(int num_samples) {
     if (num_samples < 0) {
       LOG(ERROR) << "Number of samples must be positive.";
       return std::nullopt;
     }
     // Do not call costly models if no samples have been requested.
     if (num_samples == 0) {
-      return std::vector<int16_t>(0);
+      return std::vector<T>(0);
     }
     if (num_samples_available() == 0) {
       LOG(ERROR) << "Tried generating " << num_samples << " samples but only "
@@ -88,7 +142,12 @@ class GenerativeModel : public GenerativeModelInterface {
                  << " were available in current features.";
       return std::nullopt;
     }
-    auto samples = RunModel(num_samples);
+    std::optional<std::vector<T>> samples;
+    if constexpr (std::is_same_v<T, float>) {
+      samples = RunFloatModel(num_samples);
+    } else {
+      samples = RunModel(num_samples);
+    }
     if (samples.has_value()) {
       next_sample_in_hop_ += samples->size();
       // Cumulative samples generated are guaranteed to never straddle
@@ -101,32 +160,6 @@ class GenerativeModel : public GenerativeModelInterface {
     return samples;
   }
 
-  int num_samples_available() const override final {
-    return features_queue_.size() * num_samples_per_hop_ - next_sample_in_hop_;
-  }
-
- protected:
-  GenerativeModel(int num_samples_per_hop, int num_features)
-      : num_samples_per_hop_(num_samples_per_hop),
-        num_features_(num_features),
-        next_sample_in_hop_(0) {
-    VLOG(1) << "Number of features: " << num_features;
-    VLOG(1) << "Number of samples per feature: " << num_samples_per_hop;
-  }
-
-  // Process the features on top of the queue.
-  // Called from |GenerateSamples|.
-  virtual bool RunConditioning(const std::vector<float>& features) = 0;
-
-  // Generate samples from the latest set of features added by |AddFeatures|,
-  // which have already been processed by |RunConditioning|.
-  virtual std::optional<std::vector<int16_t>> RunModel(int num_samples) = 0;
-
-  int next_sample_in_hop() const { return next_sample_in_hop_; }
-
- private:
-  GenerativeModel() = delete;
-
   // Provide read-only access to these member variables in derived classes.
   const int num_samples_per_hop_;
   const int num_features_;
@@ -0,0 +1,118 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "jitter_network_model.h"
+
+#include <cmath>
+#include <memory>
+#include <optional>
+#include <random>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "gilbert_model.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "packet_loss_model_interface.h"
+
+namespace chromemedia {
+namespace codec {
+
+std::optional<JitterDistribution> ParseJitterDistribution(
+    absl::string_view name) {
+  if (name == "none") {
+    return JitterDistribution::kNone;
+  } else if (name == "uniform") {
+    return JitterDistribution::kUniform;
+  } else if (name == "half_normal") {
+    return JitterDistribution::kHalfNormal;
+  } else if (name == "exponential") {
+    return JitterDistribution::kExponential;
+  }
+  return std::nullopt;
+}
+
+std::unique_ptr<JitterNetworkModel> JitterNetworkModel::Create(
+    const JitterNetworkParams& params, bool random_seed) {
+  if (params.base_delay < absl::ZeroDuration() ||
+      params.jitter < absl::ZeroDuration() ||
+      params.reorder_delay < absl::ZeroDuration()) {
+    LOG(ERROR) << "Delays have to be positive, but base delay was "
+               << params.base_delay << ", jitter was " << params.jitter
+               << " and reorder delay was " << params.reorder_delay << ".";
+    return nullptr;
+  }
+  if (params.reorder_probability < 0.f || params.reorder_probability > 1.f) {
+    LOG(ERROR) << "Reorder probability has to be in [0, 1], but was "
+               << params.reorder_probability << ".";
+    return nullptr;
+  }
+  auto loss_model = GilbertModel::Create(
+      params.packet_loss_rate, params.average_burst_length, random_seed);
+  if (loss_model == nullptr) {
+    LOG(ERROR) << "Could not create packet loss model.";
+    return nullptr;
+  }
+
+  unsigned int seed = 5489u;
+  if (random_seed) {
+    std::random_device rd;
+    seed = rd();
+  }
+  return absl::WrapUnique(
+      new JitterNetworkModel(params, std::move(loss_model), seed));
+}
+
+JitterNetworkModel::JitterNetworkModel(
+    const JitterNetworkParams& params,
+    std::unique_ptr<PacketLossModelInterface> loss_model, unsigned int seed)
+    : params_(params), loss_model_(std::move(loss_model)), gen_(seed) {}
+
+std::optional<absl::Duration> JitterNetworkModel::SendPacket(
+    absl::Duration send_time) {
+  // Always draw the same random numbers per packet, so the delay pattern does
+  // not change with the loss pattern.
+  const absl::Duration jitter = SampleJitter();
+  const bool is_reordered = prob_(gen_) < params_.reorder_probability;
+  if (!loss_model_->IsPacketReceived()) {
+    return std::nullopt;
+  }
+  absl::Duration arrival_time = send_time + params_.base_delay + jitter;
+  if (is_reordered) {
+    arrival_time += params_.reorder_delay;
+  }
+  return arrival_time;
+}
+
+absl::Duration JitterNetworkModel::SampleJitter() {
+  const float jitter_seconds = absl::ToDoubleSeconds(params_.jitter);
+  switch (params_.jitter_distribution) {
+    case JitterDistribution::kNone:
+      return absl::ZeroDuration();
+    case JitterDistribution::kUniform:
+      return absl::Seconds(prob_(gen_) * jitter_seconds);
+    case JitterDistribution::kHalfNormal:
+      return absl::Seconds(
+          std::abs(std::normal_distribution<float>(0.f, 1.f)(gen_)) *
+          jitter_seconds);
+    case JitterDistribution::kExponential:
+      return absl::Seconds(std::exponential_distribution<float>(1.f)(gen_) *
+                           jitter_seconds);
+  }
+  return absl::ZeroDuration();
+}
+
+}  // namespace codec
+}  // namespace chromemedia
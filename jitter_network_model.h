@@ -0,0 +1,91 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_JITTER_NETWORK_MODEL_H_
+#define LYRA_CODEC_JITTER_NETWORK_MODEL_H_
+
+#include <memory>
+#include <optional>
+#include <random>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "network_impairment_model_interface.h"
+#include "packet_loss_model_interface.h"
+
+namespace chromemedia {
+namespace codec {
+
+enum class JitterDistribution {
+  // Every packet experiences exactly the base delay.
+  kNone,
+  // Extra delay drawn uniformly from [0, jitter].
+  kUniform,
+  // Extra delay drawn from a half-normal distribution with scale jitter.
+  kHalfNormal,
+  // Extra delay drawn from an exponential distribution with mean jitter,
+  // which models the long tail of congested links.
+  kExponential,
+};
+
+// Returns nullopt if |name| is not one of "none", "uniform", "half_normal" or
+// "exponential".
+std::optional<JitterDistribution> ParseJitterDistribution(
+    absl::string_view name);
+
+struct JitterNetworkParams {
+  absl::Duration base_delay = absl::ZeroDuration();
+  JitterDistribution jitter_distribution = JitterDistribution::kNone;
+  absl::Duration jitter = absl::ZeroDuration();
+  // Probability that a packet is held back by an extra |reorder_delay|, so
+  // that packets sent after it overtake it.
+  float reorder_probability = 0.f;
+  absl::Duration reorder_delay = absl::ZeroDuration();
+  // Loss is simulated with a |GilbertModel|.
+  float packet_loss_rate = 0.f;
+  float average_burst_length = 1.f;
+};
+
+// Simulates a network with random delay, reordering and bursty loss.
+class JitterNetworkModel : public NetworkImpairmentModelInterface {
+ public:
+  // Returns a nullptr if any of the parameters is invalid.
+  static std::unique_ptr<JitterNetworkModel> Create(
+      const JitterNetworkParams& params, bool random_seed = true);
+
+  std::optional<absl::Duration> SendPacket(absl::Duration send_time) override;
+
+ private:
+  JitterNetworkModel(const JitterNetworkParams& params,
+                     std::unique_ptr<PacketLossModelInterface> loss_model,
+                     unsigned int seed);
+
+  // Returns the extra delay drawn from the jitter distribution.
+  absl::Duration SampleJitter();
+
+  const JitterNetworkParams params_;
+  const std::unique_ptr<PacketLossModelInterface> loss_model_;
+
+  // Not using absl random distributions for the same reason as
+  // |GilbertModel|: seeded runs have to be reproducible across builds.
+  std::mt19937 gen_;
+  std::uniform_real_distribution<float> prob_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_JITTER_NETWORK_MODEL_H_
@@ -0,0 +1,110 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "jitter_network_model.h"
+
+#include <optional>
+
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+TEST(JitterNetworkModelTest, ParsesDistributionNames) {
+  EXPECT_EQ(ParseJitterDistribution("none"), JitterDistribution::kNone);
+  EXPECT_EQ(ParseJitterDistribution("uniform"), JitterDistribution::kUniform);
+  EXPECT_EQ(ParseJitterDistribution("half_normal"),
+            JitterDistribution::kHalfNormal);
+  EXPECT_EQ(ParseJitterDistribution("exponential"),
+            JitterDistribution::kExponential);
+  EXPECT_FALSE(ParseJitterDistribution("pareto").has_value());
+}
+
+TEST(JitterNetworkModelTest, InvalidParams) {
+  JitterNetworkParams params;
+  params.jitter = absl::Milliseconds(-1);
+  EXPECT_EQ(nullptr, JitterNetworkModel::Create(params));
+  params = JitterNetworkParams();
+  params.reorder_probability = 1.5f;
+  EXPECT_EQ(nullptr, JitterNetworkModel::Create(params));
+  params = JitterNetworkParams();
+  params.packet_loss_rate = -0.1f;
+  EXPECT_EQ(nullptr, JitterNetworkModel::Create(params));
+}
+
+TEST(JitterNetworkModelTest, NoJitterDelaysByBaseDelay) {
+  JitterNetworkParams params;
+  params.base_delay = absl::Milliseconds(30);
+  auto model = JitterNetworkModel::Create(params, false);
+  ASSERT_NE(nullptr, model);
+  for (int i = 0; i < 100; ++i) {
+    const absl::Duration send_time = i * absl::Milliseconds(20);
+    EXPECT_EQ(model->SendPacket(send_time), send_time + params.base_delay);
+  }
+}
+
+TEST(JitterNetworkModelTest, UniformJitterStaysInRange) {
+  JitterNetworkParams params;
+  params.base_delay = absl::Milliseconds(10);
+  params.jitter_distribution = JitterDistribution::kUniform;
+  params.jitter = absl::Milliseconds(40);
+  auto model = JitterNetworkModel::Create(params, false);
+  ASSERT_NE(nullptr, model);
+  absl::Duration total_delay;
+  const int kNumPackets = 10000;
+  for (int i = 0; i < kNumPackets; ++i) {
+    const absl::Duration send_time = i * absl::Milliseconds(20);
+    const std::optional<absl::Duration> arrival_time =
+        model->SendPacket(send_time);
+    ASSERT_TRUE(arrival_time.has_value());
+    const absl::Duration delay = arrival_time.value() - send_time;
+    EXPECT_GE(delay, params.base_delay);
+    EXPECT_LE(delay, params.base_delay + params.jitter);
+    total_delay += delay;
+  }
+  EXPECT_NEAR(absl::ToDoubleMilliseconds(total_delay / kNumPackets), 30.0,
+              1.0);
+}
+
+TEST(JitterNetworkModelTest, ReorderedPacketsAreOvertaken) {
+  JitterNetworkParams params;
+  params.reorder_probability = 1.f;
+  params.reorder_delay = absl::Milliseconds(50);
+  auto model = JitterNetworkModel::Create(params, false);
+  ASSERT_NE(nullptr, model);
+  EXPECT_EQ(model->SendPacket(absl::ZeroDuration()), absl::Milliseconds(50));
+}
+
+TEST(JitterNetworkModelTest, LossFollowsPacketLossRate) {
+  JitterNetworkParams params;
+  params.packet_loss_rate = 0.2f;
+  params.average_burst_length = 2.f;
+  auto model = JitterNetworkModel::Create(params, false);
+  ASSERT_NE(nullptr, model);
+  const int kNumPackets = 100000;
+  int num_lost_packets = 0;
+  for (int i = 0; i < kNumPackets; ++i) {
+    if (!model->SendPacket(i * absl::Milliseconds(20)).has_value()) {
+      ++num_lost_packets;
+    }
+  }
+  EXPECT_NEAR(static_cast<float>(num_lost_packets) / kNumPackets,
+              params.packet_loss_rate, 0.01f);
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
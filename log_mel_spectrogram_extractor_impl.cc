@@ -17,12 +17,18 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdint>
+#include <limits>
+#include <map>
 #include <memory>
 #include <optional>
+#include <tuple>
 #include <utility>
 #include <vector>
 
+#include "absl/base/attributes.h"
+#include "absl/base/const_init.h"
 #include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/types/span.h"
 #include "audio/dsp/mfcc/mel_filterbank.h"
 #include "audio/dsp/number_util.h"
@@ -39,11 +45,26 @@ static constexpr float kLogFloor = 500.f;
 static constexpr double kLowerFreqLimit = 0.0;
 static constexpr double kUpperFreqLimitFactor = 0.495;
 
+// Sample rate, number of FFT bins and number of mel bins.
+using MelFilterbankKey = std::tuple<int, int, int>;
+
+ABSL_CONST_INIT absl::Mutex mel_filterbanks_mutex(absl::kConstInit);
+
+// Filterbanks currently in use. Expired entries are replaced on the next
+// lookup of their key.
+std::map<MelFilterbankKey, std::weak_ptr<const audio_dsp::MelFilterbank>>&
+MelFilterbanks() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mel_filterbanks_mutex) {
+  static auto* const mel_filterbanks =
+      new std::map<MelFilterbankKey,
+                   std::weak_ptr<const audio_dsp::MelFilterbank>>();
+  return *mel_filterbanks;
+}
+
 }  // namespace
 
 LogMelSpectrogramExtractorImpl::LogMelSpectrogramExtractorImpl(
     std::unique_ptr<audio_dsp::Spectrogram> spectrogram,
-    std::unique_ptr<audio_dsp::MelFilterbank> mel_filterbank,
+    std::shared_ptr<const audio_dsp::MelFilterbank> mel_filterbank,
     int hop_length_samples)
     : spectrogram_(std::move(spectrogram)),
       mel_filterbank_(std::move(mel_filterbank)),
@@ -76,15 +97,9 @@ LogMelSpectrogramExtractorImpl::Create(int sample_rate_hz,
     return nullptr;
   }
 
-  // Compute the next power of two for FFT size.
-  const int kFftSize = static_cast<int>(
-      audio_dsp::NextPowerOfTwo(static_cast<unsigned>(window_length_samples)));
-  // Number of unique FFT bins.
-  const int kFftBins = kFftSize / 2 + 1;
-  auto mel_filterbank = std::make_unique<audio_dsp::MelFilterbank>();
-  if (!mel_filterbank->Initialize(kFftBins, sample_rate_hz, num_mel_bins,
-                                  kLowerFreqLimit,
-                                  GetUpperFreqLimit(sample_rate_hz))) {
+  auto mel_filterbank =
+      GetMelFilterbank(sample_rate_hz, window_length_samples, num_mel_bins);
+  if (mel_filterbank == nullptr) {
     LOG(ERROR) << "Could not initialize mel filterbank for feature extraction.";
     return nullptr;
   }
@@ -102,7 +117,28 @@ std::optional<std::vector<float>> LogMelSpectrogramExtractorImpl::Extract(
   }
 
   std::copy(audio.begin(), audio.end(), samples_.begin());
+  return ExtractFromSamples();
+}
+
+std::optional<std::vector<float>> LogMelSpectrogramExtractorImpl::Extract(
+    const absl::Span<const float> audio) {
+  if (audio.size() != hop_length_samples_) {
+    LOG(ERROR) << "Input audio should have " << hop_length_samples_
+               << " samples but instead had " << audio.size() << ".";
+    return std::nullopt;
+  }
 
+  std::transform(audio.begin(), audio.end(), samples_.begin(),
+                 [](float sample) {
+                   return static_cast<double>(sample) *
+                          -static_cast<double>(
+                              std::numeric_limits<int16_t>::min());
+                 });
+  return ExtractFromSamples();
+}
+
+std::optional<std::vector<float>>
+LogMelSpectrogramExtractorImpl::ExtractFromSamples() {
   std::vector<std::vector<double>> spectrogram_slices;
   if (!spectrogram_->ComputeSpectrogram(samples_, &spectrogram_slices)) {
     LOG(ERROR) << "Could not compute spectrogram from audio.";
@@ -125,6 +161,35 @@ std::optional<std::vector<float>> LogMelSpectrogramExtractorImpl::Extract(
   return mel_features;
 }
 
+std::shared_ptr<const audio_dsp::MelFilterbank>
+LogMelSpectrogramExtractorImpl::GetMelFilterbank(int sample_rate_hz,
+                                                 int window_length_samples,
+                                                 int num_mel_bins) {
+  // Compute the next power of two for FFT size.
+  const int kFftSize = static_cast<int>(
+      audio_dsp::NextPowerOfTwo(static_cast<unsigned>(window_length_samples)));
+  // Number of unique FFT bins.
+  const int kFftBins = kFftSize / 2 + 1;
+  const MelFilterbankKey key(sample_rate_hz, kFftBins, num_mel_bins);
+
+  absl::MutexLock lock(&mel_filterbanks_mutex);
+  std::weak_ptr<const audio_dsp::MelFilterbank>& cached =
+      MelFilterbanks()[key];
+  if (auto mel_filterbank = cached.lock()) {
+    return mel_filterbank;
+  }
+  auto mel_filterbank = std::make_shared<audio_dsp::MelFilterbank>();
+  if (!mel_filterbank->Initialize(kFftBins, sample_rate_hz, num_mel_bins,
+                                  kLowerFreqLimit,
+                                  GetUpperFreqLimit(sample_rate_hz))) {
+    LOG(ERROR) << "Could not initialize mel filterbank with " << kFftBins
+               << " FFT bins and " << num_mel_bins << " mel bins.";
+    return nullptr;
+  }
+  cached = mel_filterbank;
+  return mel_filterbank;
+}
+
 double LogMelSpectrogramExtractorImpl::GetLowerFreqLimit() {
   return kLowerFreqLimit;
 }
@@ -46,6 +46,18 @@ class LogMelSpectrogramExtractorImpl : public FeatureExtractorInterface {
   std::optional<std::vector<float>> Extract(
       const absl::Span<const int16_t> audio) override;
 
+  // Same as above for float samples in [-1, 1], which are scaled to the int16
+  // range so that both produce the same features.
+  std::optional<std::vector<float>> Extract(
+      const absl::Span<const float> audio) override;
+
+  // Returns the mel filterbank for spectrograms computed over
+  // |window_length_samples|. Filterbanks are immutable once initialized, so
+  // all instances asking for the same parameters share one, and it is freed
+  // with the last of them. Returns nullptr if initialization fails.
+  static std::shared_ptr<const audio_dsp::MelFilterbank> GetMelFilterbank(
+      int sample_rate_hz, int window_length_samples, int num_mel_bins);
+
   // Returns the lower frequency limit used to initialize the MelFilterbank
   // class.
   static double GetLowerFreqLimit();
@@ -65,11 +77,14 @@ class LogMelSpectrogramExtractorImpl : public FeatureExtractorInterface {
   LogMelSpectrogramExtractorImpl() = delete;
   LogMelSpectrogramExtractorImpl(
       std::unique_ptr<audio_dsp::Spectrogram> spectrogram,
-      std::unique_ptr<audio_dsp::MelFilterbank> mel_filterbank,
+      std::shared_ptr<const audio_dsp::MelFilterbank> mel_filterbank,
       int hop_length_samples);
 
+  // Extracts the mel features from the hop of audio in |samples_|.
+  std::optional<std::vector<float>> ExtractFromSamples();
+
   const std::unique_ptr<audio_dsp::Spectrogram> spectrogram_;
-  const std::unique_ptr<const audio_dsp::MelFilterbank> mel_filterbank_;
+  const std::shared_ptr<const audio_dsp::MelFilterbank> mel_filterbank_;
   const int hop_length_samples_;
   std::vector<double> samples_;
 };
@@ -91,6 +91,26 @@ TEST_F(LogMelSpectrogramExtractorImplTest, SamplesLongerThanExpected) {
   EXPECT_FALSE(features.has_value());
 }
 
+TEST(LogMelSpectrogramExtractorImplSharingTest, MelFilterbanksAreShared) {
+  auto mel_filterbank = LogMelSpectrogramExtractorImpl::GetMelFilterbank(
+      kTestSampleRateHz, kWindowLengthSamples, kNumMelBins);
+  ASSERT_NE(mel_filterbank, nullptr);
+
+  // Window lengths rounding up to the same FFT size share a filterbank.
+  EXPECT_EQ(LogMelSpectrogramExtractorImpl::GetMelFilterbank(
+                kTestSampleRateHz, kWindowLengthSamples + 1, kNumMelBins),
+            mel_filterbank);
+  EXPECT_NE(LogMelSpectrogramExtractorImpl::GetMelFilterbank(
+                kTestSampleRateHz, 2 * kWindowLengthSamples, kNumMelBins),
+            mel_filterbank);
+  EXPECT_NE(LogMelSpectrogramExtractorImpl::GetMelFilterbank(
+                2 * kTestSampleRateHz, kWindowLengthSamples, kNumMelBins),
+            mel_filterbank);
+  EXPECT_NE(LogMelSpectrogramExtractorImpl::GetMelFilterbank(
+                kTestSampleRateHz, kWindowLengthSamples, kNumMelBins + 1),
+            mel_filterbank);
+}
+
 TEST_F(LogMelSpectrogramExtractorImplTest, SamplesShorterThanExpected) {
   std::vector<int16_t> audio(kWavData, kWavData + kHopLengthSamples - 1);
 
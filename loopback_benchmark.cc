@@ -0,0 +1,54 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/flags/usage.h"
+#include "absl/time/time.h"
+#include "architecture_utils.h"
+#include "include/ghc/filesystem.hpp"
+#include "loopback_benchmark_lib.h"
+
+ABSL_FLAG(int, num_streams, 1,
+          "The number of streams which are encoded, sent and decoded "
+          "concurrently.");
+
+ABSL_FLAG(int, num_frames, 500, "The number of frames sent on every stream.");
+
+ABSL_FLAG(int, sample_rate_hz, 16000, "The sample rate of all streams.");
+
+ABSL_FLAG(int, quality_preset, 1, "The quality preset of all streams.");
+
+ABSL_FLAG(double, playout_delay_ms, 20.0,
+          "Time in milliseconds from the capture of a frame until it is "
+          "played out. Packets which arrive later are concealed.");
+
+ABSL_FLAG(std::string, model_path, "model_coeffs",
+          "Path to directory containing TFLite files. For mobile this is the "
+          "absolute path, like '/sdcard/model_coeffs/'. For desktop this is "
+          "the path relative to the binary.");
+
+int main(int argc, char** argv) {
+  absl::SetProgramUsageMessage(argv[0]);
+  absl::ParseCommandLine(argc, argv);
+
+  return chromemedia::codec::loopback_benchmark(
+      absl::GetFlag(FLAGS_num_streams), absl::GetFlag(FLAGS_num_frames),
+      absl::GetFlag(FLAGS_sample_rate_hz), absl::GetFlag(FLAGS_quality_preset),
+      absl::Milliseconds(absl::GetFlag(FLAGS_playout_delay_ms)),
+      chromemedia::codec::GetCompleteArchitecturePath(
+          absl::GetFlag(FLAGS_model_path)));
+}
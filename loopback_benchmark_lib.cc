@@ -0,0 +1,469 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "loopback_benchmark_lib.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "dsp_utils.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+#include "lyra_config.h"
+#include "lyra_decoder.h"
+#include "lyra_encoder.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+// Maximum number of datagrams passed to one sendmmsg() or recvmmsg() call.
+constexpr int kMaxBatchSize = 64;
+// Large enough for the header and any Lyra packet.
+constexpr int kMaxDatagramSize = 512;
+constexpr int kSocketBufferSize = 4 << 20;
+// Both threads start this long after the codecs are set up, so neither of
+// them starts late.
+constexpr absl::Duration kStartDelay = absl::Milliseconds(100);
+
+// Every datagram starts with the stream, the frame and the time the end of the
+// frame was captured, in host byte order since both ends run on this host.
+struct DatagramHeader {
+  uint32_t stream;
+  uint32_t frame;
+  int64_t capture_time_microsecs;
+};
+
+// CPU time consumed by the calling thread.
+double GetThreadCpuSeconds() {
+  struct timespec time;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+  return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+// Returns a UDP socket bound to an ephemeral port on the loopback interface,
+// or -1 on failure.
+int CreateLoopbackSocket(struct sockaddr_in* address) {
+  const int socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (socket_fd < 0) {
+    LOG(ERROR) << "Could not create UDP socket: " << std::strerror(errno);
+    return -1;
+  }
+  setsockopt(socket_fd, SOL_SOCKET, SO_RCVBUF, &kSocketBufferSize,
+             sizeof(kSocketBufferSize));
+  setsockopt(socket_fd, SOL_SOCKET, SO_SNDBUF, &kSocketBufferSize,
+             sizeof(kSocketBufferSize));
+  std::memset(address, 0, sizeof(*address));
+  address->sin_family = AF_INET;
+  address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address->sin_port = 0;
+  socklen_t address_length = sizeof(*address);
+  if (bind(socket_fd, reinterpret_cast<struct sockaddr*>(address),
+           sizeof(*address)) != 0 ||
+      getsockname(socket_fd, reinterpret_cast<struct sockaddr*>(address),
+                  &address_length) != 0) {
+    LOG(ERROR) << "Could not bind UDP socket: " << std::strerror(errno);
+    close(socket_fd);
+    return -1;
+  }
+  return socket_fd;
+}
+
+struct SenderResult {
+  bool success = false;
+  double cpu_seconds = 0;
+  int num_late_frames = 0;
+};
+
+// Encodes and sends one hop of every stream per frame period. Frame i is
+// captured at |start| + (i + 1) frame periods.
+SenderResult RunSender(
+    int socket_fd, const struct sockaddr_in& destination, absl::Time start,
+    int num_frames, int frame_rate, const std::vector<int16_t>& audio,
+    const std::vector<std::unique_ptr<LyraEncoder>>& encoders) {
+  SenderResult result;
+  const int num_streams = encoders.size();
+  const int num_samples_per_hop = audio.size() / frame_rate;
+  const absl::Duration frame_period = absl::Seconds(1) / frame_rate;
+  std::vector<std::vector<uint8_t>> datagrams(
+      num_streams, std::vector<uint8_t>(kMaxDatagramSize));
+  std::vector<struct iovec> iovecs(num_streams);
+  std::vector<struct mmsghdr> messages(num_streams);
+  for (int stream = 0; stream < num_streams; ++stream) {
+    iovecs[stream].iov_base = datagrams[stream].data();
+    std::memset(&messages[stream], 0, sizeof(messages[stream]));
+    messages[stream].msg_hdr.msg_name =
+        const_cast<struct sockaddr_in*>(&destination);
+    messages[stream].msg_hdr.msg_namelen = sizeof(destination);
+    messages[stream].msg_hdr.msg_iov = &iovecs[stream];
+    messages[stream].msg_hdr.msg_iovlen = 1;
+  }
+
+  const double start_cpu_seconds = GetThreadCpuSeconds();
+  for (int frame = 0; frame < num_frames; ++frame) {
+    // The hop is captured once its last sample is available.
+    const absl::Time capture_time = start + (frame + 1) * frame_period;
+    absl::SleepFor(capture_time - absl::Now());
+    for (int stream = 0; stream < num_streams; ++stream) {
+      // Every stream reads the audio from a different offset.
+      const int hop = (frame + stream) % frame_rate;
+      const auto packet = encoders[stream]->Encode(absl::MakeConstSpan(
+          &audio[hop * num_samples_per_hop], num_samples_per_hop));
+      if (!packet.has_value()) {
+        LOG(ERROR) << "Could not encode frame " << frame << " of stream "
+                   << stream << ".";
+        return result;
+      }
+      const DatagramHeader header = {
+          static_cast<uint32_t>(stream), static_cast<uint32_t>(frame),
+          absl::ToUnixMicros(capture_time)};
+      std::memcpy(datagrams[stream].data(), &header, sizeof(header));
+      std::copy(packet->begin(), packet->end(),
+                datagrams[stream].begin() + sizeof(header));
+      iovecs[stream].iov_len = sizeof(header) + packet->size();
+    }
+    for (int first = 0; first < num_streams; first += kMaxBatchSize) {
+      const int batch_size = std::min(kMaxBatchSize, num_streams - first);
+      if (sendmmsg(socket_fd, &messages[first], batch_size, 0) != batch_size) {
+        LOG(ERROR) << "Could not send frame " << frame << ": "
+                   << std::strerror(errno);
+        return result;
+      }
+    }
+    if (absl::Now() > capture_time + frame_period) {
+      ++result.num_late_frames;
+    }
+  }
+  result.cpu_seconds = GetThreadCpuSeconds() - start_cpu_seconds;
+  result.success = true;
+  return result;
+}
+
+struct ReceiverResult {
+  bool success = false;
+  double cpu_seconds = 0;
+  int64_t num_played_out = 0;
+  int64_t num_concealed = 0;
+  // Packets which arrived after the playout time of their frame.
+  int64_t num_late = 0;
+  std::vector<int64_t> latencies_microsecs;
+};
+
+// One slot of a jitter buffer.
+struct BufferedPacket {
+  // The frame whose packet the slot holds, or -1 if it is empty.
+  int64_t frame = -1;
+  int64_t capture_time_microsecs = 0;
+  std::vector<uint8_t> packet;
+};
+
+// Holds the packets of every stream until they are played out. Frame i of a
+// stream is kept in slot i % |num_slots|, so a packet may arrive up to
+// |num_slots| - 1 frames ahead of the frame being played out.
+class JitterBuffers {
+ public:
+  JitterBuffers(int num_streams, int num_slots)
+      : num_slots_(num_slots),
+        slots_(static_cast<int64_t>(num_streams) * num_slots) {
+    for (BufferedPacket& slot : slots_) {
+      slot.packet.reserve(kMaxDatagramSize);
+    }
+  }
+
+  // Stores the packet of |frame|. Returns false if |frame| is too far ahead
+  // of |next_frame|, the next frame to be played out.
+  bool Insert(int stream, int64_t frame, int64_t next_frame,
+              int64_t capture_time_microsecs,
+              absl::Span<const uint8_t> packet) {
+    if (frame - next_frame >= num_slots_) {
+      return false;
+    }
+    BufferedPacket& slot = GetSlot(stream, frame);
+    slot.frame = frame;
+    slot.capture_time_microsecs = capture_time_microsecs;
+    slot.packet.assign(packet.begin(), packet.end());
+    return true;
+  }
+
+  // Removes and returns the packet of |frame|, or nullptr if it did not
+  // arrive. The returned packet stays valid until the slot is reused.
+  const BufferedPacket* Take(int stream, int64_t frame) {
+    BufferedPacket& slot = GetSlot(stream, frame);
+    if (slot.frame != frame) {
+      return nullptr;
+    }
+    slot.frame = -1;
+    return &slot;
+  }
+
+ private:
+  BufferedPacket& GetSlot(int stream, int64_t frame) {
+    return slots_[static_cast<int64_t>(stream) * num_slots_ +
+                  frame % num_slots_];
+  }
+
+  const int num_slots_;
+  std::vector<BufferedPacket> slots_;
+};
+
+// Plays out one hop of every stream per frame period, like an audio device
+// would. Frame i is played out |playout_delay| after it was captured, at
+// |start| + (i + 1) frame periods + |playout_delay|. Until then, the datagrams
+// which arrive are kept in jitter buffers. Frames whose packets are missing at
+// their playout time are concealed, and packets arriving later are dropped.
+// The latency of a frame is measured from its capture until its samples are
+// ready for playout.
+ReceiverResult RunReceiver(
+    int socket_fd, absl::Time start, int num_frames, int frame_rate,
+    int num_samples_per_hop, absl::Duration playout_delay,
+    const std::vector<std::unique_ptr<LyraDecoder>>& decoders) {
+  ReceiverResult result;
+  const int num_streams = decoders.size();
+  const absl::Duration frame_period = absl::Seconds(1) / frame_rate;
+  result.latencies_microsecs.reserve(static_cast<int64_t>(num_streams) *
+                                     num_frames);
+  // Room for the frames which may arrive before their playout time, plus the
+  // one being played out and one of slack.
+  JitterBuffers jitter_buffers(
+      num_streams,
+      static_cast<int>(std::ceil(playout_delay / frame_period)) + 2);
+
+  std::vector<std::vector<uint8_t>> datagrams(
+      kMaxBatchSize, std::vector<uint8_t>(kMaxDatagramSize));
+  std::vector<struct iovec> iovecs(kMaxBatchSize);
+  std::vector<struct mmsghdr> messages(kMaxBatchSize);
+  for (int i = 0; i < kMaxBatchSize; ++i) {
+    iovecs[i].iov_base = datagrams[i].data();
+    iovecs[i].iov_len = kMaxDatagramSize;
+    std::memset(&messages[i], 0, sizeof(messages[i]));
+    messages[i].msg_hdr.msg_iov = &iovecs[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  // The next frame to be played out.
+  int64_t next_frame = 0;
+  // Moves all queued datagrams into the jitter buffers. Returns false on
+  // failure.
+  auto receive_queued = [&]() {
+    while (true) {
+      const int num_messages = recvmmsg(socket_fd, messages.data(),
+                                        kMaxBatchSize, MSG_DONTWAIT,
+                                        /*timeout=*/nullptr);
+      if (num_messages < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          return true;
+        }
+        LOG(ERROR) << "Could not receive: " << std::strerror(errno);
+        return false;
+      }
+      for (int i = 0; i < num_messages; ++i) {
+        DatagramHeader header;
+        if (messages[i].msg_len < sizeof(header)) {
+          LOG(ERROR) << "Received truncated datagram.";
+          return false;
+        }
+        std::memcpy(&header, datagrams[i].data(), sizeof(header));
+        if (header.stream >= num_streams) {
+          LOG(ERROR) << "Received frame of unknown stream " << header.stream
+                     << ".";
+          return false;
+        }
+        if (header.frame < next_frame) {
+          ++result.num_late;
+          continue;
+        }
+        if (!jitter_buffers.Insert(
+                header.stream, header.frame, next_frame,
+                header.capture_time_microsecs,
+                absl::MakeConstSpan(datagrams[i].data() + sizeof(header),
+                                    messages[i].msg_len - sizeof(header)))) {
+          LOG(ERROR) << "Frame " << header.frame << " of stream "
+                     << header.stream << " arrived before there was room in "
+                     << "the jitter buffer.";
+          return false;
+        }
+      }
+    }
+  };
+
+  const double start_cpu_seconds = GetThreadCpuSeconds();
+  for (; next_frame < num_frames; ++next_frame) {
+    const absl::Time playout_time =
+        start + (next_frame + 1) * frame_period + playout_delay;
+    for (absl::Duration remaining = playout_time - absl::Now();
+         remaining > absl::ZeroDuration();
+         remaining = playout_time - absl::Now()) {
+      struct pollfd poll_fd = {socket_fd, POLLIN, 0};
+      const int timeout_millis = absl::ToInt64Milliseconds(
+          absl::Ceil(remaining, absl::Milliseconds(1)));
+      if (poll(&poll_fd, 1, timeout_millis) > 0 && !receive_queued()) {
+        return result;
+      }
+    }
+    if (!receive_queued()) {
+      return result;
+    }
+    for (int stream = 0; stream < num_streams; ++stream) {
+      LyraDecoder* decoder = decoders[stream].get();
+      const BufferedPacket* packet = jitter_buffers.Take(stream, next_frame);
+      if (packet == nullptr) {
+        ++result.num_concealed;
+      } else if (!decoder->SetEncodedPacket(packet->packet)) {
+        LOG(ERROR) << "Could not set frame " << next_frame << " of stream "
+                   << stream << ".";
+        return result;
+      }
+      if (!decoder->DecodeSamples(num_samples_per_hop).has_value()) {
+        LOG(ERROR) << "Could not decode frame " << next_frame << " of stream "
+                   << stream << ".";
+        return result;
+      }
+      if (packet != nullptr) {
+        result.latencies_microsecs.push_back(
+            absl::ToUnixMicros(absl::Now()) - packet->capture_time_microsecs);
+      }
+      ++result.num_played_out;
+    }
+  }
+  result.cpu_seconds = GetThreadCpuSeconds() - start_cpu_seconds;
+  result.success = true;
+  return result;
+}
+
+// Returns the |percentile| of the sorted |values| in milliseconds.
+float GetPercentileMillis(const std::vector<int64_t>& sorted_values,
+                          float percentile) {
+  const int index = std::min<int>(
+      sorted_values.size() - 1,
+      static_cast<int>(std::ceil(percentile / 100 * sorted_values.size())) -
+          1);
+  return sorted_values[std::max(index, 0)] / 1000.0f;
+}
+
+}  // namespace
+
+int loopback_benchmark(int num_streams, int num_frames, int sample_rate_hz,
+                       int quality_preset, absl::Duration playout_delay,
+                       const ghc::filesystem::path& model_path) {
+  if (num_streams <= 0 || num_frames <= 0) {
+    LOG(ERROR) << "The number of streams and frames have to be positive.";
+    return -1;
+  }
+  if (playout_delay < absl::ZeroDuration()) {
+    LOG(ERROR) << "The playout delay must not be negative.";
+    return -1;
+  }
+  const int bitrate = QualityPresetToBitrate(quality_preset, sample_rate_hz);
+  std::vector<std::unique_ptr<LyraEncoder>> encoders;
+  std::vector<std::unique_ptr<LyraDecoder>> decoders;
+  for (int stream = 0; stream < num_streams; ++stream) {
+    encoders.push_back(LyraEncoder::Create(sample_rate_hz, /*num_channels=*/1,
+                                           bitrate, /*enable_dtx=*/false,
+                                           model_path));
+    decoders.push_back(
+        LyraDecoder::Create(sample_rate_hz, /*num_channels=*/1, model_path));
+    if (encoders.back() == nullptr || decoders.back() == nullptr) {
+      LOG(ERROR) << "Could not create encoder and decoder of stream "
+                 << stream << ".";
+      return -1;
+    }
+  }
+
+  // One second of a frequency sweep, which all streams loop over.
+  const int frame_rate = GetFrameRate(sample_rate_hz);
+  const int num_samples_per_hop = GetNumSamplesPerHop(sample_rate_hz);
+  std::vector<int16_t> audio(frame_rate * num_samples_per_hop);
+  for (int i = 0; i < audio.size(); ++i) {
+    const float time = static_cast<float>(i) / sample_rate_hz;
+    audio[i] = UnitToInt16Scalar(
+        0.5f * std::sin(2 * M_PI * (100.f + 1000.f * time) * time));
+  }
+
+  struct sockaddr_in receiver_address;
+  const int receiver_fd = CreateLoopbackSocket(&receiver_address);
+  struct sockaddr_in sender_address;
+  const int sender_fd = CreateLoopbackSocket(&sender_address);
+  if (receiver_fd < 0 || sender_fd < 0) {
+    if (receiver_fd >= 0) close(receiver_fd);
+    if (sender_fd >= 0) close(sender_fd);
+    return -1;
+  }
+
+  const absl::Time start = absl::Now() + kStartDelay;
+  ReceiverResult receiver_result;
+  std::thread receiver([&]() {
+    receiver_result =
+        RunReceiver(receiver_fd, start, num_frames, frame_rate,
+                    num_samples_per_hop, playout_delay, decoders);
+  });
+  SenderResult sender_result;
+  std::thread sender([&]() {
+    sender_result = RunSender(sender_fd, receiver_address, start, num_frames,
+                              frame_rate, audio, encoders);
+  });
+  sender.join();
+  receiver.join();
+  close(sender_fd);
+  close(receiver_fd);
+  if (!sender_result.success || !receiver_result.success ||
+      receiver_result.latencies_microsecs.empty()) {
+    return -1;
+  }
+
+  std::vector<int64_t>& latencies = receiver_result.latencies_microsecs;
+  std::sort(latencies.begin(), latencies.end());
+  const double audio_seconds = static_cast<double>(num_frames) / frame_rate;
+  // Fraction of one core which a stream needs to be encoded and decoded in
+  // real time.
+  const double cpu_per_stream =
+      (sender_result.cpu_seconds + receiver_result.cpu_seconds) /
+      (num_streams * audio_seconds);
+  LOG(INFO) << absl::StrFormat(
+      "%d streams, %d frames, playout delay %s: played out %d, concealed %d, "
+      "late packets %d, frames sent late %d",
+      num_streams, num_frames, absl::FormatDuration(playout_delay),
+      receiver_result.num_played_out, receiver_result.num_concealed,
+      receiver_result.num_late, sender_result.num_late_frames);
+  LOG(INFO) << absl::StrFormat(
+      "mouth-to-ear latency:  p50: %5.3f ms  p90: %5.3f ms  p99: %5.3f ms  "
+      "max: %5.3f ms",
+      GetPercentileMillis(latencies, 50), GetPercentileMillis(latencies, 90),
+      GetPercentileMillis(latencies, 99), latencies.back() / 1000.0f);
+  LOG(INFO) << absl::StrFormat(
+      "cpu per stream: %5.3f%% of a core  streams per host: %d",
+      100 * cpu_per_stream,
+      static_cast<int>(std::thread::hardware_concurrency() / cpu_per_stream));
+  return 0;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,42 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_LOOPBACK_BENCHMARK_LIB_H_
+#define LYRA_CODEC_LOOPBACK_BENCHMARK_LIB_H_
+
+#include "absl/time/time.h"
+#include "include/ghc/filesystem.hpp"
+
+namespace chromemedia {
+namespace codec {
+
+// Runs |num_streams| Lyra streams end to end over a localhost UDP socket. A
+// sender thread encodes one hop of every stream per frame period and sends the
+// packets in one batch. A receiver thread keeps them in a jitter buffer and
+// decodes one hop of every stream per frame period, |playout_delay| after the
+// hop was captured, concealing the packets which did not arrive by then.
+// Logs the mouth-to-ear latency distribution, i.e. the time from the end of a
+// hop being captured to its samples being ready for playout, the CPU time per
+// stream and the number of streams one host could run in real time.
+// Returns 0 on success and -1 otherwise.
+int loopback_benchmark(int num_streams, int num_frames, int sample_rate_hz,
+                       int quality_preset, absl::Duration playout_delay,
+                       const ghc::filesystem::path& model_path);
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_LOOPBACK_BENCHMARK_LIB_H_
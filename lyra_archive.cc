@@ -0,0 +1,371 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra_archive.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+#include "lyra_config.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+constexpr size_t kHeaderSize = 32;
+constexpr size_t kStreamTableEntrySize = 16;
+constexpr size_t kIndexEntrySize = 16;
+
+template <typename T>
+void WriteLittleEndian(T value, std::ostream& stream) {
+  for (int i = 0; i < sizeof(T); ++i) {
+    stream.put(static_cast<char>((value >> (i * 8)) & 0xff));
+  }
+}
+
+template <typename T>
+T ReadLittleEndian(const uint8_t* data) {
+  T value = 0;
+  for (int i = 0; i < sizeof(T); ++i) {
+    value |= static_cast<T>(data[i]) << (i * 8);
+  }
+  return value;
+}
+
+// Returns the index of the block that frame |frame_index| of a stream at
+// |sample_rate_hz| starts in.
+int64_t GetBlockIndex(int64_t frame_index, int sample_rate_hz,
+                      int block_duration_ms) {
+  return frame_index * CodecProfile::kNumSamplesPerHop * 1000 /
+         (static_cast<int64_t>(sample_rate_hz) * block_duration_ms);
+}
+
+// Returns the first frame index whose start time is at or after |time|.
+int64_t GetFirstFrameAtOrAfter(absl::Duration time, int sample_rate_hz) {
+  if (time <= absl::ZeroDuration()) {
+    return 0;
+  }
+  // Frame k starts at k / frame_rate seconds. Dividing durations is exact, so
+  // a time on a frame start selects that frame. Rounding a floating point
+  // product up would skip it whenever the product lands just above the
+  // integer, e.g. 0.28 s * 25 = 7.000000000000001.
+  absl::Duration remainder;
+  const int64_t frame = absl::IDivDuration(
+      time * GetFrameRate(sample_rate_hz), absl::Seconds(1), &remainder);
+  if (remainder > absl::ZeroDuration() &&
+      frame < std::numeric_limits<int64_t>::max()) {
+    return frame + 1;
+  }
+  return frame;
+}
+
+}  // namespace
+
+std::unique_ptr<LyraArchiveWriter> LyraArchiveWriter::Create(
+    absl::Duration block_duration) {
+  const int64_t block_duration_ms = absl::ToInt64Milliseconds(block_duration);
+  if (block_duration_ms <= 0 ||
+      block_duration_ms > std::numeric_limits<uint32_t>::max()) {
+    LOG(ERROR) << "Block duration has to be a positive number of "
+               << "milliseconds, but was " << block_duration << ".";
+    return nullptr;
+  }
+  return absl::WrapUnique(new LyraArchiveWriter(block_duration_ms));
+}
+
+LyraArchiveWriter::LyraArchiveWriter(int block_duration_ms)
+    : block_duration_ms_(block_duration_ms) {}
+
+int LyraArchiveWriter::AddStream(int sample_rate_hz) {
+  if (!IsSampleRateSupported(sample_rate_hz)) {
+    LOG(ERROR) << "Sample rate " << sample_rate_hz
+               << " Hz is not supported by codec.";
+    return -1;
+  }
+  streams_.push_back({sample_rate_hz, {}});
+  return streams_.size() - 1;
+}
+
+bool LyraArchiveWriter::AddPacket(int stream_id, int64_t frame_index,
+                                  absl::Span<const uint8_t> packet) {
+  if (stream_id < 0 || stream_id >= streams_.size()) {
+    LOG(ERROR) << "Stream " << stream_id << " does not exist.";
+    return false;
+  }
+  if (frame_index < 0 || frame_index > std::numeric_limits<uint32_t>::max()) {
+    LOG(ERROR) << "Frame index " << frame_index << " is out of range.";
+    return false;
+  }
+  std::vector<BufferedPacket>& packets = streams_.at(stream_id).packets;
+  if (!packets.empty() && frame_index <= packets.back().frame_index) {
+    LOG(ERROR) << "Frame index " << frame_index << " of stream " << stream_id
+               << " is not larger than the previous frame index "
+               << packets.back().frame_index << ".";
+    return false;
+  }
+  packets.push_back({static_cast<uint32_t>(frame_index),
+                     std::vector<uint8_t>(packet.begin(), packet.end())});
+  return true;
+}
+
+bool LyraArchiveWriter::Write(const ghc::filesystem::path& path) const {
+  std::ofstream output(path.string(),
+                       std::ios_base::binary | std::ios_base::trunc);
+  if (!output.is_open()) {
+    LOG(ERROR) << "Could not open output file " << path;
+    return false;
+  }
+
+  // Every offset is known up front, since the blocks only hold payloads.
+  uint64_t payload_size = 0;
+  uint64_t num_packets = 0;
+  for (const BufferedStream& stream : streams_) {
+    for (const BufferedPacket& packet : stream.packets) {
+      payload_size += packet.payload.size();
+    }
+    num_packets += stream.packets.size();
+  }
+  const uint64_t index_offset = kHeaderSize + payload_size;
+  const uint64_t stream_table_offset =
+      index_offset + num_packets * kIndexEntrySize;
+
+  output.write(kLyraArchiveMagic, sizeof(kLyraArchiveMagic));
+  WriteLittleEndian<uint32_t>(kLyraArchiveVersion, output);
+  WriteLittleEndian<uint32_t>(streams_.size(), output);
+  WriteLittleEndian<uint32_t>(block_duration_ms_, output);
+  WriteLittleEndian<uint64_t>(stream_table_offset, output);
+  WriteLittleEndian<uint64_t>(0, output);
+
+  // Interleave the streams block by block and remember where each payload
+  // ended up. Only blocks holding a packet are visited, so gaps between
+  // packets and archives without any cost nothing.
+  std::vector<std::vector<uint64_t>> payload_offsets(streams_.size());
+  std::vector<int> next_packet(streams_.size(), 0);
+  uint64_t offset = kHeaderSize;
+  while (true) {
+    int64_t block = std::numeric_limits<int64_t>::max();
+    for (int s = 0; s < streams_.size(); ++s) {
+      const BufferedStream& stream = streams_.at(s);
+      if (next_packet.at(s) < stream.packets.size()) {
+        block = std::min(
+            block,
+            GetBlockIndex(stream.packets.at(next_packet.at(s)).frame_index,
+                          stream.sample_rate_hz, block_duration_ms_));
+      }
+    }
+    if (block == std::numeric_limits<int64_t>::max()) {
+      break;
+    }
+    for (int s = 0; s < streams_.size(); ++s) {
+      const BufferedStream& stream = streams_.at(s);
+      for (; next_packet.at(s) < stream.packets.size(); ++next_packet.at(s)) {
+        const BufferedPacket& packet = stream.packets.at(next_packet.at(s));
+        if (GetBlockIndex(packet.frame_index, stream.sample_rate_hz,
+                          block_duration_ms_) != block) {
+          break;
+        }
+        output.write(reinterpret_cast<const char*>(packet.payload.data()),
+                     packet.payload.size());
+        payload_offsets.at(s).push_back(offset);
+        offset += packet.payload.size();
+      }
+    }
+  }
+
+  for (int s = 0; s < streams_.size(); ++s) {
+    const BufferedStream& stream = streams_.at(s);
+    for (int i = 0; i < stream.packets.size(); ++i) {
+      WriteLittleEndian<uint32_t>(stream.packets.at(i).frame_index, output);
+      WriteLittleEndian<uint32_t>(stream.packets.at(i).payload.size(), output);
+      WriteLittleEndian<uint64_t>(payload_offsets.at(s).at(i), output);
+    }
+  }
+
+  uint64_t stream_index_offset = index_offset;
+  for (const BufferedStream& stream : streams_) {
+    WriteLittleEndian<uint32_t>(stream.sample_rate_hz, output);
+    WriteLittleEndian<uint32_t>(stream.packets.size(), output);
+    WriteLittleEndian<uint64_t>(stream_index_offset, output);
+    stream_index_offset += stream.packets.size() * kIndexEntrySize;
+  }
+
+  if (!output.good()) {
+    LOG(ERROR) << "Could not write archive to " << path;
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<LyraArchiveReader> LyraArchiveReader::Open(
+    const ghc::filesystem::path& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG(ERROR) << "Could not open archive " << path;
+    return nullptr;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size < kHeaderSize) {
+    LOG(ERROR) << "Archive " << path << " is too small to be valid.";
+    close(fd);
+    return nullptr;
+  }
+  const size_t size = file_stat.st_size;
+  void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping keeps its own reference to the file.
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    LOG(ERROR) << "Could not memory map archive " << path;
+    return nullptr;
+  }
+  const uint8_t* data = static_cast<const uint8_t*>(mapped);
+  auto fail = [&](const char* reason) -> std::unique_ptr<LyraArchiveReader> {
+    LOG(ERROR) << "Archive " << path << " is invalid: " << reason;
+    munmap(mapped, size);
+    return nullptr;
+  };
+
+  if (std::memcmp(data, kLyraArchiveMagic, sizeof(kLyraArchiveMagic)) != 0) {
+    return fail("bad magic.");
+  }
+  if (ReadLittleEndian<uint32_t>(data + 4) != kLyraArchiveVersion) {
+    return fail("unsupported version.");
+  }
+  const uint64_t num_streams = ReadLittleEndian<uint32_t>(data + 8);
+  const uint64_t stream_table_offset = ReadLittleEndian<uint64_t>(data + 16);
+  if (stream_table_offset > size ||
+      num_streams > (size - stream_table_offset) / kStreamTableEntrySize) {
+    return fail("stream table out of bounds.");
+  }
+
+  // Validate every index entry once, so lookups never need to.
+  std::vector<StreamEntry> streams;
+  streams.reserve(num_streams);
+  for (uint64_t s = 0; s < num_streams; ++s) {
+    const uint8_t* entry =
+        data + stream_table_offset + s * kStreamTableEntrySize;
+    const int sample_rate_hz = ReadLittleEndian<uint32_t>(entry);
+    const uint64_t num_packets = ReadLittleEndian<uint32_t>(entry + 4);
+    const uint64_t index_offset = ReadLittleEndian<uint64_t>(entry + 8);
+    if (!IsSampleRateSupported(sample_rate_hz)) {
+      return fail("unsupported sample rate.");
+    }
+    if (index_offset > size ||
+        num_packets > (size - index_offset) / kIndexEntrySize) {
+      return fail("index out of bounds.");
+    }
+    int64_t previous_frame_index = -1;
+    for (uint64_t i = 0; i < num_packets; ++i) {
+      const uint8_t* index_entry = data + index_offset + i * kIndexEntrySize;
+      const int64_t frame_index = ReadLittleEndian<uint32_t>(index_entry);
+      const uint64_t payload_size = ReadLittleEndian<uint32_t>(index_entry + 4);
+      const uint64_t payload_offset =
+          ReadLittleEndian<uint64_t>(index_entry + 8);
+      if (frame_index <= previous_frame_index) {
+        return fail("index is not sorted.");
+      }
+      if (payload_offset > size || payload_size > size - payload_offset) {
+        return fail("payload out of bounds.");
+      }
+      previous_frame_index = frame_index;
+    }
+    streams.push_back({sample_rate_hz, static_cast<int>(num_packets),
+                       data + index_offset});
+  }
+
+  return absl::WrapUnique(
+      new LyraArchiveReader(data, size, std::move(streams)));
+}
+
+LyraArchiveReader::LyraArchiveReader(const uint8_t* data, size_t size,
+                                     std::vector<StreamEntry> streams)
+    : data_(data), size_(size), streams_(std::move(streams)) {}
+
+LyraArchiveReader::~LyraArchiveReader() {
+  munmap(const_cast<uint8_t*>(data_), size_);
+}
+
+std::optional<ArchiveStreamInfo> LyraArchiveReader::stream_info(
+    int stream_id) const {
+  if (stream_id < 0 || stream_id >= streams_.size()) {
+    LOG(ERROR) << "Stream " << stream_id << " does not exist.";
+    return std::nullopt;
+  }
+  const StreamEntry& stream = streams_.at(stream_id);
+  return ArchiveStreamInfo{stream.sample_rate_hz, stream.num_packets};
+}
+
+std::optional<std::vector<ArchivePacket>> LyraArchiveReader::GetPackets(
+    int stream_id, absl::Duration start, absl::Duration end) const {
+  if (stream_id < 0 || stream_id >= streams_.size()) {
+    LOG(ERROR) << "Stream " << stream_id << " does not exist.";
+    return std::nullopt;
+  }
+  const StreamEntry& stream = streams_.at(stream_id);
+  const int64_t first_frame =
+      GetFirstFrameAtOrAfter(start, stream.sample_rate_hz);
+  const int64_t end_frame = GetFirstFrameAtOrAfter(end, stream.sample_rate_hz);
+
+  // Binary search for the first packet at or after |first_frame|.
+  int low = 0;
+  int high = stream.num_packets;
+  while (low < high) {
+    const int middle = low + (high - low) / 2;
+    if (ReadIndexEntry(stream, middle).frame_index < first_frame) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  std::vector<ArchivePacket> packets;
+  for (int i = low; i < stream.num_packets; ++i) {
+    ArchivePacket packet = ReadIndexEntry(stream, i);
+    if (packet.frame_index >= end_frame) {
+      break;
+    }
+    packets.push_back(packet);
+  }
+  return packets;
+}
+
+ArchivePacket LyraArchiveReader::ReadIndexEntry(const StreamEntry& stream,
+                                                int i) const {
+  const uint8_t* entry = stream.index + i * kIndexEntrySize;
+  const uint64_t payload_offset = ReadLittleEndian<uint64_t>(entry + 8);
+  return ArchivePacket{
+      ReadLittleEndian<uint32_t>(entry),
+      absl::MakeConstSpan(data_ + payload_offset,
+                          ReadLittleEndian<uint32_t>(entry + 4))};
+}
+
+}  // namespace codec
+}  // namespace chromemedia
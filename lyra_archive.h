@@ -0,0 +1,152 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_LYRA_ARCHIVE_H_
+#define LYRA_CODEC_LYRA_ARCHIVE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "include/ghc/filesystem.hpp"
+
+namespace chromemedia {
+namespace codec {
+
+// A .lyra archive stores the packets of many streams in a single file.
+//
+// All integers are little endian. The file is laid out as follows:
+//  +--------+---------+---------+-----+---------+-------+-------+-----+-------+
+//  | Header | Block 0 | Block 1 | ... | Block N | Index | Index | ... | Stream|
+//  |        |         |         |     |         |   0   |   1   |     | Table |
+//  +--------+---------+---------+-----+---------+-------+-------+-----+-------+
+// Each block holds the packets of every stream whose start time falls into
+// the block's time range, so reading a time range of all streams touches one
+// contiguous region. Within a block the packets of each stream are contiguous
+// and in frame order. Each stream has an index with one entry per packet,
+// sorted by frame index, pointing to the payload inside its block.
+//
+// Header (32 bytes):
+//   char[4] magic "LYRA", u32 version, u32 num_streams, u32 block_duration_ms,
+//   u64 stream_table_offset, u64 reserved.
+// Stream table entry (16 bytes):
+//   u32 sample_rate_hz, u32 num_packets, u64 index_offset.
+// Index entry (16 bytes):
+//   u32 frame_index, u32 payload_size, u64 payload_offset.
+inline constexpr char kLyraArchiveMagic[4] = {'L', 'Y', 'R', 'A'};
+inline constexpr uint32_t kLyraArchiveVersion = 1;
+
+struct ArchiveStreamInfo {
+  int sample_rate_hz;
+  int num_packets;
+};
+
+struct ArchivePacket {
+  // Index of the frame within its stream. Frames which were never added, for
+  // example because of DTX, have no packet.
+  int64_t frame_index;
+  // Points into the memory mapped archive and stays valid for the lifetime of
+  // the |LyraArchiveReader|.
+  absl::Span<const uint8_t> payload;
+};
+
+// Collects the packets of many streams and writes them out as an archive.
+// Packets are held in memory until |Write| is called.
+class LyraArchiveWriter {
+ public:
+  // Returns a nullptr if |block_duration| is not a positive number of
+  // milliseconds.
+  static std::unique_ptr<LyraArchiveWriter> Create(
+      absl::Duration block_duration = absl::Seconds(1));
+
+  // Adds a stream and returns its id, or -1 if |sample_rate_hz| is not
+  // supported by the codec.
+  int AddStream(int sample_rate_hz);
+
+  // Adds the packet of frame |frame_index| to stream |stream_id|. Frame
+  // indices of a stream have to be strictly increasing.
+  bool AddPacket(int stream_id, int64_t frame_index,
+                 absl::Span<const uint8_t> packet);
+
+  // Writes the archive to |path|, overwriting any existing file.
+  bool Write(const ghc::filesystem::path& path) const;
+
+ private:
+  struct BufferedPacket {
+    uint32_t frame_index;
+    std::vector<uint8_t> payload;
+  };
+
+  struct BufferedStream {
+    int sample_rate_hz;
+    std::vector<BufferedPacket> packets;
+  };
+
+  explicit LyraArchiveWriter(int block_duration_ms);
+
+  const int block_duration_ms_;
+  std::vector<BufferedStream> streams_;
+};
+
+// Provides random access to the packets of an archive by memory mapping it.
+// No packet payload is ever copied.
+class LyraArchiveReader {
+ public:
+  // Returns a nullptr if the file can not be mapped or is not a valid archive.
+  static std::unique_ptr<LyraArchiveReader> Open(
+      const ghc::filesystem::path& path);
+
+  ~LyraArchiveReader();
+
+  LyraArchiveReader(const LyraArchiveReader&) = delete;
+  LyraArchiveReader& operator=(const LyraArchiveReader&) = delete;
+
+  int num_streams() const { return streams_.size(); }
+
+  // Returns nullopt if |stream_id| is out of range.
+  std::optional<ArchiveStreamInfo> stream_info(int stream_id) const;
+
+  // Returns the packets of |stream_id| which start in [start, end), in frame
+  // order. Returns nullopt if |stream_id| is out of range.
+  std::optional<std::vector<ArchivePacket>> GetPackets(
+      int stream_id, absl::Duration start, absl::Duration end) const;
+
+ private:
+  struct StreamEntry {
+    int sample_rate_hz;
+    int num_packets;
+    const uint8_t* index;
+  };
+
+  LyraArchiveReader(const uint8_t* data, size_t size,
+                    std::vector<StreamEntry> streams);
+
+  // Reads index entry |i| of |stream|.
+  ArchivePacket ReadIndexEntry(const StreamEntry& stream, int i) const;
+
+  const uint8_t* const data_;
+  const size_t size_;
+  const std::vector<StreamEntry> streams_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_LYRA_ARCHIVE_H_
@@ -0,0 +1,254 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra_archive.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+class LyraArchiveTest : public testing::Test {
+ protected:
+  LyraArchiveTest()
+      : archive_path_(ghc::filesystem::path(testing::TempDir()) /
+                      (std::string(testing::UnitTest::GetInstance()
+                                       ->current_test_info()
+                                       ->name()) +
+                       ".lyra")) {}
+
+  // Returns a packet of |size| bytes whose content identifies the stream and
+  // frame it belongs to.
+  static std::vector<uint8_t> MakePacket(int stream_id, int frame_index,
+                                         int size) {
+    std::vector<uint8_t> packet(size);
+    for (int i = 0; i < size; ++i) {
+      packet.at(i) = static_cast<uint8_t>(stream_id * 31 + frame_index + i);
+    }
+    return packet;
+  }
+
+  const ghc::filesystem::path archive_path_;
+};
+
+TEST_F(LyraArchiveTest, RoundTripsInterleavedStreams) {
+  auto writer = LyraArchiveWriter::Create(absl::Milliseconds(100));
+  ASSERT_NE(writer, nullptr);
+  const int stream_16khz = writer->AddStream(16000);
+  const int stream_48khz = writer->AddStream(48000);
+  ASSERT_EQ(stream_16khz, 0);
+  ASSERT_EQ(stream_48khz, 1);
+  // Two seconds of audio at both rates, with every third 16 kHz frame dropped
+  // as if by DTX.
+  for (int frame = 0; frame < 100; ++frame) {
+    if (frame % 3 != 0) {
+      ASSERT_TRUE(writer->AddPacket(stream_16khz, frame,
+                                    MakePacket(stream_16khz, frame, 15)));
+    }
+  }
+  for (int frame = 0; frame < 300; ++frame) {
+    ASSERT_TRUE(writer->AddPacket(stream_48khz, frame,
+                                  MakePacket(stream_48khz, frame, 8)));
+  }
+  ASSERT_TRUE(writer->Write(archive_path_));
+
+  auto reader = LyraArchiveReader::Open(archive_path_);
+  ASSERT_NE(reader, nullptr);
+  ASSERT_EQ(reader->num_streams(), 2);
+  EXPECT_EQ(reader->stream_info(stream_16khz)->sample_rate_hz, 16000);
+  EXPECT_EQ(reader->stream_info(stream_16khz)->num_packets, 66);
+  EXPECT_EQ(reader->stream_info(stream_48khz)->num_packets, 300);
+
+  // [0.5 s, 1 s) covers frames [25, 50) at 16 kHz and [75, 150) at 48 kHz.
+  auto packets_16khz = reader->GetPackets(
+      stream_16khz, absl::Milliseconds(500), absl::Seconds(1));
+  ASSERT_TRUE(packets_16khz.has_value());
+  std::vector<int64_t> expected_frames;
+  for (int frame = 25; frame < 50; ++frame) {
+    if (frame % 3 != 0) expected_frames.push_back(frame);
+  }
+  ASSERT_EQ(packets_16khz->size(), expected_frames.size());
+  for (int i = 0; i < expected_frames.size(); ++i) {
+    EXPECT_EQ(packets_16khz->at(i).frame_index, expected_frames.at(i));
+    EXPECT_THAT(packets_16khz->at(i).payload,
+                testing::ElementsAreArray(
+                    MakePacket(stream_16khz, expected_frames.at(i), 15)));
+  }
+
+  auto packets_48khz = reader->GetPackets(
+      stream_48khz, absl::Milliseconds(500), absl::Seconds(1));
+  ASSERT_TRUE(packets_48khz.has_value());
+  ASSERT_EQ(packets_48khz->size(), 75);
+  EXPECT_EQ(packets_48khz->front().frame_index, 75);
+  EXPECT_EQ(packets_48khz->back().frame_index, 149);
+}
+
+TEST_F(LyraArchiveTest, EmptyRangeReturnsNoPackets) {
+  auto writer = LyraArchiveWriter::Create();
+  ASSERT_NE(writer, nullptr);
+  const int stream = writer->AddStream(8000);
+  ASSERT_TRUE(writer->AddPacket(stream, 0, MakePacket(stream, 0, 8)));
+  ASSERT_TRUE(writer->Write(archive_path_));
+
+  auto reader = LyraArchiveReader::Open(archive_path_);
+  ASSERT_NE(reader, nullptr);
+  auto packets =
+      reader->GetPackets(stream, absl::Seconds(10), absl::Seconds(20));
+  ASSERT_TRUE(packets.has_value());
+  EXPECT_TRUE(packets->empty());
+  EXPECT_FALSE(reader->GetPackets(/*stream_id=*/1, absl::ZeroDuration(),
+                                  absl::Seconds(1))
+                   .has_value());
+}
+
+TEST_F(LyraArchiveTest, WritesArchiveWithoutPackets) {
+  auto writer = LyraArchiveWriter::Create();
+  ASSERT_NE(writer, nullptr);
+  const int stream = writer->AddStream(16000);
+  ASSERT_TRUE(writer->Write(archive_path_));
+
+  auto reader = LyraArchiveReader::Open(archive_path_);
+  ASSERT_NE(reader, nullptr);
+  ASSERT_EQ(reader->num_streams(), 1);
+  EXPECT_EQ(reader->stream_info(stream)->num_packets, 0);
+  auto packets =
+      reader->GetPackets(stream, absl::ZeroDuration(), absl::Seconds(1));
+  ASSERT_TRUE(packets.has_value());
+  EXPECT_TRUE(packets->empty());
+}
+
+TEST_F(LyraArchiveTest, RoundTripsPacketsFarApart) {
+  auto writer = LyraArchiveWriter::Create(absl::Milliseconds(1));
+  ASSERT_NE(writer, nullptr);
+  const int stream = writer->AddStream(16000);
+  // A day apart at 50 frames per second.
+  const int64_t kLastFrame = 50 * 60 * 60 * 24;
+  ASSERT_TRUE(writer->AddPacket(stream, 0, MakePacket(stream, 0, 15)));
+  ASSERT_TRUE(
+      writer->AddPacket(stream, kLastFrame, MakePacket(stream, kLastFrame, 15)));
+  ASSERT_TRUE(writer->Write(archive_path_));
+
+  auto reader = LyraArchiveReader::Open(archive_path_);
+  ASSERT_NE(reader, nullptr);
+  auto packets = reader->GetPackets(stream, absl::ZeroDuration(),
+                                    absl::Hours(25));
+  ASSERT_TRUE(packets.has_value());
+  ASSERT_EQ(packets->size(), 2);
+  EXPECT_EQ(packets->back().frame_index, kLastFrame);
+  EXPECT_THAT(packets->back().payload,
+              testing::ElementsAreArray(MakePacket(stream, kLastFrame, 15)));
+}
+
+TEST_F(LyraArchiveTest, FramesStartingOnRangeBoundsAreSelectedExactly) {
+  struct Rate {
+    int sample_rate_hz;
+    int frame_rate;
+  };
+  constexpr Rate kRates[] = {
+      {8000, 25}, {16000, 50}, {24000, 75}, {32000, 100}, {48000, 150}};
+  constexpr int kDurationMs = 5000;
+
+  auto writer = LyraArchiveWriter::Create();
+  ASSERT_NE(writer, nullptr);
+  for (const Rate& rate : kRates) {
+    const int stream = writer->AddStream(rate.sample_rate_hz);
+    ASSERT_GE(stream, 0);
+    for (int frame = 0; frame < kDurationMs * rate.frame_rate / 1000;
+         ++frame) {
+      ASSERT_TRUE(
+          writer->AddPacket(stream, frame, MakePacket(stream, frame, 8)));
+    }
+  }
+  ASSERT_TRUE(writer->Write(archive_path_));
+  auto reader = LyraArchiveReader::Open(archive_path_);
+  ASSERT_NE(reader, nullptr);
+
+  // Includes times whose product with the frame rate is not exact in floating
+  // point, such as 280 ms at 25 Hz and 140 ms at 50 Hz.
+  for (int stream = 0; stream < std::size(kRates); ++stream) {
+    const int frame_rate = kRates[stream].frame_rate;
+    for (int time_ms = 0; time_ms < kDurationMs; ++time_ms) {
+      if (time_ms * frame_rate % 1000 != 0) continue;
+      const int64_t frame = time_ms * frame_rate / 1000;
+      // A frame starting at |start| is included.
+      auto starting = reader->GetPackets(stream, absl::Milliseconds(time_ms),
+                                         absl::Milliseconds(time_ms + 1));
+      ASSERT_TRUE(starting.has_value());
+      ASSERT_EQ(starting->size(), 1)
+          << "at " << time_ms << " ms, " << frame_rate << " Hz";
+      EXPECT_EQ(starting->front().frame_index, frame);
+      // A frame starting at |end| is excluded.
+      auto before = reader->GetPackets(stream, absl::ZeroDuration(),
+                                       absl::Milliseconds(time_ms));
+      ASSERT_TRUE(before.has_value());
+      EXPECT_EQ(before->size(), frame)
+          << "at " << time_ms << " ms, " << frame_rate << " Hz";
+    }
+  }
+}
+
+TEST_F(LyraArchiveTest, RejectsOutOfOrderPackets) {
+  auto writer = LyraArchiveWriter::Create();
+  ASSERT_NE(writer, nullptr);
+  const int stream = writer->AddStream(16000);
+  ASSERT_TRUE(writer->AddPacket(stream, 5, MakePacket(stream, 5, 8)));
+  EXPECT_FALSE(writer->AddPacket(stream, 5, MakePacket(stream, 5, 8)));
+  EXPECT_FALSE(writer->AddPacket(stream, 4, MakePacket(stream, 4, 8)));
+  EXPECT_FALSE(writer->AddPacket(/*stream_id=*/3, 6, MakePacket(3, 6, 8)));
+}
+
+TEST_F(LyraArchiveTest, RejectsUnsupportedSampleRate) {
+  auto writer = LyraArchiveWriter::Create();
+  ASSERT_NE(writer, nullptr);
+  EXPECT_LT(writer->AddStream(44100), 0);
+}
+
+TEST_F(LyraArchiveTest, RejectsInvalidFiles) {
+  EXPECT_EQ(LyraArchiveReader::Open(archive_path_), nullptr);
+
+  std::ofstream output(archive_path_.string(), std::ios_base::binary);
+  output << "This is not a lyra archive, but it is long enough.";
+  output.close();
+  EXPECT_EQ(LyraArchiveReader::Open(archive_path_), nullptr);
+}
+
+TEST_F(LyraArchiveTest, RejectsTruncatedArchive) {
+  auto writer = LyraArchiveWriter::Create();
+  ASSERT_NE(writer, nullptr);
+  const int stream = writer->AddStream(16000);
+  for (int frame = 0; frame < 10; ++frame) {
+    ASSERT_TRUE(writer->AddPacket(stream, frame, MakePacket(stream, frame, 8)));
+  }
+  ASSERT_TRUE(writer->Write(archive_path_));
+  ghc::filesystem::resize_file(archive_path_,
+                               ghc::filesystem::file_size(archive_path_) - 1);
+  EXPECT_EQ(LyraArchiveReader::Open(archive_path_), nullptr);
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
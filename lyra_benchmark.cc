@@ -39,6 +39,11 @@ ABSL_FLAG(bool, benchmark_quantizer, true,
 ABSL_FLAG(bool, benchmark_generative_model, true,
           "Whether to benchmark the generative model.");
 
+ABSL_FLAG(bool, profile_ops, false,
+          "Whether to log the time spent in every TFLite op of the "
+          "benchmarked models, and which ops fell back from XNNPack to the "
+          "builtin kernels.");
+
 int main(int argc, char** argv) {
   absl::SetProgramUsageMessage(argv[0]);
   absl::ParseCommandLine(argc, argv);
@@ -47,5 +52,6 @@ int main(int argc, char** argv) {
       absl::GetFlag(FLAGS_num_cond_vectors), absl::GetFlag(FLAGS_model_path),
       absl::GetFlag(FLAGS_benchmark_feature_extraction),
       absl::GetFlag(FLAGS_benchmark_quantizer),
-      absl::GetFlag(FLAGS_benchmark_generative_model));
+      absl::GetFlag(FLAGS_benchmark_generative_model),
+      absl::GetFlag(FLAGS_profile_ops));
 }
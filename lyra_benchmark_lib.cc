@@ -32,6 +32,7 @@
 #include <android/log.h>
 #endif
 
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
@@ -43,8 +44,11 @@
 #include "generative_model_interface.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "include/ghc/filesystem.hpp"
-#include "lyra_components.h"
 #include "lyra_config.h"
+#include "lyra_gan_model.h"
+#include "residual_vector_quantizer.h"
+#include "soundstream_encoder.h"
+#include "vector_quantizer_interface.h"
 
 #ifdef BENCHMARK
 #include "absl/base/thread_annotations.h"
@@ -56,6 +60,8 @@ namespace chromemedia {
 namespace codec {
 
 const int kNumQuantizedBits = 120;
+constexpr CodecProfile kProfile =
+    CodecProfileFor<kInternalSampleRateHz>::kValue;
 
 // Given an array of ints, computes the max, min, mean, and standard deviation.
 // Returns the results as a string.
@@ -92,7 +98,7 @@ std::optional<std::vector<float>> MaybeRunFeatureExtraction(
   std::optional<std::vector<float>> features =
       feature_extractor
           ? feature_extractor->Extract(absl::MakeConstSpan(random_audio))
-          : std::vector<float>(kNumFeatures, 0);
+          : std::vector<float>(kProfile.num_features, 0);
 
 #ifdef BENCHMARK
   feature_extractor_timings->push_back(absl::ToUnixMicros(absl::Now()) -
@@ -128,7 +134,7 @@ std::optional<std::vector<float>> MaybeRunQuantizerDecode(
   std::optional<std::vector<float>> lossy_features =
       vector_quantizer
           ? vector_quantizer->DecodeToLossyFeatures(quantized_features)
-          : std::vector<float>(kNumFeatures, 0.0f);
+          : std::vector<float>(kProfile.num_features, 0.0f);
 #ifdef BENCHMARK
   quantizer_decode_timings->push_back(absl::ToUnixMicros(absl::Now()) -
                                       quantizer_decode_start);
@@ -196,33 +202,48 @@ void PrintStatsAndWriteCSV(const std::vector<int64_t>& timings,
 #endif  // !defined __arm__ && !defined __aarch64__
 }
 
+// Prints the TFLite op profile |report| of the model named |title|.
+void PrintOpProfile(const std::string& report, const absl::string_view title) {
+  const std::string profile_string =
+      absl::StrCat("Op profile of ", title, ":\n", report);
+#ifdef __ANDROID__
+  __android_log_print(ANDROID_LOG_DEBUG, "lyra_benchmark", "%s",
+                      profile_string.c_str());
+#else
+  LOG(INFO) << profile_string;
+#endif
+}
+
 int lyra_benchmark(const int num_cond_vectors,
                    const std::string& model_base_path,
                    const bool benchmark_feature_extraction,
                    const bool benchmark_quantizer,
-                   const bool benchmark_generative_model) {
+                   const bool benchmark_generative_model,
+                   const bool profile_ops) {
   if (num_cond_vectors <= 0) {
     LOG(ERROR) << "The number of conditioning vectors has to be positive.";
     return -1;
   }
 
-  const int num_samples_per_hop = GetNumSamplesPerHop(kInternalSampleRateHz);
+  const int num_samples_per_hop = kProfile.num_samples_per_hop();
   const std::string model_path = GetCompleteArchitecturePath(model_base_path);
 
-  std::unique_ptr<FeatureExtractorInterface> feature_extractor =
+  // The concrete components are created instead of going through
+  // lyra_components, so that their TFLite op profiles can be retrieved.
+  std::unique_ptr<SoundStreamEncoder> feature_extractor =
       benchmark_feature_extraction
-          ? CreateFeatureExtractor(
-                kInternalSampleRateHz, kNumFeatures, num_samples_per_hop,
-                GetNumSamplesPerWindow(kInternalSampleRateHz), model_path)
+          ? SoundStreamEncoder::Create(model_path, profile_ops)
           : nullptr;
 
-  std::unique_ptr<VectorQuantizerInterface> vector_quantizer =
-      benchmark_quantizer ? CreateQuantizer(kNumFeatures, model_path) : nullptr;
+  std::unique_ptr<ResidualVectorQuantizer> vector_quantizer =
+      benchmark_quantizer
+          ? ResidualVectorQuantizer::Create(model_path, profile_ops)
+          : nullptr;
 
-  std::unique_ptr<GenerativeModelInterface> model =
+  std::unique_ptr<LyraGanModel> model =
       benchmark_generative_model
-          ? CreateGenerativeModel(GetNumSamplesPerHop(kInternalSampleRateHz),
-                                  kNumFeatures, model_path)
+          ? LyraGanModel::Create(model_path, kProfile.num_features,
+                                 profile_ops)
           : nullptr;
 
   std::vector<int64_t> feature_extractor_timings;
@@ -293,6 +314,28 @@ int lyra_benchmark(const int num_cond_vectors,
   PrintStatsAndWriteCSV(model_decode_timings, "model_decode");
   PrintStatsAndWriteCSV(total_timings, "total");
 #endif  // BENCHMARK
+
+  if (feature_extractor != nullptr) {
+    LOG(INFO) << "soundstream_encoder state copies avoided per frame: "
+              << feature_extractor->saved_state_copy_bytes() << " bytes";
+  }
+  if (model != nullptr) {
+    LOG(INFO) << "lyragan state copies avoided per frame: "
+              << model->saved_state_copy_bytes() << " bytes";
+  }
+
+  if (profile_ops) {
+    if (feature_extractor != nullptr) {
+      PrintOpProfile(feature_extractor->GetProfileReport(),
+                     "soundstream_encoder");
+    }
+    if (vector_quantizer != nullptr) {
+      PrintOpProfile(vector_quantizer->GetProfileReport(), "quantizer");
+    }
+    if (model != nullptr) {
+      PrintOpProfile(model->GetProfileReport(), "lyragan");
+    }
+  }
   return 0;
 }
 
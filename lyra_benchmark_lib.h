@@ -31,9 +31,11 @@ struct TimingStats {
   float standard_deviation;
 };
 
+// If |profile_ops| is true, the time spent in every TFLite op is logged as
+// well, along with the ops which could not be run by XNNPack.
 int lyra_benchmark(int num_cond_vectors, const std::string& model_base_path,
                    bool benchmark_feature_extraction, bool benchmark_quantizer,
-                   bool benchmark_generative_model);
+                   bool benchmark_generative_model, bool profile_ops = false);
 
 }  // namespace codec
 }  // namespace chromemedia
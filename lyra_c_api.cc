@@ -0,0 +1,156 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra_c_api.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "lyra_config.h"
+#include "lyra_decoder.h"
+#include "lyra_encoder.h"
+#include "redundant_packet.h"
+
+struct lyra_encoder {
+  std::unique_ptr<chromemedia::codec::LyraEncoder> encoder;
+};
+
+struct lyra_decoder {
+  std::unique_ptr<chromemedia::codec::LyraDecoder> decoder;
+};
+
+size_t lyra_max_packet_size(void) {
+  return chromemedia::codec::GetMaxPacketSize();
+}
+
+lyra_encoder* lyra_encoder_new(int sample_rate_hz, int num_channels,
+                               int bitrate, int enable_dtx,
+                               const char* model_path) {
+  if (model_path == nullptr) {
+    LOG(ERROR) << "Model path must not be null.";
+    return nullptr;
+  }
+  auto encoder = chromemedia::codec::LyraEncoder::Create(
+      sample_rate_hz, num_channels, bitrate, enable_dtx != 0, model_path);
+  if (encoder == nullptr) {
+    return nullptr;
+  }
+  return new lyra_encoder{std::move(encoder)};
+}
+
+void lyra_encoder_free(lyra_encoder* encoder) { delete encoder; }
+
+int lyra_encoder_num_samples_per_hop(const lyra_encoder* encoder) {
+  if (encoder == nullptr) {
+    return LYRA_ERROR_INVALID_ARGUMENT;
+  }
+  return chromemedia::codec::GetNumSamplesPerHop(
+      encoder->encoder->sample_rate_hz());
+}
+
+int lyra_encode_into(lyra_encoder* encoder, const int16_t* samples,
+                     size_t num_samples, uint8_t* packet,
+                     size_t packet_capacity) {
+  if (encoder == nullptr || samples == nullptr || packet == nullptr) {
+    return LYRA_ERROR_INVALID_ARGUMENT;
+  }
+  const auto encoded =
+      encoder->encoder->Encode(absl::MakeConstSpan(samples, num_samples));
+  if (!encoded.has_value()) {
+    return LYRA_ERROR_CODEC_FAILURE;
+  }
+  if (encoded->size() > packet_capacity) {
+    LOG(ERROR) << "Packet of " << encoded->size()
+               << " bytes does not fit into a buffer of " << packet_capacity
+               << " bytes.";
+    return LYRA_ERROR_BUFFER_TOO_SMALL;
+  }
+  std::copy(encoded->begin(), encoded->end(), packet);
+  return encoded->size();
+}
+
+int lyra_encoder_set_bitrate(lyra_encoder* encoder, int bitrate) {
+  if (encoder == nullptr || !encoder->encoder->set_bitrate(bitrate)) {
+    return LYRA_ERROR_INVALID_ARGUMENT;
+  }
+  return LYRA_OK;
+}
+
+int lyra_encoder_set_packet_loss_rate(lyra_encoder* encoder,
+                                      float packet_loss_rate) {
+  if (encoder == nullptr ||
+      !encoder->encoder->SetPacketLossRate(packet_loss_rate)) {
+    return LYRA_ERROR_INVALID_ARGUMENT;
+  }
+  return LYRA_OK;
+}
+
+lyra_decoder* lyra_decoder_new(int sample_rate_hz, int num_channels,
+                               const char* model_path) {
+  if (model_path == nullptr) {
+    LOG(ERROR) << "Model path must not be null.";
+    return nullptr;
+  }
+  auto decoder = chromemedia::codec::LyraDecoder::Create(
+      sample_rate_hz, num_channels, model_path);
+  if (decoder == nullptr) {
+    return nullptr;
+  }
+  return new lyra_decoder{std::move(decoder)};
+}
+
+void lyra_decoder_free(lyra_decoder* decoder) { delete decoder; }
+
+int lyra_decoder_set_packet(lyra_decoder* decoder, const uint8_t* packet,
+                            size_t packet_size) {
+  if (decoder == nullptr || packet == nullptr ||
+      !decoder->decoder->SetEncodedPacket(
+          absl::MakeConstSpan(packet, packet_size))) {
+    return LYRA_ERROR_INVALID_ARGUMENT;
+  }
+  return LYRA_OK;
+}
+
+int lyra_decode_into(lyra_decoder* decoder, int16_t* samples,
+                     size_t num_samples) {
+  if (decoder == nullptr || samples == nullptr) {
+    return LYRA_ERROR_INVALID_ARGUMENT;
+  }
+  // The number of samples written is returned as an int.
+  if (num_samples > static_cast<size_t>(std::numeric_limits<int>::max())) {
+    LOG(ERROR) << "Cannot decode " << num_samples << " samples in one call.";
+    return LYRA_ERROR_INVALID_ARGUMENT;
+  }
+  if (!decoder->decoder->DecodeSamplesInto(
+          absl::MakeSpan(samples, num_samples))) {
+    return LYRA_ERROR_CODEC_FAILURE;
+  }
+  return num_samples;
+}
+
+int lyra_decoder_is_comfort_noise(const lyra_decoder* decoder) {
+  if (decoder == nullptr) {
+    return LYRA_ERROR_INVALID_ARGUMENT;
+  }
+  return decoder->decoder->is_comfort_noise() ? 1 : 0;
+}
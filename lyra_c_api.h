@@ -0,0 +1,130 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_LYRA_C_API_H_
+#define LYRA_CODEC_LYRA_C_API_H_
+
+/// @file lyra_c_api.h
+/// C interface to LyraEncoder and LyraDecoder for FFI users.
+///
+/// Encoders and decoders are persistent handles which keep their state across
+/// calls, and all results are written into buffers owned by the caller. Every
+/// function which can fail returns a negative LYRA_ERROR_* code on failure.
+/// A handle may only be used by one thread at a time.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define LYRA_EXPORT __declspec(dllexport)
+#else
+#define LYRA_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LYRA_OK 0
+#define LYRA_ERROR_INVALID_ARGUMENT -1
+#define LYRA_ERROR_BUFFER_TOO_SMALL -2
+#define LYRA_ERROR_CODEC_FAILURE -3
+
+typedef struct lyra_encoder lyra_encoder;
+typedef struct lyra_decoder lyra_decoder;
+
+/// @return The largest packet any encoder writes, in bytes, including a
+///         redundant copy of the previous frame.
+LYRA_EXPORT size_t lyra_max_packet_size(void);
+
+/// Creates an encoder. The parameters are the same as for LyraEncoder.
+///
+/// @param sample_rate_hz Sample rate of the audio in Hertz.
+/// @param num_channels Number of channels. Currently only 1 is supported.
+/// @param bitrate Bitrate of the packets in bps.
+/// @param enable_dtx Nonzero if hops of noise should not be sent.
+/// @param model_path Path to the model weights.
+/// @return The encoder, or NULL if the parameters are not supported.
+LYRA_EXPORT lyra_encoder* lyra_encoder_new(int sample_rate_hz, int num_channels,
+                                           int bitrate, int enable_dtx,
+                                           const char* model_path);
+
+/// Destroys |encoder|. Does nothing if it is NULL.
+LYRA_EXPORT void lyra_encoder_free(lyra_encoder* encoder);
+
+/// @return The number of samples of one hop, which lyra_encode_into() takes.
+LYRA_EXPORT int lyra_encoder_num_samples_per_hop(const lyra_encoder* encoder);
+
+/// Encodes one hop of audio.
+///
+/// @param samples One hop of samples.
+/// @param num_samples Number of samples in |samples|.
+/// @param packet Buffer the packet is written to.
+/// @param packet_capacity Size of |packet| in bytes. A buffer of
+///                        lyra_max_packet_size() bytes always suffices.
+/// @return Size of the packet in bytes, which is 0 if the hop is not sent
+///         because of DTX.
+LYRA_EXPORT int lyra_encode_into(lyra_encoder* encoder, const int16_t* samples,
+                                 size_t num_samples, uint8_t* packet,
+                                 size_t packet_capacity);
+
+/// Sets the bitrate of the following packets.
+///
+/// @return LYRA_OK if the bitrate is supported.
+LYRA_EXPORT int lyra_encoder_set_bitrate(lyra_encoder* encoder, int bitrate);
+
+/// Makes the following packets carry a redundant copy of the previous frame
+/// which suits a receiver reporting |packet_loss_rate| in [0, 1].
+///
+/// @return LYRA_OK if the packet loss rate is valid.
+LYRA_EXPORT int lyra_encoder_set_packet_loss_rate(lyra_encoder* encoder,
+                                                  float packet_loss_rate);
+
+/// Creates a decoder. The parameters are the same as for LyraDecoder.
+///
+/// @param sample_rate_hz Sample rate of the decoded audio in Hertz.
+/// @param num_channels Number of channels. Currently only 1 is supported.
+/// @param model_path Path to the model weights.
+/// @return The decoder, or NULL if the parameters are not supported.
+LYRA_EXPORT lyra_decoder* lyra_decoder_new(int sample_rate_hz, int num_channels,
+                                           const char* model_path);
+
+/// Destroys |decoder|. Does nothing if it is NULL.
+LYRA_EXPORT void lyra_decoder_free(lyra_decoder* decoder);
+
+/// Sets the packet which the following samples are decoded from. Hops without
+/// a packet are concealed.
+///
+/// @return LYRA_OK if the packet is valid.
+LYRA_EXPORT int lyra_decoder_set_packet(lyra_decoder* decoder,
+                                        const uint8_t* packet,
+                                        size_t packet_size);
+
+/// Decodes |num_samples| samples into |samples|, which has to hold that many.
+/// |num_samples| may not exceed INT_MAX.
+///
+/// @return The number of samples written.
+LYRA_EXPORT int lyra_decode_into(lyra_decoder* decoder, int16_t* samples,
+                                 size_t num_samples);
+
+/// @return 1 if the last decoded samples were comfort noise, else 0.
+LYRA_EXPORT int lyra_decoder_is_comfort_noise(const lyra_decoder* decoder);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // LYRA_CODEC_LYRA_C_API_H_
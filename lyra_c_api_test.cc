@@ -0,0 +1,116 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lyra_c_api.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra_config.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+constexpr int kSampleRateHz = 16000;
+constexpr int kBitrate = 3200;
+
+class LyraCApiTest : public testing::Test {
+ protected:
+  LyraCApiTest()
+      : model_path_(
+            (ghc::filesystem::current_path() / "model_coeffs").string()) {}
+
+  const std::string model_path_;
+};
+
+TEST_F(LyraCApiTest, NewFailsForInvalidParameters) {
+  EXPECT_EQ(lyra_encoder_new(kSampleRateHz, kNumChannels, kBitrate,
+                             /*enable_dtx=*/0, nullptr),
+            nullptr);
+  EXPECT_EQ(lyra_encoder_new(0, kNumChannels, kBitrate, /*enable_dtx=*/0,
+                             model_path_.c_str()),
+            nullptr);
+  EXPECT_EQ(lyra_decoder_new(kSampleRateHz, kNumChannels, nullptr), nullptr);
+  EXPECT_EQ(lyra_decoder_new(0, kNumChannels, model_path_.c_str()), nullptr);
+}
+
+TEST_F(LyraCApiTest, NullHandlesAreRejected) {
+  std::vector<int16_t> samples(GetNumSamplesPerHop(kSampleRateHz));
+  std::vector<uint8_t> packet(lyra_max_packet_size());
+  EXPECT_EQ(lyra_encode_into(nullptr, samples.data(), samples.size(),
+                             packet.data(), packet.size()),
+            LYRA_ERROR_INVALID_ARGUMENT);
+  EXPECT_EQ(lyra_encoder_set_bitrate(nullptr, kBitrate),
+            LYRA_ERROR_INVALID_ARGUMENT);
+  EXPECT_EQ(lyra_decoder_set_packet(nullptr, packet.data(), packet.size()),
+            LYRA_ERROR_INVALID_ARGUMENT);
+  EXPECT_EQ(lyra_decode_into(nullptr, samples.data(), samples.size()),
+            LYRA_ERROR_INVALID_ARGUMENT);
+  lyra_encoder_free(nullptr);
+  lyra_decoder_free(nullptr);
+}
+
+TEST_F(LyraCApiTest, EncodesAndDecodesIntoCallerBuffers) {
+  lyra_encoder* encoder = lyra_encoder_new(
+      kSampleRateHz, kNumChannels, kBitrate, /*enable_dtx=*/0,
+      model_path_.c_str());
+  lyra_decoder* decoder =
+      lyra_decoder_new(kSampleRateHz, kNumChannels, model_path_.c_str());
+  ASSERT_NE(encoder, nullptr);
+  ASSERT_NE(decoder, nullptr);
+
+  const int num_samples_per_hop = lyra_encoder_num_samples_per_hop(encoder);
+  ASSERT_EQ(num_samples_per_hop, GetNumSamplesPerHop(kSampleRateHz));
+  std::vector<int16_t> samples(num_samples_per_hop);
+  for (int i = 0; i < samples.size(); ++i) {
+    samples[i] = 1000 * std::sin(0.1 * i);
+  }
+  std::vector<uint8_t> packet(lyra_max_packet_size());
+  std::vector<int16_t> decoded(num_samples_per_hop);
+  for (int hop = 0; hop < 10; ++hop) {
+    const int packet_size = lyra_encode_into(
+        encoder, samples.data(), samples.size(), packet.data(), packet.size());
+    ASSERT_EQ(packet_size,
+              BitrateToPacketSize(kBitrate, GetFrameRate(kSampleRateHz)));
+    ASSERT_EQ(lyra_decoder_set_packet(decoder, packet.data(), packet_size),
+              LYRA_OK);
+    ASSERT_EQ(lyra_decode_into(decoder, decoded.data(), decoded.size()),
+              num_samples_per_hop);
+    EXPECT_EQ(lyra_decoder_is_comfort_noise(decoder), 0);
+  }
+
+  EXPECT_EQ(lyra_encoder_set_bitrate(encoder, 1), LYRA_ERROR_INVALID_ARGUMENT);
+  EXPECT_EQ(lyra_encode_into(encoder, samples.data(), samples.size(),
+                             packet.data(), /*packet_capacity=*/1),
+            LYRA_ERROR_BUFFER_TOO_SMALL);
+  EXPECT_EQ(lyra_decoder_set_packet(decoder, packet.data(), 1),
+            LYRA_ERROR_INVALID_ARGUMENT);
+  // The result would not fit into the int returned.
+  EXPECT_EQ(lyra_decode_into(
+                decoder, decoded.data(),
+                static_cast<size_t>(std::numeric_limits<int>::max()) + 1),
+            LYRA_ERROR_INVALID_ARGUMENT);
+  lyra_encoder_free(encoder);
+  lyra_decoder_free(decoder);
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
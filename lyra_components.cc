@@ -15,6 +15,7 @@
 #include "lyra_components.h"
 
 #include <memory>
+#include <utility>
 
 #include "feature_extractor_interface.h"
 #include "generative_model_interface.h"
@@ -23,6 +24,7 @@
 #include "packet_interface.h"
 #include "residual_vector_quantizer.h"
 #include "soundstream_encoder.h"
+#include "tflite_model_wrapper.h"
 #include "vector_quantizer_interface.h"
 #include "zero_feature_estimator.h"
 
@@ -33,7 +35,7 @@ namespace {
 //  LINT.IfChange
 constexpr int kMaxNumPacketBits = 480;
 // LINT.ThenChange(
-// lyra_config.cc,
+// lyra_config.h,
 // residual_vector_quantizer.h,
 // )
 
@@ -50,12 +52,34 @@ std::unique_ptr<GenerativeModelInterface> CreateGenerativeModel(
   return LyraGanModel::Create(model_path, num_output_features);
 }
 
+std::shared_ptr<TfLiteModelWrapper> CreateSharedGenerativeModelWrapper(
+    const ghc::filesystem::path& model_path) {
+  return LyraGanModel::CreateSharedWrapper(model_path);
+}
+
+std::unique_ptr<GenerativeModelInterface> CreateMultiplexedGenerativeModel(
+    std::shared_ptr<TfLiteModelWrapper> shared_model,
+    int num_output_features) {
+  return LyraGanModel::CreateMultiplexed(std::move(shared_model),
+                                         num_output_features);
+}
+
 std::unique_ptr<FeatureExtractorInterface> CreateFeatureExtractor(
     int sample_rate_hz, int num_features, int num_samples_per_hop,
     int num_samples_per_window, const ghc::filesystem::path& model_path) {
   return SoundStreamEncoder::Create(model_path);
 }
 
+std::shared_ptr<TfLiteModelWrapper> CreateSharedFeatureExtractorWrapper(
+    const ghc::filesystem::path& model_path) {
+  return SoundStreamEncoder::CreateSharedWrapper(model_path);
+}
+
+std::unique_ptr<FeatureExtractorInterface> CreateMultiplexedFeatureExtractor(
+    std::shared_ptr<TfLiteModelWrapper> shared_model) {
+  return SoundStreamEncoder::CreateMultiplexed(std::move(shared_model));
+}
+
 std::unique_ptr<PacketInterface> CreatePacket(int num_header_bits,
                                               int num_quantized_bits) {
   return Packet<kMaxNumPacketBits>::Create(num_header_bits, num_quantized_bits);
@@ -24,6 +24,7 @@
 #include "generative_model_interface.h"
 #include "include/ghc/filesystem.hpp"
 #include "packet_interface.h"
+#include "tflite_model_wrapper.h"
 #include "vector_quantizer_interface.h"
 
 namespace chromemedia {
@@ -36,10 +37,26 @@ std::unique_ptr<GenerativeModelInterface> CreateGenerativeModel(
     int num_samples_per_hop, int num_output_features,
     const ghc::filesystem::path& model_path);
 
+// Returns a generative model wrapper which many models created with
+// |CreateMultiplexedGenerativeModel| can take turns running on.
+std::shared_ptr<TfLiteModelWrapper> CreateSharedGenerativeModelWrapper(
+    const ghc::filesystem::path& model_path);
+
+std::unique_ptr<GenerativeModelInterface> CreateMultiplexedGenerativeModel(
+    std::shared_ptr<TfLiteModelWrapper> shared_model, int num_output_features);
+
 std::unique_ptr<FeatureExtractorInterface> CreateFeatureExtractor(
     int sample_rate_hz, int num_features, int num_samples_per_hop,
     int num_samples_per_window, const ghc::filesystem::path& model_path);
 
+// Returns a feature extractor wrapper which many extractors created with
+// |CreateMultiplexedFeatureExtractor| can take turns running on.
+std::shared_ptr<TfLiteModelWrapper> CreateSharedFeatureExtractorWrapper(
+    const ghc::filesystem::path& model_path);
+
+std::unique_ptr<FeatureExtractorInterface> CreateMultiplexedFeatureExtractor(
+    std::shared_ptr<TfLiteModelWrapper> shared_model);
+
 std::unique_ptr<PacketInterface> CreatePacket(int num_header_bits,
                                               int num_quantized_bits);
 
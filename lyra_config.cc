@@ -14,6 +14,7 @@
 
 #include "lyra_config.h"
 
+#include <iterator>
 #include <vector>
 
 #include "absl/strings/string_view.h"
@@ -36,18 +37,12 @@ const int kNumFeatures = 64;
 const int kNumMelBins = 160;
 const int kNumChannels = 2;
 const int kFrameRate = 50;
-const int kOverlapFactor = 2;
-// LINT.IfChange
-const int kNumHeaderBits = 0;
 const std::vector<int>& GetSupportedQuantizedBits() {
   static const std::vector<int>* const supported_quantization_bits =
-      new std::vector<int>{64, 120, 184, 240, 304, 360, 424, 480};
+      new std::vector<int>(std::begin(kSupportedQuantizedBits),
+                           std::end(kSupportedQuantizedBits));
   return *supported_quantization_bits;
 }
-// LINT.ThenChange(
-// lyra_components.cc,
-// residual_vector_quantizer.h,
-// )
 
 std::vector<absl::string_view> GetAssets() {
   return std::vector<absl::string_view>{"quantizer.tflite", "lyragan.tflite",
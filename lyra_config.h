@@ -50,15 +50,83 @@ ABSL_CONST_INIT extern const int kNumFeatures;
 ABSL_CONST_INIT extern const int kNumMelBins;
 ABSL_CONST_INIT extern const int kNumChannels;
 ABSL_CONST_INIT extern const int kFrameRate; 
-ABSL_CONST_INIT extern const int kOverlapFactor;
-ABSL_CONST_INIT extern const int kNumHeaderBits;
+
+inline constexpr int kOverlapFactor = 2;
+// LINT.IfChange
+inline constexpr int kNumHeaderBits = 0;
+inline constexpr int kSupportedQuantizedBits[] = {64,  120, 184, 240,
+                                                  304, 360, 424, 480};
+// LINT.ThenChange(
+// lyra_components.cc,
+// residual_vector_quantizer.h,
+// )
 
 inline constexpr int kSupportedSampleRates[] = {8000, 16000, 24000, 32000, 48000};
 inline constexpr int kInternalSampleRateHz = 16000;
 
+// Quality presets are numbered from 1 and select the entries of
+// |kSupportedQuantizedBits| in order.
+inline constexpr int kNumQualityPresets =
+    sizeof(kSupportedQuantizedBits) / sizeof(kSupportedQuantizedBits[0]);
 
 const std::vector<int>& GetSupportedQuantizedBits();
 
+// Everything that depends only on the sample rate. All supported sample rates
+// use hops of the same length, so the frame rate scales with the sample rate.
+// Profiles are looked up once when a codec is created, instead of being
+// re-derived on every call.
+struct CodecProfile {
+  static constexpr int kNumSamplesPerHop = 320;
+
+  int sample_rate_hz;
+  int num_features;
+
+  constexpr int frame_rate() const {
+    return sample_rate_hz / kNumSamplesPerHop;
+  }
+  constexpr int num_samples_per_hop() const { return kNumSamplesPerHop; }
+  constexpr int num_samples_per_window() const {
+    return kOverlapFactor * kNumSamplesPerHop;
+  }
+  constexpr int num_mel_bins() const { return num_features * 5 / 2; }
+};
+
+inline constexpr CodecProfile kCodecProfiles[] = {
+    {/*sample_rate_hz=*/8000, /*num_features=*/96},
+    {/*sample_rate_hz=*/16000, /*num_features=*/64},
+    {/*sample_rate_hz=*/24000, /*num_features=*/48},
+    {/*sample_rate_hz=*/32000, /*num_features=*/32},
+    {/*sample_rate_hz=*/48000, /*num_features=*/16},
+};
+
+// Returns the profile for |sample_rate_hz|, or nullptr if the sample rate is
+// not supported.
+constexpr const CodecProfile* FindCodecProfile(int sample_rate_hz) {
+  for (const CodecProfile& profile : kCodecProfiles) {
+    if (profile.sample_rate_hz == sample_rate_hz) {
+      return &profile;
+    }
+  }
+  return nullptr;
+}
+
+// Compile-time access to the profile of a supported sample rate.
+template <int SampleRateHz>
+struct CodecProfileFor {
+  static_assert(FindCodecProfile(SampleRateHz) != nullptr,
+                "Sample rate is not supported by codec.");
+  static constexpr CodecProfile kValue = *FindCodecProfile(SampleRateHz);
+};
+
+// Returns the number of quantized bits of |quality_preset|, or -1 if the preset
+// is not in [1, kNumQualityPresets].
+constexpr int QualityPresetToNumQuantizedBits(int quality_preset) {
+  if (quality_preset < 1 || quality_preset > kNumQualityPresets) {
+    return -1;
+  }
+  return kSupportedQuantizedBits[quality_preset - 1];
+}
+
 // Returns a string of form "|kVersionMajor|.|kVersionMinor|.|kVersionMicro|".
 inline const std::string& GetVersionString() {
   static const std::string kVersionString = [] {
@@ -67,6 +135,10 @@ inline const std::string& GetVersionString() {
   return kVersionString;
 }
 
+inline bool IsSampleRateSupported(int sample_rate_hz) {
+  return FindCodecProfile(sample_rate_hz) != nullptr;
+}
+
 // Functions to get values depending on sample rate.
 inline int GetNumSamplesPerHop(int sample_rate_hz, int frame_rate) {
   CHECK_EQ(sample_rate_hz % frame_rate, 0);
@@ -77,9 +149,23 @@ inline int GetNumSamplesPerWindow(int sample_rate_hz, int frame_rate) {
   return kOverlapFactor * GetNumSamplesPerHop(sample_rate_hz, frame_rate);
 }
 
-inline int GetPacketSize(int num_quantized_bits) {
-  return static_cast<int>(std::ceil(
-      static_cast<float>(num_quantized_bits + kNumHeaderBits) / CHAR_BIT));
+// Profile-based variants, which must only be called with supported sample
+// rates.
+inline int GetNumSamplesPerHop(int sample_rate_hz) {
+  CHECK(IsSampleRateSupported(sample_rate_hz));
+  return CodecProfile::kNumSamplesPerHop;
+}
+
+inline int GetNumSamplesPerWindow(int sample_rate_hz) {
+  return kOverlapFactor * GetNumSamplesPerHop(sample_rate_hz);
+}
+
+inline int GetFrameRate(int sample_rate_hz) {
+  return sample_rate_hz / GetNumSamplesPerHop(sample_rate_hz);
+}
+
+constexpr int GetPacketSize(int num_quantized_bits) {
+  return (num_quantized_bits + kNumHeaderBits + CHAR_BIT - 1) / CHAR_BIT;
 }
 
 inline int BitrateToPacketSize(int bitrate, int frame_rate) {
@@ -87,16 +173,10 @@ inline int BitrateToPacketSize(int bitrate, int frame_rate) {
       std::ceil(static_cast<float>(bitrate) / (frame_rate * CHAR_BIT)));
 }
 
-inline int GetBitrate(int num_quantized_bits, int frame_rate) {
+constexpr int GetBitrate(int num_quantized_bits, int frame_rate) {
   return GetPacketSize(num_quantized_bits) * CHAR_BIT * frame_rate;
 }
 
-inline bool IsSampleRateSupported(int sample_rate_hz) {
-  return std::find(std::begin(kSupportedSampleRates),
-                   std::end(kSupportedSampleRates),
-                   sample_rate_hz) != std::end(kSupportedSampleRates);
-}
-
 inline int PacketSizeToNumQuantizedBits(int packet_size) {
   for (int num_quantized_bits : GetSupportedQuantizedBits()) {
     if (packet_size == GetPacketSize(num_quantized_bits)) {
@@ -106,6 +186,18 @@ inline int PacketSizeToNumQuantizedBits(int packet_size) {
   return -1;
 }
 
+// Returns the bitrate of |quality_preset| at |sample_rate_hz|, or -1 if either
+// one is not supported.
+constexpr int QualityPresetToBitrate(int quality_preset, int sample_rate_hz) {
+  const CodecProfile* profile = FindCodecProfile(sample_rate_hz);
+  const int num_quantized_bits =
+      QualityPresetToNumQuantizedBits(quality_preset);
+  if (profile == nullptr || num_quantized_bits < 0) {
+    return -1;
+  }
+  return GetBitrate(num_quantized_bits, profile->frame_rate());
+}
+
 inline int BitrateToNumQuantizedBits(int bitrate, int frame_rate) {
   for (int num_quantized_bits : GetSupportedQuantizedBits()) {
     if (bitrate == GetBitrate(num_quantized_bits, frame_rate)) {
@@ -104,6 +104,32 @@ TEST_F(LyraConfigTest, GoodBitrateSupported) {
   }
 }
 
+TEST_F(LyraConfigTest, CodecProfilesCoverSupportedSampleRates) {
+  for (int sample_rate_hz : kSupportedSampleRates) {
+    const CodecProfile* profile = FindCodecProfile(sample_rate_hz);
+    ASSERT_NE(profile, nullptr);
+    EXPECT_EQ(profile->frame_rate() * profile->num_samples_per_hop(),
+              sample_rate_hz);
+    EXPECT_EQ(GetNumSamplesPerHop(sample_rate_hz),
+              GetNumSamplesPerHop(sample_rate_hz, profile->frame_rate()));
+  }
+  EXPECT_EQ(FindCodecProfile(/*sample_rate_hz=*/137), nullptr);
+}
+
+TEST_F(LyraConfigTest, QualityPresetsSelectSupportedQuantizedBits) {
+  for (int sample_rate_hz : kSupportedSampleRates) {
+    for (int preset = 1; preset <= kNumQualityPresets; ++preset) {
+      const int bitrate = QualityPresetToBitrate(preset, sample_rate_hz);
+      EXPECT_EQ(
+          BitrateToNumQuantizedBits(bitrate, GetFrameRate(sample_rate_hz)),
+          GetSupportedQuantizedBits().at(preset - 1));
+    }
+    EXPECT_LT(QualityPresetToBitrate(0, sample_rate_hz), 0);
+    EXPECT_LT(QualityPresetToBitrate(kNumQualityPresets + 1, sample_rate_hz),
+              0);
+  }
+}
+
 TEST_F(LyraConfigTest, BadPacketSizeNotSupported) {
   EXPECT_LT(PacketSizeToNumQuantizedBits(0), 0);
 }
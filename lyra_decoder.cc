@@ -20,6 +20,8 @@
 #include <functional>
 #include <memory>
 #include <optional>
+#include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -28,53 +30,74 @@
 #include "absl/types/span.h"
 #include "buffered_resampler.h"
 #include "comfort_noise_generator.h"
+#include "dsp_kernels.h"
+#include "dsp_utils.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "include/ghc/filesystem.hpp"
 #include "lyra_components.h"
 #include "lyra_config.h"
 #include "noise_estimator.h"
+#include "packet_interface.h"
+#include "redundant_packet.h"
+#include "tflite_model_wrapper.h"
 
 namespace chromemedia {
 namespace codec {
 namespace {
 
+constexpr int kConcealmentDurationMs = 80;
+constexpr int kFadeDurationMs = 40;
+
 // Duration of pure packet loss concealment.
-inline int GetConcealmentDurationSamples(int sample_rate_hz) {
-  static const float kConcealmentDurationSeconds = 0.08;
-  static const int kConcealmentDurationSamples =
-      kConcealmentDurationSeconds * sample_rate_hz;
-  CHECK_EQ(
-      kConcealmentDurationSamples % GetNumSamplesPerHop(sample_rate_hz, (sample_rate_hz/320)),
-      0);
-  return kConcealmentDurationSamples;
+constexpr int GetConcealmentDurationSamples(int sample_rate_hz) {
+  return kConcealmentDurationMs * sample_rate_hz / 1000;
 }
 
-inline int GetNumFeatures(int sample_rate_hz) {
-  int numFeatures = 64;
-  if (sample_rate_hz == 8000) {
-    numFeatures = 96;
-  } else if (sample_rate_hz == 16000) {
-    numFeatures = 64; //make sure these values don't give decoder warnings
-  } else if (sample_rate_hz == 24000) {
-    numFeatures = 48; 
-  } else if (sample_rate_hz == 32000) {
-    numFeatures = 32; 
-  } else if (sample_rate_hz == 48000) {
-    numFeatures = 16; 
-  } else {
-    LOG(ERROR) << "Unsupported sampling rate: " << sample_rate_hz;
-  }
-  return numFeatures;
-}
 // Duration it takes to fade from concealment to comfort noise, and from
 // comfort noise to received packets.
-inline int GetFadeDurationSamples(int sample_rate_hz) {
-  static const float kFadeDurationSeconds = 0.04;
-  static const int kFadeDurationSamples =
-      kFadeDurationSeconds * sample_rate_hz;
-  CHECK_EQ(kFadeDurationSamples % GetNumSamplesPerHop(sample_rate_hz, (sample_rate_hz/320)),
-           0);
-  return kFadeDurationSamples;
+constexpr int GetFadeDurationSamples(int sample_rate_hz) {
+  return kFadeDurationMs * sample_rate_hz / 1000;
+}
+
+constexpr bool AreDurationsHopAligned() {
+  for (const CodecProfile& profile : kCodecProfiles) {
+    if (GetConcealmentDurationSamples(profile.sample_rate_hz) %
+                CodecProfile::kNumSamplesPerHop !=
+            0 ||
+        GetFadeDurationSamples(profile.sample_rate_hz) %
+                CodecProfile::kNumSamplesPerHop !=
+            0) {
+      return false;
+    }
+  }
+  return true;
+}
+static_assert(AreDurationsHopAligned(),
+              "Concealment and fade must last a whole number of hops at "
+              "every supported sample rate.");
+
+// Returns the weight of the generative model output at each fade progress in
+// [0, |fade_duration_samples|), which falls from 1 to 0 along a cos^2 curve.
+std::vector<float> CreateFadeWindow(int fade_duration_samples) {
+  std::vector<float> fade_window(fade_duration_samples);
+  for (int i = 0; i < fade_duration_samples; ++i) {
+    fade_window[i] =
+        (1.f + std::cos(i * M_PI / fade_duration_samples)) / 2.f;
+  }
+  return fade_window;
+}
+
+// Writes |weights| * |from| + (1 - |weights|) * |to| to |destination| with
+// the vectorized kernels of the host CPU.
+void Crossfade(const float* from, const float* to, const float* weights,
+               int num_samples, float* destination) {
+  GetDspKernels().crossfade(from, to, weights, num_samples, destination);
+}
+
+void Crossfade(const int16_t* from, const int16_t* to, const float* weights,
+               int num_samples, int16_t* destination) {
+  GetDspKernels().crossfade_int16(from, to, weights, num_samples,
+                                  destination);
 }
 
 // Reconciles the number of samples requested with the number we should
@@ -84,23 +107,23 @@ int GetNumSamplesToGenerate(int num_samples_requested,
                             int concealment_progress,
                             int model_samples_available,
                             int cng_samples_available,
-                            int sample_rate_hz) {
+                            int concealment_duration_samples) {
   int samples_remaining_packet;
   if (concealment_progress < 0) {
     // Finish playing out the remainder of the last fake packet.
     samples_remaining_packet = std::abs(concealment_progress);
-  } else if (concealment_progress < GetConcealmentDurationSamples(sample_rate_hz)) {
+  } else if (concealment_progress < concealment_duration_samples) {
     // If we have not yet maxed out concealment progress, the
     // |generative_model_| will be used.
     samples_remaining_packet =
-        model_samples_available % GetNumSamplesPerHop(sample_rate_hz, (sample_rate_hz/320));
+        model_samples_available % CodecProfile::kNumSamplesPerHop;
   } else {
     // Otherwise the  |comfort_noise_generator_| is guaranteed to be used.
     samples_remaining_packet = cng_samples_available;
   }
   // If we are out of samples, assume we can always add estimated features.
   if (samples_remaining_packet == 0) {
-    samples_remaining_packet = GetNumSamplesPerHop(sample_rate_hz, (sample_rate_hz/320));
+    samples_remaining_packet = CodecProfile::kNumSamplesPerHop;
   }
   // Take the min between the next packet boundary and the remaining number of
   // samples requested.
@@ -108,20 +131,73 @@ int GetNumSamplesToGenerate(int num_samples_requested,
                   samples_remaining_packet);
 }
 
+// Generates |num_samples| of type |T| from |model|.
+template <typename T>
+std::optional<std::vector<T>> GenerateSamples(GenerativeModelInterface& model,
+                                              int num_samples) {
+  if constexpr (std::is_same_v<T, float>) {
+    return model.GenerateFloatSamples(num_samples);
+  } else {
+    return model.GenerateSamples(num_samples);
+  }
+}
+
 }  // namespace
 
 std::unique_ptr<LyraDecoder> LyraDecoder::Create(
     int sample_rate_hz, int num_channels,
+    const ghc::filesystem::path& model_path,
+    int num_hops_per_noise_estimate, bool deterministic) {
+  absl::Status are_params_supported =
+      AreParamsSupported(sample_rate_hz, num_channels, model_path);
+  if (!are_params_supported.ok()) {
+    LOG(ERROR) << are_params_supported;
+    return nullptr;
+  }
+  const CodecProfile& profile = *FindCodecProfile(sample_rate_hz);
+  return CreateWithGenerativeModel(
+      sample_rate_hz, num_channels, model_path,
+      CreateGenerativeModel(profile.num_samples_per_hop(),
+                            profile.num_features, model_path),
+      num_hops_per_noise_estimate, deterministic);
+}
+
+std::shared_ptr<TfLiteModelWrapper> LyraDecoder::CreateSharedModel(
     const ghc::filesystem::path& model_path) {
+  return CreateSharedGenerativeModelWrapper(model_path);
+}
+
+std::unique_ptr<LyraDecoder> LyraDecoder::Create(
+    int sample_rate_hz, int num_channels,
+    const ghc::filesystem::path& model_path,
+    std::shared_ptr<TfLiteModelWrapper> shared_model,
+    int num_hops_per_noise_estimate, bool deterministic) {
   absl::Status are_params_supported =
       AreParamsSupported(sample_rate_hz, num_channels, model_path);
   if (!are_params_supported.ok()) {
     LOG(ERROR) << are_params_supported;
     return nullptr;
   }
-  const int kNumSamplesPerHop = GetNumSamplesPerHop(sample_rate_hz, (sample_rate_hz/320));
-  const int kNumSamplesPerWindow =
-      GetNumSamplesPerWindow(sample_rate_hz, (sample_rate_hz/320));
+  if (shared_model == nullptr) {
+    LOG(ERROR) << "Shared model must not be null.";
+    return nullptr;
+  }
+  const CodecProfile& profile = *FindCodecProfile(sample_rate_hz);
+  return CreateWithGenerativeModel(
+      sample_rate_hz, num_channels, model_path,
+      CreateMultiplexedGenerativeModel(std::move(shared_model),
+                                       profile.num_features),
+      num_hops_per_noise_estimate, deterministic);
+}
+
+std::unique_ptr<LyraDecoder> LyraDecoder::CreateWithGenerativeModel(
+    int sample_rate_hz, int num_channels,
+    const ghc::filesystem::path& model_path,
+    std::unique_ptr<GenerativeModelInterface> model,
+    int num_hops_per_noise_estimate, bool deterministic) {
+  const CodecProfile& profile = *FindCodecProfile(sample_rate_hz);
+  const int kNumSamplesPerHop = profile.num_samples_per_hop();
+  const int kNumSamplesPerWindow = profile.num_samples_per_window();
 
   // The resampler always resamples from |external_sample_rate_hz_| to the
   // requested |sample_rate_hz|.
@@ -132,32 +208,30 @@ std::unique_ptr<LyraDecoder> LyraDecoder::Create(
     return nullptr;
   }
   // All internal components operate at |external_sample_rate_hz_|.
-  auto model =
-      CreateGenerativeModel(kNumSamplesPerHop, GetNumFeatures(sample_rate_hz), model_path);
   if (model == nullptr) {
     LOG(ERROR) << "New model could not be instantiated.";
     return nullptr;
   }
-  auto comfort_noise_generator =
-      ComfortNoiseGenerator::Create(sample_rate_hz, kNumSamplesPerHop,
-                                    kNumSamplesPerWindow, (GetNumFeatures(sample_rate_hz)*2.5));
+  auto comfort_noise_generator = ComfortNoiseGenerator::Create(
+      sample_rate_hz, kNumSamplesPerHop, kNumSamplesPerWindow,
+      profile.num_mel_bins(), /*random_seed=*/!deterministic);
   if (comfort_noise_generator == nullptr) {
     LOG(ERROR) << "Could not create Comfort Noise Generator.";
     return nullptr;
   }
-  auto noise_estimator =
-      NoiseEstimator::Create(sample_rate_hz, kNumSamplesPerHop,
-                             kNumSamplesPerWindow, (GetNumFeatures(sample_rate_hz)*2.5));
+  auto noise_estimator = NoiseEstimator::Create(
+      sample_rate_hz, kNumSamplesPerHop, kNumSamplesPerWindow,
+      profile.num_mel_bins(), num_hops_per_noise_estimate);
   if (noise_estimator == nullptr) {
     LOG(ERROR) << "Could not create Noise Estimator.";
     return nullptr;
   }
-  auto vector_quantizer = CreateQuantizer(GetNumFeatures(sample_rate_hz), model_path);
+  auto vector_quantizer = CreateQuantizer(profile.num_features, model_path);
   if (vector_quantizer == nullptr) {
     LOG(ERROR) << "Could not create Vector Quantizer.";
     return nullptr;
   }
-  auto feature_estimator = CreateFeatureEstimator(GetNumFeatures(sample_rate_hz));
+  auto feature_estimator = CreateFeatureEstimator(profile.num_features);
 
   // WrapUnique is used because of private c'tor.
   return absl::WrapUnique(
@@ -182,57 +256,124 @@ LyraDecoder::LyraDecoder(
       noise_estimator_(std::move(noise_estimator)),
       feature_estimator_(std::move(feature_estimator)),
       resampler_(std::move(resampler)),
+      first_quantized_packet_(0),
+      num_quantized_packets_(0),
       concealment_progress_(0),
       fade_progress_(0),
       fade_direction_(FadeDirection::kFadeFromCNG),
       external_sample_rate_hz_(external_sample_rate_hz),
-      num_channels_(num_channels) {}
+      num_channels_(num_channels),
+      profile_(*FindCodecProfile(external_sample_rate_hz)),
+      concealment_duration_samples_(
+          GetConcealmentDurationSamples(external_sample_rate_hz)),
+      fade_duration_samples_(GetFadeDurationSamples(external_sample_rate_hz)),
+      fade_window_(CreateFadeWindow(fade_duration_samples_)) {
+  // A jitter buffer hands over a few packets at a time.
+  constexpr int kNumPreallocatedQuantizedPackets = 4;
+  quantized_packets_.resize(kNumPreallocatedQuantizedPackets);
+  for (std::string& quantized : quantized_packets_) {
+    quantized.reserve(kSupportedQuantizedBits[kNumQualityPresets - 1]);
+  }
+}
 
 bool LyraDecoder::SetEncodedPacket(absl::Span<const uint8_t> encoded) {
-  const int num_quantized_bits = PacketSizeToNumQuantizedBits(encoded.size());
-  if (num_quantized_bits < 0) {
+  const std::optional<RedundantPacket> split = SplitRedundantPacket(encoded);
+  if (!split.has_value()) {
     LOG(ERROR) << "The packet size (" << encoded.size()
                << " bytes) is not supported.";
     return false;
   }
-  auto packet = CreatePacket(kNumHeaderBits, num_quantized_bits);
-  const auto unpacked = packet->UnpackPacket(encoded);
-  if (!unpacked.has_value()) {
+  return AddPacketFeatures(
+      split->primary, PacketSizeToNumQuantizedBits(split->primary.size()));
+}
+
+bool LyraDecoder::SetRedundantPacket(absl::Span<const uint8_t> next_encoded) {
+  const std::optional<RedundantPacket> split =
+      SplitRedundantPacket(next_encoded);
+  if (!split.has_value()) {
+    LOG(ERROR) << "The packet size (" << next_encoded.size()
+               << " bytes) is not supported.";
+    return false;
+  }
+  if (split->redundant.empty()) {
+    VLOG(1) << "Packet carries no redundant copy of the previous frame.";
+    return false;
+  }
+  return AddPacketFeatures(split->redundant, split->num_redundant_bits);
+}
+
+bool LyraDecoder::AddPacketFeatures(absl::Span<const uint8_t> encoded,
+                                    int num_quantized_bits) {
+  std::unique_ptr<PacketInterface>& packet = packets_[num_quantized_bits];
+  if (packet == nullptr) {
+    packet = CreatePacket(kNumHeaderBits, num_quantized_bits);
+  }
+  if (num_quantized_packets_ == quantized_packets_.size()) {
+    // Doubles the ring with the oldest packet first.
+    std::rotate(quantized_packets_.begin(),
+                quantized_packets_.begin() + first_quantized_packet_,
+                quantized_packets_.end());
+    first_quantized_packet_ = 0;
+    quantized_packets_.resize(2 * quantized_packets_.size());
+  }
+  std::string& quantized =
+      quantized_packets_[(first_quantized_packet_ + num_quantized_packets_) %
+                         quantized_packets_.size()];
+  if (!packet->UnpackPacketInto(encoded, &quantized)) {
     LOG(ERROR) << "Could not read Lyra packet for decoding.";
     return false;
   }
 
   // Finish playing out any concealment or comfort noise packets before
   // moving on to the packet we are receiving.
-  if (concealment_progress_ == GetConcealmentDurationSamples(external_sample_rate_hz_)) {
+  if (concealment_progress_ == concealment_duration_samples_) {
     concealment_progress_ = -comfort_noise_generator_->num_samples_available();
   } else if (concealment_progress_ > 0) {
-    concealment_progress_ = -generative_model_->num_samples_available();
+    concealment_progress_ = -num_model_samples_available();
   }
   // No need to update |concealment_progress| if it is already less than
   // or equal to zero. If equal to zero we were decoding samples normally.
   // If less than zero we received than one packet while still decoding
   // concealment or comfort noise.
 
-  auto features = vector_quantizer_->DecodeToLossyFeatures(unpacked.value());
-  if (!features.has_value()) {
-    LOG(ERROR) << "Could not decode to lossy features.";
-    return false;
-  }
-  if (!generative_model_->AddFeatures(features.value())) {
-    LOG(ERROR) << "Could not add received features to generative model.";
-    return false;
+  // Dequantizing runs the quantizer model, so it is deferred to the decode
+  // path, which dequantizes all packets played out by one call together.
+  ++num_quantized_packets_;
+  return true;
+}
+
+bool LyraDecoder::DequantizePackets(int num_samples) {
+  while (num_quantized_packets_ > 0 &&
+         generative_model_->num_samples_available() < num_samples) {
+    const auto features = vector_quantizer_->DecodeToLossyFeatures(
+        quantized_packets_[first_quantized_packet_]);
+    first_quantized_packet_ =
+        (first_quantized_packet_ + 1) % quantized_packets_.size();
+    --num_quantized_packets_;
+    if (!features.has_value()) {
+      LOG(ERROR) << "Could not decode to lossy features.";
+      return false;
+    }
+    if (!generative_model_->AddFeatures(features.value())) {
+      LOG(ERROR) << "Could not add received features to generative model.";
+      return false;
+    }
+    feature_estimator_->Update(features.value());
   }
-  feature_estimator_->Update(features.value());
   return true;
 }
 
+int LyraDecoder::num_model_samples_available() const {
+  return generative_model_->num_samples_available() +
+         num_quantized_packets_ * CodecProfile::kNumSamplesPerHop;
+}
+
 std::optional<std::vector<int16_t>> LyraDecoder::DecodeSamples(
     int num_samples) {
   std::function<std::optional<std::vector<int16_t>>(int)> decode_function =
       [this](int internal_num_samples_to_generate)
       -> std::optional<std::vector<int16_t>> {
-    return DecodeSamplesInternal(internal_num_samples_to_generate);
+    return DecodeSamplesInternal<int16_t>(internal_num_samples_to_generate);
   };
   auto external_samples =
       resampler_->FilterAndBuffer(decode_function, num_samples);
@@ -244,14 +385,45 @@ std::optional<std::vector<int16_t>> LyraDecoder::DecodeSamples(
   return external_samples;
 }
 
-std::optional<std::vector<int16_t>> LyraDecoder::DecodeSamplesInternal(
+bool LyraDecoder::DecodeSamplesInto(absl::Span<int16_t> samples) {
+  const auto decoded = DecodeSamples(samples.size());
+  if (!decoded.has_value()) {
+    return false;
+  }
+  std::copy(decoded->begin(), decoded->end(), samples.begin());
+  return true;
+}
+
+std::optional<std::vector<float>> LyraDecoder::DecodeFloatSamples(
+    int num_samples) {
+  std::function<std::optional<std::vector<float>>(int)> decode_function =
+      [this](int internal_num_samples_to_generate)
+      -> std::optional<std::vector<float>> {
+    return DecodeSamplesInternal<float>(internal_num_samples_to_generate);
+  };
+  auto external_samples =
+      resampler_->FilterAndBuffer(decode_function, num_samples);
+
+  if (!external_samples.has_value()) {
+    LOG(ERROR) << "Could not decode samples.";
+    return std::nullopt;
+  }
+  return external_samples;
+}
+
+template <typename T>
+std::optional<std::vector<T>> LyraDecoder::DecodeSamplesInternal(
     int internal_num_samples_to_generate) {
-  std::vector<int16_t> result;
+  // Dequantizes all packets this call plays out in one go.
+  if (!DequantizePackets(internal_num_samples_to_generate)) {
+    return std::nullopt;
+  }
+  std::vector<T> result;
   result.reserve(internal_num_samples_to_generate);
   while (result.size() < internal_num_samples_to_generate) {
     // Aligns the number of samples requested with the number of samples per
     // packet.
-    // |GetFadeDurationSamples()| and |GetConcealmentDurationSamples()| are also
+    // |fade_duration_samples_| and |concealment_duration_samples_| are also
     // multiples of the number of samples per packet, so
     // |num_samples_to_generate| will be aligned with fade and concealment
     // progress as well.
@@ -259,24 +431,22 @@ std::optional<std::vector<int16_t>> LyraDecoder::DecodeSamplesInternal(
         /*num_samples_requested=*/internal_num_samples_to_generate,
         /*samples_generated_so_far=*/result.size(),
         /*concealment_progress=*/concealment_progress_,
-        /*model_samples_available=*/
-        generative_model_->num_samples_available(),
+        /*model_samples_available=*/num_model_samples_available(),
         /*cng_samples_available=*/
         comfort_noise_generator_->num_samples_available(),
-        external_sample_rate_hz_);
+        concealment_duration_samples_);
 
     // Check if we are decoding from a received packet;
     const bool is_packet_received =
-        generative_model_->num_samples_available() > 0 &&
-        concealment_progress_ == 0;
+        num_model_samples_available() > 0 && concealment_progress_ == 0;
 
     if (is_packet_received) {
       // Decoding from a received packet triggers comfort noise, if there is
       // any, to fade out.
       fade_direction_ = kFadeFromCNG;
-    } else if (concealment_progress_ == GetConcealmentDurationSamples(external_sample_rate_hz_)) {
+    } else if (concealment_progress_ == concealment_duration_samples_) {
       // Comfort noise begins fading in again once we have lost
-      // |GetConcealmentDurationSamples()| samples in a row.
+      // |concealment_duration_samples_| samples in a row.
       fade_direction_ = kFadeToCNG;
     } else {
       // We are not decoding from a received packet and have not yet started
@@ -289,10 +459,10 @@ std::optional<std::vector<int16_t>> LyraDecoder::DecodeSamplesInternal(
     int next_fade_progress =
         fade_progress_ + fade_direction_ * num_samples_to_generate;
     if (fade_direction_ == kFadeToCNG &&
-        fade_progress_ == GetFadeDurationSamples(external_sample_rate_hz_)) {
-      // |fade_progress_| maxes out at |GetFadeDurationSamples()|. Once here
+        fade_progress_ == fade_duration_samples_) {
+      // |fade_progress_| maxes out at |fade_duration_samples_|. Once here
       // we only generate comfort noise until |fade_direction_| is reversed.
-      next_fade_progress = GetFadeDurationSamples(external_sample_rate_hz_);
+      next_fade_progress = fade_duration_samples_;
       generative_samples_to_generate = 0;
     } else if (fade_direction_ == kFadeFromCNG && fade_progress_ == 0) {
       // |fade_progress_| has a minimum at 0. Once here we only produce
@@ -301,12 +471,13 @@ std::optional<std::vector<int16_t>> LyraDecoder::DecodeSamplesInternal(
       cng_samples_to_generate = 0;
     }
 
-    auto audio = RunGenerativeModel(generative_samples_to_generate);
+    auto audio = RunGenerativeModel<T>(generative_samples_to_generate);
     if (!audio.has_value()) {
       LOG(ERROR) << "Model could not be run on features.";
       return std::nullopt;
     }
-    auto comfort_noise = RunComfortNoiseGenerator(cng_samples_to_generate);
+    auto comfort_noise =
+        RunComfortNoiseGenerator<T>(cng_samples_to_generate);
     if (!comfort_noise.has_value()) {
       LOG(ERROR) << "Could not generate comfort noise.";
       return std::nullopt;
@@ -324,7 +495,7 @@ std::optional<std::vector<int16_t>> LyraDecoder::DecodeSamplesInternal(
     // Only update |noise_estimator_| if we are dealing with received packets.
     // Do not update with concealment.
     if (is_packet_received) {
-      if (!noise_estimator_->ReceiveSamples(audio.value())) {
+      if (!UpdateNoiseEstimate(audio.value())) {
         LOG(ERROR) << "Could not update noise estimator on decoder output.";
         return std::nullopt;
       }
@@ -334,18 +505,25 @@ std::optional<std::vector<int16_t>> LyraDecoder::DecodeSamplesInternal(
   return result;
 }
 
-std::optional<std::vector<int16_t>> LyraDecoder::RunGenerativeModel(
+template <typename T>
+std::optional<std::vector<T>> LyraDecoder::RunGenerativeModel(
     int num_samples) {
   if (num_samples > 0 && generative_model_->num_samples_available() == 0) {
-    if (!generative_model_->AddFeatures(feature_estimator_->Estimate())) {
+    if (num_quantized_packets_ > 0) {
+      if (!DequantizePackets(num_samples)) {
+        return std::nullopt;
+      }
+    } else if (!generative_model_->AddFeatures(
+                   feature_estimator_->Estimate())) {
       LOG(ERROR) << "Could not add estimated features to generative model.";
       return std::nullopt;
     }
   }
-  return generative_model_->GenerateSamples(num_samples);
+  return GenerateSamples<T>(*generative_model_, num_samples);
 }
 
-std::optional<std::vector<int16_t>> LyraDecoder::RunComfortNoiseGenerator(
+template <typename T>
+std::optional<std::vector<T>> LyraDecoder::RunComfortNoiseGenerator(
     int num_samples) {
   if (num_samples > 0 &&
       comfort_noise_generator_->num_samples_available() == 0) {
@@ -356,14 +534,24 @@ std::optional<std::vector<int16_t>> LyraDecoder::RunComfortNoiseGenerator(
       return std::nullopt;
     }
   }
-  return comfort_noise_generator_->GenerateSamples(num_samples);
+  return GenerateSamples<T>(*comfort_noise_generator_, num_samples);
 }
 
+bool LyraDecoder::UpdateNoiseEstimate(const std::vector<int16_t>& audio) {
+  return noise_estimator_->ReceiveSamples(audio);
+}
+
+bool LyraDecoder::UpdateNoiseEstimate(const std::vector<float>& audio) {
+  // The noise estimator only takes int16 samples.
+  return noise_estimator_->ReceiveSamples(
+      UnitToInt16(absl::MakeConstSpan(audio)));
+}
+
+template <typename T>
 bool LyraDecoder::MaybeOverlapAndInsert(
     FadeDirection fade_direction, int fade_progress,
-    const std::vector<int16_t>& generative_model_hop,
-    const std::vector<int16_t>& comfort_noise_hop,
-    std::vector<int16_t>& result) {
+    const std::vector<T>& generative_model_hop,
+    const std::vector<T>& comfort_noise_hop, std::vector<T>& result) {
   if (comfort_noise_hop.empty()) {
     result.insert(result.end(), generative_model_hop.begin(),
                   generative_model_hop.end());
@@ -382,13 +570,30 @@ bool LyraDecoder::MaybeOverlapAndInsert(
     return false;
   }
 
-  for (int i = 0; i < generative_model_hop.size(); ++i) {
-    const float overlap_weight =
-        (1.f + std::cos(fade_progress * M_PI / GetFadeDurationSamples(external_sample_rate_hz_))) / 2.f;
-    result.push_back(generative_model_hop.at(i) * overlap_weight +
-                     comfort_noise_hop.at(i) * (1.f - overlap_weight));
-    fade_progress += fade_direction;
+  // |fade_window_| holds the generative model weight for fades to comfort
+  // noise. The cos^2 window is symmetric, so fading from comfort noise at
+  // |fade_progress| uses the same weights read forward from
+  // |fade_duration_samples_| - |fade_progress| with the roles swapped.
+  const int num_samples = generative_model_hop.size();
+  const bool is_fade_to_cng = fade_direction == kFadeToCNG;
+  const int window_start = is_fade_to_cng
+                               ? fade_progress
+                               : fade_duration_samples_ - fade_progress;
+  if (window_start < 0 ||
+      window_start + num_samples > static_cast<int>(fade_window_.size())) {
+    LOG(ERROR) << "Fade of " << num_samples << " samples at progress "
+               << fade_progress << " exceeds the fade duration of "
+               << fade_duration_samples_ << " samples.";
+    return false;
   }
+  const std::vector<T>& from =
+      is_fade_to_cng ? generative_model_hop : comfort_noise_hop;
+  const std::vector<T>& to =
+      is_fade_to_cng ? comfort_noise_hop : generative_model_hop;
+  const int num_samples_before = result.size();
+  result.resize(num_samples_before + num_samples);
+  Crossfade(from.data(), to.data(), fade_window_.data() + window_start,
+            num_samples, result.data() + num_samples_before);
   return true;
 }
 
@@ -396,10 +601,10 @@ int LyraDecoder::sample_rate_hz() const { return external_sample_rate_hz_; }
 
 int LyraDecoder::num_channels() const { return num_channels_; }
 
-int LyraDecoder::frame_rate() const { return kFrameRate; }
+int LyraDecoder::frame_rate() const { return profile_.frame_rate(); }
 
 bool LyraDecoder::is_comfort_noise() const {
-  return fade_progress_ == GetFadeDurationSamples(external_sample_rate_hz_);
+  return fade_progress_ == fade_duration_samples_;
 }
 
 }  // namespace codec
@@ -18,8 +18,10 @@
 #define LYRA_CODEC_LYRA_DECODER_H_
 
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 
 #include "absl/types/span.h"
@@ -27,8 +29,11 @@
 #include "feature_estimator_interface.h"
 #include "generative_model_interface.h"
 #include "include/ghc/filesystem.hpp"
+#include "lyra_config.h"
 #include "lyra_decoder_interface.h"
 #include "noise_estimator_interface.h"
+#include "packet_interface.h"
+#include "tflite_model_wrapper.h"
 #include "vector_quantizer_interface.h"
 
 namespace chromemedia {
@@ -49,18 +54,63 @@ class LyraDecoder : public LyraDecoderInterface {
   /// @param model_path Path to the model weights. The identifier in the
   ///                   lyra_config.binarypb has to coincide with the
   ///                   |kVersionMinor| constant in lyra_config.cc.
+  /// @param num_hops_per_noise_estimate Number of received hops between
+  ///                                    updates of the comfort noise
+  ///                                    estimate. Values above 1 save CPU
+  ///                                    at the cost of a coarser estimate.
+  /// @param deterministic If true, comfort noise is drawn from a fixed seed,
+  ///                      so that decoding the same packets at the same
+  ///                      requests reproduces the same samples bit-exactly.
   /// @return A unique_ptr to a |LyraDecoder| if all desired params are
   ///         supported. Else it returns a nullptr.
   static std::unique_ptr<LyraDecoder> Create(
       int sample_rate_hz, int num_channels,
+      const ghc::filesystem::path& model_path,
+      int num_hops_per_noise_estimate = 1, bool deterministic = false);
+
+  /// Loads the generative model once for many decoders to share.
+  ///
+  /// @param model_path Path to the model weights.
+  /// @return The shared model, or nullptr on failure.
+  static std::shared_ptr<TfLiteModelWrapper> CreateSharedModel(
       const ghc::filesystem::path& model_path);
 
-  /// Parses a packet and prepares to decode samples from the payload.
+  /// Static method to create a LyraDecoder which runs its generative model
+  /// on |shared_model|, keeping only its own model states. Decoders sharing
+  /// a model take turns on one interpreter, so they must all be used from
+  /// the same thread.
+  ///
+  /// @param shared_model Model returned by |CreateSharedModel| for the same
+  ///                     |model_path|.
+  /// The other parameters are the same as above.
+  /// @return A unique_ptr to a |LyraDecoder| if all desired params are
+  ///         supported. Else it returns a nullptr.
+  static std::unique_ptr<LyraDecoder> Create(
+      int sample_rate_hz, int num_channels,
+      const ghc::filesystem::path& model_path,
+      std::shared_ptr<TfLiteModelWrapper> shared_model,
+      int num_hops_per_noise_estimate = 1, bool deterministic = false);
+
+  /// Parses a packet and prepares to decode samples from the payload. A
+  /// redundant copy of the previous frame in the packet is ignored here. The
+  /// payload is only dequantized once its samples are decoded, so this is
+  /// cheap enough to be called from a network thread.
   ///
   /// @param encoded Encoded packet as a span of bytes.
   /// @return True if the provided packet is a valid Lyra packet.
   bool SetEncodedPacket(absl::Span<const uint8_t> encoded) override;
 
+  /// Prepares to decode a lost frame from the low-rate copy carried by the
+  /// packet of the frame after it, instead of concealing it. This needs the
+  /// next packet to arrive before the lost frame is played out, e.g. with a
+  /// jitter buffer of one frame. The next packet itself is set with
+  /// |SetEncodedPacket| afterwards as usual.
+  ///
+  /// @param next_encoded Encoded packet of the frame after the lost one.
+  /// @return True if |next_encoded| carries a valid copy of the lost frame.
+  ///         False otherwise, in which case the frame is concealed.
+  bool SetRedundantPacket(absl::Span<const uint8_t> next_encoded) override;
+
   /// Decodes samples.
   ///
   /// If more samples are requested for decoding than are available from the
@@ -73,6 +123,31 @@ class LyraDecoder : public LyraDecoderInterface {
   /// @return Vector of int16-formatted samples, or nullopt on failure.
   std::optional<std::vector<int16_t>> DecodeSamples(int num_samples) override;
 
+  /// Decodes samples into a buffer owned by the caller.
+  ///
+  /// Same as |DecodeSamples|. The samples are still decoded into an
+  /// intermediate vector, and the model, comfort noise generator and
+  /// resampler allocate their outputs as well. So this allocates as much as
+  /// |DecodeSamples| and only spares the caller managing the vector.
+  ///
+  /// @param samples Buffer to decode |samples.size()| samples into.
+  ///
+  /// @return True on success.
+  bool DecodeSamplesInto(absl::Span<int16_t> samples) override;
+
+  /// Decodes samples as floats.
+  ///
+  /// Same as |DecodeSamples|, but the model output, the comfort noise
+  /// crossfade and the resampler all stay in float, so the samples are never
+  /// rounded or clipped to int16. Intended for mixing pipelines.
+  ///
+  /// @param num_samples Number of samples to decode.
+  ///
+  /// @return Vector of float samples in [-1, 1] (possibly exceeding it), or
+  ///         nullopt on failure.
+  std::optional<std::vector<float>> DecodeFloatSamples(
+      int num_samples) override;
+
   /// Getter for the sample rate in Hertz.
   ///
   /// @return Sample rate in Hertz.
@@ -83,9 +158,10 @@ class LyraDecoder : public LyraDecoderInterface {
   /// @return Number of channels.
   int num_channels() const override;
 
-  /// Getter for the frame rate.
+  /// Getter for the frame rate. Hops are the same length at every sample
+  /// rate, so this is 50 at 16kHz and scales with the sample rate.
   ///
-  /// @return Frame rate.
+  /// @return Frame rate in packets per second.
   int frame_rate() const override;
 
   /// Checks if the decoder is in comfort noise generation mode.
@@ -109,22 +185,53 @@ class LyraDecoder : public LyraDecoderInterface {
               std::unique_ptr<BufferedFilterInterface> resampler,
               int external_sample_rate_hz, int num_channels);
 
+  // Creates the remaining components around |model|, after the params have
+  // been checked.
+  static std::unique_ptr<LyraDecoder> CreateWithGenerativeModel(
+      int sample_rate_hz, int num_channels,
+      const ghc::filesystem::path& model_path,
+      std::unique_ptr<GenerativeModelInterface> model,
+      int num_hops_per_noise_estimate, bool deterministic);
+
+  // Unpacks |encoded|, which holds |num_quantized_bits|, and queues its
+  // quantized features for decoding.
+  bool AddPacketFeatures(absl::Span<const uint8_t> encoded,
+                         int num_quantized_bits);
+
+  // Dequantizes queued packets in arrival order and adds their features to
+  // the generative model until it holds at least |num_samples| samples, or
+  // no packets are left.
+  bool DequantizePackets(int num_samples);
+
+  // Returns the number of samples the generative model can generate from its
+  // features and the queued packets.
+  int num_model_samples_available() const;
+
   // Runs the while loop for generating samples at the internal sample rate.
-  std::optional<std::vector<int16_t>> DecodeSamplesInternal(
+  // |T| is either int16_t or float.
+  template <typename T>
+  std::optional<std::vector<T>> DecodeSamplesInternal(
       int internal_num_samples_to_generate);
 
-  // Overlaps hops using a cos^2 window.
+  // Overlaps hops using the cos^2 window in |fade_window_|.
   // Returns true on success, false on failure.
+  template <typename T>
   bool MaybeOverlapAndInsert(FadeDirection fade_direction, int fade_progress,
-                             const std::vector<int16_t>& generative_model_hop,
-                             const std::vector<int16_t>& comfort_noise_hop,
-                             std::vector<int16_t>& result);
+                             const std::vector<T>& generative_model_hop,
+                             const std::vector<T>& comfort_noise_hop,
+                             std::vector<T>& result);
 
   // Runs the generative model and adds estimated features if needed.
-  std::optional<std::vector<int16_t>> RunGenerativeModel(int num_samples);
+  template <typename T>
+  std::optional<std::vector<T>> RunGenerativeModel(int num_samples);
 
   // Runs the comfort noise generator and adds estimated features if needed.
-  std::optional<std::vector<int16_t>> RunComfortNoiseGenerator(int num_samples);
+  template <typename T>
+  std::optional<std::vector<T>> RunComfortNoiseGenerator(int num_samples);
+
+  // Updates |noise_estimator_| with decoded audio.
+  bool UpdateNoiseEstimate(const std::vector<int16_t>& audio);
+  bool UpdateNoiseEstimate(const std::vector<float>& audio);
 
   // Generates time domain samples from conditioning features.
   std::unique_ptr<GenerativeModelInterface> generative_model_;
@@ -141,6 +248,14 @@ class LyraDecoder : public LyraDecoderInterface {
   // Resamples from the generative model sample rate to the external sampling
   // rate.
   std::unique_ptr<BufferedFilterInterface> resampler_;
+  // Unpackers by number of quantized bits, created on first use.
+  std::map<int, std::unique_ptr<PacketInterface>> packets_;
+  // Ring of the quantized features of received packets which have not been
+  // dequantized yet. The slots keep their capacity, so queueing a packet
+  // only allocates when more packets are queued than ever before.
+  std::vector<std::string> quantized_packets_;
+  int first_quantized_packet_;
+  int num_quantized_packets_;
 
   // The packet loss state is described by the following three variables:
 
@@ -149,15 +264,25 @@ class LyraDecoder : public LyraDecoderInterface {
   // concealment samples until we will begin playing out a received packet.
   // Otherwise tracks samples since we last played out a received packet.
   int concealment_progress_;
-  // Ranges from [0, fade_duration_samples_]. 0 indicates we are only generating
-  // model output. |fade_duration_samples| indicates we are only generating
-  // comfort noise. Values in between indicate a fade is in progress.
+  // Ranges from [0, |fade_duration_samples_|]. 0 indicates we are only
+  // generating model output. |fade_duration_samples_| indicates we are only
+  // generating comfort noise. Values in between indicate a fade is in
+  // progress.
   int fade_progress_;
   // Indicates if we are incrementing or decrementing |fade_progress|.
   FadeDirection fade_direction_;
 
   const int external_sample_rate_hz_;
   const int num_channels_;
+  // Rate-dependent constants for |external_sample_rate_hz_|.
+  const CodecProfile profile_;
+  // Packet loss timing at |external_sample_rate_hz_|, computed once so that
+  // decoders of different sample rates can coexist in one process.
+  const int concealment_duration_samples_;
+  const int fade_duration_samples_;
+  // Weight of the generative model output at each fade progress while fading
+  // to comfort noise.
+  const std::vector<float> fade_window_;
 
   friend class LyraDecoderPeer;
 };
@@ -37,11 +37,26 @@ class LyraDecoderInterface {
   // Returns true on success.
   virtual bool SetEncodedPacket(absl::Span<const uint8_t> encoded) = 0;
 
+  // Prepares the decoder to decode the frame before |next_encoded|, which was
+  // lost, from the redundant copy carried by |next_encoded|.
+  // Returns false if |next_encoded| is invalid or carries no copy.
+  // Returns true on success.
+  virtual bool SetRedundantPacket(absl::Span<const uint8_t> next_encoded) = 0;
+
   // Decodes |num_samples|.
   // Returns nullopt on failure.
   virtual std::optional<std::vector<int16_t>> DecodeSamples(
       int num_samples) = 0;
 
+  // Decodes |samples.size()| samples into |samples|.
+  // Returns false on failure.
+  virtual bool DecodeSamplesInto(absl::Span<int16_t> samples) = 0;
+
+  // Decodes |num_samples| as floats in [-1, 1], without clipping.
+  // Returns nullopt on failure.
+  virtual std::optional<std::vector<float>> DecodeFloatSamples(
+      int num_samples) = 0;
+
   virtual int sample_rate_hz() const = 0;
 
   virtual int num_channels() const = 0;
@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <numeric>
 #include <optional>
@@ -38,6 +39,7 @@
 #include "lyra_components.h"
 #include "lyra_config.h"
 #include "packet_interface.h"
+#include "redundant_packet.h"
 #include "resampler.h"
 #include "testing/mock_generative_model.h"
 #include "testing/mock_noise_estimator.h"
@@ -70,10 +72,24 @@ class LyraDecoderPeer {
     return decoder_.SetEncodedPacket(encoded);
   }
 
+  bool SetRedundantPacket(const absl::Span<const uint8_t> next_encoded) {
+    return decoder_.SetRedundantPacket(next_encoded);
+  }
+
   std::optional<std::vector<int16_t>> DecodeSamples(int num_samples) {
     return decoder_.DecodeSamples(num_samples);
   }
 
+  bool DecodeSamplesInto(absl::Span<int16_t> samples) {
+    return decoder_.DecodeSamplesInto(samples);
+  }
+
+  std::optional<std::vector<float>> DecodeFloatSamples(int num_samples) {
+    return decoder_.DecodeFloatSamples(num_samples);
+  }
+
+  int frame_rate() const { return decoder_.frame_rate(); }
+
   void SetConcealmentProgress(int samples) {
     decoder_.concealment_progress_ = samples;
   }
@@ -98,25 +114,19 @@ using testing::Return;
 static constexpr absl::string_view kExportedModelPath = "model_coeffs";
 
 // Duration of pure packet loss concealment.
-inline int GetConcealmentDurationSamples() {
-  static constexpr float kConcealmentDurationSeconds = 0.08;
-  static constexpr int kConcealmentDurationSamples =
-      kConcealmentDurationSeconds * kInternalSampleRateHz;
-  CHECK_EQ(
-      kConcealmentDurationSamples % GetNumSamplesPerHop(kInternalSampleRateHz),
-      0);
-  return kConcealmentDurationSamples;
+inline int GetConcealmentDurationSamples(int sample_rate_hz) {
+  const int concealment_duration_samples = 80 * sample_rate_hz / 1000;
+  CHECK_EQ(concealment_duration_samples % GetNumSamplesPerHop(sample_rate_hz),
+           0);
+  return concealment_duration_samples;
 }
 
 // Duration it takes to fade from concealment to comfort noise, and from
 // comfort noise to received packets.
-inline int GetFadeDurationSamples() {
-  static constexpr float kFadeDurationSeconds = 0.04;
-  static constexpr int kFadeDurationSamples =
-      kFadeDurationSeconds * kInternalSampleRateHz;
-  CHECK_EQ(kFadeDurationSamples % GetNumSamplesPerHop(kInternalSampleRateHz),
-           0);
-  return kFadeDurationSamples;
+inline int GetFadeDurationSamples(int sample_rate_hz) {
+  const int fade_duration_samples = 40 * sample_rate_hz / 1000;
+  CHECK_EQ(fade_duration_samples % GetNumSamplesPerHop(sample_rate_hz), 0);
+  return fade_duration_samples;
 }
 
 class LyraDecoderTest
@@ -131,13 +141,18 @@ class LyraDecoderTest
   LyraDecoderTest()
       : external_sample_rate_hz_(std::get<0>(GetParam())),
         num_quantized_bits_(std::get<1>(GetParam())),
+        internal_sample_rate_hz_(external_sample_rate_hz_),
         external_num_samples_per_hop_(
             GetNumSamplesPerHop(external_sample_rate_hz_)),
         internal_num_samples_per_hop_(
-            GetNumSamplesPerHop(kInternalSampleRateHz)),
-        concealment_duration_packets_(GetConcealmentDurationSamples() /
+            GetNumSamplesPerHop(internal_sample_rate_hz_)),
+        concealment_duration_samples_(
+            GetConcealmentDurationSamples(external_sample_rate_hz_)),
+        fade_duration_samples_(
+            GetFadeDurationSamples(external_sample_rate_hz_)),
+        concealment_duration_packets_(concealment_duration_samples_ /
                                       internal_num_samples_per_hop_),
-        fade_duration_packets_(GetFadeDurationSamples() /
+        fade_duration_packets_(fade_duration_samples_ /
                                internal_num_samples_per_hop_),
         quantized_zeros_(num_quantized_bits_, '0'),
         packet_(CreatePacket(kNumHeaderBits, num_quantized_bits_)),
@@ -167,10 +182,10 @@ class LyraDecoderTest
     mock_vector_quantizer_ = std::make_unique<MockVectorQuantizer>();
     mock_noise_estimator_ = std::make_unique<MockNoiseEstimator>();
     feature_estimator_ = CreateFeatureEstimator(kNumFeatures);
-    buffered_resampler_ = BufferedResampler::Create(kInternalSampleRateHz,
+    buffered_resampler_ = BufferedResampler::Create(internal_sample_rate_hz_,
                                                     external_sample_rate_hz_);
     real_resampler_ =
-        Resampler::Create(kInternalSampleRateHz, external_sample_rate_hz_);
+        Resampler::Create(internal_sample_rate_hz_, external_sample_rate_hz_);
   }
 
   void CreateDecoder() {
@@ -231,14 +246,30 @@ class LyraDecoderTest
   // decreases.
 
   void ExpectSetEncodedPacket(int num_calls) {
+    ExpectSetEncodedPacket(Exactly(num_calls));
+  }
+
+  // Packets are only dequantized once they are played out.
+  void ExpectSetEncodedPacket(const testing::Cardinality& num_calls) {
     EXPECT_CALL(*mock_vector_quantizer_,
                 DecodeToLossyFeatures(quantized_zeros_))
-        .Times(Exactly(num_calls))
+        .Times(num_calls)
         .WillRepeatedly(Return(mock_features_));
     EXPECT_CALL(*mock_generative_model_, AddFeatures(mock_features_))
         .Times(num_calls);
   }
 
+  // The ArbitraryNumSamples tests decode 0, 1, ..., N - 1 samples with N the
+  // number of samples per hop, setting one packet before each call. Returns
+  // the number of packets needed to cover the N * (N - 1) / 2 samples.
+  int NumPacketsPlayedOutByArbitraryNumSamples() const {
+    const int num_samples_played_out =
+        external_num_samples_per_hop_ * (external_num_samples_per_hop_ - 1) /
+        2;
+    return (num_samples_played_out + internal_num_samples_per_hop_ - 1) /
+           internal_num_samples_per_hop_;
+  }
+
   void ExpectNormalDecoding(
       const std::vector<int16_t>& expected_merged_samples) {
     EXPECT_CALL(*mock_generative_model_,
@@ -352,8 +383,13 @@ class LyraDecoderTest
 
   const int external_sample_rate_hz_;
   const int num_quantized_bits_;
+  // LyraDecoder::Create runs the models at the external sample rate, which
+  // is also the rate its concealment and fade durations are counted in.
+  const int internal_sample_rate_hz_;
   const int external_num_samples_per_hop_;
   const int internal_num_samples_per_hop_;
+  const int concealment_duration_samples_;
+  const int fade_duration_samples_;
   const int concealment_duration_packets_;
   const int fade_duration_packets_;
   const std::string quantized_zeros_;
@@ -500,7 +536,7 @@ TEST_P(LyraDecoderTest, TestFinishDecoding_ComfortNoiseFadetoNormal) {
                  external_sample_requests.begin(),
                  [this](std::vector<int16_t> internal_samples) {
                    return ConvertNumSamplesBetweenSampleRate(
-                       internal_samples.size(), kInternalSampleRateHz,
+                       internal_samples.size(), internal_sample_rate_hz_,
                        external_sample_rate_hz_);
                  });
 
@@ -526,8 +562,8 @@ TEST_P(LyraDecoderTest, TestFinishDecoding_ComfortNoiseFadetoNormal) {
   }
 
   CreateDecoder();
-  lyra_decoder_peer_->SetConcealmentProgress(GetConcealmentDurationSamples());
-  lyra_decoder_peer_->SetFadeProgress(GetFadeDurationSamples());
+  lyra_decoder_peer_->SetConcealmentProgress(concealment_duration_samples_);
+  lyra_decoder_peer_->SetFadeProgress(fade_duration_samples_);
   lyra_decoder_peer_->SetFadeToCNG();
 
   request_index = 0;
@@ -560,7 +596,7 @@ TEST_P(LyraDecoderTest, MultipleHopsOneRequestNormalDecode) {
       ModelTypeSamples::kGenerative);
 
   const int sample_request = ConvertNumSamplesBetweenSampleRate(
-      expected_merged_samples.size(), kInternalSampleRateHz,
+      expected_merged_samples.size(), internal_sample_rate_hz_,
       external_sample_rate_hz_);
 
   ExpectSetEncodedPacket(/*num_calls=*/kNumHopsToDecode);
@@ -613,11 +649,11 @@ TEST_P(LyraDecoderTest, HopsAreOverlappedCorrectly) {
       real_resampler_->samples_until_steady_state();
 
   const std::vector<int16_t> expected_concealment_samples =
-      kInternalSampleRateHz == external_sample_rate_hz_
+      internal_sample_rate_hz_ == external_sample_rate_hz_
           ? generative_model_mock_samples_
           : real_resampler_->Resample(generative_model_mock_samples_);
   const std::vector<int16_t> expected_comfort_noise_samples =
-      kInternalSampleRateHz == external_sample_rate_hz_
+      internal_sample_rate_hz_ == external_sample_rate_hz_
           ? comfort_noise_generator_mock_samples_
           : real_resampler_->Resample(comfort_noise_generator_mock_samples_);
 
@@ -633,7 +669,7 @@ TEST_P(LyraDecoderTest, HopsAreOverlappedCorrectly) {
   // State 3: Fade to comfort noise should fade from generative model samples
   // to comfort noise samples.
   lyra_decoder_peer_->SetFadeProgress(0);
-  lyra_decoder_peer_->SetConcealmentProgress(GetConcealmentDurationSamples());
+  lyra_decoder_peer_->SetConcealmentProgress(concealment_duration_samples_);
   lyra_decoder_peer_->SetFadeToCNG();
   samples = lyra_decoder_peer_->DecodeSamples(external_num_samples_per_hop_);
   ASSERT_TRUE(samples.has_value());
@@ -652,8 +688,8 @@ TEST_P(LyraDecoderTest, HopsAreOverlappedCorrectly) {
     }
   }
   // State 4: Comfort noise should be all comfort noise samples.
-  lyra_decoder_peer_->SetFadeProgress(GetFadeDurationSamples());
-  lyra_decoder_peer_->SetConcealmentProgress(GetConcealmentDurationSamples());
+  lyra_decoder_peer_->SetFadeProgress(fade_duration_samples_);
+  lyra_decoder_peer_->SetConcealmentProgress(concealment_duration_samples_);
   lyra_decoder_peer_->SetFadeToCNG();
   samples = lyra_decoder_peer_->DecodeSamples(external_num_samples_per_hop_);
   ASSERT_TRUE(samples.has_value());
@@ -664,7 +700,7 @@ TEST_P(LyraDecoderTest, HopsAreOverlappedCorrectly) {
                                  expected_comfort_noise_samples.end()));
   // State 5: Fade to normal decoding noise should fade from comfort noise to
   // generative model samples.
-  lyra_decoder_peer_->SetFadeProgress(GetFadeDurationSamples());
+  lyra_decoder_peer_->SetFadeProgress(fade_duration_samples_);
   lyra_decoder_peer_->SetConcealmentProgress(0);
   lyra_decoder_peer_->SetFadeFromCNG();
   samples = lyra_decoder_peer_->DecodeSamples(external_num_samples_per_hop_);
@@ -685,8 +721,121 @@ TEST_P(LyraDecoderTest, HopsAreOverlappedCorrectly) {
   }
 }
 
+TEST_P(LyraDecoderTest, FloatSamplesAreNotClipped) {
+  const float kLoudSample = 1.5f;
+  ExpectSetEncodedPacket(/*num_calls=*/1);
+  EXPECT_CALL(*mock_generative_model_, GenerateFloatSamples(::testing::_))
+      .WillRepeatedly([kLoudSample](int num_samples) {
+        return std::vector<float>(num_samples, kLoudSample);
+      });
+  EXPECT_CALL(*mock_generative_model_, GenerateSamples(::testing::_))
+      .Times(Exactly(0));
+  // Only the noise estimator sees clipped samples.
+  EXPECT_CALL(*mock_noise_estimator_,
+              ReceiveSamples(::testing::Each(
+                  std::numeric_limits<int16_t>::max())))
+      .WillRepeatedly(Return(true));
+  const int kSamplesUntilSteadyState =
+      real_resampler_->samples_until_steady_state();
+
+  CreateDecoder();
+  ASSERT_TRUE(lyra_decoder_peer_->SetEncodedPacket(encoded_zeros_));
+  auto samples =
+      lyra_decoder_peer_->DecodeFloatSamples(external_num_samples_per_hop_);
+  ASSERT_TRUE(samples.has_value());
+  ASSERT_EQ(samples->size(), external_num_samples_per_hop_);
+  for (int i = kSamplesUntilSteadyState; i < samples->size(); ++i) {
+    EXPECT_NEAR(samples->at(i), kLoudSample, 1e-2) << "at index " << i;
+  }
+}
+
+// State 1: Normal decoding -> lost packet recovered from the redundant copy
+// in the next packet -> State 1: Normal decoding, without concealment.
+TEST_P(LyraDecoderTest, RedundantCopyReplacesConcealment) {
+  const std::vector<int16_t> expected_merged_samples(
+      internal_num_samples_per_hop_, ModelTypeSamples::kGenerative);
+  const int kNumRedundantBits = RedundancyLevelToNumQuantizedBits(1);
+  const std::string redundant_zeros(kNumRedundantBits, '0');
+  const auto next_packet = AppendRedundancy(
+      encoded_zeros_, CreatePacket(kNumHeaderBits, kNumRedundantBits)
+                          ->PackQuantized(redundant_zeros));
+  ASSERT_TRUE(next_packet.has_value());
+
+  {  // Enforce mocks are called in a specific order.
+    ::testing::InSequence in;
+    ExpectSetEncodedPacket(1);
+    ExpectNormalDecoding(expected_merged_samples);
+
+    EXPECT_CALL(*mock_vector_quantizer_,
+                DecodeToLossyFeatures(redundant_zeros))
+        .WillOnce(Return(mock_features_));
+    EXPECT_CALL(*mock_generative_model_, AddFeatures(mock_features_));
+    ExpectNormalDecoding(expected_merged_samples);
+
+    ExpectSetEncodedPacket(1);
+    ExpectNormalDecoding(expected_merged_samples);
+  }
+
+  CreateDecoder();
+
+  ASSERT_TRUE(lyra_decoder_peer_->SetEncodedPacket(encoded_zeros_));
+  ASSERT_TRUE(lyra_decoder_peer_->DecodeSamples(external_num_samples_per_hop_));
+  // The packet of the second frame is lost, but the third one has arrived.
+  ASSERT_TRUE(lyra_decoder_peer_->SetRedundantPacket(next_packet.value()));
+  ASSERT_TRUE(lyra_decoder_peer_->DecodeSamples(external_num_samples_per_hop_));
+  ASSERT_TRUE(lyra_decoder_peer_->SetEncodedPacket(next_packet.value()));
+  ASSERT_TRUE(lyra_decoder_peer_->DecodeSamples(external_num_samples_per_hop_));
+}
+
+TEST_P(LyraDecoderTest, PlainPacketHasNoRedundantCopy) {
+  EXPECT_CALL(*mock_vector_quantizer_, DecodeToLossyFeatures(::testing::_))
+      .Times(Exactly(0));
+  CreateDecoder();
+
+  EXPECT_FALSE(lyra_decoder_peer_->SetRedundantPacket(encoded_zeros_));
+  EXPECT_FALSE(lyra_decoder_peer_->SetRedundantPacket({}));
+}
+
+TEST_P(LyraDecoderTest, PacketsAreDequantizedWhenPlayedOut) {
+  // Only the first of the three packets is played out.
+  ExpectSetEncodedPacket(1);
+  EXPECT_CALL(*mock_noise_estimator_, ReceiveSamples(::testing::_))
+      .WillRepeatedly(Return(true));
+  CreateDecoder();
+
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(lyra_decoder_peer_->SetEncodedPacket(encoded_zeros_));
+  }
+  auto samples =
+      lyra_decoder_peer_->DecodeSamples(external_num_samples_per_hop_);
+  ASSERT_TRUE(samples.has_value());
+  EXPECT_EQ(samples->size(), external_num_samples_per_hop_);
+}
+
+TEST_P(LyraDecoderTest, QueuedPacketsOutgrowPreallocatedSlots) {
+  ExpectSetEncodedPacket(10);
+  EXPECT_CALL(*mock_noise_estimator_, ReceiveSamples(::testing::_))
+      .WillRepeatedly(Return(true));
+  CreateDecoder();
+
+  // Wraps around the ring before it has to grow.
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(lyra_decoder_peer_->SetEncodedPacket(encoded_zeros_));
+  }
+  ASSERT_TRUE(
+      lyra_decoder_peer_->DecodeSamples(2 * external_num_samples_per_hop_)
+          .has_value());
+  for (int i = 0; i < 7; ++i) {
+    ASSERT_TRUE(lyra_decoder_peer_->SetEncodedPacket(encoded_zeros_));
+  }
+  std::vector<int16_t> samples(8 * external_num_samples_per_hop_);
+  EXPECT_TRUE(lyra_decoder_peer_->DecodeSamplesInto(absl::MakeSpan(samples)));
+}
+
 TEST_P(LyraDecoderTest, ArbitraryNumSamplesNormalDecode) {
-  ExpectSetEncodedPacket(external_num_samples_per_hop_);
+  // More packets are set than played out, so only the ones covering the
+  // samples decoded are dequantized.
+  ExpectSetEncodedPacket(NumPacketsPlayedOutByArbitraryNumSamples());
   EXPECT_CALL(*mock_noise_estimator_, ReceiveSamples(::testing::_))
       .WillRepeatedly(Return(true));
   CreateDecoder();
@@ -728,8 +877,8 @@ TEST_P(LyraDecoderTest, ArbitraryNumSamplesComfortNoise) {
 
   for (int num_samples = 0; num_samples < external_num_samples_per_hop_;
        ++num_samples) {
-    lyra_decoder_peer_->SetConcealmentProgress(GetConcealmentDurationSamples());
-    lyra_decoder_peer_->SetFadeProgress(GetFadeDurationSamples());
+    lyra_decoder_peer_->SetConcealmentProgress(concealment_duration_samples_);
+    lyra_decoder_peer_->SetFadeProgress(fade_duration_samples_);
     lyra_decoder_peer_->SetFadeToCNG();
     auto samples = lyra_decoder_peer_->DecodeSamples(num_samples);
     ASSERT_TRUE(samples.has_value());
@@ -746,7 +895,7 @@ TEST_P(LyraDecoderTest, ArbitraryNumSamplesFadeToComfortNoise) {
 
   for (int num_samples = 0; num_samples < external_num_samples_per_hop_;
        ++num_samples) {
-    lyra_decoder_peer_->SetConcealmentProgress(GetConcealmentDurationSamples());
+    lyra_decoder_peer_->SetConcealmentProgress(concealment_duration_samples_);
     lyra_decoder_peer_->SetFadeProgress(0);
     lyra_decoder_peer_->SetFadeToCNG();
     auto samples = lyra_decoder_peer_->DecodeSamples(num_samples);
@@ -758,7 +907,9 @@ TEST_P(LyraDecoderTest, ArbitraryNumSamplesFadeToComfortNoise) {
 }
 
 TEST_P(LyraDecoderTest, ArbitraryNumSamplesFadeFromComfortNoise) {
-  ExpectSetEncodedPacket(external_num_samples_per_hop_);
+  // More packets are set than played out, so only the ones covering the
+  // samples decoded are dequantized.
+  ExpectSetEncodedPacket(NumPacketsPlayedOutByArbitraryNumSamples());
   EXPECT_CALL(*mock_noise_estimator_, ReceiveSamples(::testing::_))
       .WillRepeatedly(Return(true));
   EXPECT_CALL(*mock_noise_estimator_, noise_estimate())
@@ -767,8 +918,8 @@ TEST_P(LyraDecoderTest, ArbitraryNumSamplesFadeFromComfortNoise) {
 
   for (int num_samples = 0; num_samples < external_num_samples_per_hop_;
        ++num_samples) {
-    lyra_decoder_peer_->SetConcealmentProgress(GetConcealmentDurationSamples());
-    lyra_decoder_peer_->SetFadeProgress(GetFadeDurationSamples());
+    lyra_decoder_peer_->SetConcealmentProgress(concealment_duration_samples_);
+    lyra_decoder_peer_->SetFadeProgress(fade_duration_samples_);
     lyra_decoder_peer_->SetFadeFromCNG();
     ASSERT_TRUE(lyra_decoder_peer_->SetEncodedPacket(encoded_zeros_));
 
@@ -780,12 +931,32 @@ TEST_P(LyraDecoderTest, ArbitraryNumSamplesFadeFromComfortNoise) {
   }
 }
 
+TEST_P(LyraDecoderTest, FrameRateScalesWithSampleRate) {
+  CreateDecoder();
+  // 50 packets per second at 16kHz, e.g. 25 at 8kHz and 150 at 48kHz.
+  EXPECT_EQ(lyra_decoder_peer_->frame_rate(),
+            external_sample_rate_hz_ * 50 / 16000);
+}
+
 TEST_P(LyraDecoderTest, ValidConfig) {
   EXPECT_NE(
       LyraDecoder::Create(external_sample_rate_hz_, kNumChannels, model_path_),
       nullptr);
 }
 
+TEST_P(LyraDecoderTest, ValidConfigOnSharedModel) {
+  const auto shared_model = LyraDecoder::CreateSharedModel(model_path_);
+  ASSERT_NE(shared_model, nullptr);
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_NE(LyraDecoder::Create(external_sample_rate_hz_, kNumChannels,
+                                  model_path_, shared_model),
+              nullptr);
+  }
+  EXPECT_EQ(LyraDecoder::Create(external_sample_rate_hz_, kNumChannels,
+                                model_path_, /*shared_model=*/nullptr),
+            nullptr);
+}
+
 TEST_P(LyraDecoderTest, InvalidConfig) {
   for (const auto& invalid_num_channels : {-1, 0, 2}) {
     EXPECT_EQ(LyraDecoder::Create(external_sample_rate_hz_,
@@ -14,16 +14,19 @@
 
 #include "lyra_encoder.h"
 
+#include <algorithm>
 #include <bitset>
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/types/span.h"
+#include "dsp_kernels.h"
 #include "feature_extractor_interface.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "include/ghc/filesystem.hpp"
@@ -33,8 +36,10 @@
 #include "noise_estimator_interface.h"
 #include "packet.h"
 #include "packet_interface.h"
+#include "redundant_packet.h"
 #include "resampler.h"
 #include "resampler_interface.h"
+#include "tflite_model_wrapper.h"
 #include "vector_quantizer_interface.h"
 
 namespace chromemedia {
@@ -49,42 +54,59 @@ std::unique_ptr<LyraEncoder> LyraEncoder::Create(
     LOG(ERROR) << are_params_supported;
     return nullptr;
   }
-  const int num_quantized_bits = BitrateToNumQuantizedBits(bitrate, (sample_rate_hz/320));
+  const CodecProfile& profile = *FindCodecProfile(sample_rate_hz);
+  return CreateWithFeatureExtractor(
+      sample_rate_hz, num_channels, bitrate, enable_dtx, model_path,
+      CreateFeatureExtractor(sample_rate_hz, profile.num_features,
+                             profile.num_samples_per_hop(),
+                             profile.num_samples_per_window(), model_path));
+}
+
+std::shared_ptr<TfLiteModelWrapper> LyraEncoder::CreateSharedModel(
+    const ghc::filesystem::path& model_path) {
+  return CreateSharedFeatureExtractorWrapper(model_path);
+}
+
+std::unique_ptr<LyraEncoder> LyraEncoder::Create(
+    int sample_rate_hz, int num_channels, int bitrate, bool enable_dtx,
+    const ghc::filesystem::path& model_path,
+    std::shared_ptr<TfLiteModelWrapper> shared_model) {
+  absl::Status are_params_supported =
+      AreParamsSupported(sample_rate_hz, num_channels, model_path);
+  if (!are_params_supported.ok()) {
+    LOG(ERROR) << are_params_supported;
+    return nullptr;
+  }
+  if (shared_model == nullptr) {
+    LOG(ERROR) << "Shared model must not be null.";
+    return nullptr;
+  }
+  return CreateWithFeatureExtractor(
+      sample_rate_hz, num_channels, bitrate, enable_dtx, model_path,
+      CreateMultiplexedFeatureExtractor(std::move(shared_model)));
+}
+
+std::unique_ptr<LyraEncoder> LyraEncoder::CreateWithFeatureExtractor(
+    int sample_rate_hz, int num_channels, int bitrate, bool enable_dtx,
+    const ghc::filesystem::path& model_path,
+    std::unique_ptr<FeatureExtractorInterface> feature_extractor) {
+  const CodecProfile& profile = *FindCodecProfile(sample_rate_hz);
+  const int num_quantized_bits =
+      BitrateToNumQuantizedBits(bitrate, profile.frame_rate());
   if (num_quantized_bits < 0) {
     LOG(ERROR) << "Bitrate " << bitrate << " bps is not supported by codec.";
     return nullptr;
   }
 
   std::unique_ptr<Resampler> resampler = nullptr;
-  int numFeatures = 64;
-  if (sample_rate_hz == 8000) {
-    numFeatures = 96;
-  } else if (sample_rate_hz == 16000) {
-    numFeatures = 64;
-  } else if (sample_rate_hz == 24000) {
-    numFeatures = 48; 
-  } else if (sample_rate_hz == 32000) {
-    numFeatures = 32; 
-  } else if (sample_rate_hz == 48000) {
-    numFeatures = 16; 
-  } else {
-    LOG(ERROR) << "Unsupported sampling rate: " << sample_rate_hz;
-  }
-  const int numMelBins = numFeatures * 2.5;
-
-  const int internal_samples_per_hop =
-      GetNumSamplesPerHop(sample_rate_hz, (sample_rate_hz/320));
-  const int internal_samples_per_window =
-      GetNumSamplesPerWindow(sample_rate_hz, (sample_rate_hz/320));
-  auto feature_extractor = CreateFeatureExtractor(
-      sample_rate_hz, numFeatures, internal_samples_per_hop,
-      internal_samples_per_window, model_path);
+  const int internal_samples_per_hop = profile.num_samples_per_hop();
+  const int internal_samples_per_window = profile.num_samples_per_window();
   if (feature_extractor == nullptr) {
     LOG(ERROR) << "Could not create Features Extractor.";
     return nullptr;
   }
 
-  auto vector_quantizer = CreateQuantizer(numFeatures, model_path);
+  auto vector_quantizer = CreateQuantizer(profile.num_features, model_path);
   if (vector_quantizer == nullptr) {
     LOG(ERROR) << "Could not create Vector Quantizer.";
     return nullptr;
@@ -94,7 +116,8 @@ std::unique_ptr<LyraEncoder> LyraEncoder::Create(
   if (enable_dtx) {
     noise_estimator =
         NoiseEstimator::Create(sample_rate_hz, internal_samples_per_hop,
-                               internal_samples_per_window, numMelBins);
+                               internal_samples_per_window,
+                               profile.num_mel_bins());
     if (noise_estimator == nullptr) {
       LOG(ERROR) << "Could not create Noise Estimator.";
       return nullptr;
@@ -122,52 +145,179 @@ LyraEncoder::LyraEncoder(
       sample_rate_hz_(sample_rate_hz),
       num_channels_(num_channels),
       num_quantized_bits_(num_quantized_bits),
-      enable_dtx_(enable_dtx) {}
+      max_vbr_quantized_bits_(num_quantized_bits),
+      last_num_quantized_bits_(0),
+      redundancy_level_(0),
+      enable_dtx_(enable_dtx),
+      profile_(*FindCodecProfile(sample_rate_hz)),
+      noise_estimator_samples_(enable_dtx ? profile_.num_samples_per_hop()
+                                          : 0) {}
 
 std::optional<std::vector<uint8_t>> LyraEncoder::Encode(
     const absl::Span<const int16_t> audio) {
-  absl::Span<const int16_t> audio_for_encoding = audio;
-
-  // Space to store resampled and/or filtered samples.
-
-  const int internal_samples_per_hop =
-      GetNumSamplesPerHop(sample_rate_hz_, (sample_rate_hz_/320));
-  if (audio_for_encoding.size() != internal_samples_per_hop) {
-    LOG(ERROR) << "The number of audio samples has to be exactly "
-               << GetNumSamplesPerHop(sample_rate_hz_, (sample_rate_hz_/320)) << ", but is "
-               << audio.size() << ".";
+  if (!IsOneHop(audio.size())) {
     return std::nullopt;
   }
+  if (enable_dtx_) {
+    const std::optional<bool> is_noise = IsNoise(audio);
+    if (!is_noise.has_value()) {
+      return std::nullopt;
+    }
+    if (is_noise.value()) {
+      return PackNoise();
+    }
+  }
+  return PackFeatures(feature_extractor_->Extract(audio));
+}
 
+std::optional<std::vector<uint8_t>> LyraEncoder::Encode(
+    const absl::Span<const float> audio) {
+  if (!IsOneHop(audio.size())) {
+    return std::nullopt;
+  }
   if (enable_dtx_) {
-    if (!noise_estimator_->ReceiveSamples(audio_for_encoding)) {
-      LOG(ERROR) << "Unable to update encoder noise estimator.";
+    // The noise estimator only takes int16 samples.
+    GetDspKernels().unit_to_int16(audio.data(), audio.size(),
+                                  noise_estimator_samples_.data());
+    const std::optional<bool> is_noise = IsNoise(noise_estimator_samples_);
+    if (!is_noise.has_value()) {
       return std::nullopt;
     }
-    // We send an empty packet only if this hop is just noise.
-    if (noise_estimator_->is_noise()) {
-      auto empty_packet = Packet<0>::Create(0, 0);
-      return empty_packet->PackQuantized(std::bitset<0>{}.to_string());
+    if (is_noise.value()) {
+      return PackNoise();
     }
   }
+  return PackFeatures(feature_extractor_->Extract(audio));
+}
+
+bool LyraEncoder::IsOneHop(int num_samples) const {
+  if (num_samples != profile_.num_samples_per_hop()) {
+    LOG(ERROR) << "The number of audio samples has to be exactly "
+               << profile_.num_samples_per_hop() << ", but is " << num_samples
+               << ".";
+    return false;
+  }
+  return true;
+}
 
-  auto features = feature_extractor_->Extract(audio_for_encoding);
+std::optional<bool> LyraEncoder::IsNoise(absl::Span<const int16_t> audio) {
+  if (!noise_estimator_->ReceiveSamples(audio)) {
+    LOG(ERROR) << "Unable to update encoder noise estimator.";
+    return std::nullopt;
+  }
+  return noise_estimator_->is_noise();
+}
+
+std::optional<std::vector<uint8_t>> LyraEncoder::PackNoise() {
+  // The receiver conceals a lost noise hop with comfort noise anyway.
+  previous_quantized_features_.reset();
+  last_num_quantized_bits_ = 0;
+  // We send an empty packet only if this hop is just noise.
+  auto empty_packet = Packet<0>::Create(0, 0);
+  return empty_packet->PackQuantized(std::bitset<0>{}.to_string());
+}
+
+std::optional<std::vector<uint8_t>> LyraEncoder::PackFeatures(
+    const std::optional<std::vector<float>>& features) {
   if (!features.has_value()) {
     LOG(ERROR) << "Unable to extract features from audio hop.";
     return std::nullopt;
   }
+  // In variable bitrate mode the features are quantized once at the ceiling.
+  // The first stages of the residual quantizer occupy the most significant
+  // bits, so every shorter prefix is a valid quantization on its own. The same
+  // holds for the redundant copy sent along with the next hop.
+  const int max_quantized_bits = max_residual_error_.has_value()
+                                     ? max_vbr_quantized_bits_
+                                     : num_quantized_bits_;
   auto quantized_features =
-      vector_quantizer_->Quantize(features.value(), num_quantized_bits_);
+      vector_quantizer_->Quantize(features.value(), max_quantized_bits);
   if (!quantized_features.has_value()) {
     LOG(ERROR) << "Unable to quantize features.";
     return std::nullopt;
   }
-  auto packet = CreatePacket(kNumHeaderBits, num_quantized_bits_);
-  return packet->PackQuantized(quantized_features.value());
+  int num_quantized_bits = max_quantized_bits;
+  if (max_residual_error_.has_value()) {
+    num_quantized_bits =
+        ChooseNumQuantizedBits(features.value(), quantized_features.value());
+  }
+  quantized_features->resize(num_quantized_bits);
+  last_num_quantized_bits_ = num_quantized_bits;
+  auto packet = CreatePacket(kNumHeaderBits, num_quantized_bits)
+                    ->PackQuantized(quantized_features.value());
+
+  if (redundancy_level_ > 0 && previous_quantized_features_.has_value()) {
+    // The copy is never larger than what was sent for the previous hop.
+    int redundancy_level = redundancy_level_;
+    while (redundancy_level > 1 &&
+           RedundancyLevelToNumQuantizedBits(redundancy_level) >
+               previous_quantized_features_->size()) {
+      --redundancy_level;
+    }
+    const int num_redundant_bits =
+        RedundancyLevelToNumQuantizedBits(redundancy_level);
+    const auto redundant =
+        CreatePacket(kNumHeaderBits, num_redundant_bits)
+            ->PackQuantized(
+                previous_quantized_features_->substr(0, num_redundant_bits));
+    auto redundant_packet = AppendRedundancy(packet, redundant);
+    if (!redundant_packet.has_value()) {
+      LOG(ERROR) << "Unable to append redundant copy of previous hop.";
+      return std::nullopt;
+    }
+    packet = std::move(redundant_packet.value());
+  }
+  previous_quantized_features_ = std::move(quantized_features);
+  return packet;
+}
+
+int LyraEncoder::ChooseNumQuantizedBits(
+    const std::vector<float>& features,
+    const std::string& quantized_features) const {
+  float features_energy = 0.f;
+  for (float feature : features) {
+    features_energy += feature * feature;
+  }
+  auto is_sufficient = [&](int num_quantized_bits) {
+    const std::optional<std::vector<float>> lossy_features =
+        vector_quantizer_->DecodeToLossyFeatures(
+            quantized_features.substr(0, num_quantized_bits));
+    if (!lossy_features.has_value() ||
+        lossy_features->size() != features.size()) {
+      return false;
+    }
+    float residual_energy = 0.f;
+    for (int i = 0; i < features.size(); ++i) {
+      const float residual = features[i] - lossy_features->at(i);
+      residual_energy += residual * residual;
+    }
+    return residual_energy <= max_residual_error_.value() * features_energy;
+  };
+
+  // Every quantizer stage shrinks the residual, so the prefixes below the
+  // ceiling which are sufficient form a suffix of them. A binary search finds
+  // its first one with at most 3 quantizer invokes instead of up to 7.
+  const std::vector<int>& supported_bits = GetSupportedQuantizedBits();
+  int low = 0;
+  int high = std::lower_bound(supported_bits.begin(), supported_bits.end(),
+                              max_vbr_quantized_bits_) -
+             supported_bits.begin();
+  int num_quantized_bits = max_vbr_quantized_bits_;
+  while (low < high) {
+    const int middle = (low + high) / 2;
+    if (is_sufficient(supported_bits[middle])) {
+      num_quantized_bits = supported_bits[middle];
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+  return num_quantized_bits;
 }
 
 bool LyraEncoder::set_bitrate(int bitrate) {
-  const int num_quantized_bits = BitrateToNumQuantizedBits(bitrate, (sample_rate_hz_/320));
+  const int num_quantized_bits =
+      BitrateToNumQuantizedBits(bitrate, profile_.frame_rate());
   if (num_quantized_bits < 0) {
     LOG(ERROR) << "Bitrate " << bitrate << " bps is not supported by codec.";
     return false;
@@ -176,12 +326,49 @@ bool LyraEncoder::set_bitrate(int bitrate) {
   return true;
 }
 
+bool LyraEncoder::EnableVariableBitrate(float max_residual_error,
+                                        int max_bitrate) {
+  if (max_residual_error <= 0.f) {
+    LOG(ERROR) << "Maximum residual error has to be positive, but is "
+               << max_residual_error << ".";
+    return false;
+  }
+  const int max_quantized_bits =
+      BitrateToNumQuantizedBits(max_bitrate, profile_.frame_rate());
+  if (max_quantized_bits < 0) {
+    LOG(ERROR) << "Bitrate " << max_bitrate
+               << " bps is not supported by codec.";
+    return false;
+  }
+  max_residual_error_ = max_residual_error;
+  max_vbr_quantized_bits_ = max_quantized_bits;
+  return true;
+}
+
+void LyraEncoder::DisableVariableBitrate() { max_residual_error_.reset(); }
+
+bool LyraEncoder::SetPacketLossRate(float packet_loss_rate) {
+  if (packet_loss_rate < 0.f || packet_loss_rate > 1.f) {
+    LOG(ERROR) << "Packet loss rate has to be in [0, 1], but is "
+               << packet_loss_rate << ".";
+    return false;
+  }
+  redundancy_level_ = PacketLossRateToRedundancyLevel(packet_loss_rate);
+  return true;
+}
+
 int LyraEncoder::sample_rate_hz() const { return sample_rate_hz_; }
 
 int LyraEncoder::num_channels() const { return num_channels_; }
 
-int LyraEncoder::bitrate() const { return GetBitrate(num_quantized_bits_, (sample_rate_hz_/320)); }
+int LyraEncoder::bitrate() const {
+  return GetBitrate(num_quantized_bits_, profile_.frame_rate());
+}
+
+int LyraEncoder::last_bitrate() const {
+  return GetBitrate(last_num_quantized_bits_, profile_.frame_rate());
+}
 
-int LyraEncoder::frame_rate() const { return kFrameRate; }
+int LyraEncoder::frame_rate() const { return profile_.frame_rate(); }
 }  // namespace codec
 }  // namespace chromemedia
@@ -20,14 +20,17 @@
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 
 #include "absl/types/span.h"
 #include "feature_extractor_interface.h"
 #include "include/ghc/filesystem.hpp"
+#include "lyra_config.h"
 #include "lyra_encoder_interface.h"
 #include "noise_estimator_interface.h"
 #include "resampler_interface.h"
+#include "tflite_model_wrapper.h"
 #include "vector_quantizer_interface.h"
 
 namespace chromemedia {
@@ -62,6 +65,28 @@ class LyraEncoder : public LyraEncoderInterface {
       int sample_rate_hz, int num_channels, int bitrate, bool enable_dtx,
       const ghc::filesystem::path& model_path);
 
+  /// Loads the feature extraction model once for many encoders to share.
+  ///
+  /// @param model_path Path to the model weights.
+  /// @return The shared model, or nullptr on failure.
+  static std::shared_ptr<TfLiteModelWrapper> CreateSharedModel(
+      const ghc::filesystem::path& model_path);
+
+  /// Static method to create a LyraEncoder which runs its feature extraction
+  /// model on |shared_model|, keeping only its own model states. Encoders
+  /// sharing a model take turns on one interpreter, so they must all be used
+  /// from the same thread.
+  ///
+  /// @param shared_model Model returned by |CreateSharedModel| for the same
+  ///                     |model_path|.
+  /// The other parameters are the same as above.
+  /// @return A unique_ptr to a LyraEncoder if all desired params are supported.
+  ///         Else it returns a nullptr.
+  static std::unique_ptr<LyraEncoder> Create(
+      int sample_rate_hz, int num_channels, int bitrate, bool enable_dtx,
+      const ghc::filesystem::path& model_path,
+      std::shared_ptr<TfLiteModelWrapper> shared_model);
+
   /// Encodes the audio samples into a vector wrapped byte array.
   ///
   /// @param audio Span of int16-formatted samples. It is assumed to contain
@@ -72,12 +97,52 @@ class LyraEncoder : public LyraEncoderInterface {
   std::optional<std::vector<uint8_t>> Encode(
       const absl::Span<const int16_t> audio) override;
 
+  /// Encodes float audio samples into a vector wrapped byte array.
+  ///
+  /// @param audio Span of float samples in [-1, 1]. It is assumed to contain
+  ///              20ms of data at the sample rate chosen at Create time. If it
+  ///              is aligned to 64 bytes the samples are passed to the model
+  ///              without conversion or copy.
+  /// @return Same as the int16 overload.
+  std::optional<std::vector<uint8_t>> Encode(
+      const absl::Span<const float> audio) override;
+
   /// Setter for the bitrate.
   ///
   /// @param bitrate Desired bitrate in bps.
   /// @return True if the bitrate is supported and set correctly.
   bool set_bitrate(int bitrate) override;
 
+  /// Enables variable bitrate encoding. Each frame is then quantized with the
+  /// smallest supported number of bits whose residual error is below
+  /// |max_residual_error|, but never with more bits than |max_bitrate| allows.
+  /// Noise frames are still sent as empty packets if DTX is enabled. Since the
+  /// packet size changes from frame to frame, the packets have to be framed
+  /// by the caller, e.g. with a length prefix.
+  ///
+  /// @param max_residual_error Maximum energy of the quantization residual,
+  ///                           relative to the energy of the features. Has to
+  ///                           be positive.
+  /// @param max_bitrate Ceiling bitrate in bps. It has to be supported by the
+  ///                    codec.
+  /// @return True if the parameters are valid and variable bitrate encoding is
+  ///         enabled.
+  bool EnableVariableBitrate(float max_residual_error, int max_bitrate);
+
+  /// Disables variable bitrate encoding. Frames are quantized again at the
+  /// bitrate of the last call to set_bitrate() or Create().
+  void DisableVariableBitrate();
+
+  /// Adapts in-band forward error correction to the packet loss rate reported
+  /// by the receiver. Above a few percent of loss each packet also carries a
+  /// low-rate copy of the previous frame, which grows with the loss rate. See
+  /// redundant_packet.h for the packet layout. Redundancy is off until the
+  /// first report.
+  ///
+  /// @param packet_loss_rate Fraction of packets lost, in [0, 1].
+  /// @return True if the packet loss rate is valid.
+  bool SetPacketLossRate(float packet_loss_rate);
+
   /// Getter for the sample rate in Hertz.
   ///
   /// @return Sample rate in Hertz.
@@ -90,15 +155,34 @@ class LyraEncoder : public LyraEncoderInterface {
 
   /// Getter for the bitrate.
   ///
+  /// With variable bitrate encoding this is neither the ceiling nor the rate
+  /// actually sent, but the constant bitrate which is restored once it is
+  /// disabled. Use last_bitrate() for the rate actually sent.
+  ///
   /// @return Bitrate.
   int bitrate() const override;
 
-  /// Getter for the frame rate.
+  /// Getter for the bitrate of the last encoded hop, without its redundant
+  /// copy of the previous hop. Differs from bitrate() with variable bitrate
+  /// encoding, and is 0 after a hop of noise with DTX or before the first hop.
   ///
-  /// @return Frame rate.
+  /// @return Bitrate of the last encoded hop.
+  int last_bitrate() const;
+
+  /// Getter for the frame rate. Hops are the same length at every sample
+  /// rate, so this is 50 at 16kHz and scales with the sample rate.
+  ///
+  /// @return Frame rate in packets per second.
   int frame_rate() const override;
 
  private:
+  // Creates the remaining components around |feature_extractor|, after the
+  // params have been checked.
+  static std::unique_ptr<LyraEncoder> CreateWithFeatureExtractor(
+      int sample_rate_hz, int num_channels, int bitrate, bool enable_dtx,
+      const ghc::filesystem::path& model_path,
+      std::unique_ptr<FeatureExtractorInterface> feature_extractor);
+
   LyraEncoder() = delete;
   LyraEncoder(std::unique_ptr<ResamplerInterface> resampler,
               std::unique_ptr<FeatureExtractorInterface> feature_extractor,
@@ -107,6 +191,28 @@ class LyraEncoder : public LyraEncoderInterface {
               int sample_rate_hz, int num_channels, int num_quantized_bits,
               bool enable_dtx);
 
+  // Returns false if |num_samples| is not one hop.
+  bool IsOneHop(int num_samples) const;
+
+  // Updates the noise estimate with |audio| and returns whether it is noise,
+  // or nullopt on failure.
+  std::optional<bool> IsNoise(absl::Span<const int16_t> audio);
+
+  // Returns the packet for a hop which is only noise.
+  std::optional<std::vector<uint8_t>> PackNoise();
+
+  // Quantizes the |features| of a hop and packs them, together with the
+  // redundant copy of the previous hop if redundancy is enabled.
+  std::optional<std::vector<uint8_t>> PackFeatures(
+      const std::optional<std::vector<float>>& features);
+
+  // Returns the smallest supported number of bits up to
+  // |max_vbr_quantized_bits_| whose prefix of |quantized_features| reproduces
+  // |features| within |max_residual_error_|. Returns the ceiling if no
+  // prefix does. Relies on longer prefixes never being worse.
+  int ChooseNumQuantizedBits(const std::vector<float>& features,
+                             const std::string& quantized_features) const;
+
   const std::unique_ptr<ResamplerInterface> resampler_;
   const std::unique_ptr<FeatureExtractorInterface> feature_extractor_;
   const std::unique_ptr<NoiseEstimatorInterface> noise_estimator_;
@@ -115,7 +221,20 @@ class LyraEncoder : public LyraEncoderInterface {
   const int sample_rate_hz_;
   const int num_channels_;
   int num_quantized_bits_;
+  // Set while variable bitrate encoding is enabled.
+  std::optional<float> max_residual_error_;
+  int max_vbr_quantized_bits_;
+  // Number of bits of the last hop, 0 if it was noise.
+  int last_num_quantized_bits_;
+  // Level of the redundant copy of the previous hop in each packet.
+  int redundancy_level_;
+  // Quantized features of the previous hop, unset if it was not sent.
+  std::optional<std::string> previous_quantized_features_;
   const bool enable_dtx_;
+  // Rate-dependent constants for |sample_rate_hz_|.
+  const CodecProfile profile_;
+  // Float samples converted for the noise estimator when DTX is enabled.
+  std::vector<int16_t> noise_estimator_samples_;
   friend class LyraEncoderPeer;
 };
 
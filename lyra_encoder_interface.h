@@ -36,6 +36,10 @@ class LyraEncoderInterface {
   virtual std::optional<std::vector<uint8_t>> Encode(
       const absl::Span<const int16_t> audio) = 0;
 
+  // Same as above for float samples in [-1, 1].
+  virtual std::optional<std::vector<uint8_t>> Encode(
+      const absl::Span<const float> audio) = 0;
+
   virtual bool set_bitrate(int bitrate) = 0;
 
   virtual int sample_rate_hz() const = 0;
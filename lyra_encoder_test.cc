@@ -14,6 +14,7 @@
 
 #include "lyra_encoder.h"
 
+#include <algorithm>
 #include <bitset>
 #include <climits>
 #include <cstdint>
@@ -27,13 +28,16 @@
 
 // Placeholder for get runfiles header.
 #include "absl/types/span.h"
+#include "dsp_utils.h"
 #include "feature_extractor_interface.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "include/ghc/filesystem.hpp"
+#include "lyra_components.h"
 #include "lyra_config.h"
 #include "noise_estimator_interface.h"
 #include "packet.h"
+#include "redundant_packet.h"
 #include "resampler_interface.h"
 #include "testing/mock_feature_extractor.h"
 #include "testing/mock_noise_estimator.h"
@@ -64,8 +68,27 @@ class LyraEncoderPeer {
     return encoder_.Encode(audio);
   }
 
+  std::optional<std::vector<uint8_t>> Encode(
+      const absl::Span<const float> audio) {
+    return encoder_.Encode(audio);
+  }
+
   bool set_bitrate(int bitrate) { return encoder_.set_bitrate(bitrate); }
 
+  int frame_rate() const { return encoder_.frame_rate(); }
+
+  bool EnableVariableBitrate(float max_residual_error, int max_bitrate) {
+    return encoder_.EnableVariableBitrate(max_residual_error, max_bitrate);
+  }
+
+  void DisableVariableBitrate() { encoder_.DisableVariableBitrate(); }
+
+  int last_bitrate() const { return encoder_.last_bitrate(); }
+
+  bool SetPacketLossRate(float packet_loss_rate) {
+    return encoder_.SetPacketLossRate(packet_loss_rate);
+  }
+
  private:
   LyraEncoder encoder_;
 };
@@ -73,7 +96,9 @@ class LyraEncoderPeer {
 namespace {
 
 using testing::_;
+using testing::An;
 using testing::Combine;
+using testing::ElementsAreArray;
 using testing::Return;
 using testing::ValuesIn;
 
@@ -157,7 +182,8 @@ TEST_P(LyraEncoderTest, InvalidSizedAudioFails) {
   internal_samples_span_ = absl::MakeConstSpan(internal_samples_);
 
   SetResamplerExpectation(1);
-  EXPECT_CALL(*mock_feature_extractor_, Extract(_)).Times(0);
+  EXPECT_CALL(*mock_feature_extractor_,
+              Extract(An<absl::Span<const int16_t>>())).Times(0);
   EXPECT_CALL(*mock_vector_quantizer_, Quantize(_, _)).Times(0);
 
   LyraEncoderPeer encoder_peer(std::move(mock_resampler_),
@@ -192,7 +218,8 @@ TEST_P(LyraEncoderTest, ReceiveSamplesFails) {
       .Times(1)
       .WillOnce(Return(false));
   EXPECT_CALL(*mock_noise_estimator_, is_noise()).Times(0);
-  EXPECT_CALL(*mock_feature_extractor_, Extract(_)).Times(0);
+  EXPECT_CALL(*mock_feature_extractor_,
+              Extract(An<absl::Span<const int16_t>>())).Times(0);
   EXPECT_CALL(*mock_vector_quantizer_, Quantize(_, _)).Times(0);
 
   LyraEncoderPeer encoder_peer(
@@ -241,7 +268,8 @@ TEST_P(LyraEncoderTest, NoiseDetectionReturnsEmptyPacket) {
   EXPECT_CALL(*mock_noise_estimator_, ReceiveSamples(_))
       .Times(1)
       .WillOnce(Return(true));
-  EXPECT_CALL(*mock_feature_extractor_, Extract(_)).Times(0);
+  EXPECT_CALL(*mock_feature_extractor_,
+              Extract(An<absl::Span<const int16_t>>())).Times(0);
   EXPECT_CALL(*mock_vector_quantizer_, Quantize(_, _)).Times(0);
 
   LyraEncoderPeer encoder_peer(
@@ -260,7 +288,8 @@ TEST_P(LyraEncoderTest, NoiseDetectionReturnsEmptyPacket) {
 
 TEST_P(LyraEncoderTest, QuantizationFails) {
   SetResamplerExpectation(1);
-  EXPECT_CALL(*mock_feature_extractor_, Extract(_))
+  EXPECT_CALL(*mock_feature_extractor_,
+              Extract(An<absl::Span<const int16_t>>()))
       .Times(1)
       .WillRepeatedly(Return(mock_features_));
   EXPECT_CALL(*mock_vector_quantizer_,
@@ -280,7 +309,8 @@ TEST_P(LyraEncoderTest, QuantizationFails) {
 TEST_P(LyraEncoderTest, MultipleEncodeCalls) {
   const int kNumEncodeCalls = 5;
   SetResamplerExpectation(kNumEncodeCalls);
-  EXPECT_CALL(*mock_feature_extractor_, Extract(_))
+  EXPECT_CALL(*mock_feature_extractor_,
+              Extract(An<absl::Span<const int16_t>>()))
       .Times(kNumEncodeCalls)
       .WillRepeatedly(Return(mock_features_));
   EXPECT_CALL(*mock_vector_quantizer_,
@@ -302,6 +332,68 @@ TEST_P(LyraEncoderTest, MultipleEncodeCalls) {
   }
 }
 
+TEST_P(LyraEncoderTest, FloatAudioIsPassedToFeatureExtractor) {
+  std::vector<float> float_samples(samples_.size());
+  std::transform(samples_.begin(), samples_.end(), float_samples.begin(),
+                 Int16ToUnitScalar<float>);
+  EXPECT_CALL(*mock_feature_extractor_,
+              Extract(An<absl::Span<const int16_t>>()))
+      .Times(0);
+  EXPECT_CALL(*mock_feature_extractor_,
+              Extract(absl::MakeConstSpan(float_samples)))
+      .WillOnce(Return(mock_features_));
+  EXPECT_CALL(*mock_vector_quantizer_,
+              Quantize(mock_features_, num_quantized_bits_))
+      .WillOnce(Return(mock_quantized_));
+
+  LyraEncoderPeer encoder_peer(std::move(mock_resampler_),
+                               std::move(mock_feature_extractor_), nullptr,
+                               std::move(mock_vector_quantizer_),
+                               external_sample_rate_hz_, num_quantized_bits_,
+                               /*enable_dtx=*/false);
+  auto encoded = encoder_peer.Encode(absl::MakeConstSpan(float_samples));
+
+  ASSERT_TRUE(encoded.has_value());
+  EXPECT_TRUE(DoesPacketContainQuantized(encoded.value(), mock_quantized_));
+}
+
+TEST_P(LyraEncoderTest, FloatAudioIsConvertedForNoiseEstimator) {
+  std::vector<float> float_samples(samples_.size());
+  std::transform(samples_.begin(), samples_.end(), float_samples.begin(),
+                 Int16ToUnitScalar<float>);
+  EXPECT_CALL(*mock_noise_estimator_, ReceiveSamples(samples_span_))
+      .WillOnce(Return(true));
+  EXPECT_CALL(*mock_noise_estimator_, is_noise()).WillOnce(Return(true));
+  EXPECT_CALL(*mock_feature_extractor_, Extract(An<absl::Span<const float>>()))
+      .Times(0);
+
+  LyraEncoderPeer encoder_peer(
+      std::move(mock_resampler_), std::move(mock_feature_extractor_),
+      std::move(mock_noise_estimator_), std::move(mock_vector_quantizer_),
+      external_sample_rate_hz_, num_quantized_bits_,
+      /*enable_dtx=*/true);
+  auto encoded = encoder_peer.Encode(absl::MakeConstSpan(float_samples));
+
+  ASSERT_TRUE(encoded.has_value());
+  auto empty_packet = Packet<0>::Create(0, 0);
+  EXPECT_EQ(empty_packet->PackQuantized(std::bitset<0>{}.to_string()),
+            encoded.value());
+}
+
+TEST_P(LyraEncoderTest, InvalidSizedFloatAudioFails) {
+  std::vector<float> float_samples(samples_.size() - 1);
+  EXPECT_CALL(*mock_feature_extractor_, Extract(An<absl::Span<const float>>()))
+      .Times(0);
+
+  LyraEncoderPeer encoder_peer(std::move(mock_resampler_),
+                               std::move(mock_feature_extractor_), nullptr,
+                               std::move(mock_vector_quantizer_),
+                               external_sample_rate_hz_, num_quantized_bits_,
+                               /*enable_dtx=*/false);
+  EXPECT_FALSE(
+      encoder_peer.Encode(absl::MakeConstSpan(float_samples)).has_value());
+}
+
 TEST_P(LyraEncoderTest, GoodCreationParametersReturnNotNullptr) {
   const auto valid_model_path =
       ghc::filesystem::current_path() / "model_coeffs";
@@ -316,6 +408,31 @@ TEST_P(LyraEncoderTest, GoodCreationParametersReturnNotNullptr) {
                                 /*enable_dtx=*/true, valid_model_path));
 }
 
+TEST_P(LyraEncoderTest, GoodCreationParametersOnSharedModelReturnNotNullptr) {
+  const auto valid_model_path =
+      ghc::filesystem::current_path() / "model_coeffs";
+  std::shared_ptr<TfLiteModelWrapper> shared_model =
+      LyraEncoder::CreateSharedModel(valid_model_path);
+  ASSERT_NE(shared_model, nullptr);
+
+  // Several encoders can run on the same model.
+  EXPECT_NE(nullptr,
+            LyraEncoder::Create(external_sample_rate_hz_, kNumChannels,
+                                GetBitrate(num_quantized_bits_),
+                                /*enable_dtx=*/false, valid_model_path,
+                                shared_model));
+  EXPECT_NE(nullptr,
+            LyraEncoder::Create(external_sample_rate_hz_, kNumChannels,
+                                GetBitrate(num_quantized_bits_),
+                                /*enable_dtx=*/true, valid_model_path,
+                                shared_model));
+  EXPECT_EQ(nullptr,
+            LyraEncoder::Create(external_sample_rate_hz_, kNumChannels,
+                                GetBitrate(num_quantized_bits_),
+                                /*enable_dtx=*/false, valid_model_path,
+                                /*shared_model=*/nullptr));
+}
+
 TEST_P(LyraEncoderTest, BadCreationParametersReturnNullptr) {
   const auto valid_model_path =
       ghc::filesystem::current_path() / "model_coeffs";
@@ -368,6 +485,207 @@ TEST_P(LyraEncoderTest, SetBitrateFails) {
   EXPECT_FALSE(encoder_peer.set_bitrate(0));
 }
 
+TEST_P(LyraEncoderTest, VariableBitrateChoosesSmallestSufficientBits) {
+  SetResamplerExpectation(1);
+  EXPECT_CALL(*mock_feature_extractor_,
+              Extract(An<absl::Span<const int16_t>>()))
+      .WillOnce(Return(mock_features_));
+  // The features are quantized once at the ceiling.
+  EXPECT_CALL(*mock_vector_quantizer_,
+              Quantize(mock_features_, num_quantized_bits_))
+      .WillOnce(Return(mock_quantized_));
+  // Every prefix reproduces the features exactly, so the smallest one wins.
+  // The prefixes are searched in halves, so at most 3 of the 7 prefixes below
+  // the largest ceiling are decoded.
+  const int kMinQuantizedBits = GetSupportedQuantizedBits().front();
+  EXPECT_CALL(*mock_vector_quantizer_, DecodeToLossyFeatures(_))
+      .Times(testing::AtMost(3))
+      .WillRepeatedly(Return(mock_features_));
+
+  LyraEncoderPeer encoder_peer(std::move(mock_resampler_),
+                               std::move(mock_feature_extractor_), nullptr,
+                               std::move(mock_vector_quantizer_),
+                               external_sample_rate_hz_, num_quantized_bits_,
+                               /*enable_dtx=*/false);
+  ASSERT_TRUE(encoder_peer.EnableVariableBitrate(
+      /*max_residual_error=*/0.01f,
+      GetBitrate(num_quantized_bits_,
+                 GetFrameRate(external_sample_rate_hz_))));
+  auto encoded = encoder_peer.Encode(samples_span_);
+
+  ASSERT_TRUE(encoded.has_value());
+  EXPECT_EQ(encoded.value().size(), GetPacketSize(kMinQuantizedBits));
+  EXPECT_EQ(encoder_peer.last_bitrate(),
+            GetBitrate(kMinQuantizedBits,
+                       GetFrameRate(external_sample_rate_hz_)));
+}
+
+TEST_P(LyraEncoderTest, VariableBitrateFindsFirstSufficientPrefix) {
+  // Only the prefix just below the ceiling and longer ones are sufficient.
+  const std::vector<int>& supported_bits = GetSupportedQuantizedBits();
+  const auto ceiling = std::find(supported_bits.begin(), supported_bits.end(),
+                                 num_quantized_bits_);
+  if (ceiling == supported_bits.begin()) {
+    GTEST_SKIP() << "No prefix below the smallest ceiling.";
+  }
+  const int kSufficientBits = *(ceiling - 1);
+  SetResamplerExpectation(1);
+  EXPECT_CALL(*mock_feature_extractor_,
+              Extract(An<absl::Span<const int16_t>>()))
+      .WillOnce(Return(mock_features_));
+  EXPECT_CALL(*mock_vector_quantizer_,
+              Quantize(mock_features_, num_quantized_bits_))
+      .WillOnce(Return(mock_quantized_));
+  EXPECT_CALL(*mock_vector_quantizer_, DecodeToLossyFeatures(_))
+      .Times(testing::AtMost(3))
+      .WillRepeatedly([this, kSufficientBits](const std::string& quantized) {
+        return quantized.size() >= kSufficientBits
+                   ? mock_features_
+                   : std::vector<float>(mock_features_.size(), 0.f);
+      });
+
+  LyraEncoderPeer encoder_peer(std::move(mock_resampler_),
+                               std::move(mock_feature_extractor_), nullptr,
+                               std::move(mock_vector_quantizer_),
+                               external_sample_rate_hz_, num_quantized_bits_,
+                               /*enable_dtx=*/false);
+  ASSERT_TRUE(encoder_peer.EnableVariableBitrate(
+      /*max_residual_error=*/0.01f,
+      GetBitrate(num_quantized_bits_,
+                 GetFrameRate(external_sample_rate_hz_))));
+  auto encoded = encoder_peer.Encode(samples_span_);
+
+  ASSERT_TRUE(encoded.has_value());
+  EXPECT_EQ(encoded.value().size(), GetPacketSize(kSufficientBits));
+  EXPECT_EQ(encoder_peer.last_bitrate(),
+            GetBitrate(kSufficientBits,
+                       GetFrameRate(external_sample_rate_hz_)));
+}
+
+TEST_P(LyraEncoderTest, VariableBitrateFallsBackToCeiling) {
+  SetResamplerExpectation(1);
+  EXPECT_CALL(*mock_feature_extractor_,
+              Extract(An<absl::Span<const int16_t>>()))
+      .WillOnce(Return(mock_features_));
+  EXPECT_CALL(*mock_vector_quantizer_,
+              Quantize(mock_features_, num_quantized_bits_))
+      .WillOnce(Return(mock_quantized_));
+  // No prefix shorter than the ceiling gets anywhere close to the features.
+  EXPECT_CALL(*mock_vector_quantizer_, DecodeToLossyFeatures(_))
+      .WillRepeatedly(Return(std::vector<float>(mock_features_.size(), 0.f)));
+
+  LyraEncoderPeer encoder_peer(std::move(mock_resampler_),
+                               std::move(mock_feature_extractor_), nullptr,
+                               std::move(mock_vector_quantizer_),
+                               external_sample_rate_hz_, num_quantized_bits_,
+                               /*enable_dtx=*/false);
+  ASSERT_TRUE(encoder_peer.EnableVariableBitrate(
+      /*max_residual_error=*/0.01f,
+      GetBitrate(num_quantized_bits_,
+                 GetFrameRate(external_sample_rate_hz_))));
+  auto encoded = encoder_peer.Encode(samples_span_);
+
+  ASSERT_TRUE(encoded.has_value());
+  EXPECT_EQ(encoded.value().size(), GetPacketSize(num_quantized_bits_));
+  EXPECT_TRUE(DoesPacketContainQuantized(encoded.value(), mock_quantized_));
+}
+
+TEST_P(LyraEncoderTest, DisableVariableBitrateRestoresConstantBitrate) {
+  SetResamplerExpectation(1);
+  EXPECT_CALL(*mock_feature_extractor_,
+              Extract(An<absl::Span<const int16_t>>()))
+      .WillOnce(Return(mock_features_));
+  EXPECT_CALL(*mock_vector_quantizer_,
+              Quantize(mock_features_, num_quantized_bits_))
+      .WillOnce(Return(mock_quantized_));
+  EXPECT_CALL(*mock_vector_quantizer_, DecodeToLossyFeatures(_)).Times(0);
+
+  LyraEncoderPeer encoder_peer(std::move(mock_resampler_),
+                               std::move(mock_feature_extractor_), nullptr,
+                               std::move(mock_vector_quantizer_),
+                               external_sample_rate_hz_, num_quantized_bits_,
+                               /*enable_dtx=*/false);
+  ASSERT_TRUE(encoder_peer.EnableVariableBitrate(
+      /*max_residual_error=*/0.01f,
+      GetBitrate(num_quantized_bits_,
+                 GetFrameRate(external_sample_rate_hz_))));
+  encoder_peer.DisableVariableBitrate();
+  auto encoded = encoder_peer.Encode(samples_span_);
+
+  ASSERT_TRUE(encoded.has_value());
+  EXPECT_EQ(encoded.value().size(), GetPacketSize(num_quantized_bits_));
+}
+
+TEST_P(LyraEncoderTest, EnableVariableBitrateFails) {
+  LyraEncoderPeer encoder_peer(std::move(mock_resampler_),
+                               std::move(mock_feature_extractor_), nullptr,
+                               std::move(mock_vector_quantizer_),
+                               external_sample_rate_hz_, num_quantized_bits_,
+                               /*enable_dtx=*/false);
+  const int bitrate =
+      GetBitrate(num_quantized_bits_, GetFrameRate(external_sample_rate_hz_));
+  EXPECT_FALSE(encoder_peer.EnableVariableBitrate(0.f, bitrate));
+  EXPECT_FALSE(encoder_peer.EnableVariableBitrate(-0.5f, bitrate));
+  EXPECT_FALSE(encoder_peer.EnableVariableBitrate(0.01f, 0));
+}
+
+TEST_P(LyraEncoderTest, PacketsCarryRedundantCopyOfPreviousHop) {
+  const int kNumEncodeCalls = 2;
+  SetResamplerExpectation(kNumEncodeCalls);
+  EXPECT_CALL(*mock_feature_extractor_,
+              Extract(An<absl::Span<const int16_t>>()))
+      .Times(kNumEncodeCalls)
+      .WillRepeatedly(Return(mock_features_));
+  EXPECT_CALL(*mock_vector_quantizer_,
+              Quantize(mock_features_, num_quantized_bits_))
+      .Times(kNumEncodeCalls)
+      .WillRepeatedly(Return(mock_quantized_));
+
+  LyraEncoderPeer encoder_peer(std::move(mock_resampler_),
+                               std::move(mock_feature_extractor_), nullptr,
+                               std::move(mock_vector_quantizer_),
+                               external_sample_rate_hz_, num_quantized_bits_,
+                               /*enable_dtx=*/false);
+  ASSERT_TRUE(encoder_peer.SetPacketLossRate(0.05f));
+  // The first packet has no previous hop to carry.
+  auto first = encoder_peer.Encode(samples_span_);
+  ASSERT_TRUE(first.has_value());
+  EXPECT_EQ(first->size(), GetPacketSize(num_quantized_bits_));
+
+  auto second = encoder_peer.Encode(samples_span_);
+  ASSERT_TRUE(second.has_value());
+  const auto split = SplitRedundantPacket(second.value());
+  ASSERT_TRUE(split.has_value());
+  EXPECT_THAT(split->primary, ElementsAreArray(first.value()));
+  const int num_redundant_bits =
+      RedundancyLevelToNumQuantizedBits(PacketLossRateToRedundancyLevel(0.05f));
+  EXPECT_EQ(split->num_redundant_bits, num_redundant_bits);
+  EXPECT_THAT(split->redundant,
+              ElementsAreArray(
+                  CreatePacket(kNumHeaderBits, num_redundant_bits)
+                      ->PackQuantized(std::string(num_redundant_bits, '1'))));
+}
+
+TEST_P(LyraEncoderTest, SetPacketLossRateFails) {
+  LyraEncoderPeer encoder_peer(std::move(mock_resampler_),
+                               std::move(mock_feature_extractor_), nullptr,
+                               std::move(mock_vector_quantizer_),
+                               external_sample_rate_hz_, num_quantized_bits_,
+                               /*enable_dtx=*/false);
+  EXPECT_FALSE(encoder_peer.SetPacketLossRate(-0.1f));
+  EXPECT_FALSE(encoder_peer.SetPacketLossRate(1.5f));
+}
+
+TEST_P(LyraEncoderTest, FrameRateScalesWithSampleRate) {
+  LyraEncoderPeer encoder_peer(std::move(mock_resampler_),
+                               std::move(mock_feature_extractor_), nullptr,
+                               std::move(mock_vector_quantizer_),
+                               external_sample_rate_hz_, num_quantized_bits_,
+                               /*enable_dtx=*/false);
+  // 50 packets per second at 16kHz, e.g. 25 at 8kHz and 150 at 48kHz.
+  EXPECT_EQ(encoder_peer.frame_rate(), external_sample_rate_hz_ * 50 / 16000);
+}
+
 INSTANTIATE_TEST_SUITE_P(SampleRatesQuantizedBitsAndHopsPerPacket,
                          LyraEncoderTest,
                          Combine(ValuesIn(kSupportedSampleRates),
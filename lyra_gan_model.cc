@@ -34,36 +34,85 @@ namespace chromemedia {
 namespace codec {
 
 std::unique_ptr<LyraGanModel> LyraGanModel::Create(
-    const ghc::filesystem::path& model_path, int num_features) {
-  auto model = TfLiteModelWrapper::Create(model_path / "lyragan.tflite", true);
+    const ghc::filesystem::path& model_path, int num_features,
+    bool enable_profiling) {
+  auto model = CreateSharedWrapper(model_path, enable_profiling);
+  if (model == nullptr) {
+    return nullptr;
+  }
+  return absl::WrapUnique(
+      new LyraGanModel(std::move(model), num_features, false));
+}
+
+std::shared_ptr<TfLiteModelWrapper> LyraGanModel::CreateSharedWrapper(
+    const ghc::filesystem::path& model_path, bool enable_profiling) {
+  auto model = TfLiteModelWrapper::Create(model_path / "lyragan.tflite", true,
+                                          enable_profiling);
   if (model == nullptr) {
     LOG(ERROR) << "Unable to create LyraGAN TFLite model wrapper.";
     return nullptr;
   }
-  return absl::WrapUnique(new LyraGanModel(std::move(model), num_features));
+  // Every input but the features is a state.
+  if (!model->EnableStates(1)) {
+    LOG(ERROR) << "Unable to set up the LyraGAN model states.";
+    return nullptr;
+  }
+  return model;
 }
 
-LyraGanModel::LyraGanModel(std::unique_ptr<TfLiteModelWrapper> model,
-                           int num_features)
+std::unique_ptr<LyraGanModel> LyraGanModel::CreateMultiplexed(
+    std::shared_ptr<TfLiteModelWrapper> shared_model, int num_features) {
+  if (shared_model == nullptr) {
+    LOG(ERROR) << "Shared LyraGAN TFLite model wrapper must not be null.";
+    return nullptr;
+  }
+  return absl::WrapUnique(
+      new LyraGanModel(std::move(shared_model), num_features, true));
+}
+
+LyraGanModel::LyraGanModel(std::shared_ptr<TfLiteModelWrapper> model,
+                           int num_features, bool multiplexed)
     : GenerativeModel(model->get_output_tensor<float>(0).size(), num_features),
-      model_(std::move(model)) {}
+      model_(std::move(model)),
+      multiplexed_(multiplexed) {
+  if (multiplexed_) {
+    // Starts from zero states, like a model with its own wrapper.
+    states_.resize(model_->state_bytes(), 0);
+    samples_.resize(model_->get_output_tensor<float>(0).size(), 0.f);
+  }
+}
 
 bool LyraGanModel::RunConditioning(const std::vector<float>& features) {
+  if (multiplexed_ && !model_->LoadStates(states_)) {
+    return false;
+  }
   absl::Span<float> input = model_->get_input_tensor<float>(0);
   std::copy(features.begin(), features.end(), input.begin());
-  model_->Invoke();
-  for (int i = 1; i < model_->num_input_tensors(); ++i) {
-    absl::Span<float> input_state = model_->get_input_tensor<float>(i);
-    absl::Span<const float> output_state = model_->get_output_tensor<float>(i);
-    std::copy(output_state.begin(), output_state.end(), input_state.begin());
+  if (!model_->Invoke()) {
+    return false;
+  }
+  if (multiplexed_) {
+    const absl::Span<const float> output = model_->get_output_tensor<float>(0);
+    std::copy(output.begin(), output.end(), samples_.begin());
+    return model_->SaveStates(absl::MakeSpan(states_));
   }
   return true;
 }
 
 std::optional<std::vector<int16_t>> LyraGanModel::RunModel(int num_samples) {
-  return UnitToInt16(absl::MakeConstSpan(
-      &model_->get_output_tensor<float>(0).at(next_sample_in_hop()),
-      num_samples));
+  return UnitToInt16(GetSamples().subspan(next_sample_in_hop(), num_samples));
+}
+
+std::optional<std::vector<float>> LyraGanModel::RunFloatModel(
+    int num_samples) {
+  const absl::Span<const float> output =
+      GetSamples().subspan(next_sample_in_hop(), num_samples);
+  return std::vector<float>(output.begin(), output.end());
+}
+
+absl::Span<const float> LyraGanModel::GetSamples() {
+  return multiplexed_ ? absl::MakeConstSpan(samples_)
+                      : model_->get_output_tensor<float>(0);
 }
 
 }  // namespace codec
@@ -20,8 +20,10 @@
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 
+#include "absl/types/span.h"
 #include "generative_model_interface.h"
 #include "include/ghc/filesystem.hpp"
 #include "tflite_model_wrapper.h"
@@ -34,19 +36,53 @@ class LyraGanModel : public GenerativeModel {
  public:
   // Returns a nullptr on failure.
   static std::unique_ptr<LyraGanModel> Create(
-      const ghc::filesystem::path& model_path, int num_features);
+      const ghc::filesystem::path& model_path, int num_features,
+      bool enable_profiling = false);
+
+  // Returns a LyraGAN TFLite model wrapper which many models created with
+  // |CreateMultiplexed| can take turns running on, or nullptr on failure.
+  static std::shared_ptr<TfLiteModelWrapper> CreateSharedWrapper(
+      const ghc::filesystem::path& model_path, bool enable_profiling = false);
+
+  // Returns a model which runs on |shared_model|, as returned by
+  // |CreateSharedWrapper|, and only keeps its own states and the samples of
+  // the current hop. The states are swapped into the wrapper around each
+  // invoke, so all models sharing a wrapper must be run from one thread.
+  // Returns a nullptr on failure.
+  static std::unique_ptr<LyraGanModel> CreateMultiplexed(
+      std::shared_ptr<TfLiteModelWrapper> shared_model, int num_features);
 
   ~LyraGanModel() override {}
 
+  // Returns the op profile of the TFLite model, or an empty string if it was
+  // not created with profiling enabled.
+  std::string GetProfileReport() const { return model_->GetProfileReport(); }
+
+  // Returns the memory traffic per frame saved by double buffering the model
+  // states instead of copying them.
+  int64_t saved_state_copy_bytes() const {
+    return model_->saved_state_copy_bytes();
+  }
+
  private:
-  explicit LyraGanModel(std::unique_ptr<TfLiteModelWrapper> model,
-                        int num_features);
+  LyraGanModel(std::shared_ptr<TfLiteModelWrapper> model, int num_features,
+               bool multiplexed);
 
   bool RunConditioning(const std::vector<float>& features) override;
 
   std::optional<std::vector<int16_t>> RunModel(int num_samples) override;
 
-  const std::unique_ptr<TfLiteModelWrapper> model_;
+  std::optional<std::vector<float>> RunFloatModel(int num_samples) override;
+
+  // Returns the samples of the current hop.
+  absl::Span<const float> GetSamples();
+
+  const std::shared_ptr<TfLiteModelWrapper> model_;
+  const bool multiplexed_;
+  // Only used when multiplexed: the states between invokes and a copy of the
+  // samples of the current hop, which other models may overwrite.
+  std::vector<uint8_t> states_;
+  std::vector<float> samples_;
 };
 
 }  // namespace codec
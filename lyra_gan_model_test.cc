@@ -22,6 +22,8 @@
 #include <vector>
 
 // Placeholder for get runfiles header.
+#include "absl/types/span.h"
+#include "dsp_utils.h"
 #include "gtest/gtest.h"
 #include "include/ghc/filesystem.hpp"
 #include "lyra_config.h"
@@ -74,6 +76,72 @@ TEST_F(LyraGanModelTest, SamplesAreGeneratedUntilHopLimit) {
   EXPECT_FALSE(model_->GenerateSamples(1).has_value());
 }
 
+TEST_F(LyraGanModelTest, FloatSamplesMatchInt16Samples) {
+  ASSERT_NE(model_, nullptr);
+  auto float_model = LyraGanModel::Create(
+      ghc::filesystem::current_path() / "model_coeffs", kNumFeatures);
+  ASSERT_NE(float_model, nullptr);
+
+  const int num_samples_per_hop = GetNumSamplesPerHop(kInternalSampleRateHz);
+  model_->AddFeatures(features_);
+  float_model->AddFeatures(features_);
+  auto samples = model_->GenerateSamples(num_samples_per_hop);
+  ASSERT_TRUE(samples.has_value());
+  auto float_samples = float_model->GenerateFloatSamples(num_samples_per_hop);
+  ASSERT_TRUE(float_samples.has_value());
+  EXPECT_EQ(UnitToInt16(absl::MakeConstSpan(float_samples.value())),
+            samples.value());
+}
+
+TEST_F(LyraGanModelTest, MultiplexedModelsMatchIndependentModels) {
+  ASSERT_NE(model_, nullptr);
+  const auto model_path = ghc::filesystem::current_path() / "model_coeffs";
+  auto other_model = LyraGanModel::Create(model_path, kNumFeatures);
+  ASSERT_NE(other_model, nullptr);
+  auto shared_wrapper = LyraGanModel::CreateSharedWrapper(model_path);
+  ASSERT_NE(shared_wrapper, nullptr);
+  auto multiplexed_model =
+      LyraGanModel::CreateMultiplexed(shared_wrapper, kNumFeatures);
+  ASSERT_NE(multiplexed_model, nullptr);
+  auto other_multiplexed_model =
+      LyraGanModel::CreateMultiplexed(shared_wrapper, kNumFeatures);
+  ASSERT_NE(other_multiplexed_model, nullptr);
+
+  // The streams take turns on the shared wrapper in the middle of each hop, so
+  // each one would see the states and samples of the other if they leaked.
+  const int num_samples_per_hop = GetNumSamplesPerHop(kInternalSampleRateHz);
+  const int first_request = num_samples_per_hop / 2;
+  for (int hop = 0; hop < 5; ++hop) {
+    const std::vector<float> features(kNumFeatures, 0.1f * hop);
+    const std::vector<float> other_features(kNumFeatures, -0.1f * hop);
+    model_->AddFeatures(features);
+    multiplexed_model->AddFeatures(features);
+    other_model->AddFeatures(other_features);
+    other_multiplexed_model->AddFeatures(other_features);
+    for (const int num_samples :
+         {first_request, num_samples_per_hop - first_request}) {
+      auto samples = multiplexed_model->GenerateSamples(num_samples);
+      auto other_samples =
+          other_multiplexed_model->GenerateSamples(num_samples);
+      ASSERT_TRUE(samples.has_value());
+      ASSERT_TRUE(other_samples.has_value());
+      EXPECT_EQ(samples, model_->GenerateSamples(num_samples))
+          << "hop=" << hop;
+      EXPECT_EQ(other_samples, other_model->GenerateSamples(num_samples))
+          << "hop=" << hop;
+    }
+  }
+}
+
+TEST_F(LyraGanModelTest, XnnpackTakesOverEveryOp) {
+  auto wrapper = LyraGanModel::CreateSharedWrapper(
+      ghc::filesystem::current_path() / "model_coeffs");
+  ASSERT_NE(wrapper, nullptr);
+
+  EXPECT_TRUE(wrapper->GetNonDelegatedOps().empty())
+      << testing::PrintToString(wrapper->GetNonDelegatedOps());
+}
+
 }  // namespace
 }  // namespace codec
 }  // namespace chromemedia
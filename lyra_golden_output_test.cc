@@ -0,0 +1,166 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Encodes and decodes the testdata wav files at every sample rate and quality
+// preset in deterministic mode, and fails if the decoded audio is not
+// bit-exact with a checked-in corpus of golden hashes. This is meant to check
+// that optimizations which should not change the output, like vectorized
+// kernels or data layout changes, indeed do not.
+//
+// Floating point results of the models depend on the instruction set, so the
+// hashes are only comparable on the reference machine class named in the
+// header of the golden file. Every configuration must have a golden hash, so
+// the test fails for configurations which were never recorded. Another golden
+// file can be used with
+//   bazel test :lyra_golden_output_test \
+//     --test_env=LYRA_GOLDEN_HASHES=testdata/golden_output_hashes.txt
+// The measured hashes are logged in the golden file format, so a new golden
+// file can be created from the test log.
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra_config.h"
+#include "lyra_decoder.h"
+#include "lyra_encoder.h"
+#include "testing/corpus_test_utils.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+constexpr absl::string_view kGoldenHashesPath =
+    "testdata/golden_output_hashes.txt";
+// Packets are lost in bursts of |kNumLostHops| out of every |kLossPeriodHops|
+// hops. The bursts are long enough to go through concealment into comfort
+// noise, so that every random number drawn by the decoder affects the hash.
+constexpr int kLossPeriodHops = 50;
+constexpr int kNumLostHops = 10;
+
+ghc::filesystem::path GetGoldenHashesPath() {
+  return GetCorpusTablePath("LYRA_GOLDEN_HASHES", kGoldenHashesPath);
+}
+
+// Reads lines of the form
+//   <sample_rate_hz> <quality_preset> <hex_hash>
+std::optional<std::map<CorpusKey, uint64_t>> ReadGoldenHashes(
+    const ghc::filesystem::path& golden_path) {
+  const auto table = ReadCorpusTable(golden_path, /*num_values=*/1);
+  if (!table.has_value()) {
+    return std::nullopt;
+  }
+  std::map<CorpusKey, uint64_t> golden_hashes;
+  for (const auto& [key, values] : table.value()) {
+    uint64_t hash;
+    if (!absl::SimpleHexAtoi(values[0], &hash)) {
+      LOG(ERROR) << "Could not parse golden hash of " << key.first
+                 << " Hz at quality preset " << key.second << ".";
+      return std::nullopt;
+    }
+    golden_hashes[key] = hash;
+  }
+  return golden_hashes;
+}
+
+// 64-bit FNV-1a over the little endian bytes of |samples|. Unlike absl::Hash
+// this is stable across processes and platforms.
+uint64_t HashSamples(absl::Span<const int16_t> samples, uint64_t hash) {
+  constexpr uint64_t kFnvPrime = 0x100000001b3;
+  for (const int16_t sample : samples) {
+    const uint16_t bits = static_cast<uint16_t>(sample);
+    hash = (hash ^ (bits & 0xff)) * kFnvPrime;
+    hash = (hash ^ (bits >> 8)) * kFnvPrime;
+  }
+  return hash;
+}
+
+// Returns the hash of the deterministic decoder output of the corpus, with
+// periodic bursts of lost packets.
+std::optional<uint64_t> Measure(int sample_rate_hz, int quality_preset) {
+  constexpr uint64_t kFnvOffsetBasis = 0xcbf29ce484222325;
+  uint64_t hash = kFnvOffsetBasis;
+  const std::optional<int> num_hops = RunCorpus(
+      sample_rate_hz, quality_preset, /*deterministic=*/true,
+      [&hash](int hop, absl::Span<const int16_t> samples,
+              LyraEncoder& encoder, LyraDecoder& decoder) {
+        auto encoded = encoder.Encode(samples);
+        if (!encoded.has_value()) {
+          return false;
+        }
+        const bool is_lost =
+            hop % kLossPeriodHops >= kLossPeriodHops - kNumLostHops;
+        if (!is_lost && !decoder.SetEncodedPacket(encoded.value())) {
+          return false;
+        }
+        auto decoded = decoder.DecodeSamples(samples.size());
+        if (!decoded.has_value()) {
+          return false;
+        }
+        hash = HashSamples(decoded.value(), hash);
+        return true;
+      });
+  if (!num_hops.has_value()) {
+    return std::nullopt;
+  }
+  return hash;
+}
+
+TEST(LyraGoldenOutputTest, DecodedOutputMatchesGoldenHashes) {
+  const auto golden_hashes = ReadGoldenHashes(GetGoldenHashesPath());
+  ASSERT_TRUE(golden_hashes.has_value());
+
+  std::string measured_hashes = "# sample_rate_hz quality_preset hash\n";
+  for (const int sample_rate_hz : kTestdataSampleRatesHz) {
+    for (int quality_preset = 1; quality_preset <= kNumQualityPresets;
+         ++quality_preset) {
+      const auto hash = Measure(sample_rate_hz, quality_preset);
+      ASSERT_TRUE(hash.has_value());
+      absl::StrAppendFormat(&measured_hashes, "%d %d %016x\n", sample_rate_hz,
+                            quality_preset, hash.value());
+
+      // Fresh codecs must reproduce the output regardless of the golden file.
+      EXPECT_EQ(Measure(sample_rate_hz, quality_preset), hash)
+          << sample_rate_hz << " Hz, quality preset " << quality_preset
+          << " is not reproducible.";
+
+      const auto expected =
+          golden_hashes->find({sample_rate_hz, quality_preset});
+      if (expected == golden_hashes->end()) {
+        ADD_FAILURE() << "No golden hash for " << sample_rate_hz
+                      << " Hz at quality preset " << quality_preset << " in "
+                      << GetGoldenHashesPath()
+                      << ". Record it on the reference machine from the "
+                         "measured hashes logged below.";
+        continue;
+      }
+      EXPECT_EQ(hash.value(), expected->second)
+          << sample_rate_hz << " Hz, quality preset " << quality_preset;
+    }
+  }
+  LOG(INFO) << "Measured hashes:\n" << measured_hashes;
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,178 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Encodes and decodes the testdata wav files at every sample rate and quality
+// preset, and fails if the real time factor or the 99th percentile frame time
+// regressed against a checked-in baseline by more than a threshold.
+//
+// The baseline is recorded on the reference machine class named in its
+// header; results on other machines are not comparable. Every configuration
+// has to have a baseline row, so a missing or incomplete baseline fails the
+// test instead of silently disabling the gate. The threshold and the
+// baseline can be overridden with
+//   bazel test :lyra_rtf_regression_test \
+//     --test_env=LYRA_RTF_REGRESSION_THRESHOLD=0.2 \
+//     --test_env=LYRA_RTF_BASELINE=testdata/rtf_baseline.txt
+// The measured results are logged in the baseline format, so a new baseline
+// can be created from the test log.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra_config.h"
+#include "lyra_decoder.h"
+#include "lyra_encoder.h"
+#include "testing/corpus_test_utils.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+constexpr absl::string_view kBaselinePath = "testdata/rtf_baseline.txt";
+// Allowed relative regression before the test fails.
+constexpr float kDefaultRegressionThreshold = 0.2f;
+
+struct RealTimeFactorResult {
+  // Time spent encoding and decoding divided by the duration of the audio.
+  float real_time_factor;
+  // 99th percentile of the time spent encoding and decoding a single frame.
+  int64_t p99_frame_microsecs;
+};
+
+float GetRegressionThreshold() {
+  const char* threshold_env = std::getenv("LYRA_RTF_REGRESSION_THRESHOLD");
+  float threshold;
+  if (threshold_env != nullptr && absl::SimpleAtof(threshold_env, &threshold)) {
+    return threshold;
+  }
+  return kDefaultRegressionThreshold;
+}
+
+ghc::filesystem::path GetBaselinePath() {
+  return GetCorpusTablePath("LYRA_RTF_BASELINE", kBaselinePath);
+}
+
+// Reads lines of the form
+//   <sample_rate_hz> <quality_preset> <real_time_factor> <p99_frame_us>
+std::optional<std::map<CorpusKey, RealTimeFactorResult>> ReadBaseline(
+    const ghc::filesystem::path& baseline_path) {
+  const auto table = ReadCorpusTable(baseline_path, /*num_values=*/2);
+  if (!table.has_value()) {
+    return std::nullopt;
+  }
+  std::map<CorpusKey, RealTimeFactorResult> baseline;
+  for (const auto& [key, values] : table.value()) {
+    RealTimeFactorResult result;
+    if (!absl::SimpleAtof(values[0], &result.real_time_factor) ||
+        !absl::SimpleAtoi(values[1], &result.p99_frame_microsecs)) {
+      LOG(ERROR) << "Could not parse baseline of " << key.first
+                 << " Hz at quality preset " << key.second << ".";
+      return std::nullopt;
+    }
+    baseline[key] = result;
+  }
+  return baseline;
+}
+
+// Returns the timings of encoding and decoding the corpus one frame at a
+// time.
+std::optional<RealTimeFactorResult> Measure(int sample_rate_hz,
+                                            int quality_preset) {
+  std::vector<absl::Duration> frame_timings;
+  const std::optional<int> num_hops = RunCorpus(
+      sample_rate_hz, quality_preset, /*deterministic=*/false,
+      [&frame_timings](int hop, absl::Span<const int16_t> samples,
+                       LyraEncoder& encoder, LyraDecoder& decoder) {
+        const absl::Time start = absl::Now();
+        auto encoded = encoder.Encode(samples);
+        if (!encoded.has_value() ||
+            !decoder.SetEncodedPacket(encoded.value()) ||
+            !decoder.DecodeSamples(samples.size()).has_value()) {
+          return false;
+        }
+        frame_timings.push_back(absl::Now() - start);
+        return true;
+      });
+  if (!num_hops.has_value() || frame_timings.empty()) {
+    return std::nullopt;
+  }
+  const absl::Duration audio_duration =
+      absl::Seconds(num_hops.value()) / GetFrameRate(sample_rate_hz);
+  absl::Duration total_time;
+  for (const absl::Duration timing : frame_timings) {
+    total_time += timing;
+  }
+  auto p99 = frame_timings.begin() + (frame_timings.size() * 99) / 100;
+  std::nth_element(frame_timings.begin(), p99, frame_timings.end());
+  return RealTimeFactorResult{
+      static_cast<float>(absl::FDivDuration(total_time, audio_duration)),
+      absl::ToInt64Microseconds(*p99)};
+}
+
+TEST(LyraRtfRegressionTest, NoRegressionAgainstBaseline) {
+  const auto baseline = ReadBaseline(GetBaselinePath());
+  ASSERT_TRUE(baseline.has_value());
+  const float threshold = GetRegressionThreshold();
+
+  // Warm up caches and lazily initialized state, which would otherwise be
+  // attributed to the first configuration.
+  ASSERT_TRUE(Measure(kTestdataSampleRatesHz[0], 1).has_value());
+
+  std::string measured_baseline =
+      "# sample_rate_hz quality_preset real_time_factor p99_frame_us\n";
+  for (const int sample_rate_hz : kTestdataSampleRatesHz) {
+    for (int quality_preset = 1; quality_preset <= kNumQualityPresets;
+         ++quality_preset) {
+      const auto result = Measure(sample_rate_hz, quality_preset);
+      ASSERT_TRUE(result.has_value());
+      absl::StrAppendFormat(&measured_baseline, "%d %d %.4f %d\n",
+                            sample_rate_hz, quality_preset,
+                            result->real_time_factor,
+                            result->p99_frame_microsecs);
+
+      const auto expected = baseline->find({sample_rate_hz, quality_preset});
+      if (expected == baseline->end()) {
+        ADD_FAILURE() << "No baseline for " << sample_rate_hz
+                      << " Hz at quality preset " << quality_preset << " in "
+                      << GetBaselinePath() << ".";
+        continue;
+      }
+      EXPECT_LE(result->real_time_factor,
+                expected->second.real_time_factor * (1.f + threshold))
+          << sample_rate_hz << " Hz, quality preset " << quality_preset;
+      EXPECT_LE(result->p99_frame_microsecs,
+                expected->second.p99_frame_microsecs * (1.f + threshold))
+          << sample_rate_hz << " Hz, quality preset " << quality_preset;
+    }
+  }
+  LOG(INFO) << "Measured results:\n" << measured_baseline;
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,43 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_NETWORK_IMPAIRMENT_MODEL_INTERFACE_H_
+#define LYRA_CODEC_NETWORK_IMPAIRMENT_MODEL_INTERFACE_H_
+
+#include <optional>
+
+#include "absl/time/time.h"
+
+namespace chromemedia {
+namespace codec {
+
+// An interface to simulate the delay, jitter, reordering and loss that packets
+// experience on a network.
+class NetworkImpairmentModelInterface {
+ public:
+  virtual ~NetworkImpairmentModelInterface() {}
+
+  // Sends the next packet of the stream at |send_time|, measured from the
+  // start of the stream. Returns the time the packet arrives, or nullopt if it
+  // is lost. Packets may arrive in a different order than they were sent.
+  virtual std::optional<absl::Duration> SendPacket(
+      absl::Duration send_time) = 0;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_NETWORK_IMPAIRMENT_MODEL_INTERFACE_H_
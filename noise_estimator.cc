@@ -26,6 +26,7 @@
 #include "absl/memory/memory.h"
 #include "absl/types/span.h"
 #include "audio/dsp/signal_vector_util.h"
+#include "dsp_kernels.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "log_mel_spectrogram_extractor_impl.h"
 
@@ -63,6 +64,7 @@ void UpdateMinAndTemp(uint64_t num_hops_received,
   }
 }
 
+// Places in |smoothing_factor| the smoothing factor per frequency band.
 // The smoothing factor weighs how much the smoothed power calculation should
 // track the current power in a frequency band at a given hop and takes
 // values on the interval (0, |max_smoothing|].
@@ -71,10 +73,11 @@ void UpdateMinAndTemp(uint64_t num_hops_received,
 // Values closer to 0 indicate smoothed_power should take on the current
 // power level at this frequency bin (when there is speech in this
 // frequency bin).
-std::vector<float> SmoothingFactor(float max_smoothing,
-                                   const std::vector<float>& current_power_db,
-                                   const std::vector<float>& smoothed_power,
-                                   const std::vector<float>& noise_estimate) {
+void SmoothingFactor(float max_smoothing,
+                     const std::vector<float>& current_power_db,
+                     const std::vector<float>& smoothed_power,
+                     const std::vector<float>& noise_estimate,
+                     std::vector<float>* smoothing_factor) {
   constexpr float kPowDiff = 0.3f;
   // The smoothing correction factor approaches 0 as the current power value
   // moves away from the previously calculated smoothed power, and is 1 when
@@ -82,24 +85,27 @@ std::vector<float> SmoothingFactor(float max_smoothing,
   float smoothing_correction = std::exp(-audio_dsp::Square(
       (Average(smoothed_power) - Average(current_power_db)) / kPowDiff));
 
-  std::vector<float> smoothing_factor(noise_estimate.size());
   for (int i = 0; i < smoothed_power.size(); ++i) {
-    smoothing_factor.at(i) =
+    smoothing_factor->at(i) =
         max_smoothing * smoothing_correction *
         std::exp(-audio_dsp::Square(
             (smoothed_power.at(i) - noise_estimate.at(i)) / kPowDiff));
   }
-
-  return smoothing_factor;
 }
 
 }  // namespace
 
 std::unique_ptr<NoiseEstimator> NoiseEstimator::Create(
     int sample_rate_hz, int num_samples_per_hop, int num_samples_per_window,
-    int num_features) {
-  const float kNumSecondsPerHop =
-      static_cast<float>(num_samples_per_hop) / sample_rate_hz;
+    int num_features, int num_hops_per_estimate) {
+  if (num_hops_per_estimate < 1) {
+    LOG(ERROR) << "Number of hops per noise estimate must be at least 1 but "
+               << num_hops_per_estimate << " was requested.";
+    return nullptr;
+  }
+  // The estimator state evolves once per estimate rather than once per hop.
+  const float kNumSecondsPerEstimate = static_cast<float>(
+      num_hops_per_estimate * num_samples_per_hop) / sample_rate_hz;
 
   auto log_mel_spectrogram_extractor = LogMelSpectrogramExtractorImpl::Create(
       sample_rate_hz, num_samples_per_hop, num_samples_per_window,
@@ -113,31 +119,38 @@ std::unique_ptr<NoiseEstimator> NoiseEstimator::Create(
   const float kMaxSmoothingHalflifeSecs = 0.7f;
   const float kUpdateTimeSecs = 1.f;
   const float kBoundHalfLifeSecs = 1.f;
+  const int num_estimates_per_update = std::max(
+      1, static_cast<int>(
+             std::round(kUpdateTimeSecs / kNumSecondsPerEstimate)));
   return absl::WrapUnique(new NoiseEstimator(
-      num_samples_per_hop, std::round(kUpdateTimeSecs / kNumSecondsPerHop),
-      num_features,
-      std::pow(0.5f, kNumSecondsPerHop / kMaxSmoothingHalflifeSecs),
-      std::pow(0.5f, kNumSecondsPerHop / kBoundHalfLifeSecs),
-      std::move(log_mel_spectrogram_extractor)));
+      num_samples_per_hop, num_estimates_per_update, num_features,
+      std::pow(0.5f, kNumSecondsPerEstimate / kMaxSmoothingHalflifeSecs),
+      std::pow(0.5f, kNumSecondsPerEstimate / kBoundHalfLifeSecs),
+      num_hops_per_estimate, std::move(log_mel_spectrogram_extractor)));
 }
 
 NoiseEstimator::NoiseEstimator(int num_samples_per_hop, int num_hops_per_update,
                                int num_features, float max_smoothing,
                                float bound_decay_factor,
+                               int num_hops_per_estimate,
                                std::unique_ptr<LogMelSpectrogramExtractorImpl>
                                    log_mel_spectrogram_extractor)
     : num_samples_per_hop_(num_samples_per_hop),
       num_hops_per_update_(num_hops_per_update),
       max_smoothing_(max_smoothing),
       bound_decay_factor_(bound_decay_factor),
+      num_hops_per_estimate_(num_hops_per_estimate),
       squared_smoothed_power_(num_features),
       tmp_min_smoothed_power_(num_features),
       noise_estimate_(num_features, 0.f),
       noise_bound_(num_features, 0.f),
+      smoothing_factor_(num_features),
+      squared_power_db_(num_features),
       past_samples_hop_(num_samples_per_hop),
       is_noise_(true),
       num_hops_received_(0),
       next_sample_in_hop_(0),
+      num_hops_until_estimate_(num_hops_per_estimate - 1),
       log_mel_spectrogram_extractor_(std::move(log_mel_spectrogram_extractor)) {
 }
 
@@ -156,12 +169,25 @@ bool NoiseEstimator::ReceiveSamples(const absl::Span<const int16_t> samples) {
   // noise estimator.
   if (next_sample_in_hop_ == num_samples_per_hop_) {
     next_sample_in_hop_ = 0;
+    // Hops more than one away from the next estimate are dropped without
+    // touching the extractor.
+    if (num_hops_until_estimate_ > 1) {
+      --num_hops_until_estimate_;
+      return true;
+    }
     auto log_mel_spectrogram = log_mel_spectrogram_extractor_->Extract(
         absl::MakeConstSpan(past_samples_hop_));
     if (!log_mel_spectrogram.has_value()) {
       LOG(ERROR) << "Unable to extract features from decoded audio.";
       return false;
     }
+    // The hop right before an estimate only fills the extractor's window so
+    // that the estimate is computed from contiguous audio.
+    if (num_hops_until_estimate_ == 1) {
+      --num_hops_until_estimate_;
+      return true;
+    }
+    num_hops_until_estimate_ = num_hops_per_estimate_ - 1;
     is_noise_ = ComputeIsNoise(log_mel_spectrogram.value());
     if (is_noise_) {
       DecayBounds();
@@ -184,20 +210,22 @@ void NoiseEstimator::UpdateNoiseEstimate(
     tmp_min_smoothed_power_ = current_power_db;
   }
 
-  std::vector<float> smoothing_factor = SmoothingFactor(
-      max_smoothing_, current_power_db, smoothed_power_, noise_estimate_);
+  SmoothingFactor(max_smoothing_, current_power_db, smoothed_power_,
+                  noise_estimate_, &smoothing_factor_);
   // |smoothed_power_| per frequency band =
   //     |smoothing_factor| * |smoothed_power_| +
   //     (1 - |smoothing_factor|) * |current_power_db|.
-  for (int i = 0; i < smoothed_power_.size(); ++i) {
-    smoothed_power_.at(i) =
-        smoothing_factor.at(i) * smoothed_power_.at(i) +
-        (1.f - smoothing_factor.at(i)) * current_power_db.at(i);
-    squared_smoothed_power_.at(i) =
-        smoothing_factor.at(i) * squared_smoothed_power_.at(i) +
-        (1.f - smoothing_factor.at(i)) *
-            audio_dsp::Square(current_power_db.at(i));
+  // The same holds for |squared_smoothed_power_| and squared powers.
+  for (int i = 0; i < current_power_db.size(); ++i) {
+    squared_power_db_.at(i) = audio_dsp::Square(current_power_db.at(i));
   }
+  const DspKernels& kernels = GetDspKernels();
+  kernels.crossfade(smoothed_power_.data(), current_power_db.data(),
+                    smoothing_factor_.data(), smoothed_power_.size(),
+                    smoothed_power_.data());
+  kernels.crossfade(squared_smoothed_power_.data(), squared_power_db_.data(),
+                    smoothing_factor_.data(), squared_smoothed_power_.size(),
+                    squared_smoothed_power_.data());
 
   UpdateMinAndTemp(num_hops_received_, smoothed_power_, &noise_estimate_,
                    &tmp_min_smoothed_power_);
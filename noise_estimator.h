@@ -33,10 +33,18 @@ namespace codec {
 // minimum statistics estimation in the log frequency domain.
 class NoiseEstimator : public NoiseEstimatorInterface {
  public:
+  // |num_hops_per_estimate| trades estimate accuracy for CPU: the noise
+  // estimate is only updated once every that many hops, and the log mel
+  // spectrogram is only extracted on the update hop and the hop right before
+  // it. Time constants are scaled so that the estimate tracks noise at the
+  // same rate in seconds. A value of 1 updates the estimate on every hop.
+  // A value of 2 still extracts on every hop, so only values of 3 and above
+  // save CPU.
   static std::unique_ptr<NoiseEstimator> Create(int sample_rate_hz,
                                                 int num_samples_per_hop,
                                                 int num_samples_per_window,
-                                                int num_features);
+                                                int num_features,
+                                                int num_hops_per_estimate = 1);
 
   // Buffers samples until a log mel spectrogram can be extracted.
   // If the latest log mel spectrogram extracted is different enough from the
@@ -50,14 +58,14 @@ class NoiseEstimator : public NoiseEstimatorInterface {
   // log mel spectrogram from |ReceiveSamples|.
   std::vector<float> noise_estimate() const override;
 
-  // Returns whether the last log mel spectrogram extracted from
-  // |ReceiveSamples| is noise.
+  // Returns whether the last log mel spectrogram used to update the estimate
+  // in |ReceiveSamples| is noise.
   bool is_noise() const override;
 
  private:
   NoiseEstimator(int num_samples_per_hop, int num_hops_per_update,
                  int num_features, float max_smoothing,
-                 float bound_decay_factor,
+                 float bound_decay_factor, int num_hops_per_estimate,
                  std::unique_ptr<LogMelSpectrogramExtractorImpl>
                      log_mel_spectrogram_extractor);
 
@@ -79,16 +87,23 @@ class NoiseEstimator : public NoiseEstimatorInterface {
   const int num_hops_per_update_;
   const float max_smoothing_;
   const float bound_decay_factor_;
+  const int num_hops_per_estimate_;
   std::vector<float> smoothed_power_;
   std::vector<float> squared_smoothed_power_;
   std::vector<float> tmp_min_smoothed_power_;
   std::vector<float> noise_estimate_;
   std::vector<float> noise_bound_;
+  // Scratch buffers for the smoothing factor and the squared power of the
+  // current hop, allocated once so that |UpdateNoiseEstimate| does not
+  // allocate on every hop.
+  std::vector<float> smoothing_factor_;
+  std::vector<float> squared_power_db_;
   std::vector<int16_t> past_samples_hop_;
 
   bool is_noise_;
   int num_hops_received_;
   int next_sample_in_hop_;
+  int num_hops_until_estimate_;
 
   std::unique_ptr<LogMelSpectrogramExtractorImpl>
       log_mel_spectrogram_extractor_;
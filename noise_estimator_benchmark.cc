@@ -0,0 +1,54 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "absl/types/span.h"
+#include "benchmark/benchmark.h"
+#include "lyra_config.h"
+#include "noise_estimator.h"
+
+static constexpr int kNumSamplesPerHop = 320;
+static constexpr int kNumSamplesPerWindow = 640;
+static constexpr int kNumMelBins = 160;
+
+// Measures the cost per hop of tracking noise, updating the estimate once
+// every |state.range(0)| hops.
+void BM_ReceiveSamples(benchmark::State& state) {
+  auto noise_estimator = chromemedia::codec::NoiseEstimator::Create(
+      chromemedia::codec::kInternalSampleRateHz, kNumSamplesPerHop,
+      kNumSamplesPerWindow, kNumMelBins, state.range(0));
+  // We create random audio vectors to avoid any caching in the benchmark.
+  const int num_rand_vectors = 1000;
+  absl::BitGen gen;
+  std::vector<std::vector<int16_t>> audio_vec(
+      num_rand_vectors, std::vector<int16_t>(kNumSamplesPerHop));
+  for (auto& audio : audio_vec) {
+    for (auto& sample : audio) {
+      sample = absl::Uniform<uint16_t>(gen);
+    }
+  }
+
+  int hop = 0;
+  for (auto _ : state) {
+    noise_estimator->ReceiveSamples(absl::MakeConstSpan(audio_vec[hop]));
+    hop = (hop + 1) % num_rand_vectors;
+  }
+}
+
+BENCHMARK(BM_ReceiveSamples)->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+BENCHMARK_MAIN();
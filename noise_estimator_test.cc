@@ -41,6 +41,7 @@ class NoiseEstimatorPeer {
                                   log_mel_spectrogram_extractor)
       : noise_estimator_(num_samples_per_hop, num_hops_per_update, num_features,
                          max_smoothing, bound_decay_factor,
+                         /*num_hops_per_estimate=*/1,
                          std::move(log_mel_spectrogram_extractor)) {}
 
   void UpdateNoiseEstimate(const std::vector<float>& current_power_db) {
@@ -148,6 +149,42 @@ TEST_F(NoiseEstimatorTest, FiveSecondsSparseEnergy) {
   EXPECT_LT(spectral_distance.value(), 0.7f);
 }
 
+// Subsampling must track the noise as closely as updating on every hop.
+TEST_F(NoiseEstimatorTest, FiveSecondsSparseEnergySubsampled) {
+  for (const int num_hops_per_estimate : {2, 4, 8}) {
+    auto noise_generator = ComfortNoiseGenerator::Create(
+        kInternalSampleRateHz, kTestNumSamplesPerHop, kTestNumSamplesPerWindow,
+        kTestNumFeatures);
+    ASSERT_NE(noise_generator, nullptr);
+    auto subsampled_noise_estimator = NoiseEstimator::Create(
+        kInternalSampleRateHz, kTestNumSamplesPerHop, kTestNumSamplesPerWindow,
+        kTestNumFeatures, num_hops_per_estimate);
+    ASSERT_NE(subsampled_noise_estimator, nullptr);
+    const std::vector<float> base_noise = BaseNoise();
+    std::vector<int16_t> samples;
+
+    for (int i = 0; i < kTestNumHops; ++i) {
+      const std::vector<float> sparse_energy_noise =
+          CreateNoiseWithSparsePower(base_noise);
+      GenerateSamples(sparse_energy_noise, *noise_generator, &samples);
+      ASSERT_TRUE(subsampled_noise_estimator->ReceiveSamples(samples));
+    }
+
+    auto spectral_distance = LogSpectralDistance(
+        base_noise, subsampled_noise_estimator->noise_estimate());
+    ASSERT_TRUE(spectral_distance.has_value());
+    EXPECT_LT(spectral_distance.value(), 0.7f)
+        << "num_hops_per_estimate=" << num_hops_per_estimate;
+  }
+}
+
+TEST_F(NoiseEstimatorTest, InvalidNumHopsPerEstimate) {
+  EXPECT_EQ(NoiseEstimator::Create(kInternalSampleRateHz, kTestNumSamplesPerHop,
+                                   kTestNumSamplesPerWindow, kTestNumFeatures,
+                                   /*num_hops_per_estimate=*/0),
+            nullptr);
+}
+
 TEST_F(NoiseEstimatorTest, FiveSecondsSilence) {
   auto noise_generator = ComfortNoiseGenerator::Create(
       kInternalSampleRateHz, kTestNumSamplesPerHop, kTestNumSamplesPerWindow,
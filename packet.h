@@ -61,13 +61,28 @@ class Packet : public PacketInterface {
 
   std::optional<std::string> UnpackPacket(
       const absl::Span<const uint8_t> packet) override {
+    std::string quantized;
+    if (!UnpackPacketInto(packet, &quantized)) {
+      return std::nullopt;
+    }
+    return quantized;
+  }
+
+  bool UnpackPacketInto(const absl::Span<const uint8_t> packet,
+                        std::string* quantized) override {
     if (packet.length() != PacketSize()) {
       LOG(ERROR) << "Packet of unexpected length: " << packet.length();
-      return std::nullopt;
+      return false;
+    }
+    const std::bitset<MaxNumPacketBits> quantized_features =
+        UnpackFeatures(packet);
+    // Most significant bit first, like std::bitset::to_string().
+    quantized->resize(num_quantized_bits_);
+    for (int i = 0; i < num_quantized_bits_; ++i) {
+      (*quantized)[i] =
+          quantized_features[num_quantized_bits_ - 1 - i] ? '1' : '0';
     }
-    std::bitset<MaxNumPacketBits> quantized_features = UnpackFeatures(packet);
-    return quantized_features.to_string().substr(MaxNumPacketBits -
-                                                 num_quantized_bits_);
+    return true;
   }
 
   int PacketSize() const override {
@@ -0,0 +1,184 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "packet_aggregator.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "lyra_config.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+constexpr uint8_t kDtxCode = 0;
+constexpr uint8_t kExplicitSizeCode = 15;
+constexpr int kNumCodeBits = 4;
+constexpr int kNumCodesPerByte = 2;
+
+static_assert(kNumQualityPresets < kExplicitSizeCode,
+              "Quality presets do not fit into the table of contents.");
+
+int GetNumCodeBytes(int num_frames) {
+  return (num_frames + kNumCodesPerByte - 1) / kNumCodesPerByte;
+}
+
+// Returns the table of contents code of a packet of |packet_size| bytes.
+uint8_t GetCode(int packet_size) {
+  if (packet_size == 0) {
+    return kDtxCode;
+  }
+  for (int quality_preset = 1; quality_preset <= kNumQualityPresets;
+       ++quality_preset) {
+    if (packet_size ==
+        GetPacketSize(QualityPresetToNumQuantizedBits(quality_preset))) {
+      return quality_preset;
+    }
+  }
+  return kExplicitSizeCode;
+}
+
+}  // namespace
+
+std::unique_ptr<PacketAggregator> PacketAggregator::Create(
+    int num_frames_per_payload) {
+  if (num_frames_per_payload < 1 ||
+      num_frames_per_payload > kMaxNumFramesPerPayload) {
+    LOG(ERROR) << "Number of frames per payload has to be in [1, "
+               << kMaxNumFramesPerPayload << "], but is "
+               << num_frames_per_payload << ".";
+    return nullptr;
+  }
+  return absl::WrapUnique(new PacketAggregator(num_frames_per_payload));
+}
+
+PacketAggregator::PacketAggregator(int num_frames_per_payload)
+    : num_frames_per_payload_(num_frames_per_payload) {
+  codes_.reserve(num_frames_per_payload_);
+  const int max_packet_size =
+      GetPacketSize(QualityPresetToNumQuantizedBits(kNumQualityPresets));
+  packets_.reserve(num_frames_per_payload_ * max_packet_size);
+}
+
+bool PacketAggregator::AddPacket(absl::Span<const uint8_t> packet) {
+  if (IsPayloadComplete()) {
+    LOG(ERROR) << "Payload already holds " << num_frames_per_payload_
+               << " frames.";
+    return false;
+  }
+  const uint8_t code = GetCode(packet.size());
+  if (code == kExplicitSizeCode) {
+    if (packet.size() > std::numeric_limits<uint8_t>::max()) {
+      LOG(ERROR) << "Packet of " << packet.size()
+                 << " bytes is too long to be aggregated.";
+      return false;
+    }
+    explicit_sizes_.push_back(static_cast<uint8_t>(packet.size()));
+  }
+  codes_.push_back(code);
+  packets_.insert(packets_.end(), packet.begin(), packet.end());
+  return true;
+}
+
+bool PacketAggregator::IsPayloadComplete() const {
+  return codes_.size() == num_frames_per_payload_;
+}
+
+std::vector<uint8_t> PacketAggregator::TakePayload() {
+  std::vector<uint8_t> payload;
+  if (codes_.empty()) {
+    return payload;
+  }
+  const int num_code_bytes = GetNumCodeBytes(codes_.size());
+  payload.reserve(1 + num_code_bytes + explicit_sizes_.size() +
+                  packets_.size());
+  payload.push_back(static_cast<uint8_t>(codes_.size()));
+  payload.resize(1 + num_code_bytes, 0);
+  for (int i = 0; i < codes_.size(); ++i) {
+    const int shift = (i % kNumCodesPerByte == 0) ? kNumCodeBits : 0;
+    payload[1 + i / kNumCodesPerByte] |= codes_[i] << shift;
+  }
+  payload.insert(payload.end(), explicit_sizes_.begin(),
+                 explicit_sizes_.end());
+  payload.insert(payload.end(), packets_.begin(), packets_.end());
+
+  codes_.clear();
+  explicit_sizes_.clear();
+  packets_.clear();
+  return payload;
+}
+
+std::optional<std::vector<absl::Span<const uint8_t>>> SplitAggregatedPayload(
+    absl::Span<const uint8_t> payload) {
+  if (payload.empty() || payload[0] == 0) {
+    LOG(ERROR) << "Aggregated payload holds no frames.";
+    return std::nullopt;
+  }
+  const int num_frames = payload[0];
+  int index = 1 + GetNumCodeBytes(num_frames);
+  if (index > payload.size()) {
+    LOG(ERROR) << "Aggregated payload is shorter than its table of contents.";
+    return std::nullopt;
+  }
+
+  std::vector<int> packet_sizes(num_frames);
+  for (int i = 0; i < num_frames; ++i) {
+    const int shift = (i % kNumCodesPerByte == 0) ? kNumCodeBits : 0;
+    const uint8_t code =
+        (payload[1 + i / kNumCodesPerByte] >> shift) & kExplicitSizeCode;
+    if (code == kDtxCode) {
+      packet_sizes[i] = 0;
+    } else if (code <= kNumQualityPresets) {
+      packet_sizes[i] = GetPacketSize(QualityPresetToNumQuantizedBits(code));
+    } else if (code == kExplicitSizeCode) {
+      if (index >= payload.size()) {
+        LOG(ERROR) << "Aggregated payload is missing the size of frame " << i
+                   << ".";
+        return std::nullopt;
+      }
+      packet_sizes[i] = payload[index++];
+    } else {
+      LOG(ERROR) << "Unknown code " << static_cast<int>(code) << " of frame "
+                 << i << ".";
+      return std::nullopt;
+    }
+  }
+
+  std::vector<absl::Span<const uint8_t>> packets;
+  packets.reserve(num_frames);
+  for (int packet_size : packet_sizes) {
+    if (index + packet_size > payload.size()) {
+      LOG(ERROR) << "Aggregated payload is truncated.";
+      return std::nullopt;
+    }
+    packets.push_back(payload.subspan(index, packet_size));
+    index += packet_size;
+  }
+  if (index != payload.size()) {
+    LOG(ERROR) << "Aggregated payload has " << payload.size() - index
+               << " trailing bytes.";
+    return std::nullopt;
+  }
+  return packets;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
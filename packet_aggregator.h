@@ -0,0 +1,84 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_PACKET_AGGREGATOR_H_
+#define LYRA_CODEC_PACKET_AGGREGATOR_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/types/span.h"
+
+namespace chromemedia {
+namespace codec {
+
+// Bundles the packets of consecutive frames into one transport payload, so
+// the per-packet overhead of the transport is paid once per bundle.
+//
+// A payload starts with the number of frames, followed by a table of contents
+// with one 4-bit code per frame, two codes per byte with the first frame in
+// the high nibble. Code 0 marks a frame which was not sent because of DTX, and
+// codes 1 to kNumQualityPresets a plain packet of that quality preset. Any
+// other packet, e.g. one with redundancy, has code 15 and its size in a byte
+// after the table. The packets follow in frame order.
+class PacketAggregator {
+ public:
+  static constexpr int kMaxNumFramesPerPayload = 255;
+
+  // Returns nullptr if |num_frames_per_payload| is not in
+  // [1, kMaxNumFramesPerPayload].
+  static std::unique_ptr<PacketAggregator> Create(int num_frames_per_payload);
+
+  // Adds the packet of the next frame. An empty packet marks a frame which was
+  // not sent because of DTX. Returns false if the payload is already complete
+  // or the packet is too long to be described by the table of contents.
+  bool AddPacket(absl::Span<const uint8_t> packet);
+
+  // Returns true once |num_frames_per_payload| packets have been added.
+  bool IsPayloadComplete() const;
+
+  // Returns the payload of the packets added so far and starts a new one. May
+  // be called before the payload is complete to flush the last frames of a
+  // stream. Returns an empty vector if no packet has been added.
+  std::vector<uint8_t> TakePayload();
+
+  int num_frames_per_payload() const { return num_frames_per_payload_; }
+
+ private:
+  explicit PacketAggregator(int num_frames_per_payload);
+
+  const int num_frames_per_payload_;
+  // Table of contents code of each frame added so far.
+  std::vector<uint8_t> codes_;
+  // Sizes of the packets with an explicit size.
+  std::vector<uint8_t> explicit_sizes_;
+  // Packets added so far, back to back.
+  std::vector<uint8_t> packets_;
+};
+
+// Splits |payload| into the packets of its frames, which point into |payload|,
+// so each can be passed to LyraDecoder::SetEncodedPacket() in order. Empty
+// packets are frames which were not sent because of DTX and have to be decoded
+// without setting a packet. Returns nullopt if |payload| is malformed.
+std::optional<std::vector<absl::Span<const uint8_t>>> SplitAggregatedPayload(
+    absl::Span<const uint8_t> payload);
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_PACKET_AGGREGATOR_H_
@@ -0,0 +1,81 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the transport cost of aggregating several frames into one payload.
+// Every frame is encoded at a random quality preset, so the table of contents
+// has to describe a mix of packet sizes.
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/random/random.h"
+#include "benchmark/benchmark.h"
+#include "lyra_config.h"
+#include "packet_aggregator.h"
+
+static constexpr int kSampleRateHz = 48000;
+static constexpr int kNumRandomPackets = 120;
+// Size of the IPv4, UDP and RTP headers which are sent with every payload.
+static constexpr int kNumTransportHeaderBytes = 20 + 8 + 12;
+
+void BM_AggregatePackets(benchmark::State& state) {
+  const int num_frames_per_payload = state.range(0);
+  auto aggregator =
+      chromemedia::codec::PacketAggregator::Create(num_frames_per_payload);
+  if (aggregator == nullptr) {
+    state.SkipWithError("Could not create packet aggregator.");
+    return;
+  }
+  absl::BitGen gen;
+  std::vector<std::vector<uint8_t>> packets(kNumRandomPackets);
+  for (auto& packet : packets) {
+    const int quality_preset = absl::Uniform<int>(
+        absl::IntervalClosed, gen, 1, chromemedia::codec::kNumQualityPresets);
+    packet.resize(chromemedia::codec::GetPacketSize(
+        chromemedia::codec::QualityPresetToNumQuantizedBits(quality_preset)));
+    for (auto& byte : packet) {
+      byte = absl::Uniform<uint8_t>(gen);
+    }
+  }
+
+  int packet_index = 0;
+  int64_t num_frames = 0;
+  int64_t num_payloads = 0;
+  int64_t num_wire_bytes = 0;
+  for (auto _ : state) {
+    aggregator->AddPacket(packets.at(packet_index));
+    packet_index = (packet_index + 1) % kNumRandomPackets;
+    ++num_frames;
+    if (aggregator->IsPayloadComplete()) {
+      const std::vector<uint8_t> payload = aggregator->TakePayload();
+      const auto split = chromemedia::codec::SplitAggregatedPayload(payload);
+      benchmark::DoNotOptimize(split);
+      ++num_payloads;
+      num_wire_bytes += payload.size() + kNumTransportHeaderBytes;
+    }
+  }
+
+  // Packets and bytes which are sent per second of audio.
+  const double frame_rate = chromemedia::codec::GetFrameRate(kSampleRateHz);
+  state.counters["packets_per_second"] =
+      frame_rate / num_frames_per_payload;
+  if (num_payloads > 0) {
+    state.counters["wire_bytes_per_second"] =
+        frame_rate * num_wire_bytes / (num_payloads * num_frames_per_payload);
+  }
+}
+
+BENCHMARK(BM_AggregatePackets)->RangeMultiplier(2)->Range(1, 16);
+BENCHMARK_MAIN();
@@ -0,0 +1,128 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "packet_aggregator.h"
+
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lyra_config.h"
+#include "redundant_packet.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+using testing::ElementsAreArray;
+
+std::vector<uint8_t> MakePacket(int num_bytes, uint8_t first_byte) {
+  std::vector<uint8_t> packet(num_bytes);
+  std::iota(packet.begin(), packet.end(), first_byte);
+  return packet;
+}
+
+TEST(PacketAggregatorTest, CreateFailsForInvalidNumFrames) {
+  EXPECT_EQ(PacketAggregator::Create(0), nullptr);
+  EXPECT_EQ(PacketAggregator::Create(PacketAggregator::kMaxNumFramesPerPayload +
+                                     1),
+            nullptr);
+}
+
+TEST(PacketAggregatorTest, MixedPacketsRoundTrip) {
+  const auto redundant_packet = AppendRedundancy(
+      MakePacket(GetPacketSize(kSupportedQuantizedBits[3]), 50),
+      MakePacket(GetPacketSize(kSupportedQuantizedBits[0]), 150));
+  ASSERT_TRUE(redundant_packet.has_value());
+  const std::vector<std::vector<uint8_t>> packets = {
+      MakePacket(GetPacketSize(kSupportedQuantizedBits[0]), 0),
+      MakePacket(GetPacketSize(kSupportedQuantizedBits[7]), 10),
+      {},
+      redundant_packet.value(),
+      MakePacket(GetPacketSize(kSupportedQuantizedBits[4]), 20),
+  };
+
+  auto aggregator = PacketAggregator::Create(packets.size());
+  ASSERT_NE(aggregator, nullptr);
+  for (const auto& packet : packets) {
+    EXPECT_FALSE(aggregator->IsPayloadComplete());
+    ASSERT_TRUE(aggregator->AddPacket(packet));
+  }
+  EXPECT_TRUE(aggregator->IsPayloadComplete());
+  EXPECT_FALSE(aggregator->AddPacket(packets[0]));
+
+  const std::vector<uint8_t> payload = aggregator->TakePayload();
+  // One byte for the number of frames, three for the table of contents and one
+  // for the size of the redundant packet.
+  int num_packet_bytes = 0;
+  for (const auto& packet : packets) {
+    num_packet_bytes += packet.size();
+  }
+  EXPECT_EQ(payload.size(), 1 + 3 + 1 + num_packet_bytes);
+  EXPECT_FALSE(aggregator->IsPayloadComplete());
+
+  const auto split = SplitAggregatedPayload(payload);
+  ASSERT_TRUE(split.has_value());
+  ASSERT_EQ(split->size(), packets.size());
+  for (int i = 0; i < packets.size(); ++i) {
+    EXPECT_THAT(split->at(i), ElementsAreArray(packets[i]));
+  }
+}
+
+TEST(PacketAggregatorTest, TakePayloadFlushesIncompletePayload) {
+  auto aggregator = PacketAggregator::Create(4);
+  ASSERT_NE(aggregator, nullptr);
+  EXPECT_TRUE(aggregator->TakePayload().empty());
+
+  const std::vector<uint8_t> packet =
+      MakePacket(GetPacketSize(kSupportedQuantizedBits[2]), 7);
+  ASSERT_TRUE(aggregator->AddPacket(packet));
+  const std::vector<uint8_t> payload = aggregator->TakePayload();
+  const auto split = SplitAggregatedPayload(payload);
+  ASSERT_TRUE(split.has_value());
+  ASSERT_EQ(split->size(), 1);
+  EXPECT_THAT(split->at(0), ElementsAreArray(packet));
+  EXPECT_TRUE(aggregator->TakePayload().empty());
+}
+
+TEST(PacketAggregatorTest, AddPacketFailsForTooLongPacket) {
+  auto aggregator = PacketAggregator::Create(2);
+  ASSERT_NE(aggregator, nullptr);
+  EXPECT_FALSE(aggregator->AddPacket(std::vector<uint8_t>(256)));
+}
+
+TEST(PacketAggregatorTest, SplitFailsForMalformedPayload) {
+  auto aggregator = PacketAggregator::Create(2);
+  ASSERT_NE(aggregator, nullptr);
+  ASSERT_TRUE(aggregator->AddPacket(
+      MakePacket(GetPacketSize(kSupportedQuantizedBits[1]), 0)));
+  ASSERT_TRUE(aggregator->AddPacket(MakePacket(3, 0)));
+  std::vector<uint8_t> payload = aggregator->TakePayload();
+  ASSERT_TRUE(SplitAggregatedPayload(payload).has_value());
+
+  EXPECT_FALSE(SplitAggregatedPayload({}).has_value());
+  EXPECT_FALSE(
+      SplitAggregatedPayload(std::vector<uint8_t>{0}).has_value());
+  EXPECT_FALSE(SplitAggregatedPayload(absl::MakeConstSpan(payload).first(
+                                          payload.size() - 1))
+                   .has_value());
+  payload.push_back(0);
+  EXPECT_FALSE(SplitAggregatedPayload(payload).has_value());
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,74 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "packet_framing.h"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+
+namespace chromemedia {
+namespace codec {
+
+bool AppendLengthPrefixedPacket(absl::Span<const uint8_t> packet,
+                                std::vector<uint8_t>* stream) {
+  if (packet.size() > std::numeric_limits<uint8_t>::max()) {
+    LOG(ERROR) << "Packet of " << packet.size()
+               << " bytes is too long to be length-prefixed.";
+    return false;
+  }
+  stream->push_back(static_cast<uint8_t>(packet.size()));
+  stream->insert(stream->end(), packet.begin(), packet.end());
+  return true;
+}
+
+std::optional<std::vector<absl::Span<const uint8_t>>>
+SplitLengthPrefixedPackets(absl::Span<const uint8_t> stream) {
+  std::vector<absl::Span<const uint8_t>> packets;
+  int index = 0;
+  while (index < stream.size()) {
+    const int packet_size = stream[index];
+    ++index;
+    if (index + packet_size > stream.size()) {
+      LOG(ERROR) << "Record at byte " << index - 1 << " is truncated: "
+                 << packet_size << " bytes expected, "
+                 << stream.size() - index << " available.";
+      return std::nullopt;
+    }
+    packets.push_back(stream.subspan(index, packet_size));
+    index += packet_size;
+  }
+  return packets;
+}
+
+std::vector<absl::Span<const uint8_t>> SplitFixedSizePackets(
+    absl::Span<const uint8_t> stream, int packet_size) {
+  std::vector<absl::Span<const uint8_t>> packets;
+  if (packet_size <= 0) {
+    return packets;
+  }
+  packets.reserve(stream.size() / packet_size);
+  for (int index = 0; index + packet_size <= stream.size();
+       index += packet_size) {
+    packets.push_back(stream.subspan(index, packet_size));
+  }
+  return packets;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_PACKET_FRAMING_H_
+#define LYRA_CODEC_PACKET_FRAMING_H_
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "absl/types/span.h"
+
+namespace chromemedia {
+namespace codec {
+
+// Encoded files are either a plain concatenation of packets of one fixed size,
+// or a sequence of length-prefixed records when the packet size changes from
+// frame to frame, as with variable bitrate encoding. Each record is one length
+// byte followed by that many packet bytes. Empty records mark frames which
+// were not transmitted because of DTX, so the stream keeps its timing.
+
+// Appends |packet| to |stream| as a length-prefixed record. Returns false if
+// the packet is too long for its length to fit into the prefix.
+bool AppendLengthPrefixedPacket(absl::Span<const uint8_t> packet,
+                                std::vector<uint8_t>* stream);
+
+// Splits a stream of length-prefixed records into packets, which point into
+// |stream|. Returns nullopt if the last record is truncated.
+std::optional<std::vector<absl::Span<const uint8_t>>>
+SplitLengthPrefixedPackets(absl::Span<const uint8_t> stream);
+
+// Splits a stream of concatenated packets of |packet_size| bytes into packets,
+// which point into |stream|. Excess bytes at the end are dropped.
+std::vector<absl::Span<const uint8_t>> SplitFixedSizePackets(
+    absl::Span<const uint8_t> stream, int packet_size);
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_PACKET_FRAMING_H_
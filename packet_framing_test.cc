@@ -0,0 +1,77 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "packet_framing.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+using testing::ElementsAre;
+using testing::ElementsAreArray;
+
+TEST(PacketFramingTest, LengthPrefixedPacketsRoundTrip) {
+  const std::vector<uint8_t> first = {1, 2, 3};
+  const std::vector<uint8_t> dtx = {};
+  const std::vector<uint8_t> second = {4, 5, 6, 7, 8};
+  std::vector<uint8_t> stream;
+  ASSERT_TRUE(AppendLengthPrefixedPacket(first, &stream));
+  ASSERT_TRUE(AppendLengthPrefixedPacket(dtx, &stream));
+  ASSERT_TRUE(AppendLengthPrefixedPacket(second, &stream));
+  EXPECT_THAT(stream, ElementsAre(3, 1, 2, 3, 0, 5, 4, 5, 6, 7, 8));
+
+  const auto packets = SplitLengthPrefixedPackets(stream);
+  ASSERT_TRUE(packets.has_value());
+  ASSERT_EQ(packets->size(), 3);
+  EXPECT_THAT(packets->at(0), ElementsAreArray(first));
+  EXPECT_TRUE(packets->at(1).empty());
+  EXPECT_THAT(packets->at(2), ElementsAreArray(second));
+}
+
+TEST(PacketFramingTest, TooLongPacketFails) {
+  const std::vector<uint8_t> packet(256);
+  std::vector<uint8_t> stream;
+  EXPECT_FALSE(AppendLengthPrefixedPacket(packet, &stream));
+  EXPECT_TRUE(stream.empty());
+}
+
+TEST(PacketFramingTest, TruncatedRecordFails) {
+  const std::vector<uint8_t> stream = {2, 1, 2, 3, 1};
+  EXPECT_FALSE(SplitLengthPrefixedPackets(stream).has_value());
+}
+
+TEST(PacketFramingTest, EmptyStreamHasNoPackets) {
+  const auto packets = SplitLengthPrefixedPackets({});
+  ASSERT_TRUE(packets.has_value());
+  EXPECT_TRUE(packets->empty());
+}
+
+TEST(PacketFramingTest, FixedSizePacketsDropExcessBytes) {
+  const std::vector<uint8_t> stream = {1, 2, 3, 4, 5, 6, 7};
+  const auto packets = SplitFixedSizePackets(stream, 3);
+  ASSERT_EQ(packets.size(), 2);
+  EXPECT_THAT(packets[0], ElementsAre(1, 2, 3));
+  EXPECT_THAT(packets[1], ElementsAre(4, 5, 6));
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
@@ -41,6 +41,12 @@ class PacketInterface {
   virtual std::optional<std::string> UnpackPacket(
       const absl::Span<const uint8_t> packet) = 0;
 
+  // Same as |UnpackPacket|, but writes the quantized bits into |quantized|,
+  // which does not allocate if its capacity suffices.
+  // Returns false if |packet| is invalid.
+  virtual bool UnpackPacketInto(const absl::Span<const uint8_t> packet,
+                                std::string* quantized) = 0;
+
   virtual int PacketSize() const = 0;
 };
 
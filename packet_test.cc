@@ -191,6 +191,27 @@ TEST_F(PacketTest, UnpackQuantizedBitsAlternatingOnesAndZeros) {
                                          kNumHeaderBits, kNumQuantizedBits));
 }
 
+TEST_F(PacketTest, UnpackIntoReusesCapacity) {
+  std::vector<uint8_t> encoded(kPacketSize, 0b10110001);
+  encoded[0] = 0b00000000;  // Zero out header.
+
+  auto packet =
+      Packet<kMaxNumPacketBits>::Create(kNumHeaderBits, kNumQuantizedBits);
+  ASSERT_NE(packet, nullptr);
+  std::string quantized;
+  quantized.reserve(kMaxNumPacketBits);
+  const char* const data = quantized.data();
+  ASSERT_TRUE(
+      packet->UnpackPacketInto(absl::MakeConstSpan(encoded), &quantized));
+  EXPECT_EQ(quantized.data(), data);
+  EXPECT_EQ(quantized,
+            packet->UnpackPacket(absl::MakeConstSpan(encoded)).value());
+  EXPECT_TRUE(DoesPacketContainQuantized(encoded, quantized, kNumHeaderBits,
+                                         kNumQuantizedBits));
+  EXPECT_FALSE(packet->UnpackPacketInto(
+      absl::MakeConstSpan(encoded).subspan(1), &quantized));
+}
+
 TEST_F(PacketTest, InvalidPacketSize) {
   std::vector<uint8_t> invalid_packet(kPacketSize - 1, 0b11111111);
   auto packet =
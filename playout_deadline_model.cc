@@ -0,0 +1,76 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "playout_deadline_model.h"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "absl/time/time.h"
+#include "network_impairment_model_interface.h"
+
+namespace chromemedia {
+namespace codec {
+
+PlayoutDeadlineModel::PlayoutDeadlineModel(
+    std::unique_ptr<NetworkImpairmentModelInterface> network_model,
+    absl::Duration frame_duration, absl::Duration playout_delay)
+    : network_model_(std::move(network_model)),
+      frame_duration_(frame_duration),
+      playout_delay_(playout_delay),
+      num_packets_(0),
+      num_lost_packets_(0),
+      num_late_packets_(0),
+      total_network_delay_(absl::ZeroDuration()),
+      max_network_delay_(absl::ZeroDuration()) {}
+
+bool PlayoutDeadlineModel::IsPacketReceived() {
+  const absl::Duration send_time = num_packets_ * frame_duration_;
+  ++num_packets_;
+  const std::optional<absl::Duration> arrival_time =
+      network_model_->SendPacket(send_time);
+  if (!arrival_time.has_value()) {
+    ++num_lost_packets_;
+    return false;
+  }
+  const absl::Duration network_delay = arrival_time.value() - send_time;
+  total_network_delay_ += network_delay;
+  max_network_delay_ = std::max(max_network_delay_, network_delay);
+  if (network_delay > playout_delay_) {
+    ++num_late_packets_;
+    return false;
+  }
+  return true;
+}
+
+float PlayoutDeadlineModel::concealment_rate() const {
+  if (num_packets_ == 0) {
+    return 0.f;
+  }
+  return static_cast<float>(num_lost_packets_ + num_late_packets_) /
+         num_packets_;
+}
+
+absl::Duration PlayoutDeadlineModel::mean_network_delay() const {
+  const int num_arrived_packets = num_packets_ - num_lost_packets_;
+  if (num_arrived_packets == 0) {
+    return absl::ZeroDuration();
+  }
+  return total_network_delay_ / num_arrived_packets;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
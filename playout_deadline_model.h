@@ -0,0 +1,82 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_PLAYOUT_DEADLINE_MODEL_H_
+#define LYRA_CODEC_PLAYOUT_DEADLINE_MODEL_H_
+
+#include <memory>
+
+#include "absl/time/time.h"
+#include "network_impairment_model_interface.h"
+#include "packet_loss_model_interface.h"
+
+namespace chromemedia {
+namespace codec {
+
+// Turns the arrival times of a network model into the received or concealed
+// decision of a receiver with a fixed playout delay.
+//
+// Packet i is sent at i * |frame_duration| and played out |playout_delay|
+// later. A packet that is lost, or that arrives after its playout time, has to
+// be concealed. Reordered packets which still arrive in time are played out
+// normally.
+class PlayoutDeadlineModel : public PacketLossModelInterface {
+ public:
+  PlayoutDeadlineModel(
+      std::unique_ptr<NetworkImpairmentModelInterface> network_model,
+      absl::Duration frame_duration, absl::Duration playout_delay);
+
+  // Returns true if the next packet is available at its playout time.
+  bool IsPacketReceived() override;
+
+  int num_packets() const { return num_packets_; }
+
+  int num_lost_packets() const { return num_lost_packets_; }
+
+  int num_late_packets() const { return num_late_packets_; }
+
+  // Fraction of packets that had to be concealed because they were lost or
+  // late.
+  float concealment_rate() const;
+
+  // Mean network delay of the packets that were not lost.
+  absl::Duration mean_network_delay() const;
+
+  absl::Duration max_network_delay() const { return max_network_delay_; }
+
+  // Delay from the start of a frame being captured until it is played out,
+  // which is one frame of packetization plus the playout delay. This follows
+  // from the constructor arguments alone, not from the simulated arrivals.
+  absl::Duration configured_latency() const {
+    return frame_duration_ + playout_delay_;
+  }
+
+ private:
+  const std::unique_ptr<NetworkImpairmentModelInterface> network_model_;
+  const absl::Duration frame_duration_;
+  const absl::Duration playout_delay_;
+
+  int num_packets_;
+  int num_lost_packets_;
+  int num_late_packets_;
+  absl::Duration total_network_delay_;
+  absl::Duration max_network_delay_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_PLAYOUT_DEADLINE_MODEL_H_
@@ -0,0 +1,63 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "playout_deadline_model.h"
+
+#include <memory>
+#include <utility>
+
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "trace_network_model.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+TEST(PlayoutDeadlineModelTest, ConcealsLostAndLatePackets) {
+  // Packets are sent every 20 ms. Packet 1 is lost, packet 2 arrives 70 ms
+  // after it was sent and packet 3 overtakes it.
+  auto network_model = TraceNetworkModel::CreateFromString(
+      "0 30\n"
+      "1 lost\n"
+      "2 110\n"
+      "3 80\n");
+  ASSERT_NE(nullptr, network_model);
+  PlayoutDeadlineModel model(std::move(network_model), absl::Milliseconds(20),
+                             absl::Milliseconds(60));
+
+  EXPECT_TRUE(model.IsPacketReceived());
+  EXPECT_FALSE(model.IsPacketReceived());
+  EXPECT_FALSE(model.IsPacketReceived());
+  EXPECT_TRUE(model.IsPacketReceived());
+
+  EXPECT_EQ(model.num_packets(), 4);
+  EXPECT_EQ(model.num_lost_packets(), 1);
+  EXPECT_EQ(model.num_late_packets(), 1);
+  EXPECT_FLOAT_EQ(model.concealment_rate(), 0.5f);
+  EXPECT_EQ(model.mean_network_delay(), absl::Milliseconds(40));
+  EXPECT_EQ(model.max_network_delay(), absl::Milliseconds(70));
+  EXPECT_EQ(model.configured_latency(), absl::Milliseconds(80));
+}
+
+TEST(PlayoutDeadlineModelTest, EmptyStatsAreZero) {
+  PlayoutDeadlineModel model(TraceNetworkModel::CreateFromString(""),
+                             absl::Milliseconds(20), absl::Milliseconds(60));
+  EXPECT_EQ(model.concealment_rate(), 0.f);
+  EXPECT_EQ(model.mean_network_delay(), absl::ZeroDuration());
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
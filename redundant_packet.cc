@@ -0,0 +1,136 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "redundant_packet.h"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "lyra_config.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+// Below this loss rate concealment is good enough.
+constexpr float kMinPacketLossRateForRedundancy = 0.02f;
+// Above this loss rate the larger copy is sent.
+constexpr float kMinPacketLossRateForMaxRedundancy = 0.1f;
+
+constexpr int kNumRedundancyLevelBytes = 1;
+
+constexpr bool IsPlainPacketSize(int packet_size) {
+  for (int num_quantized_bits : kSupportedQuantizedBits) {
+    if (packet_size == GetPacketSize(num_quantized_bits)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// A packet with redundancy must not be mistaken for a plain packet.
+constexpr bool AreRedundantPacketSizesUnambiguous() {
+  for (int num_quantized_bits : kSupportedQuantizedBits) {
+    for (int level = 1; level <= kMaxRedundancyLevel; ++level) {
+      if (IsPlainPacketSize(
+              GetPacketSize(num_quantized_bits) +
+              GetPacketSize(kSupportedQuantizedBits[level - 1]) +
+              kNumRedundancyLevelBytes)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static_assert(AreRedundantPacketSizesUnambiguous(),
+              "Packets with redundancy collide with plain packet sizes.");
+
+}  // namespace
+
+int RedundancyLevelToNumQuantizedBits(int redundancy_level) {
+  if (redundancy_level < 0 || redundancy_level > kMaxRedundancyLevel) {
+    return -1;
+  }
+  return redundancy_level == 0 ? 0
+                               : kSupportedQuantizedBits[redundancy_level - 1];
+}
+
+int GetMaxPacketSize() {
+  return GetPacketSize(kSupportedQuantizedBits[kNumQualityPresets - 1]) +
+         GetPacketSize(RedundancyLevelToNumQuantizedBits(kMaxRedundancyLevel)) +
+         kNumRedundancyLevelBytes;
+}
+
+int PacketLossRateToRedundancyLevel(float packet_loss_rate) {
+  if (packet_loss_rate < kMinPacketLossRateForRedundancy) {
+    return 0;
+  }
+  if (packet_loss_rate < kMinPacketLossRateForMaxRedundancy) {
+    return 1;
+  }
+  return kMaxRedundancyLevel;
+}
+
+std::optional<std::vector<uint8_t>> AppendRedundancy(
+    absl::Span<const uint8_t> primary, absl::Span<const uint8_t> redundant) {
+  for (int level = 1; level <= kMaxRedundancyLevel; ++level) {
+    if (redundant.size() ==
+        GetPacketSize(RedundancyLevelToNumQuantizedBits(level))) {
+      std::vector<uint8_t> packet;
+      packet.reserve(primary.size() + redundant.size() +
+                     kNumRedundancyLevelBytes);
+      packet.insert(packet.end(), primary.begin(), primary.end());
+      packet.insert(packet.end(), redundant.begin(), redundant.end());
+      packet.push_back(static_cast<uint8_t>(level));
+      return packet;
+    }
+  }
+  LOG(ERROR) << "Redundant copy of " << redundant.size()
+             << " bytes does not match any redundancy level.";
+  return std::nullopt;
+}
+
+std::optional<RedundantPacket> SplitRedundantPacket(
+    absl::Span<const uint8_t> packet) {
+  RedundantPacket redundant_packet;
+  if (IsPlainPacketSize(packet.size())) {
+    redundant_packet.primary = packet;
+    return redundant_packet;
+  }
+  if (packet.empty()) {
+    return std::nullopt;
+  }
+  const int level = packet.back();
+  const int num_redundant_bits = RedundancyLevelToNumQuantizedBits(level);
+  if (num_redundant_bits <= 0) {
+    return std::nullopt;
+  }
+  const int redundant_size = GetPacketSize(num_redundant_bits);
+  const int primary_size = static_cast<int>(packet.size()) - redundant_size -
+                           kNumRedundancyLevelBytes;
+  if (primary_size <= 0 || !IsPlainPacketSize(primary_size)) {
+    return std::nullopt;
+  }
+  redundant_packet.primary = packet.subspan(0, primary_size);
+  redundant_packet.redundant = packet.subspan(primary_size, redundant_size);
+  redundant_packet.num_redundant_bits = num_redundant_bits;
+  return redundant_packet;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
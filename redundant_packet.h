@@ -0,0 +1,75 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_REDUNDANT_PACKET_H_
+#define LYRA_CODEC_REDUNDANT_PACKET_H_
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "absl/types/span.h"
+
+namespace chromemedia {
+namespace codec {
+
+// In-band forward error correction. A packet may carry, after its own payload,
+// a low-rate copy of the previous frame: the first bits of that frame's
+// residual quantization, which form a valid quantization at one of the lowest
+// supported sizes. The copy is followed by one byte holding the redundancy
+// level, so a packet with redundancy never has the size of a plain packet.
+
+// The highest redundancy level. Level n carries the previous frame at the n-th
+// smallest supported number of quantized bits; level 0 carries nothing.
+inline constexpr int kMaxRedundancyLevel = 2;
+
+// Returns the number of quantized bits of the previous frame carried at
+// |redundancy_level|, or -1 if the level is not in [0, kMaxRedundancyLevel].
+int RedundancyLevelToNumQuantizedBits(int redundancy_level);
+
+// Returns the size of the largest packet, which carries a redundant copy at
+// the highest level.
+int GetMaxPacketSize();
+
+// Returns the redundancy level which suits a receiver that reports
+// |packet_loss_rate|. The copy is only worth its bits when packets are lost
+// regularly, and grows with the loss rate.
+int PacketLossRateToRedundancyLevel(float packet_loss_rate);
+
+// Returns the packet which carries |redundant| after |primary|, or nullopt if
+// |redundant| does not have the size of a redundancy level.
+std::optional<std::vector<uint8_t>> AppendRedundancy(
+    absl::Span<const uint8_t> primary, absl::Span<const uint8_t> redundant);
+
+struct RedundantPacket {
+  // Payload of the frame the packet was sent for.
+  absl::Span<const uint8_t> primary;
+  // Copy of the previous frame. Empty if the packet carries none.
+  absl::Span<const uint8_t> redundant;
+  // Number of quantized bits in |redundant|.
+  int num_redundant_bits = 0;
+};
+
+// Splits |packet| into its payload and redundant copy, which point into
+// |packet|. Plain packets are returned with an empty copy. Returns nullopt if
+// |packet| is neither a plain packet nor one with redundancy.
+std::optional<RedundantPacket> SplitRedundantPacket(
+    absl::Span<const uint8_t> packet);
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_REDUNDANT_PACKET_H_
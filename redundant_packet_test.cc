@@ -0,0 +1,88 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "redundant_packet.h"
+
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lyra_config.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+using testing::ElementsAreArray;
+
+TEST(RedundantPacketTest, RedundancyGrowsWithPacketLossRate) {
+  EXPECT_EQ(PacketLossRateToRedundancyLevel(0.f), 0);
+  EXPECT_EQ(PacketLossRateToRedundancyLevel(0.05f), 1);
+  EXPECT_EQ(PacketLossRateToRedundancyLevel(0.3f), kMaxRedundancyLevel);
+  EXPECT_EQ(RedundancyLevelToNumQuantizedBits(0), 0);
+  EXPECT_EQ(RedundancyLevelToNumQuantizedBits(1), kSupportedQuantizedBits[0]);
+  EXPECT_EQ(RedundancyLevelToNumQuantizedBits(kMaxRedundancyLevel + 1), -1);
+}
+
+TEST(RedundantPacketTest, PlainPacketHasNoRedundancy) {
+  const std::vector<uint8_t> packet(GetPacketSize(kSupportedQuantizedBits[2]));
+  const auto split = SplitRedundantPacket(packet);
+  ASSERT_TRUE(split.has_value());
+  EXPECT_EQ(split->primary.size(), packet.size());
+  EXPECT_TRUE(split->redundant.empty());
+  EXPECT_EQ(split->num_redundant_bits, 0);
+}
+
+TEST(RedundantPacketTest, RedundancyRoundTripsForEverySize) {
+  for (int num_quantized_bits : GetSupportedQuantizedBits()) {
+    for (int level = 1; level <= kMaxRedundancyLevel; ++level) {
+      std::vector<uint8_t> primary(GetPacketSize(num_quantized_bits));
+      std::iota(primary.begin(), primary.end(), 0);
+      const int num_redundant_bits = RedundancyLevelToNumQuantizedBits(level);
+      std::vector<uint8_t> redundant(GetPacketSize(num_redundant_bits));
+      std::iota(redundant.begin(), redundant.end(), 100);
+
+      const auto packet = AppendRedundancy(primary, redundant);
+      ASSERT_TRUE(packet.has_value());
+      const auto split = SplitRedundantPacket(packet.value());
+      ASSERT_TRUE(split.has_value());
+      EXPECT_THAT(split->primary, ElementsAreArray(primary));
+      EXPECT_THAT(split->redundant, ElementsAreArray(redundant));
+      EXPECT_EQ(split->num_redundant_bits, num_redundant_bits);
+    }
+  }
+}
+
+TEST(RedundantPacketTest, RedundancyOfUnsupportedSizeFails) {
+  const std::vector<uint8_t> primary(GetPacketSize(kSupportedQuantizedBits[0]));
+  const std::vector<uint8_t> redundant(3);
+  EXPECT_FALSE(AppendRedundancy(primary, redundant).has_value());
+}
+
+TEST(RedundantPacketTest, InvalidPacketsFail) {
+  EXPECT_FALSE(SplitRedundantPacket({}).has_value());
+  // The level byte does not match the size of the packet.
+  std::vector<uint8_t> packet(GetPacketSize(kSupportedQuantizedBits[0]) +
+                              GetPacketSize(kSupportedQuantizedBits[0]) + 1);
+  packet.back() = 2;
+  EXPECT_FALSE(SplitRedundantPacket(packet).has_value());
+  packet.back() = kMaxRedundancyLevel + 1;
+  EXPECT_FALSE(SplitRedundantPacket(packet).has_value());
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -65,6 +66,21 @@ std::vector<int16_t> Resampler::Resample(absl::Span<const int16_t> audio) {
   return ClipToInt16(absl::MakeConstSpan(output_floats));
 }
 
+std::vector<float> Resampler::Resample(absl::Span<const float> audio) {
+  // Both overloads share the delay line of |resampler_|, so the filter runs at
+  // the int16 scale of the other overload and callers may switch between them.
+  constexpr float kInt16Scale = -std::numeric_limits<int16_t>::min();
+  std::vector<float> input_floats(audio.size());
+  std::transform(audio.begin(), audio.end(), input_floats.begin(),
+                 [](float sample) { return sample * kInt16Scale; });
+  std::vector<float> output_floats;
+  resampler_.ProcessSamples(input_floats, &output_floats);
+  for (float& sample : output_floats) {
+    sample /= kInt16Scale;
+  }
+  return output_floats;
+}
+
 void Resampler::Reset() { resampler_.ResetFullyPrimed(); }
 
 int Resampler::input_sample_rate_hz() const { return input_sample_rate_hz_; }
@@ -39,6 +39,9 @@ class Resampler : public ResamplerInterface {
   // Resamples audio at |input_sample_rate_hz| to |target_sample_rate_hz|.
   std::vector<int16_t> Resample(absl::Span<const int16_t> audio) override;
 
+  // Same as above for float samples, which are returned unclipped.
+  std::vector<float> Resample(absl::Span<const float> audio) override;
+
   void Reset() override;
 
   int input_sample_rate_hz() const override;
@@ -31,6 +31,9 @@ class ResamplerInterface {
 
   virtual std::vector<int16_t> Resample(absl::Span<const int16_t> audio) = 0;
 
+  // Resamples float audio in [-1, 1] without rounding or clipping.
+  virtual std::vector<float> Resample(absl::Span<const float> audio) = 0;
+
   virtual void Reset() = 0;
 
   virtual int input_sample_rate_hz() const = 0;
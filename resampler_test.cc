@@ -94,5 +94,48 @@ TEST(ResamplerExtremeValuesTest, AlternatingExtremeValuesTest) {
   EXPECT_EQ(resampled.size(), GetNumSamplesPerHop(kOutputSampleRate));
 }
 
+// The float and int16 overloads share one delay line, so a stream may switch
+// between them without a transient.
+TEST(ResamplerTest, SwitchingBetweenFloatAndInt16IsSeamless) {
+  constexpr int kInputSampleRate = 16000;
+  constexpr int kOutputSampleRate = 48000;
+  constexpr int kNumHops = 6;
+  const int num_samples_per_hop = GetNumSamplesPerHop(kInputSampleRate);
+  std::vector<double> doubles_samples;
+  audio_dsp::ComputeSineWaveVector(440, kInputSampleRate, 0.0,
+                                   kNumHops * num_samples_per_hop,
+                                   &doubles_samples);
+  std::vector<int16_t> samples;
+  for (auto val : doubles_samples) {
+    samples.push_back(val * 10000);
+  }
+
+  auto reference_resampler =
+      Resampler::Create(kInputSampleRate, kOutputSampleRate);
+  auto switching_resampler =
+      Resampler::Create(kInputSampleRate, kOutputSampleRate);
+  for (int hop = 0; hop < kNumHops; ++hop) {
+    const auto hop_samples = absl::MakeConstSpan(samples).subspan(
+        hop * num_samples_per_hop, num_samples_per_hop);
+    const auto expected = reference_resampler->Resample(hop_samples);
+    if (hop % 2 == 0) {
+      EXPECT_EQ(switching_resampler->Resample(hop_samples), expected)
+          << "hop " << hop;
+      continue;
+    }
+    std::vector<float> float_samples;
+    for (int16_t sample : hop_samples) {
+      float_samples.push_back(sample / 32768.f);
+    }
+    const auto resampled =
+        switching_resampler->Resample(absl::MakeConstSpan(float_samples));
+    ASSERT_EQ(resampled.size(), expected.size());
+    for (int i = 0; i < resampled.size(); ++i) {
+      EXPECT_NEAR(resampled[i] * 32768.f, expected[i], 1.f)
+          << "hop " << hop << ", sample " << i;
+    }
+  }
+}
+
 }  // namespace codec
 }  // namespace chromemedia
@@ -33,10 +33,41 @@
 namespace chromemedia {
 namespace codec {
 
+bool ResidualVectorQuantizer::ResizeIndices(tflite::Interpreter* interpreter) {
+  tflite::SignatureRunner* encode_runner =
+      interpreter->GetSignatureRunner("encode");
+  tflite::SignatureRunner* decode_runner =
+      interpreter->GetSignatureRunner("decode");
+  if (encode_runner == nullptr || decode_runner == nullptr) {
+    LOG(ERROR) << "The quantizer TFLite model lacks an encode or decode "
+               << "signature.";
+    return false;
+  }
+  if (encode_runner->AllocateTensors() != kTfLiteOk) {
+    LOG(ERROR) << "Could not allocate encode runner TFLite tensors.";
+    return false;
+  }
+  const int bits_per_quantizer =
+      encode_runner->output_tensor("output_1")->data.i32[0];
+  // The indices of unused quantizers are set to -1, so a single shape serves
+  // every number of quantizers and the tensor never has to be resized again.
+  const int max_num_quantizers = kMaxNumQuantizedBits / bits_per_quantizer;
+  if (decode_runner->ResizeInputTensor(
+          "encoding_indices", {max_num_quantizers, 1, 1}) != kTfLiteOk) {
+    LOG(ERROR) << "Failed to resize the indices tensor to the maximum number "
+               << "of quantizers (" << max_num_quantizers << ").";
+    return false;
+  }
+  return true;
+}
+
 std::unique_ptr<ResidualVectorQuantizer> ResidualVectorQuantizer::Create(
-    const ghc::filesystem::path& model_path) {
-  auto quantizer_model =
-      TfLiteModelWrapper::Create(model_path / "quantizer.tflite", false);
+    const ghc::filesystem::path& model_path, bool enable_profiling) {
+  // All tensors have static shapes once the indices are resized, so XNNPack
+  // can take over the graph without allowing dynamic tensors.
+  auto quantizer_model = TfLiteModelWrapper::Create(
+      model_path / "quantizer.tflite", /*use_xnn=*/true, enable_profiling,
+      /*allow_dynamic_tensors=*/false, &ResizeIndices);
   if (quantizer_model == nullptr) {
     LOG(ERROR) << "Unable to create the quantizer TfLite model wrapper.";
     return nullptr;
@@ -61,6 +92,12 @@ std::unique_ptr<ResidualVectorQuantizer> ResidualVectorQuantizer::Create(
     LOG(ERROR) << "Could not allocate decode runner TFLite tensors.";
     return nullptr;
   }
+  if (quantizer_model->GetNonDelegatedOps().empty()) {
+    VLOG(1) << "The quantizer is fully delegated to XNNPack.";
+  } else {
+    LOG(WARNING) << "The quantizer is not fully delegated to XNNPack. "
+                 << quantizer_model->GetDelegationReport();
+  }
   return absl::WrapUnique(
       new ResidualVectorQuantizer(std::move(quantizer_model)));
 }
@@ -125,17 +162,6 @@ ResidualVectorQuantizer::DecodeToLossyFeatures(
   }
   const int required_quantizers = num_bits / bits_per_quantizer_;
   const int max_num_quantizers = kMaxNumQuantizedBits / bits_per_quantizer_;
-  if (decode_runner_->ResizeInputTensor(
-          "encoding_indices", {max_num_quantizers, 1, 1}) != kTfLiteOk) {
-    LOG(ERROR)
-        << "Failed to resize the indices tensor to the required number of "
-        << "quantizers (" << max_num_quantizers << ").";
-    return std::nullopt;
-  }
-  if (decode_runner_->AllocateTensors() != kTfLiteOk) {
-    LOG(ERROR) << "Unable to allocate tensors.";
-    return std::nullopt;
-  }
   const std::bitset<kMaxNumQuantizedBits> quantized_bits(quantized_features);
   const std::bitset<kMaxNumQuantizedBits> quantizer_mask(
       (1 << bits_per_quantizer_) - 1);
@@ -35,7 +35,7 @@ class ResidualVectorQuantizer : public VectorQuantizerInterface {
  public:
   // Returns nullptr if the TFLite model can't be built or allocated.
   static std::unique_ptr<ResidualVectorQuantizer> Create(
-      const ghc::filesystem::path& model_path);
+      const ghc::filesystem::path& model_path, bool enable_profiling = false);
 
   // Quantizes the features using vector quantization.
   std::optional<std::string> Quantize(const std::vector<float>& features,
@@ -45,17 +45,33 @@ class ResidualVectorQuantizer : public VectorQuantizerInterface {
   std::optional<std::vector<float>> DecodeToLossyFeatures(
       const std::string& quantized_features) const override;
 
+  // Returns the op profile of the TFLite model, or an empty string if it was
+  // not created with profiling enabled.
+  std::string GetProfileReport() const {
+    return quantizer_model_->GetProfileReport();
+  }
+
+  // Returns the ops of the TFLite model which XNNPack did not take over.
+  std::vector<std::string> GetNonDelegatedOps() const {
+    return quantizer_model_->GetNonDelegatedOps();
+  }
+
  private:
   // LINT.IfChange
   static constexpr int kMaxNumQuantizedBits = 480;
   // LINT.ThenChange(
   // lyra_components.cc,
-  // lyra_config.cc,
+  // lyra_config.h,
   // )
 
   explicit ResidualVectorQuantizer(
       std::unique_ptr<TfLiteModelWrapper> quantizer_model);
 
+  // Resizes the indices input of the decode signature to the maximum number
+  // of quantizers. Called before XNNPack is applied, which only plans for the
+  // shapes the tensors have at that point.
+  static bool ResizeIndices(tflite::Interpreter* interpreter);
+
   const std::unique_ptr<TfLiteModelWrapper> quantizer_model_;
   tflite::SignatureRunner* encode_runner_;
   tflite::SignatureRunner* decode_runner_;
@@ -110,9 +110,38 @@ TEST_P(ResidualVectorQuantizerTest, EncodeDecodeResultsInSimilarFeatures) {
   EXPECT_LT(FeatureDistance(decoded_features.value()), 1.1);
 }
 
+TEST_P(ResidualVectorQuantizerTest, DecodingIsIndependentOfPreviousBitrate) {
+  // The indices tensor keeps its shape across calls, so decoding at another
+  // bitrate in between must not leave stale indices behind.
+  auto quantized = quantizer_->Quantize(features_, num_quantized_bits_);
+  ASSERT_TRUE(quantized.has_value());
+  auto decoded_features = quantizer_->DecodeToLossyFeatures(quantized.value());
+  ASSERT_TRUE(decoded_features.has_value());
+  for (const int other_num_quantized_bits : GetSupportedQuantizedBits()) {
+    auto other_quantized =
+        quantizer_->Quantize(features_, other_num_quantized_bits);
+    ASSERT_TRUE(other_quantized.has_value());
+    ASSERT_TRUE(
+        quantizer_->DecodeToLossyFeatures(other_quantized.value()).has_value());
+  }
+  auto redecoded_features =
+      quantizer_->DecodeToLossyFeatures(quantized.value());
+  ASSERT_TRUE(redecoded_features.has_value());
+  EXPECT_EQ(redecoded_features.value(), decoded_features.value());
+}
+
 INSTANTIATE_TEST_SUITE_P(NumQuantizedBits, ResidualVectorQuantizerTest,
                          testing::ValuesIn(GetSupportedQuantizedBits()));
 
+TEST(ResidualVectorQuantizerDelegationTest, XnnpackTakesOverEveryOp) {
+  auto quantizer = ResidualVectorQuantizer::Create(
+      ghc::filesystem::current_path() / "model_coeffs");
+  ASSERT_NE(quantizer, nullptr);
+
+  EXPECT_TRUE(quantizer->GetNonDelegatedOps().empty())
+      << testing::PrintToString(quantizer->GetNonDelegatedOps());
+}
+
 }  // namespace
 }  // namespace codec
 }  // namespace chromemedia
@@ -0,0 +1,164 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "shared_memory_ring.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+constexpr uint32_t kMagic = 0x4c595252;  // "LYRR"
+
+// Every record starts with the size of its payload and its type.
+constexpr int kRecordHeaderBytes = sizeof(uint32_t) + sizeof(uint8_t);
+
+}  // namespace
+
+size_t SharedMemoryRing::GetRequiredBytes(int capacity) {
+  return sizeof(Header) + capacity;
+}
+
+int SharedMemoryRing::GetRecordBytes(int payload_size) {
+  return kRecordHeaderBytes + payload_size;
+}
+
+std::unique_ptr<SharedMemoryRing> SharedMemoryRing::Create(void* memory,
+                                                           int capacity) {
+  if (capacity <= 0) {
+    LOG(ERROR) << "Ring capacity has to be positive, but is " << capacity
+               << ".";
+    return nullptr;
+  }
+  Header* header = new (memory) Header;
+  header->magic = kMagic;
+  header->capacity = capacity;
+  header->write_index.store(0, std::memory_order_relaxed);
+  header->read_index.store(0, std::memory_order_release);
+  return absl::WrapUnique(new SharedMemoryRing(
+      header, static_cast<uint8_t*>(memory) + sizeof(Header), capacity));
+}
+
+std::unique_ptr<SharedMemoryRing> SharedMemoryRing::Attach(void* memory,
+                                                           int capacity) {
+  Header* header = static_cast<Header*>(memory);
+  if (header->magic != kMagic || header->capacity != capacity) {
+    LOG(ERROR) << "Memory does not hold a ring of " << capacity << " bytes.";
+    return nullptr;
+  }
+  return absl::WrapUnique(new SharedMemoryRing(
+      header, static_cast<uint8_t*>(memory) + sizeof(Header), capacity));
+}
+
+SharedMemoryRing::SharedMemoryRing(Header* header, uint8_t* data,
+                                   int capacity)
+    : header_(header), data_(data), capacity_(capacity), corrupted_(false) {}
+
+bool SharedMemoryRing::Write(uint8_t type, absl::Span<const uint8_t> payload) {
+  const uint64_t record_bytes = kRecordHeaderBytes + payload.size();
+  const uint64_t write_index =
+      header_->write_index.load(std::memory_order_relaxed);
+  const uint64_t read_index =
+      header_->read_index.load(std::memory_order_acquire);
+  // The consumer may be another process, so its index cannot be trusted to
+  // lie behind the write index.
+  const uint64_t used_bytes = write_index - read_index;
+  if (used_bytes > capacity_ || record_bytes > capacity_ - used_bytes) {
+    return false;
+  }
+  const uint32_t payload_size = payload.size();
+  CopyIn(write_index, reinterpret_cast<const uint8_t*>(&payload_size),
+         sizeof(payload_size));
+  CopyIn(write_index + sizeof(payload_size), &type, sizeof(type));
+  CopyIn(write_index + kRecordHeaderBytes, payload.data(), payload.size());
+  header_->write_index.store(write_index + record_bytes,
+                             std::memory_order_release);
+  return true;
+}
+
+std::optional<uint8_t> SharedMemoryRing::Read(std::vector<uint8_t>* payload) {
+  if (corrupted_) {
+    return std::nullopt;
+  }
+  const uint64_t read_index =
+      header_->read_index.load(std::memory_order_relaxed);
+  const uint64_t write_index =
+      header_->write_index.load(std::memory_order_acquire);
+  if (read_index == write_index) {
+    return std::nullopt;
+  }
+  // The indices and the record header may have been written by another
+  // process, so nothing is read or allocated before they are checked.
+  const uint64_t available_bytes = write_index - read_index;
+  if (available_bytes < kRecordHeaderBytes || available_bytes > capacity_) {
+    LOG(ERROR) << "Ring indices are inconsistent: " << available_bytes
+               << " bytes are pending in a ring of " << capacity_ << " bytes.";
+    corrupted_ = true;
+    return std::nullopt;
+  }
+  uint32_t payload_size;
+  uint8_t type;
+  CopyOut(read_index, reinterpret_cast<uint8_t*>(&payload_size),
+          sizeof(payload_size));
+  CopyOut(read_index + sizeof(payload_size), &type, sizeof(type));
+  if (payload_size > available_bytes - kRecordHeaderBytes) {
+    LOG(ERROR) << "Record of " << payload_size << " bytes exceeds the "
+               << available_bytes << " bytes pending in the ring.";
+    corrupted_ = true;
+    return std::nullopt;
+  }
+  payload->resize(payload_size);
+  CopyOut(read_index + kRecordHeaderBytes, payload->data(), payload_size);
+  header_->read_index.store(read_index + kRecordHeaderBytes + payload_size,
+                            std::memory_order_release);
+  return type;
+}
+
+void SharedMemoryRing::CopyIn(uint64_t index, const uint8_t* source,
+                              int size) {
+  if (size == 0) {
+    return;
+  }
+  const int offset = index % capacity_;
+  const int first_size = std::min(size, capacity_ - offset);
+  std::memcpy(data_ + offset, source, first_size);
+  std::memcpy(data_, source + first_size, size - first_size);
+}
+
+void SharedMemoryRing::CopyOut(uint64_t index, uint8_t* destination,
+                               int size) const {
+  if (size == 0) {
+    return;
+  }
+  const int offset = index % capacity_;
+  const int first_size = std::min(size, capacity_ - offset);
+  std::memcpy(destination, data_ + offset, first_size);
+  std::memcpy(destination + first_size, data_, size - first_size);
+}
+
+}  // namespace codec
+}  // namespace chromemedia
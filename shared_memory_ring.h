@@ -0,0 +1,103 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_SHARED_MEMORY_RING_H_
+#define LYRA_CODEC_SHARED_MEMORY_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "absl/types/span.h"
+
+namespace chromemedia {
+namespace codec {
+
+// A lock-free ring of variable-size records with a single producer and a
+// single consumer, which may live in memory shared between two processes.
+// Every record has a type and a payload. The producer publishes a record with
+// one release store of the write index and the consumer frees it with one
+// release store of the read index, so neither side ever blocks or makes a
+// system call.
+class SharedMemoryRing {
+ public:
+  // Returns the number of bytes of memory a ring of |capacity| bytes needs.
+  static size_t GetRequiredBytes(int capacity);
+
+  // Returns the number of bytes a record with |payload_size| bytes of payload
+  // takes in the ring.
+  static int GetRecordBytes(int payload_size);
+
+  // Initializes an empty ring in |memory|, which has to hold
+  // GetRequiredBytes(|capacity|) bytes aligned to 64 bytes and outlive the
+  // ring. Returns nullptr if |capacity| is not positive.
+  static std::unique_ptr<SharedMemoryRing> Create(void* memory, int capacity);
+
+  // Attaches to a ring which was initialized in |memory| by Create(), possibly
+  // by another process. Returns nullptr if |memory| holds no ring of
+  // |capacity| bytes.
+  static std::unique_ptr<SharedMemoryRing> Attach(void* memory, int capacity);
+
+  // Called by the producer. Returns false if the ring does not have room for
+  // the record.
+  bool Write(uint8_t type, absl::Span<const uint8_t> payload);
+
+  // Called by the consumer. Moves the payload of the oldest record into
+  // |payload| and returns its type, or returns nullopt if the ring is empty
+  // or corrupted.
+  std::optional<uint8_t> Read(std::vector<uint8_t>* payload);
+
+  // Whether Read() found indices or a record header which the producer cannot
+  // have written. A corrupted ring is never read again.
+  bool corrupted() const { return corrupted_; }
+
+  int capacity() const { return capacity_; }
+
+ private:
+  // Lives at the start of the shared memory. The indices count bytes since
+  // the ring was created and never wrap.
+  struct Header {
+    uint32_t magic;
+    uint32_t capacity;
+    // On separate cache lines so producer and consumer do not contend.
+    alignas(64) std::atomic<uint64_t> write_index;
+    alignas(64) std::atomic<uint64_t> read_index;
+  };
+  static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                "Ring indices have to be lock-free to be shared between "
+                "processes.");
+
+  SharedMemoryRing(Header* header, uint8_t* data, int capacity);
+
+  // Copy |size| bytes at |index| in and out of the ring, wrapping around its
+  // end.
+  void CopyIn(uint64_t index, const uint8_t* source, int size);
+  void CopyOut(uint64_t index, uint8_t* destination, int size) const;
+
+  Header* const header_;
+  uint8_t* const data_;
+  const int capacity_;
+  // Not shared, so a corrupting peer cannot clear it.
+  bool corrupted_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_SHARED_MEMORY_RING_H_
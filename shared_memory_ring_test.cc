@@ -0,0 +1,169 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "shared_memory_ring.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+constexpr int kCapacity = 64;
+
+class SharedMemoryRingTest : public testing::Test {
+ protected:
+  SharedMemoryRingTest()
+      : memory_(SharedMemoryRing::GetRequiredBytes(kCapacity)),
+        ring_(SharedMemoryRing::Create(memory_.data(), kCapacity)) {}
+
+  struct alignas(64) AlignedBlock {
+    uint8_t bytes[64];
+  };
+  // Stands in for memory shared with another process.
+  std::vector<AlignedBlock> memory_;
+  std::unique_ptr<SharedMemoryRing> ring_;
+};
+
+TEST_F(SharedMemoryRingTest, CreateFailsForInvalidCapacity) {
+  EXPECT_EQ(SharedMemoryRing::Create(memory_.data(), 0), nullptr);
+}
+
+TEST_F(SharedMemoryRingTest, AttachSeesRecordsOfCreatedRing) {
+  ASSERT_NE(ring_, nullptr);
+  auto attached = SharedMemoryRing::Attach(memory_.data(), kCapacity);
+  ASSERT_NE(attached, nullptr);
+  EXPECT_EQ(SharedMemoryRing::Attach(memory_.data(), kCapacity + 1), nullptr);
+
+  ASSERT_TRUE(ring_->Write(7, std::vector<uint8_t>{1, 2, 3}));
+  ASSERT_TRUE(ring_->Write(8, {}));
+  std::vector<uint8_t> payload;
+  EXPECT_EQ(attached->Read(&payload), 7);
+  EXPECT_THAT(payload, ElementsAre(1, 2, 3));
+  EXPECT_EQ(attached->Read(&payload), 8);
+  EXPECT_THAT(payload, IsEmpty());
+  EXPECT_FALSE(attached->Read(&payload).has_value());
+}
+
+TEST_F(SharedMemoryRingTest, WriteFailsWhenFull) {
+  ASSERT_NE(ring_, nullptr);
+  // Every record carries five bytes of header.
+  const std::vector<uint8_t> payload(kCapacity / 2 - 5);
+  EXPECT_TRUE(ring_->Write(1, payload));
+  EXPECT_TRUE(ring_->Write(2, payload));
+  EXPECT_FALSE(ring_->Write(3, {}));
+
+  std::vector<uint8_t> read_payload;
+  EXPECT_EQ(ring_->Read(&read_payload), 1);
+  EXPECT_TRUE(ring_->Write(3, {}));
+}
+
+TEST_F(SharedMemoryRingTest, RecordsWrapAroundTheEnd) {
+  ASSERT_NE(ring_, nullptr);
+  std::vector<uint8_t> payload;
+  for (int i = 0; i < 10 * kCapacity; ++i) {
+    const std::vector<uint8_t> written = {static_cast<uint8_t>(i),
+                                          static_cast<uint8_t>(i + 1),
+                                          static_cast<uint8_t>(i + 2)};
+    ASSERT_TRUE(ring_->Write(i % 256, written));
+    ASSERT_EQ(ring_->Read(&payload), i % 256);
+    ASSERT_EQ(payload, written);
+  }
+}
+
+TEST_F(SharedMemoryRingTest, ReadRejectsRecordLargerThanPendingBytes) {
+  ASSERT_NE(ring_, nullptr);
+  ASSERT_TRUE(ring_->Write(1, std::vector<uint8_t>{1, 2, 3}));
+  // A peer overwrites the payload size, which starts the record at the
+  // beginning of the data after the header.
+  uint8_t* data = memory_.data()->bytes +
+                  SharedMemoryRing::GetRequiredBytes(kCapacity) - kCapacity;
+  const uint32_t payload_size = 0xffffffff;
+  std::memcpy(data, &payload_size, sizeof(payload_size));
+
+  std::vector<uint8_t> payload;
+  EXPECT_FALSE(ring_->Read(&payload).has_value());
+  EXPECT_TRUE(ring_->corrupted());
+  EXPECT_THAT(payload, IsEmpty());
+  // The ring stays unusable even once the record looks valid again.
+  const uint32_t valid_payload_size = 3;
+  std::memcpy(data, &valid_payload_size, sizeof(valid_payload_size));
+  EXPECT_FALSE(ring_->Read(&payload).has_value());
+}
+
+TEST_F(SharedMemoryRingTest, ReadRejectsWriteIndexBeyondCapacity) {
+  ASSERT_NE(ring_, nullptr);
+  ASSERT_TRUE(ring_->Write(1, std::vector<uint8_t>{1, 2, 3}));
+  // A peer moves the write index, which lies on the second cache line of the
+  // header, more than a whole ring ahead of the read index.
+  uint64_t write_index;
+  std::memcpy(&write_index, memory_.data()->bytes + 64, sizeof(write_index));
+  write_index += kCapacity;
+  std::memcpy(memory_.data()->bytes + 64, &write_index, sizeof(write_index));
+
+  std::vector<uint8_t> payload;
+  EXPECT_FALSE(ring_->Read(&payload).has_value());
+  EXPECT_TRUE(ring_->corrupted());
+}
+
+TEST_F(SharedMemoryRingTest, WriteRejectsReadIndexAheadOfWriteIndex) {
+  ASSERT_NE(ring_, nullptr);
+  // A peer moves the read index, on the third cache line of the header, past
+  // the write index.
+  const uint64_t read_index = 3;
+  std::memcpy(memory_.data()->bytes + 128, &read_index, sizeof(read_index));
+  EXPECT_FALSE(ring_->Write(1, std::vector<uint8_t>{1, 2, 3}));
+}
+
+TEST_F(SharedMemoryRingTest, ConsumerThreadReadsRecordsInOrder) {
+  ASSERT_NE(ring_, nullptr);
+  constexpr int kNumRecords = 100000;
+  std::thread consumer([this]() {
+    std::vector<uint8_t> payload;
+    for (int i = 0; i < kNumRecords;) {
+      const std::optional<uint8_t> type = ring_->Read(&payload);
+      if (!type.has_value()) {
+        std::this_thread::yield();
+        continue;
+      }
+      ASSERT_EQ(type.value(), static_cast<uint8_t>(i));
+      ASSERT_EQ(payload.size(), i % 7);
+      ++i;
+    }
+  });
+  for (int i = 0; i < kNumRecords;) {
+    if (ring_->Write(i, std::vector<uint8_t>(i % 7, i))) {
+      ++i;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  consumer.join();
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
@@ -16,7 +16,6 @@
 
 #include "soundstream_encoder.h"
 
-#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <optional>
@@ -25,7 +24,7 @@
 
 #include "absl/memory/memory.h"
 #include "absl/types/span.h"
-#include "dsp_utils.h"
+#include "dsp_kernels.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "include/ghc/filesystem.hpp"
 #include "tflite_model_wrapper.h"
@@ -34,34 +33,85 @@ namespace chromemedia {
 namespace codec {
 
 std::unique_ptr<SoundStreamEncoder> SoundStreamEncoder::Create(
-    const ghc::filesystem::path& model_path) {
+    const ghc::filesystem::path& model_path, bool enable_profiling) {
+  auto model = CreateSharedWrapper(model_path, enable_profiling);
+  if (model == nullptr) {
+    return nullptr;
+  }
+  return absl::WrapUnique(new SoundStreamEncoder(std::move(model), false));
+}
+
+std::shared_ptr<TfLiteModelWrapper> SoundStreamEncoder::CreateSharedWrapper(
+    const ghc::filesystem::path& model_path, bool enable_profiling) {
   auto model = TfLiteModelWrapper::Create(
-      model_path / "soundstream_encoder.tflite", true);
+      model_path / "soundstream_encoder.tflite", true, enable_profiling);
   if (model == nullptr) {
     LOG(ERROR) << "Unable to create SoundStream encoder TFLite model wrapper.";
     return nullptr;
   }
-  return absl::WrapUnique(new SoundStreamEncoder(std::move(model)));
+  // Every input but the audio is a state.
+  if (!model->EnableStates(1)) {
+    LOG(ERROR) << "Unable to set up the SoundStream encoder states.";
+    return nullptr;
+  }
+  return model;
+}
+
+std::unique_ptr<SoundStreamEncoder> SoundStreamEncoder::CreateMultiplexed(
+    std::shared_ptr<TfLiteModelWrapper> shared_model) {
+  if (shared_model == nullptr) {
+    LOG(ERROR) << "Shared SoundStream encoder TFLite model wrapper must not be "
+                  "null.";
+    return nullptr;
+  }
+  return absl::WrapUnique(
+      new SoundStreamEncoder(std::move(shared_model), true));
 }
 
 SoundStreamEncoder::SoundStreamEncoder(
-    std::unique_ptr<TfLiteModelWrapper> model)
+    std::shared_ptr<TfLiteModelWrapper> model, bool multiplexed)
     : model_(std::move(model)),
-      num_features_(model_->get_output_tensor<float>(0).size()) {}
+      num_features_(model_->get_output_tensor<float>(0).size()),
+      multiplexed_(multiplexed) {
+  if (multiplexed_) {
+    // Starts from zero states, like an encoder with its own wrapper.
+    states_.resize(model_->state_bytes(), 0);
+  }
+}
 
 std::optional<std::vector<float>> SoundStreamEncoder::Extract(
     const absl::Span<const int16_t> audio) {
+  if (!LoadStates()) {
+    return std::nullopt;
+  }
   absl::Span<float> input = model_->get_input_tensor<float>(0);
-  std::transform(audio.begin(), audio.end(), input.begin(),
-                 Int16ToUnitScalar<float>);
+  GetDspKernels().int16_to_unit(audio.data(), audio.size(), input.data());
   if (!model_->Invoke()) {
     LOG(ERROR) << "Unable to invoke SoundStream encoder TFLite model wrapper.";
     return std::nullopt;
   }
-  for (int i = 1; i < model_->num_input_tensors(); ++i) {
-    absl::Span<float> input_state = model_->get_input_tensor<float>(i);
-    absl::Span<const float> output_state = model_->get_output_tensor<float>(i);
-    std::copy(output_state.begin(), output_state.end(), input_state.begin());
+  return GetFeatures();
+}
+
+std::optional<std::vector<float>> SoundStreamEncoder::Extract(
+    const absl::Span<const float> audio) {
+  if (!LoadStates()) {
+    return std::nullopt;
+  }
+  if (!model_->InvokeWithInput(0, audio)) {
+    LOG(ERROR) << "Unable to invoke SoundStream encoder TFLite model wrapper.";
+    return std::nullopt;
+  }
+  return GetFeatures();
+}
+
+bool SoundStreamEncoder::LoadStates() {
+  return !multiplexed_ || model_->LoadStates(states_);
+}
+
+std::optional<std::vector<float>> SoundStreamEncoder::GetFeatures() {
+  if (multiplexed_ && !model_->SaveStates(absl::MakeSpan(states_))) {
+    return std::nullopt;
   }
   absl::Span<const float> output = model_->get_output_tensor<float>(0);
   return std::vector<float>(output.begin(), output.end());
@@ -20,6 +20,7 @@
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 
 #include "absl/types/span.h"
@@ -36,7 +37,20 @@ class SoundStreamEncoder : public FeatureExtractorInterface {
  public:
   // Returns a nullptr on failure.
   static std::unique_ptr<SoundStreamEncoder> Create(
-      const ghc::filesystem::path& model_path);
+      const ghc::filesystem::path& model_path, bool enable_profiling = false);
+
+  // Returns a SoundStream encoder TFLite model wrapper which many encoders
+  // created with |CreateMultiplexed| can take turns running on, or nullptr on
+  // failure.
+  static std::shared_ptr<TfLiteModelWrapper> CreateSharedWrapper(
+      const ghc::filesystem::path& model_path, bool enable_profiling = false);
+
+  // Returns an encoder which runs on |shared_model|, as returned by
+  // |CreateSharedWrapper|, and only keeps its own states. The states are
+  // swapped into the wrapper around each invoke, so all encoders sharing a
+  // wrapper must be run from one thread. Returns a nullptr on failure.
+  static std::unique_ptr<SoundStreamEncoder> CreateMultiplexed(
+      std::shared_ptr<TfLiteModelWrapper> shared_model);
 
   ~SoundStreamEncoder() override {}
 
@@ -44,11 +58,37 @@ class SoundStreamEncoder : public FeatureExtractorInterface {
   std::optional<std::vector<float>> Extract(
       const absl::Span<const int16_t> audio) override;
 
+  // Same as above for float samples in [-1, 1]. If |audio| is aligned to 64
+  // bytes it is fed to the model without any conversion or copy.
+  std::optional<std::vector<float>> Extract(
+      const absl::Span<const float> audio) override;
+
+  // Returns the op profile of the TFLite model, or an empty string if it was
+  // not created with profiling enabled.
+  std::string GetProfileReport() const { return model_->GetProfileReport(); }
+
+  // Returns the memory traffic per frame saved by double buffering the model
+  // states instead of copying them.
+  int64_t saved_state_copy_bytes() const {
+    return model_->saved_state_copy_bytes();
+  }
+
  private:
-  explicit SoundStreamEncoder(std::unique_ptr<TfLiteModelWrapper> model);
+  SoundStreamEncoder(std::shared_ptr<TfLiteModelWrapper> model,
+                     bool multiplexed);
+
+  // Swaps the states of this encoder into the wrapper if it is multiplexed.
+  bool LoadStates();
+
+  // Returns the features of the last invoke, and swaps the states of this
+  // encoder back out of the wrapper if it is multiplexed.
+  std::optional<std::vector<float>> GetFeatures();
 
-  const std::unique_ptr<TfLiteModelWrapper> model_;
+  const std::shared_ptr<TfLiteModelWrapper> model_;
   const int num_features_;
+  const bool multiplexed_;
+  // Only used when multiplexed: the states between invokes.
+  std::vector<uint8_t> states_;
 };
 
 }  // namespace codec
@@ -23,6 +23,8 @@
 #include <vector>
 
 // Placeholder for get runfiles header.
+#include "absl/types/span.h"
+#include "dsp_utils.h"
 #include "gtest/gtest.h"
 #include "include/ghc/filesystem.hpp"
 #include "lyra_config.h"
@@ -56,6 +58,72 @@ TEST_F(SoundStreamEncoderTest, ExtractingExpectedNumberOfFeatures) {
   EXPECT_EQ(features.value().size(), kNumFeatures);
 }
 
+TEST_F(SoundStreamEncoderTest, FloatAudioMatchesInt16Audio) {
+  ASSERT_NE(encoder_, nullptr);
+  auto aligned_encoder = SoundStreamEncoder::Create(
+      ghc::filesystem::current_path() / "model_coeffs");
+  ASSERT_NE(aligned_encoder, nullptr);
+  auto unaligned_encoder = SoundStreamEncoder::Create(
+      ghc::filesystem::current_path() / "model_coeffs");
+  ASSERT_NE(unaligned_encoder, nullptr);
+
+  const int num_samples_per_hop = GetNumSamplesPerHop(kInternalSampleRateHz);
+  std::vector<int16_t> audio(num_samples_per_hop);
+  // The aligned hop starts at the beginning of the buffer, the unaligned one
+  // one float later, so the latter cannot be bound to the input tensor.
+  alignas(64) float aligned_audio[CodecProfile::kNumSamplesPerHop];
+  alignas(64) float unaligned_audio[CodecProfile::kNumSamplesPerHop + 1];
+  for (int hop = 0; hop < 5; ++hop) {
+    for (int i = 0; i < num_samples_per_hop; ++i) {
+      audio.at(i) = static_cast<int16_t>((i * 97 + hop * 1013) % 2000 - 1000);
+      aligned_audio[i] = Int16ToUnitScalar<float>(audio.at(i));
+      unaligned_audio[i + 1] = aligned_audio[i];
+    }
+    auto features = encoder_->Extract(audio);
+    ASSERT_TRUE(features.has_value());
+    auto aligned_features = aligned_encoder->Extract(
+        absl::MakeConstSpan(aligned_audio, num_samples_per_hop));
+    ASSERT_TRUE(aligned_features.has_value());
+    EXPECT_EQ(aligned_features.value(), features.value()) << "hop=" << hop;
+    auto unaligned_features = unaligned_encoder->Extract(
+        absl::MakeConstSpan(unaligned_audio + 1, num_samples_per_hop));
+    ASSERT_TRUE(unaligned_features.has_value());
+    EXPECT_EQ(unaligned_features.value(), features.value()) << "hop=" << hop;
+  }
+}
+
+TEST_F(SoundStreamEncoderTest, MultiplexedEncodersMatchIndependentEncoders) {
+  ASSERT_NE(encoder_, nullptr);
+  const auto model_path = ghc::filesystem::current_path() / "model_coeffs";
+  auto other_encoder = SoundStreamEncoder::Create(model_path);
+  ASSERT_NE(other_encoder, nullptr);
+  auto shared_wrapper = SoundStreamEncoder::CreateSharedWrapper(model_path);
+  ASSERT_NE(shared_wrapper, nullptr);
+  auto multiplexed_encoder =
+      SoundStreamEncoder::CreateMultiplexed(shared_wrapper);
+  ASSERT_NE(multiplexed_encoder, nullptr);
+  auto other_multiplexed_encoder =
+      SoundStreamEncoder::CreateMultiplexed(shared_wrapper);
+  ASSERT_NE(other_multiplexed_encoder, nullptr);
+
+  const int num_samples_per_hop = GetNumSamplesPerHop(kInternalSampleRateHz);
+  std::vector<int16_t> audio(num_samples_per_hop);
+  std::vector<int16_t> other_audio(num_samples_per_hop);
+  for (int hop = 0; hop < 5; ++hop) {
+    for (int i = 0; i < num_samples_per_hop; ++i) {
+      audio.at(i) = static_cast<int16_t>((i * 97 + hop * 1013) % 2000 - 1000);
+      other_audio.at(i) = static_cast<int16_t>(-audio.at(i) / 2);
+    }
+    auto features = multiplexed_encoder->Extract(audio);
+    ASSERT_TRUE(features.has_value());
+    auto other_features = other_multiplexed_encoder->Extract(other_audio);
+    ASSERT_TRUE(other_features.has_value());
+    EXPECT_EQ(features, encoder_->Extract(audio)) << "hop=" << hop;
+    EXPECT_EQ(other_features, other_encoder->Extract(other_audio))
+        << "hop=" << hop;
+  }
+}
+
 }  // namespace
 }  // namespace codec
 }  // namespace chromemedia
@@ -0,0 +1,131 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "testing/corpus_test_utils.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Placeholder for get runfiles header.
+#include "absl/status/statusor.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+#include "lyra_config.h"
+#include "lyra_decoder.h"
+#include "lyra_encoder.h"
+#include "wav_utils.h"
+
+namespace chromemedia {
+namespace codec {
+
+ghc::filesystem::path GetCorpusTablePath(const char* env_var,
+                                         absl::string_view default_path) {
+  const char* path_env = std::getenv(env_var);
+  return ghc::filesystem::current_path() /
+         std::string(path_env != nullptr ? path_env : default_path);
+}
+
+std::optional<std::map<CorpusKey, std::vector<std::string>>> ReadCorpusTable(
+    const ghc::filesystem::path& table_path, int num_values) {
+  std::ifstream table_stream(table_path.string());
+  if (!table_stream.is_open()) {
+    LOG(ERROR) << "Could not open " << table_path;
+    return std::nullopt;
+  }
+  const std::string contents{std::istreambuf_iterator<char>(table_stream),
+                             std::istreambuf_iterator<char>()};
+  std::map<CorpusKey, std::vector<std::string>> table;
+  for (absl::string_view line : absl::StrSplit(contents, '\n')) {
+    line = absl::StripAsciiWhitespace(line);
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+    const std::vector<std::string> fields =
+        absl::StrSplit(line, ' ', absl::SkipEmpty());
+    CorpusKey key;
+    if (fields.size() != 2 + num_values ||
+        !absl::SimpleAtoi(fields[0], &key.first) ||
+        !absl::SimpleAtoi(fields[1], &key.second)) {
+      LOG(ERROR) << "Could not parse line of " << table_path << ": " << line;
+      return std::nullopt;
+    }
+    table[key] = std::vector<std::string>(fields.begin() + 2, fields.end());
+  }
+  return table;
+}
+
+std::optional<int> RunCorpus(int sample_rate_hz, int quality_preset,
+                             bool deterministic,
+                             const CorpusHopFunction& process_hop) {
+  const ghc::filesystem::path model_path =
+      ghc::filesystem::current_path() / "model_coeffs";
+  const ghc::filesystem::path testdata_dir =
+      ghc::filesystem::current_path() / "testdata";
+  int num_hops_processed = 0;
+  for (absl::string_view sample : {"sample1", "sample2"}) {
+    const ghc::filesystem::path wav_path =
+        testdata_dir /
+        absl::StrFormat("%s_%dkHz.wav", sample, sample_rate_hz / 1000);
+    absl::StatusOr<ReadWavResult> wav_result =
+        Read16BitWavFileToVector(wav_path.string());
+    if (!wav_result.ok()) {
+      LOG(ERROR) << "Could not read " << wav_path;
+      return std::nullopt;
+    }
+    // The encoder draws no random numbers, so it is deterministic as is.
+    auto encoder = LyraEncoder::Create(
+        wav_result->sample_rate_hz, wav_result->num_channels,
+        QualityPresetToBitrate(quality_preset, wav_result->sample_rate_hz),
+        /*enable_dtx=*/false, model_path);
+    auto decoder = LyraDecoder::Create(
+        wav_result->sample_rate_hz, wav_result->num_channels, model_path,
+        /*num_hops_per_noise_estimate=*/1, deterministic);
+    if (encoder == nullptr || decoder == nullptr) {
+      LOG(ERROR) << "Could not create codec at " << wav_result->sample_rate_hz
+                 << " Hz.";
+      return std::nullopt;
+    }
+
+    const int num_samples_per_hop =
+        GetNumSamplesPerHop(wav_result->sample_rate_hz);
+    const int num_hops = wav_result->samples.size() / num_samples_per_hop;
+    for (int hop = 0; hop < num_hops; ++hop) {
+      if (!process_hop(hop,
+                       absl::MakeConstSpan(wav_result->samples)
+                           .subspan(hop * num_samples_per_hop,
+                                    num_samples_per_hop),
+                       *encoder, *decoder)) {
+        LOG(ERROR) << "Could not process hop " << hop << " of " << wav_path;
+        return std::nullopt;
+      }
+    }
+    num_hops_processed += num_hops;
+  }
+  return num_hops_processed;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
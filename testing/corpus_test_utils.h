@@ -0,0 +1,78 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_TESTING_CORPUS_TEST_UTILS_H_
+#define LYRA_CODEC_TESTING_CORPUS_TEST_UTILS_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "include/ghc/filesystem.hpp"
+#include "lyra_decoder.h"
+#include "lyra_encoder.h"
+
+namespace chromemedia {
+namespace codec {
+
+// Helpers shared by the tests which run the codec over the testdata wav files
+// at every sample rate and quality preset, and compare the results against a
+// checked-in table.
+
+// The sample rates for which testdata wav files exist.
+inline constexpr int kTestdataSampleRatesHz[] = {8000, 16000, 32000, 48000};
+
+using CorpusKey = std::pair</*sample_rate_hz=*/int, /*quality_preset=*/int>;
+
+// Returns the path of a checked-in table: the value of the environment
+// variable |env_var| if it is set, or |default_path| otherwise, relative to
+// the working directory.
+ghc::filesystem::path GetCorpusTablePath(const char* env_var,
+                                         absl::string_view default_path);
+
+// Parses lines of the form
+//   <sample_rate_hz> <quality_preset> <value_1> ... <value_n>
+// ignoring empty lines and comments starting with '#', and returns the values
+// of each line. Returns nullopt if the file cannot be read or a line does not
+// have exactly |num_values| values.
+std::optional<std::map<CorpusKey, std::vector<std::string>>> ReadCorpusTable(
+    const ghc::filesystem::path& table_path, int num_values);
+
+// Called for every hop of the corpus with the index of the hop in its file,
+// its input samples and the codecs of the file. Returns false on failure.
+using CorpusHopFunction =
+    std::function<bool(int hop, absl::Span<const int16_t> samples,
+                       LyraEncoder& encoder, LyraDecoder& decoder)>;
+
+// Runs |process_hop| on every whole hop of the sample1 and sample2 testdata
+// files at |sample_rate_hz|, with fresh codecs at |quality_preset| for each
+// file. If |deterministic| is true the decoder draws its random numbers from
+// a fixed seed. Returns the number of hops processed, or nullopt if a file or
+// codec could not be created or |process_hop| failed.
+std::optional<int> RunCorpus(int sample_rate_hz, int quality_preset,
+                             bool deterministic,
+                             const CorpusHopFunction& process_hop);
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_TESTING_CORPUS_TEST_UTILS_H_
@@ -32,6 +32,9 @@ class MockFeatureExtractor : public FeatureExtractorInterface {
  public:
   ~MockFeatureExtractor() override {}
 
+  MOCK_METHOD(std::optional<std::vector<float>>, Extract,
+              (const absl::Span<const float> audio), (override));
+
   MOCK_METHOD(std::optional<std::vector<float>>, Extract,
               (const absl::Span<const int16_t> audio), (override));
 };
@@ -69,6 +69,10 @@ class MockGenerativeModel : public GenerativeModelInterface {
     ON_CALL(*this, GenerateSamples).WillByDefault([this](int num_samples) {
       return fake_generative_model_.GenerateSamples(num_samples);
     });
+    ON_CALL(*this, GenerateFloatSamples)
+        .WillByDefault([this](int num_samples) {
+          return fake_generative_model_.GenerateFloatSamples(num_samples);
+        });
     ON_CALL(*this, num_samples_available).WillByDefault([this]() {
       return fake_generative_model_.num_samples_available();
     });
@@ -78,6 +82,8 @@ class MockGenerativeModel : public GenerativeModelInterface {
               (override));
   MOCK_METHOD(std::optional<std::vector<int16_t>>, GenerateSamples,
               (int num_samples), (override));
+  MOCK_METHOD(std::optional<std::vector<float>>, GenerateFloatSamples,
+              (int num_samples), (override));
   MOCK_METHOD(int, num_samples_available, (), (const override));
 
  private:
@@ -34,9 +34,17 @@ class MockLyraDecoder : public LyraDecoderInterface {
 
   MOCK_METHOD(bool, SetEncodedPacket, (absl::Span<const uint8_t>), (override));
 
+  MOCK_METHOD(bool, SetRedundantPacket, (absl::Span<const uint8_t>),
+              (override));
+
   MOCK_METHOD(std::optional<std::vector<int16_t>>, DecodeSamples, (int),
               (override));
 
+  MOCK_METHOD(bool, DecodeSamplesInto, (absl::Span<int16_t>), (override));
+
+  MOCK_METHOD(std::optional<std::vector<float>>, DecodeFloatSamples, (int),
+              (override));
+
   MOCK_METHOD(int, sample_rate_hz, (), (const, override));
 
   MOCK_METHOD(int, num_channels, (), (const, override));
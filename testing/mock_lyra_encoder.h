@@ -35,6 +35,9 @@ class MockLyraEncoder : public LyraEncoderInterface {
   MOCK_METHOD(std::optional<std::vector<uint8_t>>, Encode,
               (const absl::Span<const int16_t>), (override));
 
+  MOCK_METHOD(std::optional<std::vector<uint8_t>>, Encode,
+              (const absl::Span<const float>), (override));
+
   MOCK_METHOD(bool, set_bitrate, (int bitrate), (override));
 
   MOCK_METHOD(int, sample_rate_hz, (), (const, override));
@@ -33,10 +33,14 @@ class MockResampler : public ResamplerInterface {
   MockResampler(int input_sample_rate_hz, int target_sample_rate_hz)
       : resampler_(
             Resampler::Create(input_sample_rate_hz, target_sample_rate_hz)) {
-    ON_CALL(*this, Resample)
+    ON_CALL(*this, Resample(testing::An<absl::Span<const int16_t>>()))
         .WillByDefault([this](absl::Span<const int16_t> audio) {
           return resampler_->Resample(audio);
         });
+    ON_CALL(*this, Resample(testing::An<absl::Span<const float>>()))
+        .WillByDefault([this](absl::Span<const float> audio) {
+          return resampler_->Resample(audio);
+        });
     ON_CALL(*this, Reset).WillByDefault([this]() {
       return resampler_->Reset();
     });
@@ -56,6 +60,9 @@ class MockResampler : public ResamplerInterface {
   MOCK_METHOD(std::vector<int16_t>, Resample, (absl::Span<const int16_t> audio),
               (override));
 
+  MOCK_METHOD(std::vector<float>, Resample, (absl::Span<const float> audio),
+              (override));
+
   MOCK_METHOD(void, Reset, (), (override));
 
   MOCK_METHOD(int, input_sample_rate_hz, (), (const override));
@@ -16,11 +16,20 @@
 
 #include "tflite_model_wrapper.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <new>
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "glog/logging.h"  // IWYU pragma: keep
 #include "include/ghc/filesystem.hpp"
 #include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
@@ -28,13 +37,17 @@
 #include "tensorflow/lite/interpreter_builder.h"
 #include "tensorflow/lite/kernels/register.h"
 #include "tensorflow/lite/model_builder.h"
+#include "tensorflow/lite/schema/schema_generated.h"
 #include "tensorflow/lite/signature_runner.h"
+#include "tflite_op_profiler.h"
 
 namespace chromemedia {
 namespace codec {
 
 std::unique_ptr<TfLiteModelWrapper> TfLiteModelWrapper::Create(
-    const ghc::filesystem::path& model_file, bool use_xnn) {
+    const ghc::filesystem::path& model_file, bool use_xnn,
+    bool enable_profiling, bool allow_dynamic_tensors,
+    const std::function<bool(tflite::Interpreter*)>& resize_inputs) {
   auto model = tflite::FlatBufferModel::BuildFromFile(model_file.c_str());
   if (model == nullptr) {
     LOG(ERROR) << "Could not build TFLite FlatBufferModel for file: "
@@ -58,6 +71,12 @@ std::unique_ptr<TfLiteModelWrapper> TfLiteModelWrapper::Create(
     return nullptr;
   }
 
+  if (resize_inputs != nullptr && !resize_inputs(interpreter.get())) {
+    LOG(ERROR) << "Could not resize the inputs of TFLite model: "
+               << model_file;
+    return nullptr;
+  }
+
   // Start of XNNPack delegate creation.
   if (use_xnn) {
     // Enable XXNPack.
@@ -67,13 +86,23 @@ std::unique_ptr<TfLiteModelWrapper> TfLiteModelWrapper::Create(
         std::unique_ptr<TfLiteDelegate, std::function<void(TfLiteDelegate*)> >(
             TfLiteXNNPackDelegateCreate(&options),
             &TfLiteXNNPackDelegateDelete);
-    // Allow dynamic tensors.
-    // TODO(b/204470960): Remove this flag once the bug is fixed.
-    delegate->flags |= kTfLiteDelegateFlagsAllowDynamicTensors;
+    if (allow_dynamic_tensors) {
+      // TODO(b/204470960): Remove this flag once the bug is fixed.
+      delegate->flags |= kTfLiteDelegateFlagsAllowDynamicTensors;
+    }
 
     auto status = interpreter->ModifyGraphWithDelegate(std::move(delegate));
-    if (status == kTfLiteDelegateError) {
-      LOG(WARNING) << "Failed to set delegate; continuing without.";
+    if (status != kTfLiteOk && !allow_dynamic_tensors) {
+      // Models with static shapes are expected to run on XNNPack, so falling
+      // back to the builtin kernels would silently slow them down.
+      LOG(ERROR) << "Failed to apply XNNPack to model " << model_file
+                 << ", whose tensors should all have static shapes.";
+      return nullptr;
+    } else if (status == kTfLiteApplicationError ||
+               status == kTfLiteDelegateError) {
+      // The graph is left untouched or restored in these cases.
+      LOG(WARNING) << "Failed to apply XNNPack to model " << model_file
+                   << "; continuing without delegate.";
     } else if (status != kTfLiteOk) {
       LOG(ERROR) << "Failed to set delegate, and cannot continue.";
       return nullptr;
@@ -87,17 +116,195 @@ std::unique_ptr<TfLiteModelWrapper> TfLiteModelWrapper::Create(
     return nullptr;
   }
 
+  std::unique_ptr<TfLiteOpProfiler> profiler;
+  if (enable_profiling) {
+    profiler = std::make_unique<TfLiteOpProfiler>();
+    interpreter->SetProfiler(profiler.get());
+  }
+
   return absl::WrapUnique(
-      new TfLiteModelWrapper(std::move(model), std::move(interpreter)));
+      new TfLiteModelWrapper(std::move(model), std::move(profiler),
+                             std::move(interpreter), use_xnn));
 }
 
 TfLiteModelWrapper::TfLiteModelWrapper(
     std::unique_ptr<tflite::FlatBufferModel> model,
-    std::unique_ptr<tflite::Interpreter> interpreter)
-    : model_(std::move(model)), interpreter_(std::move(interpreter)) {}
+    std::unique_ptr<TfLiteOpProfiler> profiler,
+    std::unique_ptr<tflite::Interpreter> interpreter, bool use_xnn)
+    : model_(std::move(model)),
+      profiler_(std::move(profiler)),
+      interpreter_(std::move(interpreter)),
+      use_xnn_(use_xnn),
+      double_buffered_states_(false) {}
 
 bool TfLiteModelWrapper::Invoke() {
-  return interpreter_->Invoke() == kTfLiteOk;
+  if (interpreter_->Invoke() != kTfLiteOk) {
+    return false;
+  }
+  return PassStates();
+}
+
+bool TfLiteModelWrapper::InvokeWithInput(int index,
+                                         absl::Span<const float> input) {
+  const TfLiteTensor* tensor = interpreter_->input_tensor(index);
+  if (tensor->type != kTfLiteFloat32 ||
+      tensor->bytes != input.size() * sizeof(float)) {
+    LOG(ERROR) << "Input " << index << " holds " << tensor->bytes
+               << " bytes, but " << input.size() << " floats were given.";
+    return false;
+  }
+  const bool is_aligned =
+      reinterpret_cast<uintptr_t>(input.data()) % kStateAlignment == 0;
+  if (!is_aligned) {
+    absl::Span<float> input_tensor = get_input_tensor<float>(index);
+    std::copy(input.begin(), input.end(), input_tensor.begin());
+    return Invoke();
+  }
+  auto buffer = input_buffers_.find(index);
+  if (buffer == input_buffers_.end()) {
+    // Move the input from the arena to a buffer owned by the wrapper, which
+    // it can be bound back to after the invoke.
+    AlignedBuffer owned_buffer(
+        ::operator new(tensor->bytes, std::align_val_t(kStateAlignment)));
+    std::memcpy(owned_buffer.get(), tensor->data.raw, tensor->bytes);
+    buffer = input_buffers_.emplace(index, std::move(owned_buffer)).first;
+    if (!BindInput(index, buffer->second.get()) ||
+        interpreter_->AllocateTensors() != kTfLiteOk) {
+      LOG(ERROR) << "Could not bind input " << index << " to its own buffer.";
+      return false;
+    }
+  }
+  // TFLite only takes mutable allocations, but never writes to model inputs.
+  if (!BindInput(index, const_cast<float*>(input.data()))) {
+    return false;
+  }
+  const bool invoked = Invoke();
+  return BindInput(index, buffer->second.get()) && invoked;
+}
+
+bool TfLiteModelWrapper::BindInput(int index, void* data) {
+  if (interpreter_->SetCustomAllocationForTensor(
+          interpreter_->inputs().at(index),
+          {data, interpreter_->input_tensor(index)->bytes}) != kTfLiteOk) {
+    LOG(ERROR) << "Could not bind input " << index << ".";
+    return false;
+  }
+  return true;
+}
+
+bool TfLiteModelWrapper::EnableStates(int first_state_index) {
+  if (!states_.empty()) {
+    LOG(ERROR) << "States are already enabled.";
+    return false;
+  }
+  if (first_state_index < 0 || num_input_tensors() != num_output_tensors()) {
+    LOG(ERROR) << "Model has " << num_input_tensors() << " inputs and "
+               << num_output_tensors() << " outputs, and can not use inputs "
+               << first_state_index << " and onwards as states.";
+    return false;
+  }
+  for (int i = first_state_index; i < num_input_tensors(); ++i) {
+    const TfLiteTensor* input = interpreter_->input_tensor(i);
+    const TfLiteTensor* output = interpreter_->output_tensor(i);
+    if (input->bytes != output->bytes || input->type != output->type) {
+      LOG(ERROR) << "Input state " << i << " does not match output state.";
+      states_.clear();
+      return false;
+    }
+    states_.push_back({interpreter_->inputs().at(i),
+                       interpreter_->outputs().at(i), input->bytes, nullptr,
+                       nullptr});
+  }
+  double_buffered_states_ = BindStateBuffers();
+  if (!double_buffered_states_) {
+    LOG(WARNING) << "Could not double buffer the states, copying them instead.";
+    for (const State& state : states_) {
+      TfLiteTensor* input = interpreter_->tensor(state.input_tensor_index);
+      std::memset(input->data.raw, 0, state.bytes);
+    }
+  }
+  return true;
+}
+
+bool TfLiteModelWrapper::BindStateBuffers() {
+  for (State& state : states_) {
+    state.input_buffer.reset(
+        ::operator new(state.bytes, std::align_val_t(kStateAlignment)));
+    state.output_buffer.reset(
+        ::operator new(state.bytes, std::align_val_t(kStateAlignment)));
+    std::memset(state.input_buffer.get(), 0, state.bytes);
+    if (interpreter_->SetCustomAllocationForTensor(
+            state.input_tensor_index,
+            {state.input_buffer.get(), state.bytes}) != kTfLiteOk ||
+        interpreter_->SetCustomAllocationForTensor(
+            state.output_tensor_index,
+            {state.output_buffer.get(), state.bytes}) != kTfLiteOk) {
+      return false;
+    }
+  }
+  // Validates the custom allocations.
+  return interpreter_->AllocateTensors() == kTfLiteOk;
+}
+
+bool TfLiteModelWrapper::PassStates() {
+  for (State& state : states_) {
+    if (double_buffered_states_) {
+      std::swap(state.input_buffer, state.output_buffer);
+      if (interpreter_->SetCustomAllocationForTensor(
+              state.input_tensor_index,
+              {state.input_buffer.get(), state.bytes}) != kTfLiteOk ||
+          interpreter_->SetCustomAllocationForTensor(
+              state.output_tensor_index,
+              {state.output_buffer.get(), state.bytes}) != kTfLiteOk) {
+        LOG(ERROR) << "Could not swap state buffers.";
+        return false;
+      }
+    } else {
+      const TfLiteTensor* output =
+          interpreter_->tensor(state.output_tensor_index);
+      TfLiteTensor* input = interpreter_->tensor(state.input_tensor_index);
+      std::memcpy(input->data.raw, output->data.raw, state.bytes);
+    }
+  }
+  return true;
+}
+
+int64_t TfLiteModelWrapper::state_bytes() const {
+  int64_t bytes = 0;
+  for (const State& state : states_) {
+    bytes += state.bytes;
+  }
+  return bytes;
+}
+
+bool TfLiteModelWrapper::SaveStates(absl::Span<uint8_t> states) const {
+  if (static_cast<int64_t>(states.size()) != state_bytes()) {
+    LOG(ERROR) << "Model has " << state_bytes() << " bytes of states, but "
+               << states.size() << " bytes were given.";
+    return false;
+  }
+  uint8_t* destination = states.data();
+  for (const State& state : states_) {
+    const TfLiteTensor* input = interpreter_->tensor(state.input_tensor_index);
+    std::memcpy(destination, input->data.raw, state.bytes);
+    destination += state.bytes;
+  }
+  return true;
+}
+
+bool TfLiteModelWrapper::LoadStates(absl::Span<const uint8_t> states) {
+  if (static_cast<int64_t>(states.size()) != state_bytes()) {
+    LOG(ERROR) << "Model has " << state_bytes() << " bytes of states, but "
+               << states.size() << " bytes were given.";
+    return false;
+  }
+  const uint8_t* source = states.data();
+  for (const State& state : states_) {
+    TfLiteTensor* input = interpreter_->tensor(state.input_tensor_index);
+    std::memcpy(input->data.raw, source, state.bytes);
+    source += state.bytes;
+  }
+  return true;
 }
 
 tflite::SignatureRunner* TfLiteModelWrapper::GetSignatureRunner(
@@ -117,5 +324,77 @@ int TfLiteModelWrapper::num_output_tensors() {
   return interpreter_->outputs().size();
 }
 
+std::vector<std::string> TfLiteModelWrapper::GetNonDelegatedOps() const {
+  std::vector<std::string> non_delegated_ops;
+  for (int subgraph_index = 0; subgraph_index < interpreter_->subgraphs_size();
+       ++subgraph_index) {
+    tflite::Subgraph* subgraph = interpreter_->subgraph(subgraph_index);
+    for (const int node_index : subgraph->execution_plan()) {
+      const auto* node_and_registration =
+          subgraph->node_and_registration(node_index);
+      if (node_and_registration->first.delegate != nullptr) {
+        continue;
+      }
+      const TfLiteRegistration& registration = node_and_registration->second;
+      const std::string op_name =
+          registration.builtin_code == tflite::BuiltinOperator_CUSTOM
+              ? registration.custom_name
+              : tflite::EnumNameBuiltinOperator(
+                    static_cast<tflite::BuiltinOperator>(
+                        registration.builtin_code));
+      non_delegated_ops.push_back(absl::StrFormat(
+          "%s (subgraph %d, node %d)", op_name, subgraph_index, node_index));
+    }
+  }
+  return non_delegated_ops;
+}
+
+std::string TfLiteModelWrapper::GetProfileReport() const {
+  if (profiler_ == nullptr) {
+    return "";
+  }
+  const std::vector<OpProfile> profiles = profiler_->GetOpProfiles();
+  absl::Duration total_time;
+  for (const OpProfile& profile : profiles) {
+    // Ops inside a delegate partition are already part of its time.
+    if (!profile.is_delegate_op) {
+      total_time += profile.total_time;
+    }
+  }
+  std::string report = absl::StrFormat(
+      "%-40s %8s %8s %10s %10s %7s\n", "op", "subgraph", "node", "invokes",
+      "mean us", "share");
+  for (const OpProfile& profile : profiles) {
+    const std::string name =
+        profile.is_delegate_op ? absl::StrCat("  ", profile.name)
+                               : profile.name;
+    absl::StrAppendFormat(
+        &report, "%-40s %8d %8d %10d %10.1f %6.1f%%\n", name,
+        profile.subgraph_index, profile.node_index, profile.num_invokes,
+        absl::ToDoubleMicroseconds(profile.total_time) /
+            std::max<int64_t>(profile.num_invokes, 1),
+        total_time > absl::ZeroDuration()
+            ? 100.0 * absl::FDivDuration(profile.total_time, total_time)
+            : 0.0);
+  }
+  absl::StrAppend(&report, GetDelegationReport());
+  return report;
+}
+
+std::string TfLiteModelWrapper::GetDelegationReport() const {
+  if (!use_xnn_) {
+    return "";
+  }
+  const std::vector<std::string> non_delegated_ops = GetNonDelegatedOps();
+  std::string report =
+      absl::StrFormat("%d ops fell back from XNNPack to builtin kernels%s\n",
+                      non_delegated_ops.size(),
+                      non_delegated_ops.empty() ? "." : ":");
+  for (const std::string& op : non_delegated_ops) {
+    absl::StrAppend(&report, "  ", op, "\n");
+  }
+  return report;
+}
+
 }  // namespace codec
 }  // namespace chromemedia
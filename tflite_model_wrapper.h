@@ -17,25 +17,83 @@
 #ifndef THIRD_PARTY_LYRA_CODEC_TFLITE_MODEL_WRAPPER_H_
 #define THIRD_PARTY_LYRA_CODEC_TFLITE_MODEL_WRAPPER_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <map>
 #include <memory>
+#include <new>
+#include <string>
+#include <vector>
 
 #include "absl/types/span.h"
 #include "include/ghc/filesystem.hpp"
 #include "tensorflow/lite/interpreter.h"
 #include "tensorflow/lite/model_builder.h"
 #include "tensorflow/lite/signature_runner.h"
+#include "tflite_op_profiler.h"
 
 namespace chromemedia {
 namespace codec {
 
 class TfLiteModelWrapper {
  public:
+  // If |enable_profiling| is true the time of every op is aggregated across
+  // invokes, at the cost of some overhead per op.
+  // Models whose tensors all have static shapes should pass
+  // |allow_dynamic_tensors| = false, which lets XNNPack plan its memory once
+  // and take over every op it supports. Creation then fails if XNNPack cannot
+  // be applied. Inputs must not be resized after creation in that case, so
+  // |resize_inputs| is called before the delegate is applied to give them
+  // their final shapes, and creation fails if it returns false.
   static std::unique_ptr<TfLiteModelWrapper> Create(
-      const ghc::filesystem::path& model_file, bool use_xnn);
+      const ghc::filesystem::path& model_file, bool use_xnn,
+      bool enable_profiling = false, bool allow_dynamic_tensors = true,
+      const std::function<bool(tflite::Interpreter*)>& resize_inputs =
+          nullptr);
 
+  // If states were enabled with |EnableStates|, also passes the output states
+  // on to the input states of the next invoke.
   bool Invoke();
 
+  // Invokes the model with |input| as input tensor |index|. If |input| is
+  // aligned like the TFLite arena it is bound as the tensor without a copy,
+  // otherwise it is copied into the tensor. The binding only lasts for this
+  // invoke. The model must not write to its inputs, which TFLite models do
+  // not.
+  bool InvokeWithInput(int index, absl::Span<const float> input);
+
+  // Treats input and output tensor |i| as the state of a streaming model for
+  // every i >= |first_state_index|: after each |Invoke| the output state
+  // becomes the next input state. Where TFLite accepts custom allocations the
+  // two tensors are bound to a pair of buffers which are swapped after each
+  // invoke, otherwise the output states are copied. All states start out as
+  // zeros. Returns false if the input and output states do not match.
+  bool EnableStates(int first_state_index);
+
+  // Returns the number of bytes held by all states. Without double buffering
+  // this many bytes are read and written again after every invoke.
+  int64_t state_bytes() const;
+
+  // Copies the states the next invoke reads into |states|, which has to hold
+  // state_bytes() bytes. Together with |LoadStates| this lets one wrapper take
+  // turns serving many streams, each of which only keeps its states between
+  // invokes.
+  bool SaveStates(absl::Span<uint8_t> states) const;
+
+  // Makes |states|, as written by |SaveStates|, the states the next invoke
+  // reads.
+  bool LoadStates(absl::Span<const uint8_t> states);
+
+  // Returns true if the states are passed on by swapping buffers.
+  bool double_buffered_states() const { return double_buffered_states_; }
+
+  // Returns the memory traffic per invoke which double buffering saves over
+  // copying the states, counting both the reads and the writes.
+  int64_t saved_state_copy_bytes() const {
+    return double_buffered_states_ ? 2 * state_bytes() : 0;
+  }
+
   tflite::SignatureRunner* GetSignatureRunner(const char* signature);
 
   bool ResetVariableTensors();
@@ -44,6 +102,23 @@ class TfLiteModelWrapper {
 
   int num_output_tensors();
 
+  // Returns nullptr if profiling is not enabled.
+  const TfLiteOpProfiler* profiler() const { return profiler_.get(); }
+
+  // Returns the names of the ops which are run by the builtin kernels, as
+  // "<op name> (subgraph <index>, node <index>)". If XNNPack was requested
+  // these are the ops it could not take over.
+  std::vector<std::string> GetNonDelegatedOps() const;
+
+  // Returns a human readable list of the ops which fell back from XNNPack to
+  // the builtin kernels. Returns an empty string if XNNPack was not requested.
+  std::string GetDelegationReport() const;
+
+  // Returns a human readable table of the op profiles followed by the ops
+  // which fell back from XNNPack to the builtin kernels. Returns an empty
+  // string if profiling is not enabled.
+  std::string GetProfileReport() const;
+
   template <class T>
   absl::Span<T> get_input_tensor(int index) {
     return absl::Span<T>(interpreter_->typed_input_tensor<T>(index),
@@ -59,10 +134,53 @@ class TfLiteModelWrapper {
 
  private:
   TfLiteModelWrapper(std::unique_ptr<tflite::FlatBufferModel> model,
-                     std::unique_ptr<tflite::Interpreter> interpreter);
+                     std::unique_ptr<TfLiteOpProfiler> profiler,
+                     std::unique_ptr<tflite::Interpreter> interpreter,
+                     bool use_xnn);
 
   std::unique_ptr<tflite::FlatBufferModel> model_;
+  // Declared before |interpreter_| so it outlives it.
+  std::unique_ptr<TfLiteOpProfiler> profiler_;
+  // Matches the alignment of the TFLite tensor arena, which custom
+  // allocations have to satisfy.
+  static constexpr size_t kStateAlignment = 64;
+
+  struct AlignedDelete {
+    void operator()(void* data) const {
+      ::operator delete(data, std::align_val_t(kStateAlignment));
+    }
+  };
+  using AlignedBuffer = std::unique_ptr<void, AlignedDelete>;
+
+  // The input and output tensor of one state, and the buffers they are bound
+  // to when double buffering.
+  struct State {
+    int input_tensor_index;
+    int output_tensor_index;
+    size_t bytes;
+    AlignedBuffer input_buffer;
+    AlignedBuffer output_buffer;
+  };
+
+  // Tries to bind every state to a pair of zeroed buffers.
+  bool BindStateBuffers();
+
+  // Binds input tensor |index| to |data|, which has to hold the size of the
+  // tensor.
+  bool BindInput(int index, void* data);
+
+  // Makes the output states the next input states.
+  bool PassStates();
+
+  // Tensors are bound to the buffers of |states_| and |input_buffers_|, so
+  // they are declared before |interpreter_| to outlive it.
+  std::vector<State> states_;
+  // Buffers owned by the wrapper which inputs are bound to outside of
+  // |InvokeWithInput|, by input index.
+  std::map<int, AlignedBuffer> input_buffers_;
   std::unique_ptr<tflite::Interpreter> interpreter_;
+  const bool use_xnn_;
+  bool double_buffered_states_;
 };
 
 }  // namespace codec
@@ -17,13 +17,16 @@
 #include "tflite_model_wrapper.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 // Placeholder for get runfiles header.
 #include "absl/types/span.h"
 #include "gtest/gtest.h"
 #include "include/ghc/filesystem.hpp"
+#include "tflite_op_profiler.h"
 
 namespace chromemedia {
 namespace codec {
@@ -41,6 +44,79 @@ TEST(TfliteUtilsTest, CreateSucceedsAndMethodsRun) {
   std::fill(input.begin(), input.end(), 0);
   EXPECT_TRUE(model_wrapper->Invoke());
   EXPECT_TRUE(model_wrapper->ResetVariableTensors());
+  EXPECT_EQ(model_wrapper->profiler(), nullptr);
+  EXPECT_TRUE(model_wrapper->GetProfileReport().empty());
+}
+
+TEST(TfLiteModelWrapperTest, EnabledStatesMatchCopiedStates) {
+  const auto model_file =
+      ghc::filesystem::current_path() / "model_coeffs/lyragan.tflite";
+  auto stateful_wrapper = TfLiteModelWrapper::Create(model_file, true);
+  ASSERT_NE(stateful_wrapper, nullptr);
+  ASSERT_TRUE(stateful_wrapper->EnableStates(1));
+  EXPECT_GT(stateful_wrapper->state_bytes(), 0);
+  auto copying_wrapper = TfLiteModelWrapper::Create(model_file, true);
+  ASSERT_NE(copying_wrapper, nullptr);
+  for (int i = 1; i < copying_wrapper->num_input_tensors(); ++i) {
+    absl::Span<float> state = copying_wrapper->get_input_tensor<float>(i);
+    std::fill(state.begin(), state.end(), 0.f);
+  }
+
+  for (int frame = 0; frame < 5; ++frame) {
+    for (auto* wrapper : {stateful_wrapper.get(), copying_wrapper.get()}) {
+      absl::Span<float> input = wrapper->get_input_tensor<float>(0);
+      std::fill(input.begin(), input.end(), 0.1f * frame);
+      ASSERT_TRUE(wrapper->Invoke());
+    }
+    for (int i = 1; i < copying_wrapper->num_input_tensors(); ++i) {
+      absl::Span<float> input_state =
+          copying_wrapper->get_input_tensor<float>(i);
+      absl::Span<const float> output_state =
+          copying_wrapper->get_output_tensor<float>(i);
+      std::copy(output_state.begin(), output_state.end(), input_state.begin());
+    }
+    EXPECT_EQ(stateful_wrapper->get_output_tensor<float>(0),
+              copying_wrapper->get_output_tensor<float>(0))
+        << "frame=" << frame;
+  }
+}
+
+TEST(TfLiteModelWrapperTest, SavedStatesMustMatchStateBytes) {
+  auto model_wrapper = TfLiteModelWrapper::Create(
+      ghc::filesystem::current_path() / "model_coeffs/lyragan.tflite", true);
+  ASSERT_NE(model_wrapper, nullptr);
+  ASSERT_TRUE(model_wrapper->EnableStates(1));
+  std::vector<uint8_t> states(model_wrapper->state_bytes());
+
+  EXPECT_TRUE(model_wrapper->SaveStates(absl::MakeSpan(states)));
+  EXPECT_TRUE(model_wrapper->LoadStates(states));
+  states.pop_back();
+  EXPECT_FALSE(model_wrapper->SaveStates(absl::MakeSpan(states)));
+  EXPECT_FALSE(model_wrapper->LoadStates(states));
+}
+
+TEST(TfLiteModelWrapperTest, ProfilingAggregatesOpTimes) {
+  auto model_wrapper = TfLiteModelWrapper::Create(
+      ghc::filesystem::current_path() / "model_coeffs/lyragan.tflite", true,
+      /*enable_profiling=*/true);
+  ASSERT_NE(model_wrapper, nullptr);
+  ASSERT_NE(model_wrapper->profiler(), nullptr);
+  absl::Span<float> input = model_wrapper->get_input_tensor<float>(0);
+  std::fill(input.begin(), input.end(), 0);
+  const int kNumInvokes = 5;
+  for (int i = 0; i < kNumInvokes; ++i) {
+    ASSERT_TRUE(model_wrapper->Invoke());
+  }
+  const std::vector<OpProfile> profiles =
+      model_wrapper->profiler()->GetOpProfiles();
+  ASSERT_FALSE(profiles.empty());
+  for (const OpProfile& profile : profiles) {
+    if (!profile.is_delegate_op) {
+      EXPECT_EQ(profile.num_invokes, kNumInvokes) << profile.name;
+    }
+  }
+  EXPECT_NE(model_wrapper->GetProfileReport().find("XNNPack"),
+            std::string::npos);
 }
 
 }  // namespace
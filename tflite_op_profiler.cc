@@ -0,0 +1,81 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tflite_op_profiler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tensorflow/lite/core/api/profiler.h"
+
+namespace chromemedia {
+namespace codec {
+
+uint32_t TfLiteOpProfiler::BeginEvent(const char* tag, EventType event_type,
+                                      int64_t event_metadata1,
+                                      int64_t event_metadata2) {
+  // For both event types the first metadata is the node index and the second
+  // the subgraph index. Runtime instrumentation events are of no interest.
+  const bool is_delegate_op =
+      event_type == EventType::DELEGATE_OPERATOR_INVOKE_EVENT;
+  if (event_type != EventType::OPERATOR_INVOKE_EVENT && !is_delegate_op) {
+    return 0;
+  }
+  ProfileKey key(event_metadata2, event_metadata1, is_delegate_op,
+                 tag != nullptr ? tag : "");
+  auto it = profile_indices_.find(key);
+  if (it == profile_indices_.end()) {
+    profiles_.push_back({std::get<3>(key), static_cast<int>(event_metadata2),
+                         static_cast<int>(event_metadata1), is_delegate_op, 0,
+                         absl::ZeroDuration()});
+    it = profile_indices_.emplace(std::move(key), profiles_.size() - 1).first;
+  }
+  open_events_.push_back({it->second, absl::Now()});
+  return open_events_.size();
+}
+
+void TfLiteOpProfiler::EndEvent(uint32_t event_handle) {
+  if (event_handle == 0 || event_handle != open_events_.size()) {
+    return;
+  }
+  const absl::Time end = absl::Now();
+  const OpenEvent& event = open_events_.back();
+  OpProfile& profile = profiles_.at(event.profile_index);
+  ++profile.num_invokes;
+  profile.total_time += end - event.start;
+  open_events_.pop_back();
+}
+
+std::vector<OpProfile> TfLiteOpProfiler::GetOpProfiles() const {
+  std::vector<OpProfile> profiles = profiles_;
+  std::stable_sort(profiles.begin(), profiles.end(),
+                   [](const OpProfile& a, const OpProfile& b) {
+                     return a.total_time > b.total_time;
+                   });
+  return profiles;
+}
+
+void TfLiteOpProfiler::Reset() {
+  profile_indices_.clear();
+  profiles_.clear();
+  open_events_.clear();
+}
+
+}  // namespace codec
+}  // namespace chromemedia
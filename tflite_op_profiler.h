@@ -0,0 +1,80 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_TFLITE_OP_PROFILER_H_
+#define LYRA_CODEC_TFLITE_OP_PROFILER_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "tensorflow/lite/core/api/profiler.h"
+
+namespace chromemedia {
+namespace codec {
+
+// Time spent in one node of a TFLite graph, aggregated over many invokes.
+struct OpProfile {
+  // The op name, or the delegate name if the node is a delegate partition.
+  std::string name;
+  int subgraph_index;
+  int node_index;
+  // True if the time was reported by a delegate for an op inside one of its
+  // partitions. Those ops are also accounted for in their partition's time.
+  bool is_delegate_op;
+  int64_t num_invokes;
+  absl::Duration total_time;
+};
+
+// A TFLite profiler which aggregates the time of every op and delegate
+// partition, instead of recording a trace of individual events. Meant to be
+// installed on a single interpreter which is invoked from one thread.
+class TfLiteOpProfiler : public tflite::Profiler {
+ public:
+  uint32_t BeginEvent(const char* tag, EventType event_type,
+                      int64_t event_metadata1,
+                      int64_t event_metadata2) override;
+
+  using tflite::Profiler::EndEvent;
+  void EndEvent(uint32_t event_handle) override;
+
+  // Returns the profiles sorted by decreasing total time.
+  std::vector<OpProfile> GetOpProfiles() const;
+
+  void Reset();
+
+ private:
+  struct OpenEvent {
+    int profile_index;
+    absl::Time start;
+  };
+
+  // Subgraph index, node index, delegate op and name.
+  using ProfileKey = std::tuple<int64_t, int64_t, bool, std::string>;
+
+  std::map<ProfileKey, int> profile_indices_;
+  std::vector<OpProfile> profiles_;
+  // TFLite events nest, so the handle of an event is its depth in this stack.
+  std::vector<OpenEvent> open_events_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_TFLITE_OP_PROFILER_H_
@@ -0,0 +1,86 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tflite_op_profiler.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "tensorflow/lite/core/api/profiler.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+using EventType = tflite::Profiler::EventType;
+
+TEST(TfLiteOpProfilerTest, AggregatesOpsAcrossInvokes) {
+  TfLiteOpProfiler profiler;
+  for (int i = 0; i < 3; ++i) {
+    const uint32_t conv = profiler.BeginEvent(
+        "CONV_2D", EventType::OPERATOR_INVOKE_EVENT, /*node_index=*/0,
+        /*subgraph_index=*/0);
+    absl::SleepFor(absl::Milliseconds(2));
+    profiler.EndEvent(conv);
+    const uint32_t add = profiler.BeginEvent(
+        "ADD", EventType::OPERATOR_INVOKE_EVENT, /*node_index=*/1,
+        /*subgraph_index=*/0);
+    profiler.EndEvent(add);
+  }
+
+  const std::vector<OpProfile> profiles = profiler.GetOpProfiles();
+  ASSERT_EQ(profiles.size(), 2);
+  EXPECT_EQ(profiles.at(0).name, "CONV_2D");
+  EXPECT_EQ(profiles.at(0).node_index, 0);
+  EXPECT_EQ(profiles.at(0).num_invokes, 3);
+  EXPECT_GE(profiles.at(0).total_time, absl::Milliseconds(6));
+  EXPECT_EQ(profiles.at(1).name, "ADD");
+  EXPECT_EQ(profiles.at(1).num_invokes, 3);
+}
+
+TEST(TfLiteOpProfilerTest, SeparatesDelegateOpsAndIgnoresOtherEvents) {
+  TfLiteOpProfiler profiler;
+  const uint32_t invoke =
+      profiler.BeginEvent("Invoke", EventType::DEFAULT, 0, 0);
+  const uint32_t partition = profiler.BeginEvent(
+      "TfLiteXNNPackDelegate", EventType::OPERATOR_INVOKE_EVENT,
+      /*node_index=*/4, /*subgraph_index=*/1);
+  const uint32_t delegate_op = profiler.BeginEvent(
+      "Fully Connected (NC, F32)",
+      EventType::DELEGATE_OPERATOR_INVOKE_EVENT, 0, 1);
+  profiler.EndEvent(delegate_op);
+  profiler.EndEvent(partition);
+  profiler.EndEvent(invoke);
+
+  const std::vector<OpProfile> profiles = profiler.GetOpProfiles();
+  ASSERT_EQ(profiles.size(), 2);
+  int num_delegate_ops = 0;
+  for (const OpProfile& profile : profiles) {
+    EXPECT_NE(profile.name, "Invoke");
+    EXPECT_EQ(profile.subgraph_index, 1);
+    EXPECT_EQ(profile.num_invokes, 1);
+    num_delegate_ops += profile.is_delegate_op;
+  }
+  EXPECT_EQ(num_delegate_ops, 1);
+
+  profiler.Reset();
+  EXPECT_TRUE(profiler.GetOpProfiles().empty());
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
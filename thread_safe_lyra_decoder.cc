@@ -0,0 +1,143 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "thread_safe_lyra_decoder.h"
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/types/span.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "lyra_decoder_interface.h"
+#include "redundant_packet.h"
+#include "shared_memory_ring.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+// Types of the records in the ring.
+enum RecordType : uint8_t {
+  kEncodedPacket = 0,
+  kRedundantPacket = 1,
+};
+
+}  // namespace
+
+std::unique_ptr<ThreadSafeLyraDecoder> ThreadSafeLyraDecoder::Create(
+    std::unique_ptr<LyraDecoderInterface> decoder,
+    int max_num_queued_packets) {
+  if (decoder == nullptr) {
+    LOG(ERROR) << "Decoder must not be null.";
+    return nullptr;
+  }
+  if (max_num_queued_packets <= 0) {
+    LOG(ERROR) << "Maximum number of queued packets has to be positive, but "
+               << "is " << max_num_queued_packets << ".";
+    return nullptr;
+  }
+  const int capacity = max_num_queued_packets *
+                       SharedMemoryRing::GetRecordBytes(GetMaxPacketSize());
+  AlignedMemory ring_memory(
+      ::operator new(SharedMemoryRing::GetRequiredBytes(capacity),
+                     std::align_val_t(kRingAlignment)));
+  auto ring = SharedMemoryRing::Create(ring_memory.get(), capacity);
+  if (ring == nullptr) {
+    return nullptr;
+  }
+  return absl::WrapUnique(new ThreadSafeLyraDecoder(
+      std::move(decoder), std::move(ring_memory), std::move(ring)));
+}
+
+ThreadSafeLyraDecoder::ThreadSafeLyraDecoder(
+    std::unique_ptr<LyraDecoderInterface> decoder, AlignedMemory ring_memory,
+    std::unique_ptr<SharedMemoryRing> ring)
+    : decoder_(std::move(decoder)),
+      ring_memory_(std::move(ring_memory)),
+      ring_(std::move(ring)),
+      max_packet_size_(GetMaxPacketSize()),
+      num_dropped_packets_(0) {
+  packet_.reserve(max_packet_size_);
+}
+
+bool ThreadSafeLyraDecoder::SetEncodedPacket(
+    absl::Span<const uint8_t> encoded) {
+  return QueuePacket(kEncodedPacket, encoded);
+}
+
+bool ThreadSafeLyraDecoder::SetRedundantPacket(
+    absl::Span<const uint8_t> next_encoded) {
+  return QueuePacket(kRedundantPacket, next_encoded);
+}
+
+std::optional<std::vector<int16_t>> ThreadSafeLyraDecoder::DecodeSamples(
+    int num_samples) {
+  DrainPackets();
+  return decoder_->DecodeSamples(num_samples);
+}
+
+bool ThreadSafeLyraDecoder::DecodeSamplesInto(absl::Span<int16_t> samples) {
+  DrainPackets();
+  return decoder_->DecodeSamplesInto(samples);
+}
+
+std::optional<std::vector<float>> ThreadSafeLyraDecoder::DecodeFloatSamples(
+    int num_samples) {
+  DrainPackets();
+  return decoder_->DecodeFloatSamples(num_samples);
+}
+
+int ThreadSafeLyraDecoder::sample_rate_hz() const {
+  return decoder_->sample_rate_hz();
+}
+
+int ThreadSafeLyraDecoder::num_channels() const {
+  return decoder_->num_channels();
+}
+
+int ThreadSafeLyraDecoder::frame_rate() const {
+  return decoder_->frame_rate();
+}
+
+bool ThreadSafeLyraDecoder::is_comfort_noise() const {
+  return decoder_->is_comfort_noise();
+}
+
+bool ThreadSafeLyraDecoder::QueuePacket(uint8_t type,
+                                        absl::Span<const uint8_t> packet) {
+  // Larger packets are invalid anyway, and would make draining allocate.
+  if (packet.size() > max_packet_size_) {
+    return false;
+  }
+  return ring_->Write(type, packet);
+}
+
+void ThreadSafeLyraDecoder::DrainPackets() {
+  while (const std::optional<uint8_t> type = ring_->Read(&packet_)) {
+    const bool success = type.value() == kRedundantPacket
+                             ? decoder_->SetRedundantPacket(packet_)
+                             : decoder_->SetEncodedPacket(packet_);
+    if (!success) {
+      ++num_dropped_packets_;
+    }
+  }
+}
+
+}  // namespace codec
+}  // namespace chromemedia
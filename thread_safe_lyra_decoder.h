@@ -0,0 +1,144 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_THREAD_SAFE_LYRA_DECODER_H_
+#define LYRA_CODEC_THREAD_SAFE_LYRA_DECODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "lyra_decoder_interface.h"
+#include "shared_memory_ring.h"
+
+namespace chromemedia {
+namespace codec {
+
+/// Lets a network thread set packets while an audio thread decodes.
+///
+/// Packets are not passed to the decoder right away but pushed into a
+/// single-producer single-consumer ring. Every decode call first drains the
+/// ring into the wrapped decoder on the audio thread, so the network thread
+/// never has to wait for a decode to finish.
+///
+/// SetEncodedPacket() and SetRedundantPacket() may only be called from one
+/// thread, the network thread. The decode methods and is_comfort_noise() may
+/// only be called from one other thread, the audio thread. The remaining
+/// getters may be called from any thread.
+///
+/// Queueing a packet takes no lock and never allocates. Passing it on to the
+/// wrapped decoder and decoding both allocate inside the wrapped decoder, on
+/// every decode call and also in DecodeSamplesInto(). So the decode methods
+/// are not real-time safe.
+class ThreadSafeLyraDecoder : public LyraDecoderInterface {
+ public:
+  /// Static method to create a ThreadSafeLyraDecoder.
+  ///
+  /// @param decoder Decoder which is only accessed from the audio thread.
+  /// @param max_num_queued_packets Number of packets of the largest size which
+  ///                               can be queued before the audio thread
+  ///                               drains them.
+  /// @return A unique_ptr to a |ThreadSafeLyraDecoder| on success, else
+  ///         nullptr.
+  static std::unique_ptr<ThreadSafeLyraDecoder> Create(
+      std::unique_ptr<LyraDecoderInterface> decoder,
+      int max_num_queued_packets);
+
+  /// Queues a packet. Never blocks.
+  ///
+  /// @param encoded Encoded packet as a span of bytes.
+  /// @return True if the packet was queued. False if the queue is full or the
+  ///         packet is larger than any valid packet. The packet is only
+  ///         validated when it is drained, and invalid packets are then
+  ///         dropped.
+  bool SetEncodedPacket(absl::Span<const uint8_t> encoded) override;
+
+  /// Queues the packet of the frame after a lost one, whose redundant copy
+  /// replaces the concealment of the lost frame. Never blocks.
+  ///
+  /// @param next_encoded Encoded packet of the frame after the lost one.
+  /// @return True if the packet was queued. False if the queue is full or the
+  ///         packet is larger than any valid packet.
+  bool SetRedundantPacket(absl::Span<const uint8_t> next_encoded) override;
+
+  /// Drains the queued packets and decodes samples.
+  ///
+  /// @param num_samples Number of samples to decode.
+  /// @return Vector of int16-formatted samples, or nullopt on failure.
+  std::optional<std::vector<int16_t>> DecodeSamples(int num_samples) override;
+
+  /// Drains the queued packets and decodes samples into |samples|.
+  ///
+  /// @param samples Buffer to decode |samples.size()| samples into.
+  /// @return True on success.
+  bool DecodeSamplesInto(absl::Span<int16_t> samples) override;
+
+  /// Drains the queued packets and decodes float samples.
+  ///
+  /// @param num_samples Number of samples to decode.
+  /// @return Vector of float samples, or nullopt on failure.
+  std::optional<std::vector<float>> DecodeFloatSamples(
+      int num_samples) override;
+
+  int sample_rate_hz() const override;
+
+  int num_channels() const override;
+
+  int frame_rate() const override;
+
+  bool is_comfort_noise() const override;
+
+  /// @return Number of queued packets the decoder rejected. May only be
+  ///         called from the audio thread.
+  int num_dropped_packets() const { return num_dropped_packets_; }
+
+ private:
+  static constexpr size_t kRingAlignment = 64;
+
+  struct AlignedDelete {
+    void operator()(void* memory) const {
+      ::operator delete(memory, std::align_val_t(kRingAlignment));
+    }
+  };
+  using AlignedMemory = std::unique_ptr<void, AlignedDelete>;
+
+  ThreadSafeLyraDecoder(std::unique_ptr<LyraDecoderInterface> decoder,
+                        AlignedMemory ring_memory,
+                        std::unique_ptr<SharedMemoryRing> ring);
+
+  // Called from the network thread.
+  bool QueuePacket(uint8_t type, absl::Span<const uint8_t> packet);
+
+  // Called from the audio thread. Passes all queued packets to |decoder_|.
+  void DrainPackets();
+
+  const std::unique_ptr<LyraDecoderInterface> decoder_;
+  const AlignedMemory ring_memory_;
+  const std::unique_ptr<SharedMemoryRing> ring_;
+  const int max_packet_size_;
+  // Reserved for the largest packet, so draining never allocates.
+  std::vector<uint8_t> packet_;
+  int num_dropped_packets_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_THREAD_SAFE_LYRA_DECODER_H_
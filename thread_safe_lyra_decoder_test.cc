@@ -0,0 +1,183 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "thread_safe_lyra_decoder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "lyra_config.h"
+#include "lyra_decoder_interface.h"
+#include "redundant_packet.h"
+#include "testing/mock_lyra_decoder.h"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+using testing::_;
+using testing::ElementsAre;
+using testing::InSequence;
+using testing::Return;
+using testing::StrictMock;
+
+constexpr int kNumSamples = 320;
+
+TEST(ThreadSafeLyraDecoderTest, CreateFailsForInvalidParameters) {
+  EXPECT_EQ(ThreadSafeLyraDecoder::Create(nullptr, 1), nullptr);
+  EXPECT_EQ(ThreadSafeLyraDecoder::Create(
+                std::make_unique<StrictMock<MockLyraDecoder>>(), 0),
+            nullptr);
+}
+
+TEST(ThreadSafeLyraDecoderTest, QueuedPacketsAreSetBeforeDecoding) {
+  auto mock_decoder = std::make_unique<StrictMock<MockLyraDecoder>>();
+  {
+    InSequence sequence;
+    EXPECT_CALL(*mock_decoder, SetEncodedPacket(ElementsAre(1, 2)))
+        .WillOnce(Return(true));
+    EXPECT_CALL(*mock_decoder, SetRedundantPacket(ElementsAre(3)))
+        .WillOnce(Return(true));
+    EXPECT_CALL(*mock_decoder, SetEncodedPacket(ElementsAre(3)))
+        .WillOnce(Return(false));
+    EXPECT_CALL(*mock_decoder, DecodeSamples(kNumSamples))
+        .WillOnce(Return(std::vector<int16_t>(kNumSamples)));
+    EXPECT_CALL(*mock_decoder, DecodeFloatSamples(kNumSamples))
+        .WillOnce(Return(std::vector<float>(kNumSamples)));
+    EXPECT_CALL(*mock_decoder, SetEncodedPacket(ElementsAre(4)))
+        .WillOnce(Return(true));
+    EXPECT_CALL(*mock_decoder, DecodeSamplesInto(_)).WillOnce(Return(true));
+  }
+  auto decoder = ThreadSafeLyraDecoder::Create(std::move(mock_decoder), 4);
+  ASSERT_NE(decoder, nullptr);
+
+  // Nothing reaches the wrapped decoder before the audio side decodes.
+  EXPECT_TRUE(decoder->SetEncodedPacket(std::vector<uint8_t>{1, 2}));
+  EXPECT_TRUE(decoder->SetRedundantPacket(std::vector<uint8_t>{3}));
+  EXPECT_TRUE(decoder->SetEncodedPacket(std::vector<uint8_t>{3}));
+  EXPECT_TRUE(decoder->DecodeSamples(kNumSamples).has_value());
+  EXPECT_EQ(decoder->num_dropped_packets(), 1);
+  EXPECT_TRUE(decoder->DecodeFloatSamples(kNumSamples).has_value());
+  EXPECT_TRUE(decoder->SetEncodedPacket(std::vector<uint8_t>{4}));
+  std::vector<int16_t> samples(kNumSamples);
+  EXPECT_TRUE(decoder->DecodeSamplesInto(absl::MakeSpan(samples)));
+}
+
+TEST(ThreadSafeLyraDecoderTest, FullQueueRejectsPackets) {
+  auto mock_decoder = std::make_unique<StrictMock<MockLyraDecoder>>();
+  EXPECT_CALL(*mock_decoder, SetEncodedPacket(_)).WillOnce(Return(true));
+  EXPECT_CALL(*mock_decoder, DecodeSamples(kNumSamples))
+      .WillOnce(Return(std::vector<int16_t>(kNumSamples)));
+  auto decoder = ThreadSafeLyraDecoder::Create(std::move(mock_decoder), 1);
+  ASSERT_NE(decoder, nullptr);
+
+  const std::vector<uint8_t> packet(GetMaxPacketSize());
+  EXPECT_FALSE(
+      decoder->SetEncodedPacket(std::vector<uint8_t>(GetMaxPacketSize() + 1)));
+  EXPECT_TRUE(decoder->SetEncodedPacket(packet));
+  EXPECT_FALSE(decoder->SetEncodedPacket(packet));
+  EXPECT_TRUE(decoder->DecodeSamples(kNumSamples).has_value());
+  EXPECT_TRUE(decoder->SetEncodedPacket(packet));
+}
+
+// Records the sequence numbers of the packets it is given. Only called from
+// the audio thread.
+class SequenceRecordingDecoder : public LyraDecoderInterface {
+ public:
+  explicit SequenceRecordingDecoder(std::vector<uint32_t>* sequence_numbers)
+      : sequence_numbers_(sequence_numbers) {}
+
+  bool SetEncodedPacket(absl::Span<const uint8_t> encoded) override {
+    uint32_t sequence_number;
+    std::memcpy(&sequence_number, encoded.data(), sizeof(sequence_number));
+    sequence_numbers_->push_back(sequence_number);
+    return true;
+  }
+
+  bool SetRedundantPacket(absl::Span<const uint8_t> next_encoded) override {
+    return false;
+  }
+
+  std::optional<std::vector<int16_t>> DecodeSamples(int num_samples) override {
+    return std::vector<int16_t>(num_samples);
+  }
+
+  bool DecodeSamplesInto(absl::Span<int16_t> samples) override {
+    std::fill(samples.begin(), samples.end(), 0);
+    return true;
+  }
+
+  std::optional<std::vector<float>> DecodeFloatSamples(
+      int num_samples) override {
+    return std::vector<float>(num_samples);
+  }
+
+  int sample_rate_hz() const override { return 16000; }
+  int num_channels() const override { return kNumChannels; }
+  int frame_rate() const override { return 50; }
+  bool is_comfort_noise() const override { return false; }
+
+ private:
+  std::vector<uint32_t>* const sequence_numbers_;
+};
+
+TEST(ThreadSafeLyraDecoderTest, ConcurrentNetworkAndAudioThreads) {
+  constexpr uint32_t kNumPackets = 20000;
+  std::vector<uint32_t> sequence_numbers;
+  sequence_numbers.reserve(kNumPackets);
+  auto decoder = ThreadSafeLyraDecoder::Create(
+      std::make_unique<SequenceRecordingDecoder>(&sequence_numbers),
+      /*max_num_queued_packets=*/4);
+  ASSERT_NE(decoder, nullptr);
+
+  // Packets of varying size, so records wrap around the ring at every offset.
+  std::thread network_thread([&decoder]() {
+    for (uint32_t i = 0; i < kNumPackets;) {
+      std::vector<uint8_t> packet(sizeof(i) + i % 50);
+      std::memcpy(packet.data(), &i, sizeof(i));
+      if (decoder->SetEncodedPacket(packet)) {
+        ++i;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+  std::thread audio_thread([&decoder, &sequence_numbers]() {
+    std::vector<int16_t> samples(kNumSamples);
+    while (sequence_numbers.size() < kNumPackets) {
+      ASSERT_TRUE(decoder->DecodeSamplesInto(absl::MakeSpan(samples)));
+      std::this_thread::yield();
+    }
+  });
+  network_thread.join();
+  audio_thread.join();
+
+  ASSERT_EQ(sequence_numbers.size(), kNumPackets);
+  for (uint32_t i = 0; i < kNumPackets; ++i) {
+    ASSERT_EQ(sequence_numbers[i], i);
+  }
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,100 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "trace_network_model.h"
+
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/time/time.h"
+#include "glog/logging.h"  // IWYU pragma: keep
+#include "include/ghc/filesystem.hpp"
+
+namespace chromemedia {
+namespace codec {
+
+std::unique_ptr<TraceNetworkModel> TraceNetworkModel::Create(
+    const ghc::filesystem::path& trace_path) {
+  std::ifstream trace_stream(trace_path.string());
+  if (!trace_stream.is_open()) {
+    LOG(ERROR) << "Could not open network trace " << trace_path;
+    return nullptr;
+  }
+  const std::string trace{std::istreambuf_iterator<char>(trace_stream),
+                          std::istreambuf_iterator<char>()};
+  return CreateFromString(trace);
+}
+
+std::unique_ptr<TraceNetworkModel> TraceNetworkModel::CreateFromString(
+    absl::string_view trace) {
+  std::map<int, std::optional<absl::Duration>> arrival_times;
+  int line_number = 0;
+  for (absl::string_view line : absl::StrSplit(trace, '\n')) {
+    ++line_number;
+    line = absl::StripAsciiWhitespace(line);
+    if (line.empty() || absl::StartsWith(line, "#")) {
+      continue;
+    }
+    const std::vector<absl::string_view> fields =
+        absl::StrSplit(line, absl::ByAnyChar(" \t"), absl::SkipEmpty());
+    int sequence_number;
+    if (fields.size() != 2 || !absl::SimpleAtoi(fields[0], &sequence_number) ||
+        sequence_number < 0) {
+      LOG(ERROR) << "Could not parse line " << line_number
+                 << " of network trace: " << line;
+      return nullptr;
+    }
+    std::optional<absl::Duration> arrival_time;
+    if (fields[1] != "lost") {
+      double arrival_time_ms;
+      if (!absl::SimpleAtod(fields[1], &arrival_time_ms) ||
+          arrival_time_ms < 0.0) {
+        LOG(ERROR) << "Could not parse arrival time on line " << line_number
+                   << " of network trace: " << line;
+        return nullptr;
+      }
+      arrival_time = absl::Milliseconds(arrival_time_ms);
+    }
+    arrival_times[sequence_number] = arrival_time;
+  }
+  return absl::WrapUnique(new TraceNetworkModel(std::move(arrival_times)));
+}
+
+TraceNetworkModel::TraceNetworkModel(
+    std::map<int, std::optional<absl::Duration>> arrival_times)
+    : arrival_times_(std::move(arrival_times)), next_sequence_number_(0) {}
+
+std::optional<absl::Duration> TraceNetworkModel::SendPacket(
+    absl::Duration send_time) {
+  const auto arrival_time = arrival_times_.find(next_sequence_number_++);
+  if (arrival_time == arrival_times_.end()) {
+    return std::nullopt;
+  }
+  return arrival_time->second;
+}
+
+}  // namespace codec
+}  // namespace chromemedia
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2021 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LYRA_CODEC_TRACE_NETWORK_MODEL_H_
+#define LYRA_CODEC_TRACE_NETWORK_MODEL_H_
+
+#include <map>
+#include <memory>
+#include <optional>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "include/ghc/filesystem.hpp"
+#include "network_impairment_model_interface.h"
+
+namespace chromemedia {
+namespace codec {
+
+// Replays the arrival times of a recorded packet trace.
+//
+// The trace is a text file with one packet per line, in the form
+//   <sequence number> <arrival time in milliseconds>
+// or
+//   <sequence number> lost
+// Arrival times are measured from the time packet 0 was sent. Sequence numbers
+// start at 0 and may be listed in any order. Empty lines and lines starting
+// with '#' are ignored. Packets missing from the trace are treated as lost.
+class TraceNetworkModel : public NetworkImpairmentModelInterface {
+ public:
+  // Returns a nullptr if the file can not be read or parsed.
+  static std::unique_ptr<TraceNetworkModel> Create(
+      const ghc::filesystem::path& trace_path);
+
+  // Same as |Create|, but parses the trace from |trace|.
+  static std::unique_ptr<TraceNetworkModel> CreateFromString(
+      absl::string_view trace);
+
+  // The |send_time| is ignored, since the trace already contains the arrival
+  // times.
+  std::optional<absl::Duration> SendPacket(absl::Duration send_time) override;
+
+ private:
+  explicit TraceNetworkModel(
+      std::map<int, std::optional<absl::Duration>> arrival_times);
+
+  // Keyed by sequence number. A map, so a trace can not make the model
+  // allocate for sequence numbers it does not list.
+  const std::map<int, std::optional<absl::Duration>> arrival_times_;
+  int next_sequence_number_;
+};
+
+}  // namespace codec
+}  // namespace chromemedia
+
+#endif  // LYRA_CODEC_TRACE_NETWORK_MODEL_H_
@@ -0,0 +1,87 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "trace_network_model.h"
+
+#include <fstream>
+#include <optional>
+#include <string>
+
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+#include "include/ghc/filesystem.hpp"
+
+namespace chromemedia {
+namespace codec {
+namespace {
+
+TEST(TraceNetworkModelTest, ReplaysArrivalTimes) {
+  auto model = TraceNetworkModel::CreateFromString(
+      "# sequence arrival_ms\n"
+      "0 25\n"
+      "1 lost\n"
+      "\n"
+      "3 70.5\n"
+      "2 90\n");
+  ASSERT_NE(nullptr, model);
+  EXPECT_EQ(model->SendPacket(absl::ZeroDuration()), absl::Milliseconds(25));
+  EXPECT_EQ(model->SendPacket(absl::Milliseconds(20)), std::nullopt);
+  EXPECT_EQ(model->SendPacket(absl::Milliseconds(40)), absl::Milliseconds(90));
+  EXPECT_EQ(model->SendPacket(absl::Milliseconds(60)),
+            absl::Milliseconds(70.5));
+  // Packets past the end of the trace are lost.
+  EXPECT_EQ(model->SendPacket(absl::Milliseconds(80)), std::nullopt);
+}
+
+TEST(TraceNetworkModelTest, MissingSequenceNumbersAreLost) {
+  auto model = TraceNetworkModel::CreateFromString("2 50\n");
+  ASSERT_NE(nullptr, model);
+  EXPECT_EQ(model->SendPacket(absl::ZeroDuration()), std::nullopt);
+  EXPECT_EQ(model->SendPacket(absl::Milliseconds(20)), std::nullopt);
+  EXPECT_EQ(model->SendPacket(absl::Milliseconds(40)), absl::Milliseconds(50));
+}
+
+TEST(TraceNetworkModelTest, LargeSequenceNumbersOnlyCostTheirLine) {
+  auto model = TraceNetworkModel::CreateFromString("0 20\n2147483647 30\n");
+  ASSERT_NE(nullptr, model);
+  EXPECT_EQ(model->SendPacket(absl::ZeroDuration()), absl::Milliseconds(20));
+  EXPECT_EQ(model->SendPacket(absl::Milliseconds(20)), std::nullopt);
+}
+
+TEST(TraceNetworkModelTest, RejectsMalformedLines) {
+  EXPECT_EQ(nullptr, TraceNetworkModel::CreateFromString("0\n"));
+  EXPECT_EQ(nullptr, TraceNetworkModel::CreateFromString("0 soon\n"));
+  EXPECT_EQ(nullptr, TraceNetworkModel::CreateFromString("-1 20\n"));
+  EXPECT_EQ(nullptr, TraceNetworkModel::CreateFromString("0 20 30\n"));
+}
+
+TEST(TraceNetworkModelTest, ReadsTraceFromFile) {
+  const ghc::filesystem::path trace_path =
+      ghc::filesystem::path(testing::TempDir()) / "network_trace.txt";
+  std::ofstream trace(trace_path.string());
+  trace << "0 40\n1 lost\n";
+  trace.close();
+  auto model = TraceNetworkModel::Create(trace_path);
+  ASSERT_NE(nullptr, model);
+  EXPECT_EQ(model->SendPacket(absl::ZeroDuration()), absl::Milliseconds(40));
+  EXPECT_EQ(model->SendPacket(absl::Milliseconds(20)), std::nullopt);
+
+  EXPECT_EQ(nullptr, TraceNetworkModel::Create(
+                         ghc::filesystem::path(testing::TempDir()) /
+                         "does_not_exist.txt"));
+}
+
+}  // namespace
+}  // namespace codec
+}  // namespace chromemedia